@@ -18,23 +18,72 @@ void intvec_free(intvec_t *iv);
 // Feed model
 typedef struct {
     char name[POC_MAX_FEED];
-    intvec_t subs; // fds subscribed
+    uint32_t hash;  // FNV-1a of name, checked before strcmp
+    intvec_t subs;  // fds subscribed, by name or through a pattern
+    intvec_t exact; // fds subscribed by name
+    /* retained last value: a publish marked "retain":true, replayed to new subscribers */
+    char *ret_json;
+    size_t ret_len;
+    int ret_fds[16];   // broker-owned dups of the attached descriptors
+    size_t ret_nfds;
+    int ret_owner;     // publishing fd; the value is dropped when it disconnects
 } feed_t;
 
+/* Feeds are interned: a name maps to a stable index into v[] through an
+ * open-addressing hash (linear probing, power-of-two slots). Feeds are never
+ * removed, so indices stay valid and no tombstones are needed. byfd[fd] lists
+ * the feed indices an fd is subscribed to, so disconnect cleanup only visits
+ * that client's subscriptions.
+ *
+ * Pattern subscriptions live in a trie over '.'-separated segments ("*" is one
+ * segment, a trailing ">" one or more). They are expanded into ordinary
+ * subscribers: for existing feeds when the pattern is added, and for new feeds
+ * by one trie walk in feedtab_ensure, so routing never evaluates patterns. */
+struct feedpat;
 typedef struct {
     feed_t *v;
     size_t n, cap;
+    int *slots;         // feed index or -1, slot_cap entries
+    size_t slot_cap;
+    intvec_t *byfd;     // reverse index, byfd_cap entries
+    size_t byfd_cap;
+    size_t n_retained;
+    struct feedpat *pats;  // pattern trie root (NULL until the first pattern)
+    size_t n_patsubs;      // live (pattern, fd) pairs
+    uint64_t gen;       // bumped whenever feeds or subscriptions change
     pthread_mutex_t mu;
 } feedtab_t;
 
+uint32_t feedtab_hash(const char *name);  // the FNV-1a used for slots
 void feedtab_init(feedtab_t *t);
 void feedtab_free(feedtab_t *t);
 int  feedtab_find(feedtab_t *t, const char *name);
 int  feedtab_ensure(feedtab_t *t, const char *name);
-void feedtab_sub(feedtab_t *t, const char *name, int fd);
+int  feedtab_sub(feedtab_t *t, const char *name, int fd);  // 1 if newly subscribed
 void feedtab_unsub_all_fd(feedtab_t *t, int fd);
 void feedtab_unsub(feedtab_t *t, const char *name, int fd);
-void feedtab_list(feedtab_t *t, int fd);
+/* Pattern subscriptions. feedtab_is_pattern: some segment is "*" or ">".
+ * feedtab_sub_pattern returns 1 if new, 0 if fd already had it, -1 if the
+ * pattern is malformed; indices of feeds that gained fd are appended to added
+ * (may be NULL) so the caller can replay retained values. */
+int  feedtab_is_pattern(const char *name);
+int  feedtab_sub_pattern(feedtab_t *t, const char *pattern, int fd, intvec_t *added);
+void feedtab_unsub_pattern(feedtab_t *t, const char *pattern, int fd);
+int  feedtab_pattern_matches(feedtab_t *t, const char *name);  // 1 if any pattern covers name
+/* Retained values: feedtab_retain dups fds; feedtab_retained hands back a malloc'd
+ * copy of the JSON plus fresh dups (caller frees/closes). */
+int  feedtab_retain(feedtab_t *t, const char *name, int owner, const char *json, size_t len,
+                    const int *fds, size_t nfds);
+int  feedtab_retained(feedtab_t *t, const char *name, char **json, size_t *len,
+                      int *fds, size_t *nfds);
+void feedtab_drop_retained_fd(feedtab_t *t, int fd);
+/* one info frame per feed, delivered through sendf (the broker's non-blocking writer) */
+void feedtab_list(feedtab_t *t, int fd, int (*sendf)(int fd, const char *json, size_t len));
+/* copy up to cap subscriber fds of a feed; returns the feed's total subscriber count */
+size_t feedtab_snapshot_subs(feedtab_t *t, const char *name, int *out, size_t cap);
+/* same, addressed by interned feed index; also copies the name (empty if idx is unknown) */
+size_t feedtab_snapshot_subs_idx(feedtab_t *t, int idx, char *name, size_t namecap,
+                                 int *out, size_t cap);
 
 // JSON tiny helpers
 int json_get_string(const char *json, const char *key, char *out, size_t outcap);
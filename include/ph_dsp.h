@@ -1,4 +1,5 @@
 #pragma once
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -14,6 +15,40 @@ typedef struct ph_dsp_nco_f32 {
 void ph_dsp_nco_f32_init(ph_dsp_nco_f32_t *nco, double fs_hz, double freq_hz, double phase_rad);
 void ph_dsp_nco_f32_set_freq(ph_dsp_nco_f32_t *nco, double fs_hz, double freq_hz);
 void ph_dsp_nco_f32_next(ph_dsp_nco_f32_t *nco, float *c, float *s);
+/* Fill n consecutive oscillator values into planar c[]/s[] (block form of _next). */
+void ph_dsp_nco_f32_fill(ph_dsp_nco_f32_t *nco, float *c, float *s, size_t n);
+
+/* Widen n complex frames of ring data (PHIQ_FMT_*) to interleaved CF32 at
+   full scale +-1.0. Straight elementwise loops the compiler vectorizes.
+   Returns n, or 0 for an unknown format. CF32 input is copied. */
+size_t ph_dsp_iq_to_cf32(uint32_t fmt, const void *src, float *dst, size_t n);
+
+/* Fractional polyphase resampler for interleaved float frames.
+   A windowed-sinc bank of nphases+1 phases x ntaps taps is interpolated
+   linearly between neighbouring phases, so any ratio works and the ratio
+   can be retuned on the fly (clock steering) without rebuilding the bank.
+   The anti-alias cutoff is fixed at init from fs_in/fs_out. */
+typedef struct ph_dsp_resamp_f32 {
+    float   *bank;              /* (nphases+1) * ntaps coefficients */
+    int      ntaps, nphases;
+    unsigned channels;
+    float   *hist;              /* interleaved input frames not yet consumed */
+    size_t   hist_n, hist_cap;  /* frames */
+    double   pos;               /* next output position, frames from hist[0] */
+    double   step;              /* input frames per output frame (fs_in/fs_out) */
+} ph_dsp_resamp_f32_t;
+
+int    ph_dsp_resamp_f32_init(ph_dsp_resamp_f32_t *r, unsigned channels,
+                              double fs_in, double fs_out, int ntaps);
+void   ph_dsp_resamp_f32_free(ph_dsp_resamp_f32_t *r);
+void   ph_dsp_resamp_f32_reset(ph_dsp_resamp_f32_t *r);
+/* ratio = fs_out/fs_in; small adjustments do not touch the filter bank. */
+void   ph_dsp_resamp_f32_set_ratio(ph_dsp_resamp_f32_t *r, double ratio);
+/* Upper bound on frames produced by the next process() call for n_in frames. */
+size_t ph_dsp_resamp_f32_max_out(const ph_dsp_resamp_f32_t *r, size_t n_in);
+/* Returns frames written to out (<= out_cap); unused input stays buffered. */
+size_t ph_dsp_resamp_f32_process(ph_dsp_resamp_f32_t *r, const float *in, size_t n_in,
+                                 float *out, size_t out_cap);
 
 /* In-place radix-2 DIT complex FFT.
    buf: interleaved CF32 [re,im,...], N elements, N must be a power of 2.
@@ -141,6 +141,8 @@ static inline ph_timestamp_v0_t ph_file_block_timestamp(const ph_file_block_hdr_
 static inline uint32_t ph_stream_encoding_from_iq_fmt(uint32_t fmt) {
     if (fmt == PHIQ_FMT_CF32) return PH_STREAM_ENCODING_CF32;
     if (fmt == PHIQ_FMT_CS16) return PH_STREAM_ENCODING_CS16;
+    if (fmt == PHIQ_FMT_CU8)  return PH_STREAM_ENCODING_CU8;
+    if (fmt == PHIQ_FMT_CS8)  return PH_STREAM_ENCODING_CS8;
     return PH_STREAM_ENCODING_UNKNOWN;
 }
 
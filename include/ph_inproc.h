@@ -0,0 +1,40 @@
+#pragma once
+/* In-process broker endpoints (plugin ABI >= 1.1, PH_CORE_FEAT_INPROC).
+ *
+ * Addons dlopen'ed into ph-core reach the broker through a pair of lock-free
+ * frame queues instead of a UDS round-trip through the kernel. A frame is the
+ * same JSON (or binary) payload the socket would carry, plus up to 16
+ * descriptors that are dup'd on send exactly like SCM_RIGHTS.
+ *
+ * Addons normally never call this table directly: PH_ENSURE_ABI hands it to
+ * ph_inproc_use(), after which ph_connect_retry() to the core's socket path
+ * returns an in-process endpoint and the framing helpers route through it.
+ * The returned fd is an eventfd owned by the endpoint; release it with
+ * ph_conn_close(), never close(). */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct ph_inproc_ep ph_inproc_ep_t;
+
+typedef struct ph_inproc_api {
+    uint32_t api_size;    /* sizeof(ph_inproc_api_t) seen by core */
+    /* new endpoint; *fd_out receives its handle (a pollable eventfd) */
+    ph_inproc_ep_t *(*open)(const char *name, int *fd_out);
+    /* one frame = head (may be NULL) followed by body; 0 on success,
+     * -1 when closed or the queue is still full after timeout_ms */
+    int  (*send)(ph_inproc_ep_t *ep, const void *head, size_t hlen,
+                 const void *body, size_t len, bool bin,
+                 const int *fds, size_t nfds, int timeout_ms);
+    /* payload length (NUL-terminated in buf), or -1 on timeout, close, or a
+     * frame too large for cap (dropped). *nfds is capacity in, count out. */
+    int  (*recv)(ph_inproc_ep_t *ep, void *buf, size_t cap, bool *bin,
+                 int *fds, size_t *nfds, int timeout_ms);
+    void (*close)(ph_inproc_ep_t *ep);
+} ph_inproc_api_t;
+
+/* addon side (common.c) */
+/* route connections to sock_path through api (NULL disables) */
+void ph_inproc_use(const ph_inproc_api_t *api, const char *sock_path, const char *name);
+/* close a broker connection from ph_connect_retry(), in-process or not */
+int  ph_conn_close(int fd);
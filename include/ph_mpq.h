@@ -0,0 +1,89 @@
+#pragma once
+/* Bounded lock-free multi-producer/multi-consumer pointer queue.
+ *
+ * Vyukov's array queue: every cell carries a sequence number, so producers
+ * and consumers claim slots with one CAS on their own cursor and never touch
+ * each other's cache line on the fast path. Capacity is a power of two.
+ * Header-only so every module (core and each addon .so) can use it. */
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef struct {
+    atomic_size_t seq;
+    void         *p;
+} ph_mpq_cell_t;
+
+typedef struct {
+    ph_mpq_cell_t *cells;
+    size_t         mask;
+    _Alignas(64) atomic_size_t tail;   /* producers */
+    _Alignas(64) atomic_size_t head;   /* consumers */
+} ph_mpq_t;
+
+static inline int ph_mpq_init(ph_mpq_t *q, size_t cap_pow2){
+    size_t cap = 2;
+    while(cap < cap_pow2) cap <<= 1;
+    q->cells = (ph_mpq_cell_t*)calloc(cap, sizeof *q->cells);
+    if(!q->cells) return -1;
+    for(size_t i = 0; i < cap; i++) atomic_init(&q->cells[i].seq, i);
+    q->mask = cap - 1;
+    atomic_init(&q->tail, 0);
+    atomic_init(&q->head, 0);
+    return 0;
+}
+
+static inline void ph_mpq_free(ph_mpq_t *q){ free(q->cells); q->cells = NULL; }
+
+/* false when full */
+static inline bool ph_mpq_push(ph_mpq_t *q, void *p){
+    size_t pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    for(;;){
+        ph_mpq_cell_t *c = &q->cells[pos & q->mask];
+        size_t seq = atomic_load_explicit(&c->seq, memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+        if(dif == 0){
+            if(atomic_compare_exchange_weak_explicit(&q->tail, &pos, pos + 1,
+                                                     memory_order_relaxed, memory_order_relaxed)){
+                c->p = p;
+                atomic_store_explicit(&c->seq, pos + 1, memory_order_release);
+                return true;
+            }
+        } else if(dif < 0){
+            return false;
+        } else {
+            pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+        }
+    }
+}
+
+/* NULL when empty */
+static inline void *ph_mpq_pop(ph_mpq_t *q){
+    size_t pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+    for(;;){
+        ph_mpq_cell_t *c = &q->cells[pos & q->mask];
+        size_t seq = atomic_load_explicit(&c->seq, memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+        if(dif == 0){
+            if(atomic_compare_exchange_weak_explicit(&q->head, &pos, pos + 1,
+                                                     memory_order_relaxed, memory_order_relaxed)){
+                void *p = c->p;
+                atomic_store_explicit(&c->seq, pos + q->mask + 1, memory_order_release);
+                return p;
+            }
+        } else if(dif < 0){
+            return NULL;
+        } else {
+            pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+        }
+    }
+}
+
+/* approximate number of queued entries (exact when both sides are quiet) */
+static inline size_t ph_mpq_depth(ph_mpq_t *q){
+    size_t h = atomic_load_explicit(&q->head, memory_order_relaxed);
+    size_t t = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    return t > h ? t - h : 0;
+}
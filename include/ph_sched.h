@@ -0,0 +1,36 @@
+#pragma once
+/* Core-managed worker threads (plugin ABI >= 1.3, PH_CORE_FEAT_SCHED).
+ *
+ * Addons name their threads and say what kind of work they do; ph-core then
+ * places them: CPU affinity per class or per thread from its scheduler
+ * config (isolcpus-aware by default), SCHED_FIFO/RR or nice where configured,
+ * and per-thread CPU accounting for the `threads` command.
+ *
+ * Addons normally never call this table directly: PH_ENSURE_ABI hands it to
+ * ph_sched_use(), after which ph_thread_start() creates threads through it.
+ * Without a core (or an older one) ph_thread_start() is pthread_create() plus
+ * a thread name. The thread is an ordinary pthread either way: the addon
+ * still joins it in plugin_stop(). */
+#include <pthread.h>
+#include <stdint.h>
+
+typedef enum {
+    PH_WORKER_RT_IO      = 0,   /* paced by hardware: SDR RX, ALSA playback */
+    PH_WORKER_DSP        = 1,   /* sustained compute on stream data */
+    PH_WORKER_BACKGROUND = 2,   /* control, disk I/O, housekeeping */
+} ph_worker_class_t;
+
+typedef struct ph_sched_api {
+    uint32_t api_size;    /* sizeof(ph_sched_api_t) seen by core */
+    /* like pthread_create(); name is "<addon>.<worker>", cls a ph_worker_class_t.
+     * Placement is applied on the new thread before fn runs. */
+    int (*spawn)(pthread_t *t, const char *name, uint32_t cls,
+                 void *(*fn)(void *), void *arg);
+} ph_sched_api_t;
+
+/* addon side (common.c) */
+/* create threads through api from now on (NULL: plain pthreads); owner prefixes names */
+void ph_sched_use(const ph_sched_api_t *api, const char *owner);
+/* pthread_create() for a named worker; 0 or an errno value */
+int  ph_thread_start(pthread_t *t, const char *name, ph_worker_class_t cls,
+                     void *(*fn)(void *), void *arg);
@@ -0,0 +1,82 @@
+#pragma once
+// PhaseHound — broker stats page ("phasehound.stats.v0", 1.0)
+//
+// ph-core keeps its routing counters directly in one shared-memory page and
+// announces the memfd as a retained publish on feed "core.stats":
+//   {"type":"publish","feed":"core.stats","subtype":"shm_map",
+//    "proto":"phasehound.stats.v0","size":<bytes>,"mode":"r", ...}
+// A scraper subscribes once, mmaps the descriptor PROT_READ and reads from
+// then on without talking to the broker. Every counter is a naturally aligned
+// 64-bit atomic written with relaxed increments; totals are monotonic.
+//
+// Feeds are append-only: entries [0, nfeeds) carry a name and never move, and
+// the index equals the broker's feed id. Client slots are indexed by fd and
+// reused; read a slot under its seq (even and unchanged before/after a copy)
+// and skip it unless active is set.
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PH_STATS_MAGIC    0x50485354u /* 'PHST' */
+#define PH_STATS_VMAJOR   1
+#define PH_STATS_VMINOR   0
+#define PH_STATS_FEEDS    65536       /* feed ids past this are counted in totals only */
+#define PH_STATS_CLIENTS  65536       /* fds past this are not tracked */
+#define PH_STATS_HIST     32          /* bucket i: [2^i, 2^(i+1)) ns, last one open-ended */
+#define PH_STATS_NAME     64
+#define PH_STATS_FEED     "core.stats"
+#define PH_STATS_PROTO    "phasehound.stats.v0"
+
+typedef struct {
+    char             name[PH_STATS_NAME];
+    _Atomic uint64_t pubs;         /* publishes routed */
+    _Atomic uint64_t bytes;        /* frame body bytes published */
+    _Atomic uint64_t fds;          /* descriptors attached to publishes */
+    _Atomic uint64_t deliveries;   /* frames handed to subscribers (fan-out) */
+} ph_stats_feed_t;
+
+enum { PH_STATS_LINK_UDS = 0, PH_STATS_LINK_INPROC = 1 };
+
+typedef struct {
+    _Atomic uint32_t seq;          /* odd while the slot is being reset */
+    _Atomic uint32_t active;
+    uint32_t         loop;         /* owning event loop */
+    uint32_t         link;         /* PH_STATS_LINK_* */
+    _Atomic uint64_t tx_frames, tx_bytes;   /* written to the client (incl. length prefix) */
+    _Atomic uint64_t rx_frames, rx_bytes;   /* read from it */
+    _Atomic uint64_t blocked_ns;   /* time spent waiting for the socket to drain (EPOLLOUT armed) */
+    _Atomic uint64_t dropped;      /* frames dropped or coalesced by the queue policy */
+} ph_stats_client_t;
+
+typedef struct {
+    uint32_t         magic;        /* PH_STATS_MAGIC */
+    uint16_t         ver_major;
+    uint16_t         ver_minor;
+    uint32_t         feeds_cap;    /* PH_STATS_FEEDS */
+    uint32_t         clients_cap;  /* PH_STATS_CLIENTS */
+    uint64_t         page_bytes;
+    uint64_t         feeds_off;    /* byte offset of ph_stats_feed_t[feeds_cap] */
+    uint64_t         clients_off;  /* byte offset of ph_stats_client_t[clients_cap] */
+    uint64_t         start_ns;     /* CLOCK_MONOTONIC at broker start */
+    _Atomic uint32_t nfeeds;       /* named feed entries */
+    uint32_t         _pad;
+    _Atomic uint64_t pubs, bytes, fds, deliveries;
+    _Atomic uint64_t route_n;      /* publishes timed */
+    _Atomic uint64_t route_ns;     /* sum of routing time */
+    _Atomic uint64_t route_hist[PH_STATS_HIST];
+} ph_stats_hdr_t;
+
+static inline ph_stats_feed_t *ph_stats_feeds(const ph_stats_hdr_t *h){
+    return (ph_stats_feed_t*)((char*)h + h->feeds_off);
+}
+static inline ph_stats_client_t *ph_stats_clients(const ph_stats_hdr_t *h){
+    return (ph_stats_client_t*)((char*)h + h->clients_off);
+}
+
+#ifdef __cplusplus
+}
+#endif
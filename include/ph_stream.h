@@ -37,7 +37,9 @@ typedef enum {
     PH_STREAM_ENCODING_S16     = 4,  /* scalar int16 PCM     */
     PH_STREAM_ENCODING_HEX     = 5,  /* ASCII hex frames     */
     PH_STREAM_ENCODING_JSON    = 6,  /* JSON objects         */
-    PH_STREAM_ENCODING_UTF8    = 7   /* plain UTF-8 text     */
+    PH_STREAM_ENCODING_UTF8    = 7,  /* plain UTF-8 text     */
+    PH_STREAM_ENCODING_CU8     = 8,  /* complex uint8 IQ (offset 127.5) */
+    PH_STREAM_ENCODING_CS8     = 9   /* complex int8 IQ      */
 } ph_stream_encoding_t;
 
 /* ---- IQ ring v0 ----------------------------------------------------- */
@@ -51,9 +53,33 @@ enum {
 
 typedef enum {
     PHIQ_FMT_CF32 = 1, /* interleaved I,Q float32 (8 bytes/frame) */
-    PHIQ_FMT_CS16 = 2  /* interleaved I,Q int16  (4 bytes/frame) */
+    PHIQ_FMT_CS16 = 2, /* interleaved I,Q int16  (4 bytes/frame) */
+    PHIQ_FMT_CU8  = 3, /* interleaved I,Q uint8, zero at 127.5 (2 bytes/frame): RTL-SDR native */
+    PHIQ_FMT_CS8  = 4  /* interleaved I,Q int8   (2 bytes/frame) */
 } phiq_fmt_t;
 
+/* bytes per complex frame; 0 for an unknown format */
+static inline uint32_t phiq_fmt_bytes(uint32_t fmt) {
+    switch (fmt) {
+    case PHIQ_FMT_CF32: return 8u;
+    case PHIQ_FMT_CS16: return 4u;
+    case PHIQ_FMT_CU8:
+    case PHIQ_FMT_CS8:  return 2u;
+    default:            return 0u;
+    }
+}
+
+/* the "encoding" string of shm_map descriptors */
+static inline const char *phiq_fmt_name(uint32_t fmt) {
+    switch (fmt) {
+    case PHIQ_FMT_CF32: return "cf32";
+    case PHIQ_FMT_CS16: return "cs16";
+    case PHIQ_FMT_CU8:  return "cu8";
+    case PHIQ_FMT_CS8:  return "cs8";
+    default:            return "unknown";
+    }
+}
+
 typedef struct {
     uint32_t magic;           /* PHIQ_MAGIC */
     uint32_t version;         /* PHIQ_VERSION */
@@ -29,7 +29,10 @@ typedef enum {
 } log_level_t;
 
 // Utilities (implemented in common.c)
-void log_msg(log_level_t lvl, const char *fmt, ...);
+void log_msg(log_level_t lvl, const char *fmt, ...);   // queued; written by a background thread
+void log_set_level(log_level_t lvl);                   // default: PH_LOG_LEVEL env, else debug
+int  log_parse_level(const char *s, log_level_t *out); // "debug" | "info" | "warn" | "error"
+void log_flush(int timeout_ms);                        // wait for queued lines to be written
 int  set_nonblock(int fd);
 int  uds_listen_create(const char *path);
 int  uds_connect(const char *path);
@@ -44,9 +47,43 @@ size_t b64_decoded_maxlen(size_t b64_len);
 int    b64_encode(const uint8_t *in, size_t inlen, char *out, size_t *outlen);
 int    b64_decode(const char *in, size_t inlen, uint8_t *out, size_t *outlen);
 
+// Binary frames (negotiated, see docs/PROTOCOL.md):
+// [u32 BE length | PH_FRAME_BIN][8-byte ph_bin header][opaque payload]
+// A client opts in with {"type":"hello","bin":1}; the broker then routes its
+// binary publishes on feed_id alone and never parses the payload. Feed ids
+// come from {"type":"feed_id","feed":"name"} and stay valid for the broker's
+// lifetime.
+#define PH_FRAME_BIN       0x80000000u
+#define PH_FRAME_LEN_MASK  0x7fffffffu
+#define PH_BIN_HDR_LEN     8
+enum { PH_BIN_VERSION = 1 };
+enum { PH_BIN_OP_PUBLISH = 1, PH_BIN_OP_ACK = 2 };
+enum { PH_BIN_F_ACK = 1u << 0 };   // publisher wants a PH_BIN_OP_ACK back
+
+typedef struct {
+    uint8_t  version;   // PH_BIN_VERSION
+    uint8_t  op;        // PH_BIN_OP_*
+    uint16_t flags;     // PH_BIN_F_*
+    uint32_t feed_id;
+} ph_bin_hdr_t;
+
+void ph_bin_hdr_pack(uint8_t out[PH_BIN_HDR_LEN], const ph_bin_hdr_t *h);
+int  ph_bin_hdr_unpack(const uint8_t *in, size_t len, ph_bin_hdr_t *h);
+
 #endif // POC_PROTOCOL_H
 
 
 // --- FD-passing (SCM_RIGHTS) helpers ---
 int send_frame_json_with_fds(int fd, const char *json_str, size_t len, const int *fds, size_t nfds);
 int recv_frame_json_with_fds(int fd, char *json_out, size_t outcap, int *fds_out, size_t *nfds_inout, int timeout_ms);
+
+// --- binary frames (after ph_bin_hello) ---
+int send_frame_bin(int fd, const ph_bin_hdr_t *h, const void *payload, size_t len,
+                   const int *fds, size_t nfds);
+// Receives either frame kind; *is_bin tells which. JSON is NUL-terminated,
+// binary frames start with the packed ph_bin header.
+int recv_frame_any_with_fds(int fd, char *out, size_t outcap, int *is_bin,
+                            int *fds_out, size_t *nfds_inout, int timeout_ms);
+// Blocking handshakes, meant for right after connect.
+int ph_bin_hello(int fd, int timeout_ms);
+int ph_feed_id(int fd, const char *feed, uint32_t *id_out, int timeout_ms);
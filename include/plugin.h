@@ -2,18 +2,26 @@
 #define PLUGIN_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include "ph_inproc.h"
+#include "ph_sched.h"
+#include "ph_time.h"
 
 /* ================================
- * PhaseHound Plugin ABI v1.0
+ * PhaseHound Plugin ABI v1.3
  * - Split MAJOR/MINOR
  * - Size fields for ctx/caps
  * - Feature bits (lightweight)
  * - Inline ABI check + macro
+ * - 1.1: in-process broker endpoints (ctx->inproc)
+ * - 1.2: optional plugin_process/plugin_fuse for fused pipelines
+ * - 1.3: core-managed worker threads (ctx->sched); addons export
+ *        plugin_abi_minor so older addons get a context they accept
  * ================================ */
 
 #define PLUGIN_ABI_MAJOR 1
-#define PLUGIN_ABI_MINOR 0
+#define PLUGIN_ABI_MINOR 3
 
 enum {
     PH_FEAT_NONE = 0u,
@@ -23,15 +31,29 @@ enum {
     /* reserve future bits here */
 };
 
+/* ctx->core_features */
+enum {
+    PH_CORE_FEAT_INPROC  = 1u << 0,  /* ctx->inproc is valid (ABI >= 1.1) */
+    PH_CORE_FEAT_PROCESS = 1u << 1,  /* core may fuse plugin_process into a pipeline (ABI >= 1.2) */
+    PH_CORE_FEAT_SCHED   = 1u << 2,  /* ctx->sched is valid (ABI >= 1.3) */
+};
+
 typedef struct plugin_ctx {
     uint16_t     abi_major;     /* must equal PLUGIN_ABI_MAJOR */
-    uint16_t     abi_minor;     /* must be <= PLUGIN_ABI_MINOR */
+    uint16_t     abi_minor;     /* min(core, addon) minor; newer fields are gated on it */
     uint32_t     ctx_size;      /* sizeof(plugin_ctx_t) seen by core */
     const char  *sock_path;     /* UDS broker path */
     const char  *name;          /* logical addon name */
-    uint32_t     core_features; /* reserved bitset for future use */
+    uint32_t     core_features; /* PH_CORE_FEAT_* bitset */
+    /* ---- 1.1 ---- */
+    const ph_inproc_api_t *inproc; /* in-process endpoints (PH_CORE_FEAT_INPROC) */
+    /* ---- 1.3 ---- */
+    const ph_sched_api_t  *sched;  /* worker placement (PH_CORE_FEAT_SCHED) */
 } plugin_ctx_t;
 
+/* smallest ctx a 1.x core hands out */
+#define PH_CTX_SIZE_V1_0 offsetof(plugin_ctx_t, inproc)
+
 typedef struct plugin_caps {
     uint32_t           caps_size;   /* sizeof(plugin_caps_t) from plugin */
     const char        *name;        /* addon name (human/log) */
@@ -41,20 +63,89 @@ typedef struct plugin_caps {
     uint32_t           feat_bits;   /* PH_FEAT_* bitset */
 } plugin_caps_t;
 
+/* ---- 1.2: fused pipelines ----
+ * `pipeline a b c` makes ph-core call plugin_process() of each stage in turn
+ * on one worker thread, handing stage N's output block to stage N+1.
+ * The first stage gets in->n == 0 and reads its own input (device, file,
+ * subscribed ring); the last gets out->n == 0 and delivers its result the way
+ * it normally would (its ring). In between, out->v[0].data points at a core
+ * buffer of out->v[0].cap bytes; a stage sets bytes (0 is fine: nothing this
+ * round) or repoints data at memory of its own, valid until its next call.
+ * Return 0, or -1 to stop the pipeline. */
+
+enum { PH_SPAN_NONE = 0, PH_SPAN_IQ = 1, PH_SPAN_PCM = 2 };
+
+typedef struct ph_span {
+    void              *data;
+    size_t             bytes;        /* valid bytes */
+    size_t             cap;          /* writable bytes at data (output spans) */
+    uint32_t           kind;         /* PH_SPAN_* */
+    uint32_t           fmt;          /* PHIQ_FMT_* / PHAU_FMT_* */
+    uint32_t           channels;
+    double             sample_rate;
+    ph_timestamp_v0_t  ts;           /* first sample, if known */
+} ph_span_t;
+
+typedef struct ph_spans {
+    ph_span_t *v;
+    uint32_t   n;
+} ph_spans_t;
+
+/* ---- 1.3: the addon's minor ----
+ * Addons before 1.3 refuse a context whose minor is newer than their own, and
+ * do not export this; the core hands them a 1.0 context (no inproc, no
+ * sched). Defined weak here so every translation unit that includes this
+ * header may carry it; the core looks it up with dlsym. */
+__attribute__((weak, visibility("default")))
+const uint16_t plugin_abi_minor = PLUGIN_ABI_MINOR;
+
 typedef const char* (*plugin_name_fn)(void);
 typedef bool        (*plugin_init_fn)(const plugin_ctx_t*, plugin_caps_t* out_caps);
 typedef bool        (*plugin_start_fn)(void);
 typedef void        (*plugin_stop_fn)(void);
+/* both optional, both or neither: plugin_fuse(true) before the first
+ * plugin_process() call parks the addon's own worker, plugin_fuse(false)
+ * after the last one resumes it; returning false refuses the pipeline */
+typedef int         (*plugin_process_fn)(const plugin_ctx_t*, const ph_spans_t *in, ph_spans_t *out);
+typedef bool        (*plugin_fuse_fn)(bool on);
 
+/* Minor versions only append to plugin_ctx_t, so any 1.x core is accepted;
+ * fields past the 1.0 layout are read through the accessors below. */
 static inline bool ph_check_abi(const plugin_ctx_t *ctx) {
     if (!ctx) return false;
     if (ctx->abi_major != PLUGIN_ABI_MAJOR) return false;
-    if (ctx->abi_minor >  PLUGIN_ABI_MINOR) return false;
-    if (ctx->ctx_size  <  sizeof(plugin_ctx_t)) return false;
+    if (ctx->ctx_size  <  PH_CTX_SIZE_V1_0) return false;
     return true;
 }
 
-/* Must be called at the very top of plugin_init() */
-#define PH_ENSURE_ABI(ctx) do { if(!ph_check_abi((ctx))) return false; } while(0)
+static inline const ph_inproc_api_t *ph_ctx_inproc(const plugin_ctx_t *ctx) {
+    if (ctx->abi_minor < 1 || ctx->ctx_size < offsetof(plugin_ctx_t, inproc) + sizeof ctx->inproc)
+        return NULL;
+    if (!(ctx->core_features & PH_CORE_FEAT_INPROC) || !ctx->inproc) return NULL;
+    if (ctx->inproc->api_size < sizeof(ph_inproc_api_t)) return NULL;
+    return ctx->inproc;
+}
+
+static inline const ph_sched_api_t *ph_ctx_sched(const plugin_ctx_t *ctx) {
+    if (ctx->abi_minor < 3 || ctx->ctx_size < offsetof(plugin_ctx_t, sched) + sizeof ctx->sched)
+        return NULL;
+    if (!(ctx->core_features & PH_CORE_FEAT_SCHED) || !ctx->sched) return NULL;
+    if (ctx->sched->api_size < sizeof(ph_sched_api_t)) return NULL;
+    return ctx->sched;
+}
+
+/* Provided by common.c. Weak references, so an addon that does not link
+ * common.c still loads; it just keeps its own sockets and threads. */
+__attribute__((weak)) void ph_inproc_use(const ph_inproc_api_t *api, const char *sock_path, const char *name);
+__attribute__((weak)) void ph_sched_use(const ph_sched_api_t *api, const char *owner);
+
+/* Must be called at the very top of plugin_init(). Also switches the addon's
+ * broker connections to in-process endpoints and its ph_thread_start()
+ * workers to core placement when the core offers them. */
+#define PH_ENSURE_ABI(ctx) do { \
+    if(!ph_check_abi((ctx))) return false; \
+    if(ph_inproc_use) ph_inproc_use(ph_ctx_inproc((ctx)), (ctx)->sock_path, (ctx)->name); \
+    if(ph_sched_use)  ph_sched_use(ph_ctx_sched((ctx)), (ctx)->name); \
+} while(0)
 
 #endif /* PLUGIN_H */
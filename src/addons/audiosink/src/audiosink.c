@@ -7,6 +7,7 @@
 #include "audiosink.h"
 
 #include <pthread.h>
+#include <stdlib.h>
 #include <stdatomic.h>
 #include <string.h>
 #include <errno.h>
@@ -57,39 +58,139 @@ static int audiosink_unsubscribe_cb(void *user, const char *usage) {
 
 
 /* ---- playback thread ---- */
+/* Silence for one chunk; keeps ALSA fed instead of sleeping. */
+static void pcm_silence(float *scratch, size_t max_frames, size_t frames, unsigned ch){
+    float *dst; size_t room;
+    if(au_pcm_begin(&S, scratch, max_frames, &dst, &room) != 0) return;
+    if(room > frames) room = frames;
+    memset(dst, 0, room * ch * sizeof(float));
+    au_pcm_commit(&S, dst, room);
+}
+
+/* Legacy path: ring frames straight to ALSA (into the DMA area when mmap'd),
+   large buffer hides drift. */
+static void play_direct(float *scratch, size_t max_frames, unsigned ch){
+    double fs = S.hdr->sample_rate > 0.0 ? S.hdr->sample_rate : (double)S.pcm_rate;
+    au_stats_latency(&S, 1000.0 * (au_ring_fill_frames(&S) / fs
+                                   + (double)au_pcm_delay(&S) / (double)S.pcm_rate));
+
+    float *dst; size_t room;
+    if(au_pcm_begin(&S, scratch, max_frames, &dst, &room) != 0) return;
+    size_t nframes = au_ring_pop_f32(&S, dst, room);
+    if(nframes == 0){
+        S.underrun_events++;
+        /* Feed silence to ALSA rather than sleeping; prevents XRUN when the
+         * audio ring stalls briefly (e.g., during wfmd DSP batch or USB gap). */
+        nframes = S.pcm_period && S.pcm_period < room ? (size_t)S.pcm_period : room;
+        memset(dst, 0, nframes * ch * sizeof(float));
+    }
+    au_pcm_commit(&S, dst, nframes);
+}
+
+/* Drift-compensated path: at most one ALSA period per step through the
+ * resampler, whose ratio the PI controller nudges to hold ring fill + ALSA
+ * delay at target. Output lands directly in the DMA area when mmap'd. */
+static void play_drift(float *inbuf, float *scratch, size_t max_frames, unsigned ch){
+    double fs_in  = S.hdr->sample_rate > 0.0 ? S.hdr->sample_rate : (double)S.pcm_rate;
+    double fs_out = (double)S.pcm_rate;
+    if(!S.rs.bank || S.rs_fs_in != fs_in || S.rs_fs_out != fs_out || S.rs.channels != ch){
+        ph_dsp_resamp_f32_free(&S.rs);
+        if(ph_dsp_resamp_f32_init(&S.rs, ch, fs_in, fs_out, 32) != 0){ ph_msleep(5); return; }
+        S.rs_fs_in = fs_in; S.rs_fs_out = fs_out;
+        au_drift_reset(&S);
+        S.priming = true;
+    }
+
+    size_t period = S.pcm_period ? (size_t)S.pcm_period : 256;
+    if(period > max_frames / 2) period = max_frames / 2;
+
+    double fill = au_ring_fill_frames(&S);
+    long dl = au_pcm_delay(&S);
+    double lat_ms = 1000.0 * (fill / fs_in + (double)dl / fs_out);
+    if(!S.priming) au_stats_latency(&S, lat_ms);
+
+    if(S.priming){
+        /* ALSA stays full, so latency grows only as the ring fills */
+        if(lat_ms < S.target_ms){ pcm_silence(scratch, max_frames, period, ch); return; }
+        S.priming = false;
+        au_drift_reset(&S);
+    }else if(lat_ms > 2.0 * S.target_ms + 50.0){
+        /* far outside what ppm steering can recover (e.g. producer burst) */
+        size_t excess = (size_t)((lat_ms - S.target_ms) * 1e-3 * fs_in);
+        while(excess){
+            size_t n = au_ring_pop_f32(&S, inbuf, excess < max_frames ? excess : max_frames);
+            if(!n) break;
+            excess -= n;
+        }
+        au_drift_reset(&S);
+        return;
+    }
+
+    float *dst; size_t room;
+    if(au_pcm_begin(&S, scratch, max_frames, &dst, &room) != 0) return;
+    if(room > period) room = period;
+
+    double corr = au_drift_update(&S, lat_ms, (double)room / fs_out);
+    ph_dsp_resamp_f32_set_ratio(&S.rs, (fs_out / fs_in) / (1.0 + corr));
+
+    size_t want_in = (size_t)((double)room * fs_in / fs_out * (1.0 + corr) + 0.5);
+    if(want_in > max_frames) want_in = max_frames;
+    size_t n_in = au_ring_pop_f32(&S, inbuf, want_in);
+    size_t n_out = ph_dsp_resamp_f32_process(&S.rs, inbuf, n_in, dst, room);
+    if(n_out == 0){
+        S.underrun_events++;
+        S.priming = true;
+        memset(dst, 0, room * ch * sizeof(float));
+        n_out = room;
+    }
+    au_pcm_commit(&S, dst, n_out);
+}
+
 static void *play_thread(void *arg){
     (void)arg;
-    float framebuf[1024];
+    static float inbuf[8192], outbuf[8192];
 
     while(atomic_load(&S.play_run)){
-        if(!S.hdr || !S.pcm){ ph_msleep(5); continue; }
-
-        unsigned ch = S.hdr->channels ? S.hdr->channels : 1u;
-        size_t max_frames = (sizeof(framebuf)/sizeof(framebuf[0])) / ch;
-        size_t nframes = au_ring_pop_f32(&S, framebuf, max_frames);
-        if(nframes == 0){
-            S.underrun_events++;
-            /* Feed silence to ALSA rather than sleeping; prevents XRUN when the
-             * audio ring stalls briefly (e.g., during wfmd DSP batch or USB gap). */
-            memset(framebuf, 0, max_frames * ch * sizeof(float));
-            nframes = max_frames;
+        if(atomic_load(&S.pause_req)){
+            atomic_store(&S.paused, true);
+            while(atomic_load(&S.pause_req) && atomic_load(&S.play_run)) ph_msleep(1);
+            atomic_store(&S.paused, false);
+            continue;
         }
+        if(!S.hdr || !S.pcm_open){ ph_msleep(5); continue; }
 
-        snd_pcm_sframes_t wrote = snd_pcm_writei(S.pcm, framebuf, nframes);
-        if(wrote < 0){
-            if(wrote == -EPIPE){ S.xrun_events++; snd_pcm_prepare(S.pcm); continue; }
-            if(wrote == -ESTRPIPE){
-                while((wrote = snd_pcm_resume(S.pcm)) == -EAGAIN) ph_msleep(1);
-                if(wrote < 0) snd_pcm_prepare(S.pcm);
-                continue;
-            }
-            fprintf(stderr,"[audiosink] writei: %s\n", snd_strerror(wrote));
-            ph_msleep(5);
-        }
+        unsigned ch = S.hdr->channels ? S.hdr->channels : 1u;
+        size_t max_frames = (sizeof(inbuf)/sizeof(inbuf[0])) / ch;
+        if(atomic_load(&S.drift_on))
+            play_drift(inbuf, outbuf, max_frames, ch);
+        else
+            play_direct(outbuf, max_frames, ch);
     }
     return NULL;
 }
 
+/* ---- backend/ring swaps ----
+ * Device (re)open and ring remaps run on the ctrl thread, but only while the
+ * play thread is parked between periods, so it never touches a backend or
+ * ring that is being closed. Without a running play thread there is nobody
+ * to wait for. */
+static void play_pause(void){
+    if(!atomic_load(&S.started)) return;
+    atomic_store(&S.pause_req, true);
+    while(!atomic_load(&S.paused) && atomic_load(&S.play_run)) ph_msleep(1);
+}
+
+static void play_resume(void){
+    if(!atomic_load(&S.pause_req)) return;
+    atomic_store(&S.pause_req, false);
+    while(atomic_load(&S.paused) && atomic_load(&S.play_run)) ph_msleep(1);
+}
+
+/* Re-open the device with the current settings; caller holds the play thread parked. */
+static void pcm_reopen_locked(void){
+    if(S.hdr) au_pcm_open(&S, (unsigned)S.hdr->sample_rate, (unsigned)S.hdr->channels);
+}
+
 /* ---- control: command callback ---- */
 static void copy_alsa_token(const char *src, char *dst, size_t dstsz){
     while(*src==' '||*src=='\t') src++;
@@ -114,14 +215,24 @@ static void on_cmd(ph_ctrl_t *c, const char *line, void *u){
 
     if(strncmp(line,"help",4)==0){
         ph_reply(c, "{\"ok\":true,"
-                     "\"help\":\"help|start|stop|device <alsa>|"
+                     "\"help\":\"help|start|stop|device <alsa|null|file:path>|drift <0|1>|latency <ms>|"
+                             "mmap <0|1>|period <frames>|buffer <frames>|"
+                             "sim-rate <Hz>|sim-ppm <ppm>|sim-jitter <us>|stats-reset|"
                              "subscribe <usage> <feed>|unsubscribe <usage>|status\"}");
         return;
     }
     if(strcmp(line,"start")==0){
         if(!atomic_load(&S.started)){
+            atomic_store(&S.pause_req, false);
+            atomic_store(&S.paused, false);
             atomic_store(&S.play_run, true);
-            pthread_create(&S.th_play, NULL, play_thread, NULL);
+            /* placement problems are only logged; rc != 0 means no thread */
+            int rc = ph_thread_start(&S.th_play, "play", PH_WORKER_RT_IO, play_thread, NULL);
+            if(rc != 0){
+                atomic_store(&S.play_run, false);
+                ph_reply_errf(c, "play thread start failed: %s", strerror(rc));
+                return;
+            }
             atomic_store(&S.started, true);
         }
         ph_reply_ok(c, "started");
@@ -137,14 +248,102 @@ static void on_cmd(ph_ctrl_t *c, const char *line, void *u){
         return;
     }
     if(strncmp(line,"device ",7)==0){
-        copy_alsa_token(line+7, S.alsa_dev, sizeof S.alsa_dev);
-        if(S.hdr) au_pcm_open(&S, (unsigned)S.hdr->sample_rate, (unsigned)S.hdr->channels);
-        else      au_pcm_open(&S, 48000u, 1u);
+        char dev[300];
+        copy_alsa_token(line+7, dev, sizeof dev);
+        play_pause();
+        int rc = au_pcm_select(&S, dev);
+        if(rc == 0){
+            if(S.hdr) pcm_reopen_locked();
+            else      au_pcm_open(&S, 48000u, 1u);
+        }
+        play_resume();
+        if(rc != 0){ ph_reply_err(c, "device unavailable (no ALSA in this build, or file not writable)"); return; }
         ph_reply_ok(c, "device set");
         return;
     }
+    if(strncmp(line,"sim-rate ",9)==0){
+        long v = atol(line+9);
+        if(v < 0 || v > 384000){ ph_reply_err(c, "sim-rate expects Hz (0 = ring rate)"); return; }
+        play_pause();
+        S.sim_rate = (unsigned)v;
+        pcm_reopen_locked();
+        play_resume();
+        ph_reply_okf(c, "sim-rate=%u", S.sim_rate);
+        return;
+    }
+    if(strncmp(line,"sim-ppm ",8)==0){
+        play_pause();
+        S.sim_ppm = strtod(line+8, NULL);
+        pcm_reopen_locked();
+        play_resume();
+        ph_reply_okf(c, "sim-ppm=%.1f", S.sim_ppm);
+        return;
+    }
+    if(strncmp(line,"sim-jitter ",11)==0){
+        double us = strtod(line+11, NULL);
+        if(us < 0.0 || us > 1e6){ ph_reply_err(c, "sim-jitter expects 0..1000000 us"); return; }
+        play_pause();
+        S.sim_jitter_us = us;
+        play_resume();
+        ph_reply_okf(c, "sim-jitter=%.0f us", us);
+        return;
+    }
+    if(strcmp(line,"stats-reset")==0){
+        au_stats_reset(&S);
+        ph_reply_ok(c, "stats reset");
+        return;
+    }
+    if(strncmp(line,"drift ",6)==0){
+        play_pause();
+        atomic_store(&S.drift_on, atoi(line+6) != 0);
+        /* ALSA buffer size depends on the mode; re-open with the new budget */
+        pcm_reopen_locked();
+        S.priming = true;
+        play_resume();
+        ph_reply_okf(c, "drift=%d", (int)atomic_load(&S.drift_on));
+        return;
+    }
+    if(strncmp(line,"latency ",8)==0){
+        double ms = strtod(line+8, NULL);
+        if(ms < 10.0 || ms > 500.0){ ph_reply_err(c, "latency must be 10..500 ms"); return; }
+        play_pause();
+        S.target_ms = ms;
+        pcm_reopen_locked();
+        S.priming = true;
+        play_resume();
+        ph_reply_okf(c, "latency=%.0f ms", ms);
+        return;
+    }
+    if(strncmp(line,"mmap ",5)==0){
+        play_pause();
+        atomic_store(&S.want_mmap, atoi(line+5) != 0);
+        pcm_reopen_locked();
+        play_resume();
+        ph_reply_okf(c, "mmap=%d active=%d", (int)atomic_load(&S.want_mmap), (int)S.pcm_mmap);
+        return;
+    }
+    if(strncmp(line,"period ",7)==0){
+        long v = atol(line+7);
+        if(v < 0 || v > 1L<<20){ ph_reply_err(c, "period expects frames (0 = auto)"); return; }
+        play_pause();
+        S.cfg_period = (unsigned long)v;
+        pcm_reopen_locked();
+        play_resume();
+        ph_reply_okf(c, "period=%lu buffer=%lu latency=%.1f ms", S.pcm_period, S.pcm_buffer, S.pcm_latency_ms);
+        return;
+    }
+    if(strncmp(line,"buffer ",7)==0){
+        long v = atol(line+7);
+        if(v < 0 || v > 1L<<20){ ph_reply_err(c, "buffer expects frames (0 = auto)"); return; }
+        play_pause();
+        S.cfg_buffer = (unsigned long)v;
+        pcm_reopen_locked();
+        play_resume();
+        ph_reply_okf(c, "period=%lu buffer=%lu latency=%.1f ms", S.pcm_period, S.pcm_buffer, S.pcm_latency_ms);
+        return;
+    }
     if(strcmp(line,"status")==0){
-        char js[256];
+        char js[1024];
         uint64_t w = S.hdr ? atomic_load(&S.hdr->wpos) : 0;
         uint64_t lag_bytes = (S.hdr && w >= S.consumer.rpos) ? (w - S.consumer.rpos) : 0;
         double lag_ms = 0.0;
@@ -153,13 +352,23 @@ static void on_cmd(ph_ctrl_t *c, const char *line, void *u){
             lag_ms = 1000.0 * ((double)lag_bytes / frame_bytes) / S.hdr->sample_rate;
         }
         snprintf(js,sizeof js,
-            "{\"ok\":true,\"pcm\":%s,\"feed\":\"%s\",\"lag_ms\":%.3f,"
-            "\"lost_bytes\":%llu,\"overrun_events\":%llu,\"underruns\":%llu,\"xruns\":%llu}",
-            S.pcm?"true":"false", S.current_feed[0]?S.current_feed:"", lag_ms,
+            "{\"ok\":true,\"pcm\":%s,\"backend\":\"%s\",\"feed\":\"%s\",\"lag_ms\":%.3f,"
+            "\"lost_bytes\":%llu,\"overrun_events\":%llu,\"underruns\":%llu,\"xruns\":%llu,"
+            "\"drift\":%s,\"target_ms\":%.1f,\"latency_ms\":%.2f,\"drift_ppm\":%.1f,"
+            "\"pcm_rate\":%u,\"pcm_period\":%lu,\"pcm_buffer\":%lu,"
+            "\"pcm_latency_ms\":%.2f,\"pcm_mmap\":%s,"
+            "\"frames_out\":%llu,\"lat_min_ms\":%.2f,\"lat_avg_ms\":%.2f,\"lat_max_ms\":%.2f}",
+            S.pcm_open?"true":"false", S.be?S.be->name:"", S.current_feed[0]?S.current_feed:"", lag_ms,
             (unsigned long long)S.consumer.lost_bytes,
             (unsigned long long)S.consumer.overrun_events,
             (unsigned long long)S.underrun_events,
-            (unsigned long long)S.xrun_events);
+            (unsigned long long)S.xrun_events,
+            atomic_load(&S.drift_on)?"true":"false", S.target_ms,
+            S.lat_ms_avg > 0.0 ? S.lat_ms_avg : 0.0, S.drift_corr * 1e6,
+            S.pcm_rate, S.pcm_period, S.pcm_buffer,
+            S.pcm_latency_ms, S.pcm_mmap?"true":"false",
+            (unsigned long long)S.frames_out, S.lat_min_ms,
+            S.lat_n ? S.lat_sum_ms / (double)S.lat_n : 0.0, S.lat_max_ms);
         ph_reply(c, js);
         return;
     }
@@ -204,17 +413,16 @@ static void *cmd_thread(void *arg){
            json_get_string(js,"feed", feed, sizeof feed)==0 &&
            nfds==1 && infd>=0)
         {
-            if(au_ring_map_from_fd(&S, infd)==0 && S.hdr){
-                au_pcm_open(&S, (unsigned)S.hdr->sample_rate, (unsigned)S.hdr->channels);
-            }else{
-                close(infd);
-            }
+            /* au_ring_map_from_fd closes infd itself on failure */
+            play_pause();
+            if(au_ring_map_from_fd(&S, infd)==0) pcm_reopen_locked();
+            play_resume();
         } else {
             if(infd>=0) close(infd);
         }
     }
 
-    close(fd);
+    ph_conn_close(fd);
     return NULL;
 }
 
@@ -228,9 +436,13 @@ bool plugin_init(const plugin_ctx_t *ctx, plugin_caps_t *out){
     snprintf(S.name, sizeof S.name, "audiosink");
     snprintf(S.feed_in,  sizeof S.feed_in,  "audiosink.config.in");
     snprintf(S.feed_out, sizeof S.feed_out, "audiosink.config.out");
-    S.memfd = -1; S.pcm=NULL;
+    S.memfd = -1;
+    atomic_store(&S.drift_on, true);
+    atomic_store(&S.want_mmap, true);
+    S.target_ms = 30.0;
 
-    static const char *CONS[] = { "audiosink.config.in", NULL };
+    /* data feeds: the PCM sources it is usually subscribed to (autoload order) */
+    static const char *CONS[] = { "audiosink.config.in", "wfmd.audio-info", "filesource.audio-info", NULL };
     static const char *PROD[] = { "audiosink.config.out", NULL };
 
     if(out){
@@ -246,7 +458,10 @@ bool plugin_init(const plugin_ctx_t *ctx, plugin_caps_t *out){
 bool plugin_start(void){
     /* command I/O thread */
     atomic_store(&S.cmd_run, true);
-    pthread_create(&S.th_cmd, NULL, cmd_thread, NULL);
+    if(ph_thread_start(&S.th_cmd, "ctrl", PH_WORKER_BACKGROUND, cmd_thread, NULL) != 0){
+        atomic_store(&S.cmd_run, false);
+        return false;
+    }
     /* playback thread starts on 'start' command; no autostart here */
     return true;
 }
@@ -262,6 +477,7 @@ void plugin_stop(void){
     atomic_store(&S.cmd_run, false);
     pthread_join(S.th_cmd, NULL);
 
-    au_pcm_close(&S);
+    au_pcm_release(&S);
     au_ring_close(&S);
+    ph_dsp_resamp_f32_free(&S.rs);
 }
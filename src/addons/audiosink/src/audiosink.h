@@ -1,14 +1,39 @@
 #pragma once
+#ifdef PH_HAVE_ALSA
 #include <alsa/asoundlib.h>
+#endif
+#include <pthread.h>
 #include <stdatomic.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
+#include <stdio.h>
 #include "ph_stream.h"
 #include "ph_ring.h"
+#include "ph_dsp.h"
+
+typedef struct audiosink audiosink_t;
+
+/* Output backend. begin/commit borrow and hand back room for frames;
+   delay reports frames queued ahead of the (real or simulated) DAC. */
+typedef struct au_backend {
+    const char *name;
+    int  (*open)(audiosink_t *s, unsigned rate, unsigned ch);
+    void (*close)(audiosink_t *s);
+    int  (*begin)(audiosink_t *s, float *scratch, size_t scratch_frames,
+                  float **dst, size_t *frames);
+    void (*commit)(audiosink_t *s, const float *buf, size_t frames);
+    long (*delay)(audiosink_t *s);
+} au_backend_t;
+
+#ifdef PH_HAVE_ALSA
+extern const au_backend_t au_backend_alsa;
+#endif
+extern const au_backend_t au_backend_null;
+extern const au_backend_t au_backend_file;
 
 /* Runtime state for audiosink */
-typedef struct {
+struct audiosink {
     /* broker */
     int fd;                   /* UDS to core */
     char name[32];            /* "audiosink" */
@@ -23,32 +48,86 @@ typedef struct {
     phau_hdr_t *hdr;          /* mmap base */
     size_t      map_bytes;    /* mmap length */
 
-    /* ALSA */
+    /* output device */
+    const au_backend_t *be;   /* selected backend */
+    void       *be_priv;      /* backend-private state while open */
+    bool        pcm_open;
     char        alsa_dev[128];/* "default" or "hw:0,0" */
+#ifdef PH_HAVE_ALSA
     snd_pcm_t  *pcm;
+#endif
     unsigned    pcm_rate;
     unsigned    pcm_ch;
+    unsigned long pcm_period; /* negotiated period, frames */
+    unsigned long pcm_buffer; /* negotiated buffer, frames */
+    double      pcm_latency_ms; /* negotiated buffer expressed in ms */
+    bool        pcm_mmap;     /* negotiated access is MMAP_INTERLEAVED */
+    unsigned long mm_offset;  /* pending snd_pcm_mmap_begin offset */
+    _Atomic bool want_mmap;   /* try mmap first, fall back to rw */
+    unsigned long cfg_period; /* requested period, 0 = auto */
+    unsigned long cfg_buffer; /* requested buffer, 0 = auto */
+
+    /* null/file backends: simulated DAC clock */
+    char        file_path[256];
+    FILE       *file_out;     /* opened by 'device file:', kept across reopens */
+    unsigned    sim_rate;     /* Hz, 0 = follow the ring */
+    double      sim_ppm;      /* DAC clock offset */
+    double      sim_jitter_us;/* max extra wakeup delay */
 
     /* threads */
     _Atomic bool play_run;
     _Atomic bool cmd_run;
     pthread_t   th_play;
     pthread_t   th_cmd;
+    _Atomic bool pause_req;   /* ctrl: park the play thread between periods */
+    _Atomic bool paused;      /* play: parked, backend and ring are free */
 
     /* local consumer cursor + telemetry */
     ph_ring_consumer_t consumer;
     uint64_t underrun_events;
     uint64_t xrun_events;
+    uint64_t frames_out;
+    double   lat_min_ms, lat_max_ms, lat_sum_ms;   /* per-period total latency */
+    uint64_t lat_n;
+
+    /* clock-drift compensation: ring → resampler → ALSA, PI-steered ratio */
+    _Atomic bool drift_on;
+    double   target_ms;       /* total latency target (ring fill + ALSA delay) */
+    double   lat_ms_avg;      /* smoothed measured latency, <0 until first sample */
+    double   drift_i;         /* PI integrator */
+    double   drift_corr;      /* current rate correction (1e-6 == 1 ppm) */
+    bool     priming;         /* filling to target before consuming */
+    ph_dsp_resamp_f32_t rs;
+    double   rs_fs_in, rs_fs_out;
 
     /* misc */
     _Atomic bool started;
-} audiosink_t;
+};
 
 /* ring */
 int  au_ring_map_from_fd(audiosink_t *s, int fd);
 void au_ring_close(audiosink_t *s);
 size_t au_ring_pop_f32(audiosink_t *s, float *dst, size_t max_frames);
 
-/* alsa */
+/* drift controller */
+void   au_drift_reset(audiosink_t *s);
+double au_drift_update(audiosink_t *s, double lat_ms, double dt);
+double au_ring_fill_frames(const audiosink_t *s);
+
+/* output (dispatch to s->be) */
+int  au_pcm_select(audiosink_t *s, const char *dev);  /* "null", "file:<path>", else ALSA */
 int  au_pcm_open(audiosink_t *s, unsigned rate, unsigned ch);
 void au_pcm_close(audiosink_t *s);
+void au_pcm_release(audiosink_t *s);                  /* close, and end a file capture */
+/* Borrow space for up to *frames output frames: the DMA area for ALSA mmap,
+   the caller's scratch otherwise. Waits for a period of room. -1 = nothing
+   writable yet or recovered from an error; retry. */
+int  au_pcm_begin(audiosink_t *s, float *scratch, size_t scratch_frames,
+                  float **dst, size_t *frames);
+void au_pcm_commit(audiosink_t *s, const float *buf, size_t frames);
+long au_pcm_delay(audiosink_t *s);
+/* period/buffer request from cfg_* / drift target / legacy defaults */
+void au_pcm_pick_sizes(const audiosink_t *s, unsigned rate,
+                       unsigned long *period, unsigned long *buffer);
+void au_stats_latency(audiosink_t *s, double lat_ms);
+void au_stats_reset(audiosink_t *s);
@@ -1,17 +1,52 @@
 #include "audiosink.h"
+#include "common.h"
 #include <alloca.h>
 #include <stdio.h>
 
-void au_pcm_close(audiosink_t *s){
+/* ALSA output backend (compiled only with PH_HAVE_ALSA) */
+
+static void alsa_close(audiosink_t *s){
     if(s->pcm){
         snd_pcm_drop(s->pcm);
         snd_pcm_close(s->pcm);
         s->pcm = NULL;
     }
+    s->pcm_mmap = false;
 }
 
-int au_pcm_open(audiosink_t *s, unsigned rate, unsigned ch){
-    if(s->pcm) au_pcm_close(s);
+/* hw params for one access mode; 0 on success */
+static int pcm_set_hw(audiosink_t *s, snd_pcm_t *pcm, snd_pcm_access_t access,
+                      unsigned *rate, unsigned ch,
+                      snd_pcm_uframes_t *period, snd_pcm_uframes_t *bufsize){
+    snd_pcm_hw_params_t *hw;
+    snd_pcm_hw_params_alloca(&hw);
+    snd_pcm_hw_params_any(pcm, hw);
+    if(snd_pcm_hw_params_set_access(pcm, hw, access) < 0) return -1;
+    snd_pcm_hw_params_set_format(pcm, hw, SND_PCM_FORMAT_FLOAT_LE);
+    snd_pcm_hw_params_set_channels(pcm, hw, ch);
+    snd_pcm_hw_params_set_rate_near(pcm, hw, rate, 0);
+
+    unsigned long pp = 0, bb = 0;
+    au_pcm_pick_sizes(s, *rate, &pp, &bb);
+    snd_pcm_uframes_t p = pp, b = bb;
+
+    snd_pcm_hw_params_set_period_size_near(pcm, hw, &p, 0);
+    snd_pcm_hw_params_set_buffer_size_near(pcm, hw, &b);
+
+    int rc = snd_pcm_hw_params(pcm, hw);
+    if(rc < 0){
+        fprintf(stderr,"[audiosink] hw_params: %s\n", snd_strerror(rc));
+        return rc;
+    }
+    /* what the device actually granted */
+    snd_pcm_hw_params_get_period_size(hw, &p, 0);
+    snd_pcm_hw_params_get_buffer_size(hw, &b);
+    *period = p; *bufsize = b;
+    return 0;
+}
+
+static int alsa_open(audiosink_t *s, unsigned rate, unsigned ch){
+    if(s->pcm) alsa_close(s);
 
     snd_pcm_t *pcm = NULL;
     int rc = snd_pcm_open(&pcm, s->alsa_dev[0] ? s->alsa_dev : "default",
@@ -22,34 +57,112 @@ int au_pcm_open(audiosink_t *s, unsigned rate, unsigned ch){
         return -1;
     }
 
-    snd_pcm_hw_params_t *hw;
-    snd_pcm_hw_params_alloca(&hw);
-    snd_pcm_hw_params_any(pcm, hw);
-    snd_pcm_hw_params_set_access(pcm, hw, SND_PCM_ACCESS_RW_INTERLEAVED);
-    snd_pcm_hw_params_set_format(pcm, hw, SND_PCM_FORMAT_FLOAT_LE);
-    snd_pcm_hw_params_set_channels(pcm, hw, ch);
-
     unsigned rr = rate;
-    snd_pcm_hw_params_set_rate_near(pcm, hw, &rr, 0);
-
-    snd_pcm_uframes_t period = 480;  /* ~10 ms @ 48k */
-    snd_pcm_hw_params_set_period_size_near(pcm, hw, &period, 0);
-    snd_pcm_uframes_t bufsize = period * 20; /* ~200 ms; large buffer prevents XRUN during brief ring starvation */
-    snd_pcm_hw_params_set_buffer_size_near(pcm, hw, &bufsize);
-
-    rc = snd_pcm_hw_params(pcm, hw);
-    if(rc < 0){
-        fprintf(stderr,"[audiosink] hw_params: %s\n", snd_strerror(rc));
+    snd_pcm_uframes_t period = 0, bufsize = 0;
+    bool mm = atomic_load(&s->want_mmap);
+    if(mm && pcm_set_hw(s, pcm, SND_PCM_ACCESS_MMAP_INTERLEAVED, &rr, ch, &period, &bufsize) != 0){
+        /* device (or plugin chain) refused mmap: fall back to read/write */
+        mm = false; rr = rate;
+    }
+    if(!mm && pcm_set_hw(s, pcm, SND_PCM_ACCESS_RW_INTERLEAVED, &rr, ch, &period, &bufsize) != 0){
         snd_pcm_close(pcm);
         return -1;
     }
 
+    /* wake once per period; start as soon as one period is queued */
+    snd_pcm_sw_params_t *sw;
+    snd_pcm_sw_params_alloca(&sw);
+    if(snd_pcm_sw_params_current(pcm, sw) == 0){
+        snd_pcm_sw_params_set_avail_min(pcm, sw, period);
+        snd_pcm_sw_params_set_start_threshold(pcm, sw, period);
+        snd_pcm_sw_params(pcm, sw);
+    }
+
     s->pcm      = pcm;
     s->pcm_rate = rr;
     s->pcm_ch   = ch;
+    s->pcm_mmap = mm;
+    s->pcm_period = (unsigned long)period;
+    s->pcm_buffer = (unsigned long)bufsize;
+    s->pcm_latency_ms = rr ? 1000.0 * (double)bufsize / (double)rr : 0.0;
 
-    fprintf(stderr,"[audiosink] ALSA ready dev=%s rate=%u ch=%u period=%lu buf=%lu\n",
+    fprintf(stderr,"[audiosink] ALSA ready dev=%s rate=%u ch=%u access=%s period=%lu buf=%lu latency=%.1fms\n",
             s->alsa_dev[0]?s->alsa_dev:"default", s->pcm_rate, s->pcm_ch,
-            (unsigned long)period, (unsigned long)bufsize);
+            mm ? "mmap" : "rw",
+            (unsigned long)period, (unsigned long)bufsize, s->pcm_latency_ms);
+    return 0;
+}
+
+/* xrun/suspend recovery shared by both access modes */
+static void pcm_recover(audiosink_t *s, int err){
+    if(err == -EPIPE){ s->xrun_events++; snd_pcm_prepare(s->pcm); return; }
+    if(err == -ESTRPIPE){
+        int rc;
+        while((rc = snd_pcm_resume(s->pcm)) == -EAGAIN) ph_msleep(1);
+        if(rc < 0) snd_pcm_prepare(s->pcm);
+        return;
+    }
+    fprintf(stderr,"[audiosink] pcm: %s\n", snd_strerror(err));
+    ph_msleep(5);
+}
+
+static int alsa_begin(audiosink_t *s, float *scratch, size_t scratch_frames,
+                      float **dst, size_t *frames){
+    if(!s->pcm_mmap){
+        /* rw: caller fills scratch, commit does the (blocking) writei */
+        *dst = scratch;
+        *frames = scratch_frames;
+        return 0;
+    }
+
+    snd_pcm_sframes_t avail = snd_pcm_avail_update(s->pcm);
+    if(avail < 0){ pcm_recover(s, (int)avail); return -1; }
+    if((snd_pcm_uframes_t)avail < s->pcm_period){
+        if(snd_pcm_state(s->pcm) == SND_PCM_STATE_RUNNING){
+            int rc = snd_pcm_wait(s->pcm, 100);
+            if(rc < 0){ pcm_recover(s, rc); return -1; }
+            if(rc == 0) return -1;   /* timeout: let the caller re-check state */
+        }
+        avail = snd_pcm_avail_update(s->pcm);
+        if(avail < 0){ pcm_recover(s, (int)avail); return -1; }
+        if(avail == 0) return -1;
+    }
+
+    const snd_pcm_channel_area_t *areas = NULL;
+    snd_pcm_uframes_t off = 0, fr = (snd_pcm_uframes_t)avail;
+    if(fr > scratch_frames) fr = scratch_frames;
+    int rc = snd_pcm_mmap_begin(s->pcm, &areas, &off, &fr);
+    if(rc < 0){ pcm_recover(s, rc); return -1; }
+
+    /* interleaved FLOAT_LE: one area, step = frame size in bits */
+    s->mm_offset = (unsigned long)off;
+    *dst = (float *)((char *)areas[0].addr + areas[0].first / 8 + (size_t)off * (areas[0].step / 8));
+    *frames = (size_t)fr;
     return 0;
 }
+
+static void alsa_commit(audiosink_t *s, const float *buf, size_t frames){
+    if(!s->pcm_mmap){
+        while(frames){
+            snd_pcm_sframes_t wrote = snd_pcm_writei(s->pcm, buf, frames);
+            if(wrote < 0){ pcm_recover(s, (int)wrote); return; }
+            buf += (size_t)wrote * s->pcm_ch;
+            frames -= (size_t)wrote;
+        }
+        return;
+    }
+    snd_pcm_sframes_t rc = snd_pcm_mmap_commit(s->pcm, (snd_pcm_uframes_t)s->mm_offset,
+                                               (snd_pcm_uframes_t)frames);
+    if(rc < 0) pcm_recover(s, (int)rc);
+    else if((size_t)rc != frames) pcm_recover(s, -EPIPE);
+}
+
+static long alsa_delay(audiosink_t *s){
+    snd_pcm_sframes_t dl = 0;
+    if(snd_pcm_delay(s->pcm, &dl) < 0) return 0;
+    return (long)dl;
+}
+
+const au_backend_t au_backend_alsa = {
+    "alsa", alsa_open, alsa_close, alsa_begin, alsa_commit, alsa_delay
+};
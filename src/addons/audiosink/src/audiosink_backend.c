@@ -0,0 +1,106 @@
+#include "audiosink.h"
+#include <stdio.h>
+#include <string.h>
+
+static const au_backend_t *default_backend(void){
+#ifdef PH_HAVE_ALSA
+    return &au_backend_alsa;
+#else
+    return &au_backend_null;
+#endif
+}
+
+/* The file is created here, once per selection, rather than by every backend
+ * open: rate, latency and drift changes reopen the backend, and must not cut
+ * the capture short. */
+int au_pcm_select(audiosink_t *s, const char *dev){
+    const au_backend_t *be;
+    FILE *f = NULL;
+    if(strcmp(dev, "null") == 0){
+        be = &au_backend_null;
+    }else if(strncmp(dev, "file:", 5) == 0 && dev[5]){
+        be = &au_backend_file;
+        f = fopen(dev + 5, "wb");
+        if(!f){ perror("[audiosink] file backend fopen"); return -1; }
+        snprintf(s->file_path, sizeof s->file_path, "%s", dev + 5);
+    }else{
+#ifdef PH_HAVE_ALSA
+        be = &au_backend_alsa;
+        snprintf(s->alsa_dev, sizeof s->alsa_dev, "%s", dev);
+#else
+        fprintf(stderr,"[audiosink] built without ALSA; use null or file:<path>\n");
+        return -1;
+#endif
+    }
+    au_pcm_close(s);
+    if(s->file_out) fclose(s->file_out);
+    s->file_out = f;
+    s->be = be;
+    return 0;
+}
+
+int au_pcm_open(audiosink_t *s, unsigned rate, unsigned ch){
+    if(s->pcm_open) au_pcm_close(s);
+    if(!s->be) s->be = default_backend();
+    int rc = s->be->open(s, rate, ch);
+    s->pcm_open = (rc == 0);
+    return rc;
+}
+
+void au_pcm_close(audiosink_t *s){
+    if(s->pcm_open && s->be) s->be->close(s);
+    s->pcm_open = false;
+}
+
+void au_pcm_release(audiosink_t *s){
+    au_pcm_close(s);
+    if(s->file_out){ fclose(s->file_out); s->file_out = NULL; }
+}
+
+int au_pcm_begin(audiosink_t *s, float *scratch, size_t scratch_frames,
+                 float **dst, size_t *frames){
+    return s->be->begin(s, scratch, scratch_frames, dst, frames);
+}
+
+void au_pcm_commit(audiosink_t *s, const float *buf, size_t frames){
+    s->be->commit(s, buf, frames);
+    s->frames_out += frames;
+}
+
+long au_pcm_delay(audiosink_t *s){
+    long d = s->be->delay(s);
+    return d < 0 ? 0 : d;
+}
+
+void au_pcm_pick_sizes(const audiosink_t *s, unsigned rate,
+                       unsigned long *period, unsigned long *buffer){
+    /* explicit sizes win; otherwise drift mode budgets half the latency target
+       in four periods, and the legacy path keeps its ~200 ms cushion */
+    unsigned long p = 480;  /* ~10 ms @ 48k */
+    unsigned long b = p * 20; /* ~200 ms; large buffer prevents XRUN during brief ring starvation */
+    if(atomic_load(&s->drift_on) && s->target_ms > 0.0){
+        b = (unsigned long)((double)rate * s->target_ms / 2000.0);
+        p = b / 4;
+        if(p < 64) { p = 64; b = p * 4; }
+    }
+    if(s->cfg_period) p = s->cfg_period;
+    if(s->cfg_buffer) b = s->cfg_buffer;
+    else if(s->cfg_period) b = p * 4;
+    *period = p; *buffer = b;
+}
+
+/* ---- latency statistics (all backends) ---- */
+void au_stats_latency(audiosink_t *s, double lat_ms){
+    if(s->lat_n == 0 || lat_ms < s->lat_min_ms) s->lat_min_ms = lat_ms;
+    if(s->lat_n == 0 || lat_ms > s->lat_max_ms) s->lat_max_ms = lat_ms;
+    s->lat_sum_ms += lat_ms;
+    s->lat_n++;
+}
+
+void au_stats_reset(audiosink_t *s){
+    s->lat_min_ms = s->lat_max_ms = s->lat_sum_ms = 0.0;
+    s->lat_n = 0;
+    s->frames_out = 0;
+    s->underrun_events = 0;
+    s->xrun_events = 0;
+}
@@ -0,0 +1,43 @@
+#include "audiosink.h"
+
+/* PI clock-drift controller.
+ *
+ * The controlled quantity is total output latency: frames waiting in the
+ * audio ring plus snd_pcm_delay(). The output is a small rate correction
+ * applied to the fractional resampler between ring and ALSA. Positive error
+ * (too much buffered) makes the sink consume slightly faster. */
+
+#define AU_DRIFT_KP        0.02     /* correction per second of latency error */
+#define AU_DRIFT_KI        0.002    /* integral gain, per second of error per second */
+#define AU_DRIFT_MAX_CORR  2000e-6  /* ±2000 ppm: well below audible pitch shift */
+#define AU_DRIFT_EMA       0.05     /* latency smoothing; ring fill is bursty */
+
+static double clampd(double v, double lim){ return v > lim ? lim : (v < -lim ? -lim : v); }
+
+void au_drift_reset(audiosink_t *s){
+    s->drift_i    = 0.0;
+    s->drift_corr = 0.0;
+    s->lat_ms_avg = -1.0;
+}
+
+double au_drift_update(audiosink_t *s, double lat_ms, double dt){
+    if(s->lat_ms_avg < 0.0) s->lat_ms_avg = lat_ms;
+    else                    s->lat_ms_avg += AU_DRIFT_EMA * (lat_ms - s->lat_ms_avg);
+
+    double e = (s->lat_ms_avg - s->target_ms) * 1e-3;   /* seconds */
+    s->drift_i    = clampd(s->drift_i + AU_DRIFT_KI * e * dt, AU_DRIFT_MAX_CORR);
+    s->drift_corr = clampd(AU_DRIFT_KP * e + s->drift_i, AU_DRIFT_MAX_CORR);
+    return s->drift_corr;
+}
+
+double au_ring_fill_frames(const audiosink_t *s){
+    const phau_hdr_t *h = s->hdr;
+    if(!h || !h->bytes_per_samp) return 0.0;
+    unsigned ch = h->channels ? h->channels : 1u;
+    uint64_t w = atomic_load(&((phau_hdr_t *)h)->wpos);
+    uint64_t r = s->consumer.rpos;
+    if(w <= r) return 0.0;
+    uint64_t lag = w - r;
+    if(lag > h->capacity) lag = h->capacity;   /* overrun: pop resyncs */
+    return (double)lag / ((double)h->bytes_per_samp * (double)ch);
+}
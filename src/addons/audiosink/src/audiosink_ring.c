@@ -4,6 +4,7 @@
 #include <string.h>
 #include <errno.h>
 #include <stdio.h>
+#include <unistd.h>
 
 int au_ring_map_from_fd(audiosink_t *s, int fd){
     au_ring_close(s);
@@ -0,0 +1,131 @@
+/* Null and file output backends: a simulated DAC clock for headless runs.
+ *
+ * The simulated device drains its buffer continuously at sim_rate*(1+ppm),
+ * starts once a period is queued (like ALSA's start threshold), and counts an
+ * xrun when it runs dry while playing. Waits for room oversleep by a random
+ * 0..sim_jitter_us to model scheduler wakeup latency. The file backend
+ * follows the same clock and appends the interleaved f32 frames to the file
+ * au_pcm_select() opened; reopens keep writing to it. */
+#define _GNU_SOURCE
+#include "audiosink.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+    double   rate;          /* effective drain rate, frames/s */
+    double   q;             /* frames queued in the simulated buffer */
+    bool     running;
+    struct timespec last;   /* last drain update */
+    unsigned seed;
+    FILE    *out;           /* file backend only; owned by audiosink_t */
+} au_sim_t;
+
+static double ts_diff(const struct timespec *a, const struct timespec *b){
+    return (double)(a->tv_sec - b->tv_sec) + (double)(a->tv_nsec - b->tv_nsec) * 1e-9;
+}
+
+static void sim_drain(audiosink_t *s, au_sim_t *m){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if(m->running){
+        m->q -= ts_diff(&now, &m->last) * m->rate;
+        if(m->q < 0.0){ s->xrun_events++; m->q = 0.0; m->running = false; }
+    }
+    m->last = now;
+}
+
+static void sim_sleep(double sec){
+    if(sec <= 0.0) return;
+    struct timespec ts = { (time_t)sec, (long)((sec - (double)(time_t)sec) * 1e9) };
+    while(clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, &ts) != 0) {}
+}
+
+static int sim_open_common(audiosink_t *s, unsigned rate, unsigned ch, FILE *out){
+    au_sim_t *m = calloc(1, sizeof *m);
+    if(!m) return -1;
+    unsigned rr = s->sim_rate ? s->sim_rate : rate;
+    if(!rr) rr = 48000u;
+    m->rate = (double)rr * (1.0 + s->sim_ppm * 1e-6);
+    m->seed = (unsigned)time(NULL);
+    m->out  = out;
+    clock_gettime(CLOCK_MONOTONIC, &m->last);
+
+    unsigned long period = 0, buffer = 0;
+    au_pcm_pick_sizes(s, rr, &period, &buffer);
+    if(buffer < period * 2) buffer = period * 2;
+
+    s->be_priv  = m;
+    s->pcm_rate = rr;
+    s->pcm_ch   = ch;
+    s->pcm_mmap = false;
+    s->pcm_period = period;
+    s->pcm_buffer = buffer;
+    s->pcm_latency_ms = 1000.0 * (double)buffer / (double)rr;
+
+    fprintf(stderr,"[audiosink] %s ready rate=%u ch=%u ppm=%.1f jitter=%.0fus period=%lu buf=%lu latency=%.1fms\n",
+            s->be->name, rr, ch, s->sim_ppm, s->sim_jitter_us, period, buffer, s->pcm_latency_ms);
+    return 0;
+}
+
+static int null_open(audiosink_t *s, unsigned rate, unsigned ch){
+    return sim_open_common(s, rate, ch, NULL);
+}
+
+static int file_open(audiosink_t *s, unsigned rate, unsigned ch){
+    if(!s->file_out){ fprintf(stderr,"[audiosink] file backend: no file selected\n"); return -1; }
+    return sim_open_common(s, rate, ch, s->file_out);
+}
+
+static void sim_close(audiosink_t *s){
+    au_sim_t *m = s->be_priv;
+    if(!m) return;
+    if(m->out) fflush(m->out);
+    free(m);
+    s->be_priv = NULL;
+}
+
+static int sim_begin(audiosink_t *s, float *scratch, size_t scratch_frames,
+                     float **dst, size_t *frames){
+    au_sim_t *m = s->be_priv;
+    sim_drain(s, m);
+    double room = (double)s->pcm_buffer - m->q;
+    if(m->running && room < (double)s->pcm_period){
+        /* sleep until a period drains, plus wakeup jitter */
+        double wait = ((double)s->pcm_period - room) / m->rate;
+        if(s->sim_jitter_us > 0.0)
+            wait += s->sim_jitter_us * 1e-6 * ((double)rand_r(&m->seed) / (double)RAND_MAX);
+        sim_sleep(wait);
+        sim_drain(s, m);
+        room = (double)s->pcm_buffer - m->q;
+    }
+    if(room < 1.0) return -1;
+    size_t n = (size_t)room;
+    *dst = scratch;
+    *frames = n < scratch_frames ? n : scratch_frames;
+    return 0;
+}
+
+static void sim_commit(audiosink_t *s, const float *buf, size_t frames){
+    au_sim_t *m = s->be_priv;
+    if(m->out && frames && fwrite(buf, sizeof(float) * s->pcm_ch, frames, m->out) != frames)
+        fprintf(stderr,"[audiosink] file backend short write\n");
+    sim_drain(s, m);
+    m->q += (double)frames;
+    if(!m->running && m->q >= (double)s->pcm_period) m->running = true;
+}
+
+static long sim_delay(audiosink_t *s){
+    au_sim_t *m = s->be_priv;
+    sim_drain(s, m);
+    return (long)m->q;
+}
+
+const au_backend_t au_backend_null = {
+    "null", null_open, sim_close, sim_begin, sim_commit, sim_delay
+};
+
+const au_backend_t au_backend_file = {
+    "file", file_open, sim_close, sim_begin, sim_commit, sim_delay
+};
@@ -133,7 +133,7 @@ static void on_cmd(ph_ctrl_t *c, const char *line, void *user) {
         char jsmap[POC_MAX_JSON];
         int len = snprintf(jsmap, sizeof jsmap,
                            "{\"type\":\"publish\",\"feed\":\"dummy.foo\","
-                           "\"subtype\":\"shm_map\",\"proto\":\"phasehound.shm.v0\","
+                           "\"subtype\":\"shm_map\",\"retain\":true,\"proto\":\"phasehound.shm.v0\","
                            "\"version\":\"0.1\",\"size\":%u,"
                            "\"desc\":\"dummy 1MiB buffer\",\"mode\":\"rw\"}",
                            g_demo.hdr->capacity);
@@ -184,7 +184,7 @@ static void *run(void *arg) {
         /* Handle other frames if subscribing to data feeds */
     }
 
-    close(fd);
+    ph_conn_close(fd);
     return NULL;
 }
 
@@ -207,7 +207,7 @@ bool plugin_init(const plugin_ctx_t *ctx, plugin_caps_t *out) {
     return true;
 }
 
-bool plugin_start(void) { return pthread_create(&g_thr, NULL, run, NULL) == 0; }
+bool plugin_start(void) { return ph_thread_start(&g_thr, "ctrl", PH_WORKER_BACKGROUND, run, NULL) == 0; }
 
 void plugin_stop(void) {
     atomic_store(&g_run, 0);
@@ -85,7 +85,7 @@ static void trim_left(const char **p){ while(**p==' ' || **p=='\t') (*p)++; }
 static int parse_u64(const char *s, uint64_t *out){ char *e=NULL; unsigned long long v=strtoull(s,&e,0); if(e==s) return -1; *out=(uint64_t)v; return 0; }
 static int parse_boolish(const char *s, int *out){ if(!s) return -1; if(!strcasecmp(s,"1")||!strcasecmp(s,"on")||!strcasecmp(s,"true")||!strcasecmp(s,"yes")){*out=1;return 0;} if(!strcasecmp(s,"0")||!strcasecmp(s,"off")||!strcasecmp(s,"false")||!strcasecmp(s,"no")){*out=0;return 0;} return -1; }
 static const char *kind_str(ph_stream_kind_t k){ return k==PH_STREAM_KIND_IQ?"iq":(k==PH_STREAM_KIND_AUDIO?"audio":"unknown"); }
-static const char *enc_str(ph_stream_encoding_t e){ switch(e){ case PH_STREAM_ENCODING_CF32:return "cf32"; case PH_STREAM_ENCODING_CS16:return "cs16"; case PH_STREAM_ENCODING_F32:return "f32"; case PH_STREAM_ENCODING_S16:return "s16"; default:return "unknown"; } }
+static const char *enc_str(ph_stream_encoding_t e){ switch(e){ case PH_STREAM_ENCODING_CF32:return "cf32"; case PH_STREAM_ENCODING_CS16:return "cs16"; case PH_STREAM_ENCODING_F32:return "f32"; case PH_STREAM_ENCODING_S16:return "s16"; case PH_STREAM_ENCODING_CU8:return "cu8"; case PH_STREAM_ENCODING_CS8:return "cs8"; default:return "unknown"; } }
 
 static void target_init(sink_target_t *t, const char *label, ph_stream_kind_t want){
     memset(t, 0, sizeof *t);
@@ -552,7 +552,7 @@ static void *ctrl_thread(void *arg){
         }
         if(infd>=0) close(infd);
     }
-    close(fd);
+    ph_conn_close(fd);
     return NULL;
 }
 
@@ -571,7 +571,9 @@ bool plugin_init(const plugin_ctx_t *ctx, plugin_caps_t *out){
     S.ctrl.fd=-1;
     target_init(&S.iq,"iq",PH_STREAM_KIND_IQ);
     target_init(&S.au,"audio",PH_STREAM_KIND_AUDIO);
-    static const char *CONS[]={"filesink.config.in","<iq/audio ring info feed>",NULL};
+    /* data feeds: the usual iq-source/pcm-source subscriptions (autoload order) */
+    static const char *CONS[]={"filesink.config.in","soapy.IQ-info","filesource.IQ-info",
+                               "wfmd.audio-info","filesource.audio-info",NULL};
     static const char *PROD[]={"filesink.config.out",NULL};
     if(out){ out->caps_size=sizeof *out; out->name=plugin_name(); out->version="0.2.0-dual"; out->consumes=CONS; out->produces=PROD; out->feat_bits=PH_FEAT_IQ|PH_FEAT_PCM; }
     return true;
@@ -579,8 +581,8 @@ bool plugin_init(const plugin_ctx_t *ctx, plugin_caps_t *out){
 
 bool plugin_start(void){
     atomic_store(&S.run,1);
-    if(pthread_create(&S.io_thr,NULL,io_thread,NULL)!=0) return false;
-    if(pthread_create(&S.ctrl_thr,NULL,ctrl_thread,NULL)!=0){ atomic_store(&S.run,0); pthread_join(S.io_thr,NULL); return false; }
+    if(ph_thread_start(&S.io_thr,"io",PH_WORKER_BACKGROUND,io_thread,NULL)!=0) return false;
+    if(ph_thread_start(&S.ctrl_thr,"ctrl",PH_WORKER_BACKGROUND,ctrl_thread,NULL)!=0){ atomic_store(&S.run,0); pthread_join(S.io_thr,NULL); return false; }
     return true;
 }
 
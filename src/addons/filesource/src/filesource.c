@@ -39,7 +39,9 @@ typedef struct {
     _Atomic int run;
     _Atomic int started;
     _Atomic int io_joinable;
+    _Atomic int fused;          /* a core pipeline calls plugin_process instead of io_thread */
     pthread_mutex_t mu;
+    pthread_mutex_t io_mu;      /* start/stop/fuse: who owns the replay */
 
     char path[512];
     file_fmt_t file_fmt;
@@ -61,6 +63,11 @@ typedef struct {
     phau_hdr_t *au;
     size_t map_bytes;
 
+    FILE *fp;                   /* replay cursor, under mu */
+    uint8_t *buf;
+    size_t bufcap;
+    uint64_t sample_index;
+
     _Atomic uint64_t bytes_read;
     _Atomic uint64_t bytes_written;
     _Atomic uint64_t blocks;
@@ -76,11 +83,18 @@ static int parse_u64(const char *s, uint64_t *out){ char *e=NULL; unsigned long
 static int parse_double(const char *s, double *out){ char *e=NULL; double v=strtod(s,&e); if(e==s) return -1; *out=v; return 0; }
 static int parse_boolish(const char *s, int *out){ if(!s) return -1; if(!strcasecmp(s,"1")||!strcasecmp(s,"on")||!strcasecmp(s,"true")||!strcasecmp(s,"yes")){*out=1;return 0;} if(!strcasecmp(s,"0")||!strcasecmp(s,"off")||!strcasecmp(s,"false")||!strcasecmp(s,"no")){*out=0;return 0;} return -1; }
 
-static size_t bytes_per_unit(ph_stream_kind_t kind, ph_stream_encoding_t enc, uint32_t ch){
-    if(kind == PH_STREAM_KIND_IQ){
-        if(enc == PH_STREAM_ENCODING_CF32) return 8;
-        if(enc == PH_STREAM_ENCODING_CS16) return 4;
+static uint32_t iq_fmt_from_encoding(ph_stream_encoding_t enc){
+    switch(enc){
+    case PH_STREAM_ENCODING_CF32: return PHIQ_FMT_CF32;
+    case PH_STREAM_ENCODING_CS16: return PHIQ_FMT_CS16;
+    case PH_STREAM_ENCODING_CU8:  return PHIQ_FMT_CU8;
+    case PH_STREAM_ENCODING_CS8:  return PHIQ_FMT_CS8;
+    default:                      return 0;
     }
+}
+
+static size_t bytes_per_unit(ph_stream_kind_t kind, ph_stream_encoding_t enc, uint32_t ch){
+    if(kind == PH_STREAM_KIND_IQ) return phiq_fmt_bytes(iq_fmt_from_encoding(enc));
     if(kind == PH_STREAM_KIND_AUDIO){
         size_t b = 0;
         if(enc == PH_STREAM_ENCODING_F32) b = 4;
@@ -90,21 +104,18 @@ static size_t bytes_per_unit(ph_stream_kind_t kind, ph_stream_encoding_t enc, ui
     return 0;
 }
 
-static uint32_t iq_fmt_from_encoding(ph_stream_encoding_t enc){
-    return enc == PH_STREAM_ENCODING_CF32 ? PHIQ_FMT_CF32 : PHIQ_FMT_CS16;
-}
 static uint32_t au_fmt_from_encoding(ph_stream_encoding_t enc){
     return enc == PH_STREAM_ENCODING_F32 ? PHAU_FMT_F32 : PHAU_FMT_S16;
 }
 static const char *kind_str(ph_stream_kind_t k){ return k==PH_STREAM_KIND_IQ?"iq":(k==PH_STREAM_KIND_AUDIO?"audio":"unknown"); }
 static const char *enc_str(ph_stream_encoding_t e){
-    switch(e){ case PH_STREAM_ENCODING_CF32:return "cf32"; case PH_STREAM_ENCODING_CS16:return "cs16"; case PH_STREAM_ENCODING_F32:return "f32"; case PH_STREAM_ENCODING_S16:return "s16"; default:return "unknown"; }
+    switch(e){ case PH_STREAM_ENCODING_CF32:return "cf32"; case PH_STREAM_ENCODING_CS16:return "cs16"; case PH_STREAM_ENCODING_F32:return "f32"; case PH_STREAM_ENCODING_S16:return "s16"; case PH_STREAM_ENCODING_CU8:return "cu8"; case PH_STREAM_ENCODING_CS8:return "cs8"; default:return "unknown"; }
 }
 
 static int stream_config_valid(void){
     if(S.sample_rate <= 0.0 || S.channels < 1 || S.channels > 64) return 0;
     if(S.kind == PH_STREAM_KIND_IQ)
-        return S.encoding == PH_STREAM_ENCODING_CF32 || S.encoding == PH_STREAM_ENCODING_CS16;
+        return iq_fmt_from_encoding(S.encoding) != 0;
     if(S.kind == PH_STREAM_KIND_AUDIO)
         return S.encoding == PH_STREAM_ENCODING_F32 || S.encoding == PH_STREAM_ENCODING_S16;
     return 0;
@@ -117,6 +128,8 @@ static void join_io_thread(void){
 static int set_type(const char *s){
     if(!strcasecmp(s,"iq-cf32") || !strcasecmp(s,"cf32")){ S.kind=PH_STREAM_KIND_IQ; S.encoding=PH_STREAM_ENCODING_CF32; return 0; }
     if(!strcasecmp(s,"iq-cs16") || !strcasecmp(s,"cs16")){ S.kind=PH_STREAM_KIND_IQ; S.encoding=PH_STREAM_ENCODING_CS16; return 0; }
+    if(!strcasecmp(s,"iq-cu8") || !strcasecmp(s,"cu8")){ S.kind=PH_STREAM_KIND_IQ; S.encoding=PH_STREAM_ENCODING_CU8; return 0; }
+    if(!strcasecmp(s,"iq-cs8") || !strcasecmp(s,"cs8")){ S.kind=PH_STREAM_KIND_IQ; S.encoding=PH_STREAM_ENCODING_CS8; return 0; }
     if(!strcasecmp(s,"audio-f32") || !strcasecmp(s,"pcm-f32") || !strcasecmp(s,"f32")){ S.kind=PH_STREAM_KIND_AUDIO; S.encoding=PH_STREAM_ENCODING_F32; return 0; }
     if(!strcasecmp(s,"audio-s16") || !strcasecmp(s,"pcm-s16") || !strcasecmp(s,"s16")){ S.kind=PH_STREAM_KIND_AUDIO; S.encoding=PH_STREAM_ENCODING_S16; return 0; }
     return -1;
@@ -157,7 +170,7 @@ static void publish_ring_locked(void){
     const char *proto = S.kind == PH_STREAM_KIND_IQ ? PH_PROTO_IQ_RING : PH_PROTO_AUDIO_RING;
     const char *mode = "r";
     int n = snprintf(js, sizeof js,
-        "{\"type\":\"publish\",\"feed\":\"%s\",\"subtype\":\"shm_map\","
+        "{\"type\":\"publish\",\"feed\":\"%s\",\"subtype\":\"shm_map\",\"retain\":true,"
         "\"proto\":\"%s\",\"version\":\"0.1\",\"size\":%zu,\"mode\":\"%s\","
         "\"kind\":\"%s\",\"encoding\":\"%s\",\"sample_rate\":%.0f,\"channels\":%u,"
         "\"center_freq\":%.0f,\"antenna_id\":%u,\"metadata\":\"reserved64.ph-ring-meta.v0\","
@@ -233,83 +246,120 @@ static int source_prepare(FILE **out_fp){
     return 0;
 }
 
-static void *io_thread(void *arg){
-    (void)arg;
-    FILE *fp = NULL;
-    uint8_t *buf = NULL;
-    size_t bufcap = 0;
-    uint64_t sample_index = 0;
+/* ---------- replay: one block per step, from io_thread or plugin_process ---------- */
 
-    pthread_mutex_lock(&S.mu);
-    int prep = source_prepare(&fp);
-    pthread_mutex_unlock(&S.mu);
-    if(prep != 0){ atomic_store(&S.eof, 1); atomic_store(&S.started, 0); return NULL; }
+static int grow_buf_locked(size_t want){
+    if(want <= S.bufcap) return 0;
+    uint8_t *nb = realloc(S.buf, want);
+    if(!nb) return -1;
+    S.buf = nb; S.bufcap = want;
+    return 0;
+}
 
-    while(atomic_load(&S.run) && atomic_load(&S.started)){
-        size_t want = S.block_bytes ? S.block_bytes : (256u * 1024u);
-        ph_timestamp_v0_t ts = ph_timestamp_unknown();
-        size_t nread = 0;
-
-        if(S.file_fmt == FMT_PHCAP){
-            ph_file_block_hdr_v0_t bh;
-            if(fread(&bh, 1, sizeof bh, fp) != sizeof bh || !ph_file_block_valid(&bh)){
-                if(S.loop){ atomic_fetch_add(&S.loops,1); fseek(fp, (long)sizeof(ph_file_hdr_v0_t), SEEK_SET); continue; }
-                atomic_store(&S.eof, 1); break;
-            }
-            if(bh.payload_bytes > (64ull<<20)){ atomic_fetch_add(&S.short_reads,1); atomic_store(&S.eof,1); break; }
-            want = (size_t)bh.payload_bytes;
-            if(want > bufcap){ uint8_t *nb = realloc(buf, want); if(!nb) break; buf=nb; bufcap=want; }
-            nread = fread(buf, 1, want, fp);
-            if(nread != want){ atomic_fetch_add(&S.short_reads,1); if(S.loop){ fseek(fp, (long)sizeof(ph_file_hdr_v0_t), SEEK_SET); continue; } atomic_store(&S.eof,1); break; }
-            ts = ph_file_block_timestamp(&bh);
-            if(!(ts.quality & PH_TS_QUALITY_VALID)) ts = generated_timestamp(sample_index);
-        } else {
-            size_t unit = bytes_per_unit(S.kind, S.encoding, S.channels);
-            if(unit == 0){ atomic_store(&S.eof,1); break; }
-            want -= want % unit;
-            if(want == 0) want = unit;
-            if(want > bufcap){ uint8_t *nb = realloc(buf, want); if(!nb) break; buf=nb; bufcap=want; }
-            nread = fread(buf, 1, want, fp);
-            nread -= nread % unit;
-            if(nread == 0){
-                if(S.loop){ atomic_fetch_add(&S.loops,1); clearerr(fp); fseek(fp, 0, SEEK_SET); continue; }
-                atomic_store(&S.eof,1); break;
-            }
-            ts = generated_timestamp(sample_index);
+static void reader_close_locked(void){
+    if(S.fp) fclose(S.fp);
+    S.fp = NULL;
+}
+
+/* Next block. Raw files read straight into dst (at most cap bytes) when one
+ * is given, PHCAP blocks and dst == NULL use S.buf. Returns 1 with the block
+ * in blk and len, 0 after a loop rewind (try again), -1 when the replay is over. */
+static int source_read_locked(uint8_t *dst, size_t cap, const uint8_t **blk, size_t *len, ph_timestamp_v0_t *ts){
+    FILE *fp = S.fp;
+    if(!fp) return -1;
+    size_t want = S.block_bytes ? S.block_bytes : (256u * 1024u);
+    size_t nread = 0;
+
+    if(S.file_fmt == FMT_PHCAP){
+        ph_file_block_hdr_v0_t bh;
+        if(fread(&bh, 1, sizeof bh, fp) != sizeof bh || !ph_file_block_valid(&bh)){
+            if(S.loop){ atomic_fetch_add(&S.loops,1); fseek(fp, (long)sizeof(ph_file_hdr_v0_t), SEEK_SET); return 0; }
+            atomic_store(&S.eof, 1); return -1;
         }
+        if(bh.payload_bytes > (64ull<<20)){ atomic_fetch_add(&S.short_reads,1); atomic_store(&S.eof,1); return -1; }
+        want = (size_t)bh.payload_bytes;
+        if(grow_buf_locked(want) != 0) return -1;
+        nread = fread(S.buf, 1, want, fp);
+        if(nread != want){ atomic_fetch_add(&S.short_reads,1); if(S.loop){ fseek(fp, (long)sizeof(ph_file_hdr_v0_t), SEEK_SET); return 0; } atomic_store(&S.eof,1); return -1; }
+        *ts = ph_file_block_timestamp(&bh);
+        if(!(ts->quality & PH_TS_QUALITY_VALID)) *ts = generated_timestamp(S.sample_index);
+        *blk = S.buf; *len = nread;
+        return 1;
+    }
+
+    size_t unit = bytes_per_unit(S.kind, S.encoding, S.channels);
+    if(unit == 0){ atomic_store(&S.eof,1); return -1; }
+    if(dst && cap >= unit && want > cap) want = cap;
+    want -= want % unit;
+    if(want == 0) want = unit;
+    if(!dst || want > cap){
+        if(grow_buf_locked(want) != 0) return -1;
+        dst = S.buf;
+    }
+    nread = fread(dst, 1, want, fp);
+    nread -= nread % unit;
+    if(nread == 0){
+        if(S.loop){ atomic_fetch_add(&S.loops,1); clearerr(fp); fseek(fp, 0, SEEK_SET); return 0; }
+        atomic_store(&S.eof,1); return -1;
+    }
+    *ts = generated_timestamp(S.sample_index);
+    *blk = dst; *len = nread;
+    return 1;
+}
+
+static size_t ring_write_locked(const uint8_t *blk, size_t len, const ph_timestamp_v0_t *ts){
+    if(S.kind == PH_STREAM_KIND_IQ && S.iq) return ph_iq_ring_write(S.iq, blk, len, ts);
+    if(S.kind == PH_STREAM_KIND_AUDIO && S.au) return ph_audio_ring_write_raw(S.au, blk, len, ts);
+    return 0;
+}
 
+static void account_locked(size_t nread, size_t wrote){
+    atomic_fetch_add(&S.bytes_read, nread);
+    atomic_fetch_add(&S.bytes_written, wrote);
+    atomic_fetch_add(&S.blocks, 1);
+    size_t unit = bytes_per_unit(S.kind, S.encoding, S.channels);
+    if(unit) S.sample_index += wrote / unit;
+}
+
+/* runs until the replay ends or stops, or a pipeline takes it over */
+static void *io_thread(void *arg){
+    (void)arg;
+    while(atomic_load(&S.run) && atomic_load(&S.started) && !atomic_load(&S.fused)){
+        const uint8_t *blk = NULL;
+        size_t len = 0, wrote = 0;
+        ph_timestamp_v0_t ts = ph_timestamp_unknown();
         pthread_mutex_lock(&S.mu);
-        size_t wrote = 0;
-        if(S.kind == PH_STREAM_KIND_IQ && S.iq) wrote = ph_iq_ring_write(S.iq, buf, nread, &ts);
-        else if(S.kind == PH_STREAM_KIND_AUDIO && S.au) wrote = ph_audio_ring_write_raw(S.au, buf, nread, &ts);
+        int rc = source_read_locked(NULL, 0, &blk, &len, &ts);
+        if(rc > 0){ wrote = ring_write_locked(blk, len, &ts); account_locked(len, wrote); }
+        if(rc < 0) reader_close_locked();
         pthread_mutex_unlock(&S.mu);
-
-        atomic_fetch_add(&S.bytes_read, nread);
-        atomic_fetch_add(&S.bytes_written, wrote);
-        atomic_fetch_add(&S.blocks, 1);
-        size_t unit = bytes_per_unit(S.kind, S.encoding, S.channels);
-        if(unit) sample_index += wrote / unit;
+        if(rc < 0){ atomic_store(&S.started, 0); break; }
         sleep_for_payload(wrote);
     }
-
-    free(buf);
-    if(fp) fclose(fp);
-    atomic_store(&S.started, 0);
     return NULL;
 }
 
+static int spawn_io_thread(void){
+    atomic_store(&S.io_joinable,1);
+    if(ph_thread_start(&S.io_thr,"io",PH_WORKER_BACKGROUND,io_thread,NULL)!=0){
+        atomic_store(&S.io_joinable,0); atomic_store(&S.started,0);
+        return -1;
+    }
+    return 0;
+}
+
 static void on_cmd(ph_ctrl_t *c, const char *line, void *user){
     (void)user;
     trim_left(&line);
     if(strncmp(line,"help",4)==0){
-        ph_reply(c, "{\"ok\":true,\"help\":\"help|path <file>|format raw|phcap|type iq-cf32|iq-cs16|audio-f32|audio-s16|sr <Hz>|cf <Hz>|channels <n>|ring <bytes>|block <bytes>|metadata none|latest|clock host|sample|antenna <id>|loop <0|1>|throttle <0|1>|open|start|stop|status\"}");
+        ph_reply(c, "{\"ok\":true,\"help\":\"help|path <file>|format raw|phcap|type iq-cf32|iq-cs16|iq-cu8|iq-cs8|audio-f32|audio-s16|sr <Hz>|cf <Hz>|channels <n>|ring <bytes>|block <bytes>|metadata none|latest|clock host|sample|antenna <id>|loop <0|1>|throttle <0|1>|open|start|stop|status\"}");
         return;
     }
     if(strncmp(line,"path ",5)==0){ line+=5; trim_left(&line); pthread_mutex_lock(&S.mu); snprintf(S.path,sizeof S.path,"%s",line); pthread_mutex_unlock(&S.mu); ph_reply_okf(c,"path=%s", line); return; }
     if(strncmp(line,"format ",7)==0){ const char *v=line+7; trim_left(&v); if(!strcasecmp(v,"raw")) S.file_fmt=FMT_RAW; else if(!strcasecmp(v,"phcap")) S.file_fmt=FMT_PHCAP; else {ph_reply_err(c,"format expects raw or phcap");return;} ph_reply_okf(c,"format=%s", v); return; }
     if(strncmp(line,"type ",5)==0){ const char *v=line+5; trim_left(&v); if(set_type(v)!=0){ph_reply_err(c,"bad type");return;} ph_reply_okf(c,"type=%s/%s", kind_str(S.kind), enc_str(S.encoding)); return; }
     if(strncmp(line,"kind ",5)==0){ const char *v=line+5; trim_left(&v); if(!strcasecmp(v,"iq")) S.kind=PH_STREAM_KIND_IQ; else if(!strcasecmp(v,"audio")||!strcasecmp(v,"pcm")) S.kind=PH_STREAM_KIND_AUDIO; else {ph_reply_err(c,"kind expects iq or audio");return;} ph_reply_okf(c,"kind=%s", kind_str(S.kind)); return; }
-    if(strncmp(line,"encoding ",9)==0){ const char *v=line+9; trim_left(&v); if(!strcasecmp(v,"cf32")) S.encoding=PH_STREAM_ENCODING_CF32; else if(!strcasecmp(v,"cs16")) S.encoding=PH_STREAM_ENCODING_CS16; else if(!strcasecmp(v,"f32")) S.encoding=PH_STREAM_ENCODING_F32; else if(!strcasecmp(v,"s16")) S.encoding=PH_STREAM_ENCODING_S16; else {ph_reply_err(c,"bad encoding");return;} ph_reply_okf(c,"encoding=%s", enc_str(S.encoding)); return; }
+    if(strncmp(line,"encoding ",9)==0){ const char *v=line+9; trim_left(&v); if(!strcasecmp(v,"cf32")) S.encoding=PH_STREAM_ENCODING_CF32; else if(!strcasecmp(v,"cs16")) S.encoding=PH_STREAM_ENCODING_CS16; else if(!strcasecmp(v,"f32")) S.encoding=PH_STREAM_ENCODING_F32; else if(!strcasecmp(v,"s16")) S.encoding=PH_STREAM_ENCODING_S16; else if(!strcasecmp(v,"cu8")) S.encoding=PH_STREAM_ENCODING_CU8; else if(!strcasecmp(v,"cs8")) S.encoding=PH_STREAM_ENCODING_CS8; else {ph_reply_err(c,"bad encoding");return;} ph_reply_okf(c,"encoding=%s", enc_str(S.encoding)); return; }
     if(strncmp(line,"sr ",3)==0 || strncmp(line,"sample_rate ",12)==0){ const char *v = line + (line[1]=='r'?3:12); double d; if(parse_double(v,&d)||d<=0){ph_reply_err(c,"bad sample rate");return;} S.sample_rate=d; ph_reply_okf(c,"sr=%.0f",d); return; }
     if(strncmp(line,"cf ",3)==0 || strncmp(line,"center_freq ",12)==0){ const char *v = line + (line[1]=='f'?3:12); double d; if(parse_double(v,&d)){ph_reply_err(c,"bad center freq");return;} S.center_freq=d; ph_reply_okf(c,"cf=%.0f",d); return; }
     if(strncmp(line,"channels ",9)==0){ uint64_t v; if(parse_u64(line+9,&v)||v<1||v>64){ph_reply_err(c,"bad channels");return;} S.channels=(uint32_t)v; ph_reply_okf(c,"channels=%u",S.channels); return; }
@@ -333,20 +383,34 @@ static void on_cmd(ph_ctrl_t *c, const char *line, void *user){
     }
     if(strncmp(line,"start",5)==0){
         if(atomic_load(&S.started)){ ph_reply_ok(c,"already started"); return; }
-        join_io_thread();
         if(!S.path[0]){ ph_reply_err(c,"path unset"); return; }
+        pthread_mutex_lock(&S.io_mu);
+        join_io_thread();
         atomic_store(&S.eof,0); atomic_store(&S.bytes_read,0); atomic_store(&S.bytes_written,0);
         atomic_store(&S.blocks,0); atomic_store(&S.loops,0); atomic_store(&S.short_reads,0);
-        atomic_store(&S.started,1); atomic_store(&S.io_joinable,1);
-        if(pthread_create(&S.io_thr,NULL,io_thread,NULL)!=0){
-            atomic_store(&S.io_joinable,0); atomic_store(&S.started,0);
-            ph_reply_err(c,"pthread_create failed"); return;
+        pthread_mutex_lock(&S.mu);
+        reader_close_locked();
+        S.sample_index = 0;
+        int rc = source_prepare(&S.fp); int saved_errno = errno;
+        pthread_mutex_unlock(&S.mu);
+        if(rc != 0){
+            atomic_store(&S.eof,1);
+            pthread_mutex_unlock(&S.io_mu);
+            ph_reply_errf(c,"open failed: %s", strerror(saved_errno ? saved_errno : EINVAL)); return;
         }
+        atomic_store(&S.started,1);
+        /* fused: the pipeline's plugin_process calls pick the replay up */
+        rc = atomic_load(&S.fused) ? 0 : spawn_io_thread();
+        pthread_mutex_unlock(&S.io_mu);
+        if(rc != 0){ ph_reply_err(c,"thread start failed"); return; }
         ph_reply_ok(c,"started"); return;
     }
     if(strncmp(line,"stop",4)==0){
+        pthread_mutex_lock(&S.io_mu);
         atomic_store(&S.started,0);
         join_io_thread();
+        pthread_mutex_lock(&S.mu); reader_close_locked(); pthread_mutex_unlock(&S.mu);
+        pthread_mutex_unlock(&S.io_mu);
         ph_reply_ok(c,"stopped"); return;
     }
     if(strncmp(line,"status",6)==0){
@@ -356,7 +420,7 @@ static void on_cmd(ph_ctrl_t *c, const char *line, void *user){
         if(S.iq){ w=atomic_load(&S.iq->wpos); ph_ring_meta_get_iq(S.iq,&m); }
         else if(S.au){ w=atomic_load(&S.au->wpos); ph_ring_meta_get_audio(S.au,&m); }
         pthread_mutex_unlock(&S.mu);
-        snprintf(js,sizeof js,"{\"ok\":true,\"started\":%d,\"eof\":%d,\"path\":\"%s\",\"format\":\"%s\",\"kind\":\"%s\",\"encoding\":\"%s\",\"sr\":%.0f,\"cf\":%.0f,\"channels\":%u,\"ring_bytes\":%zu,\"block_bytes\":%zu,\"loop\":%d,\"throttle\":%d,\"wpos\":%llu,\"bytes_read\":%llu,\"bytes_written\":%llu,\"blocks\":%llu,\"loops\":%llu,\"short_reads\":%llu,\"drop_bytes\":%llu}", atomic_load(&S.started), atomic_load(&S.eof), path_esc, S.file_fmt==FMT_PHCAP?"phcap":"raw", kind_str(S.kind), enc_str(S.encoding), S.sample_rate, S.center_freq, S.channels, S.ring_bytes, S.block_bytes, S.loop, S.throttle, (unsigned long long)w, (unsigned long long)atomic_load(&S.bytes_read), (unsigned long long)atomic_load(&S.bytes_written), (unsigned long long)atomic_load(&S.blocks), (unsigned long long)atomic_load(&S.loops), (unsigned long long)atomic_load(&S.short_reads), (unsigned long long)ph_u32_pair_get(m.drop_lo,m.drop_hi));
+        snprintf(js,sizeof js,"{\"ok\":true,\"started\":%d,\"fused\":%d,\"eof\":%d,\"path\":\"%s\",\"format\":\"%s\",\"kind\":\"%s\",\"encoding\":\"%s\",\"sr\":%.0f,\"cf\":%.0f,\"channels\":%u,\"ring_bytes\":%zu,\"block_bytes\":%zu,\"loop\":%d,\"throttle\":%d,\"wpos\":%llu,\"bytes_read\":%llu,\"bytes_written\":%llu,\"blocks\":%llu,\"loops\":%llu,\"short_reads\":%llu,\"drop_bytes\":%llu}", atomic_load(&S.started), atomic_load(&S.fused), atomic_load(&S.eof), path_esc, S.file_fmt==FMT_PHCAP?"phcap":"raw", kind_str(S.kind), enc_str(S.encoding), S.sample_rate, S.center_freq, S.channels, S.ring_bytes, S.block_bytes, S.loop, S.throttle, (unsigned long long)w, (unsigned long long)atomic_load(&S.bytes_read), (unsigned long long)atomic_load(&S.bytes_written), (unsigned long long)atomic_load(&S.blocks), (unsigned long long)atomic_load(&S.loops), (unsigned long long)atomic_load(&S.short_reads), (unsigned long long)ph_u32_pair_get(m.drop_lo,m.drop_hi));
         ph_reply(c,js); return;
     }
     ph_reply_err(c,"unknown");
@@ -374,7 +438,7 @@ static void *ctrl_thread(void *arg){
         if(got <= 0) continue;
         ph_ctrl_dispatch(&S.ctrl, js, (size_t)got, on_cmd, NULL);
     }
-    close(fd);
+    ph_conn_close(fd);
     return NULL;
 }
 
@@ -384,6 +448,7 @@ bool plugin_init(const plugin_ctx_t *ctx, plugin_caps_t *out){
     PH_ENSURE_ABI(ctx);
     memset(&S,0,sizeof S);
     pthread_mutex_init(&S.mu,NULL);
+    pthread_mutex_init(&S.io_mu,NULL);
     S.sock = ctx->sock_path;
     S.file_fmt = FMT_RAW;
     S.meta_mode = META_LATEST;
@@ -408,7 +473,7 @@ bool plugin_init(const plugin_ctx_t *ctx, plugin_caps_t *out){
 
 bool plugin_start(void){
     atomic_store(&S.run,1);
-    return pthread_create(&S.ctrl_thr,NULL,ctrl_thread,NULL)==0;
+    return ph_thread_start(&S.ctrl_thr,"ctrl",PH_WORKER_BACKGROUND,ctrl_thread,NULL)==0;
 }
 
 void plugin_stop(void){
@@ -416,6 +481,52 @@ void plugin_stop(void){
     atomic_store(&S.started,0);
     pthread_join(S.ctrl_thr,NULL);
     join_io_thread();
-    pthread_mutex_lock(&S.mu); close_ring_locked(); pthread_mutex_unlock(&S.mu);
+    pthread_mutex_lock(&S.mu);
+    reader_close_locked();
+    close_ring_locked();
+    free(S.buf); S.buf = NULL; S.bufcap = 0;
+    pthread_mutex_unlock(&S.mu);
     pthread_mutex_destroy(&S.mu);
+    pthread_mutex_destroy(&S.io_mu);
+}
+
+/* pipeline source: the next replay block goes to the next stage instead of
+ * the ring, read straight into its buffer for raw files. A throttled replay
+ * paces the whole pipeline. */
+int plugin_process(const plugin_ctx_t *ctx, const ph_spans_t *in, ph_spans_t *out){
+    (void)ctx; (void)in;
+    ph_span_t *o = out->n ? &out->v[0] : NULL;
+    if(o) o->bytes = 0;
+    if(!atomic_load(&S.started)) return 0;
+
+    const uint8_t *blk = NULL;
+    size_t len = 0, wrote = 0;
+    ph_timestamp_v0_t ts = ph_timestamp_unknown();
+    pthread_mutex_lock(&S.mu);
+    int rc = source_read_locked(o ? (uint8_t*)o->data : NULL, o ? o->cap : 0, &blk, &len, &ts);
+    if(rc > 0 && o){
+        o->data = (void*)blk; o->bytes = len; wrote = len;
+        o->kind = S.kind == PH_STREAM_KIND_IQ ? PH_SPAN_IQ : PH_SPAN_PCM;
+        o->fmt = S.kind == PH_STREAM_KIND_IQ ? iq_fmt_from_encoding(S.encoding) : au_fmt_from_encoding(S.encoding);
+        o->channels = S.channels ? S.channels : 1;
+        o->sample_rate = S.sample_rate;
+        o->ts = ts;
+    }else if(rc > 0){
+        wrote = ring_write_locked(blk, len, &ts);
+    }
+    if(rc > 0) account_locked(len, wrote);
+    if(rc < 0) reader_close_locked();
+    pthread_mutex_unlock(&S.mu);
+    if(rc < 0) atomic_store(&S.started, 0);
+    sleep_for_payload(wrote);
+    return 0;
+}
+
+bool plugin_fuse(bool on){
+    pthread_mutex_lock(&S.io_mu);
+    atomic_store(&S.fused, on ? 1 : 0);
+    if(on) join_io_thread();   /* it returns at the next block and leaves the cursor */
+    else if(atomic_load(&S.started) && !atomic_load(&S.io_joinable)) spawn_io_thread();
+    pthread_mutex_unlock(&S.io_mu);
+    return true;
 }
@@ -434,14 +434,9 @@ static size_t lorad_from_ring(void) {
     const float *iq_f32;
     if (fmt==PHIQ_FMT_CF32) {
         iq_f32=(const float*)g_raw_buf;
-    } else if (fmt==PHIQ_FMT_CS16) {
+    } else if (phiq_fmt_bytes(fmt)) {
         if (ensure_fcap(&g_tmp_f, &g_tmp_cap, nsamp*2)) return bytes;
-        const int16_t *s=(const int16_t*)g_raw_buf;
-        const float sc=1.0f/32768.0f;
-        for (size_t i=0;i<nsamp;i++) {
-            g_tmp_f[2*i+0]=(float)s[2*i+0]*sc;
-            g_tmp_f[2*i+1]=(float)s[2*i+1]*sc;
-        }
+        ph_dsp_iq_to_cf32(fmt, g_raw_buf, g_tmp_f, nsamp);
         iq_f32=g_tmp_f;
     } else {
         return bytes;
@@ -638,7 +633,7 @@ static void *ctrl_run(void *arg) {
         }
         if (infd>=0) close(infd);
     }
-    close(fd);
+    ph_conn_close(fd);
     return NULL;
 }
 
@@ -648,7 +643,8 @@ const char* plugin_name(void) { return "lorad"; }
 bool plugin_init(const plugin_ctx_t *ctx, plugin_caps_t *out) {
     PH_ENSURE_ABI(ctx);
     g_sock = ctx->sock_path;
-    static const char *CONS[] = { "lorad.config.in", NULL };
+    /* data feeds: the IQ sources it is usually subscribed to (autoload order) */
+    static const char *CONS[] = { "lorad.config.in", "soapy.IQ-info", "filesource.IQ-info", NULL };
     static const char *PROD[] = { "lorad.config.out", "lorad.packets", NULL };
     if (out) {
         out->caps_size  = sizeof *out;
@@ -663,11 +659,11 @@ bool plugin_init(const plugin_ctx_t *ctx, plugin_caps_t *out) {
 
 bool plugin_start(void) {
     atomic_store(&g_run, 1);
-    if (pthread_create(&g_ctrl_thr, NULL, ctrl_run, NULL)!=0) {
+    if (ph_thread_start(&g_ctrl_thr, "ctrl", PH_WORKER_BACKGROUND, ctrl_run, NULL)!=0) {
         atomic_store(&g_run, 0); return false;
     }
     atomic_store(&g_ctrl_started, true);
-    if (pthread_create(&g_dsp_thr, NULL, dsp_run, NULL)!=0) {
+    if (ph_thread_start(&g_dsp_thr, "dsp", PH_WORKER_DSP, dsp_run, NULL)!=0) {
         atomic_store(&g_run, 0);
         pthread_join(g_ctrl_thr, NULL);
         atomic_store(&g_ctrl_started, false);
@@ -8,6 +8,7 @@
 #include <stdatomic.h>
 #include <limits.h>
 #include <pthread.h>
+#include <sched.h>
 #include <errno.h>
 #include <stdint.h>
 #include <stdbool.h>
@@ -45,37 +46,131 @@ static bool parse_int(const char *s, int *out) {
 }
 
 /* ---------- addon state ---------- */
+/* The control thread owns g_dev and the ring mapping. The RX thread never
+ * takes a lock: while g_active is set it owns the open stream (g_rx) and
+ * receives parameter changes through g_rxq, applying them between reads.
+ * Control gets the stream back with rx_park() before setup or teardown. */
 static const char *g_sock = NULL;
 static pthread_t   g_thr;
 static pthread_t   g_rxthr;
 static _Atomic int g_run = 0;
 static _Atomic int g_rx_started = 0;
-static pthread_mutex_t g_dev_mu = PTHREAD_MUTEX_INITIALIZER;
 
 static ph_ctrl_t   g_ctrl;
 static char g_mon_feed[128] = {0};
 
-/* soapy device state */
+/* soapy device state (configuration as last commanded) */
 typedef struct {
     SoapySDRDevice *dev;
     SoapySDRStream *rx;
-    double sr, cf, bw;
+    double sr, cf, bw, gain;
+    bool   gain_set;
+    int    idx;       /* enumeration index of dev */
     int    chan;
     uint32_t antenna_id;
     char clock_source[64];
     char time_source[64];
-    uint64_t read_errors;
-    uint64_t hw_timestamps;
-    uint64_t host_timestamps;
 } soapy_t;
 static soapy_t g_dev = {0};
-static _Atomic int g_active = 0;
-static _Atomic phiq_fmt_t g_fmt = PHIQ_FMT_CF32;
+enum { RX_IDLE, RX_SINGLE, RX_SESSION };
+static _Atomic int g_active = RX_IDLE;   /* control: what RX may stream */
+static _Atomic int g_rx_busy = 0;     /* RX: inside a streaming iteration */
+static _Atomic uint32_t g_fmt = PHIQ_FMT_CF32;   /* 0: the device's native format */
+static bool g_dma = true;             /* use driver buffers directly when offered */
 
-/* IQ shm map */
-static int         g_memfd = -1;
-static phiq_hdr_t *g_hdr = NULL;
-static size_t      g_map_bytes = 0;
+/* RX-side view of the stream, written by control only while parked */
+typedef struct {
+    SoapySDRDevice *dev;
+    SoapySDRStream *rx;
+    phiq_hdr_t     *hdr;
+    size_t          chan;
+    double          sr;
+    uint32_t        antenna_id;
+    uint32_t        src_fmt;      /* stream format; differs from hdr->fmt only with direct */
+    float           src_scale;    /* integer -> CF32 widening: 1/full scale */
+    _Atomic int     direct;       /* acquireReadBuffer path; RX drops it if refused */
+    _Atomic uint64_t read_errors, overflows, late;
+    _Atomic uint64_t overflows_ps, late_ps;   /* last full second */
+    _Atomic uint64_t hw_timestamps, host_timestamps;
+    _Atomic uint64_t cmds_applied, cmds_failed;
+} rx_t;
+static rx_t g_rx;
+
+/* RX thread real-time options (`rt`) */
+static struct { int prio; char cpus[64]; bool mlock; } g_rt;
+
+/* IQ shm maps. Ring 0 carries the single stream and session member 0 on
+ * soapy.IQ-info; session member k > 0 writes ring k on soapy.IQ<k>-info. */
+#define SOAPY_MAX_RX 8
+typedef struct {
+    int         memfd;
+    phiq_hdr_t *hdr;
+    size_t      map_bytes;
+    uint32_t    antenna_id;
+} iq_ring_t;
+static iq_ring_t g_ring[SOAPY_MAX_RX];
+
+/* RX staging buffers, one per stream; only the RX thread touches them */
+static uint8_t g_rxbuf[SOAPY_MAX_RX][1<<16];
+
+/* Session: several channels, on one device or several, started together.
+ * Members are (device index, channel); member k is logical antenna k.
+ * Each device gets one stream over its member channels. */
+typedef struct {
+    int              idx;
+    SoapySDRDevice  *dev;
+    SoapySDRStream  *rx;
+    bool             owned;                 /* made for the session, not g_dev's */
+    size_t           nch;
+    size_t           chan[SOAPY_MAX_RX];
+    int              member[SOAPY_MAX_RX];  /* stream channel -> member/ring */
+    /* RX-owned while streaming */
+    uint64_t         n;                     /* frames delivered */
+    long long        t_first;               /* hardware time of frame 0 */
+    long long        next_ts;               /* expected time of the next block, 0: unknown */
+    _Atomic int      has_ts;
+    _Atomic int64_t  skew_ns;               /* t_first minus device 0's */
+} ses_dev_t;
+
+static struct {
+    int       n;                            /* members configured, 0: single stream */
+    int       dev[SOAPY_MAX_RX], chan[SOAPY_MAX_RX];
+    int       delay_ms;                     /* arm time before the common start */
+    const char *sync;                       /* none|now|pps: zero device clocks first */
+    double    tol_ns;                       /* alignment tolerance, 0: one sample */
+    int       ndev;
+    ses_dev_t d[SOAPY_MAX_RX];
+    bool      timed;
+    long long t_start;
+    _Atomic uint64_t ts_jumps;
+    _Atomic int64_t  start_err_ns;          /* device 0: first sample vs t_start */
+} g_ses = { .delay_ms = 100, .sync = "none" };
+
+/* ---------- control -> RX command queue ---------- */
+/* Single producer (on_cmd), single consumer: the RX thread while streaming,
+ * otherwise control itself once rx_park() has returned. */
+typedef enum { RXC_FREQ, RXC_RATE, RXC_BW, RXC_GAIN, RXC_CLOCK, RXC_TIME, RXC_ANTENNA } rxc_op_t;
+typedef struct { rxc_op_t op; double v; char s[64]; } rxc_t;
+
+#define RXQ_SLOTS 64u
+static struct {
+    rxc_t            slot[RXQ_SLOTS];
+    _Atomic uint32_t head, tail;
+} g_rxq;
+
+static bool rxq_push(const rxc_t *c) {
+    uint32_t t = atomic_load_explicit(&g_rxq.tail, memory_order_relaxed);
+    if (t - atomic_load_explicit(&g_rxq.head, memory_order_acquire) >= RXQ_SLOTS) return false;
+    g_rxq.slot[t % RXQ_SLOTS] = *c;
+    atomic_store_explicit(&g_rxq.tail, t + 1, memory_order_release);
+    return true;
+}
+
+static uint64_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
 
 /* ---------- helpers ---------- */
 static int soapy_subscribe_cb(void *user, const char *usage, const char *feed) {
@@ -100,25 +195,26 @@ static int soapy_unsubscribe_cb(void *user, const char *usage) {
     return 0;
 }
 
-static void publish_iq_memfd(void) {
-    pthread_mutex_lock(&g_dev_mu);
-    int memfd = g_memfd;
-    phiq_hdr_t *h = g_hdr;
-    char js[POC_MAX_JSON];
-    if (memfd < 0 || !h) {
-        pthread_mutex_unlock(&g_dev_mu);
-        return;
-    }
+static void ring_feed(int k, char *out, size_t cap) {
+    if (k == 0) snprintf(out, cap, "%s", FEED_IQ_INFO);
+    else snprintf(out, cap, "soapy.IQ%d-info", k);
+}
+
+static void publish_iq_memfd(int k) {
+    int memfd = g_ring[k].memfd;
+    phiq_hdr_t *h = g_ring[k].hdr;
+    char js[POC_MAX_JSON], feed[32];
+    if (!h) return;
+    ring_feed(k, feed, sizeof feed);
 
-    const char *enc = "unknown";
-    if (h->fmt == PHIQ_FMT_CF32) enc = "cf32";
-    else if (h->fmt == PHIQ_FMT_CS16) enc = "cs16";
+    const char *enc = phiq_fmt_name(h->fmt);
 
     int n = snprintf(js, sizeof js,
         "{"
           "\"type\":\"publish\","
           "\"feed\":\"%s\","
           "\"subtype\":\"shm_map\","
+          "\"retain\":true,"
           "\"proto\":\"" PH_PROTO_IQ_RING "\","
           "\"version\":\"0.1\","
           "\"size\":%u,"
@@ -132,50 +228,58 @@ static void publish_iq_memfd(void) {
           "\"metadata\":\"reserved64.ph-ring-meta.v0\","
           "\"desc\":\"Soapy IQ ring (cf=%.3f MHz,sr=%.3f Msps)\""
         "}",
-        FEED_IQ_INFO, h->capacity, enc, h->sample_rate, h->channels,
-        h->center_freq, g_dev.antenna_id,
+        feed, h->capacity, enc, h->sample_rate, h->channels,
+        h->center_freq, g_ring[k].antenna_id,
         h->center_freq/1e6, h->sample_rate/1e6);
-    pthread_mutex_unlock(&g_dev_mu);
 
     int fds[1] = { memfd };
     if (n > 0) send_frame_json_with_fds(g_ctrl.fd, js, (size_t)n, fds, 1);
 }
 
-static int iq_ring_open_locked(size_t capacity_bytes, double sr, double cf, phiq_fmt_t fmt) {
-    if (g_hdr) { munmap(g_hdr, g_map_bytes); g_hdr = NULL; }
-    if (g_memfd >= 0) { close(g_memfd); g_memfd = -1; }
+static void iq_ring_close(iq_ring_t *r) {
+    if (r->hdr) {
+        munmap(r->hdr, r->map_bytes);
+        close(r->memfd);
+    }
+    *r = (iq_ring_t){ .memfd = -1 };
+}
+
+static int iq_ring_open(iq_ring_t *r, size_t capacity_bytes, double sr, double cf, uint32_t fmt) {
+    iq_ring_close(r);
 
     size_t total = sizeof(phiq_hdr_t) + capacity_bytes;
     int fd = ph_shm_create_fd("ph-iq", total);
     if (fd < 0) return -1;
     void *map = mmap(NULL, total, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
     if (map == MAP_FAILED) { int e = errno; close(fd); errno = e; return -1; }
+    if (g_rt.mlock && mlock(map, total) != 0)
+        fprintf(stderr, "[soapy] mlock IQ ring: %s\n", strerror(errno));
 
-    g_memfd = fd;
-    g_hdr = (phiq_hdr_t*)map;
-    g_map_bytes = total;
-    memset(g_hdr, 0, sizeof(phiq_hdr_t));
-    g_hdr->magic = PHIQ_MAGIC;
-    g_hdr->version = PHIQ_VERSION;
-    atomic_store(&g_hdr->seq, 0);
-    atomic_store(&g_hdr->wpos, 0);
-    atomic_store(&g_hdr->rpos, 0); /* deprecated ABI mirror */
-    g_hdr->capacity = (uint32_t)capacity_bytes;
-    g_hdr->fmt = (uint32_t)fmt;
-    g_hdr->bytes_per_samp = (fmt == PHIQ_FMT_CF32) ? 8u : 4u;
-    g_hdr->channels = 1;
-    g_hdr->sample_rate = sr;
-    g_hdr->center_freq = cf;
-    ph_ring_meta_init_iq(g_hdr);
+    phiq_hdr_t *h = (phiq_hdr_t*)map;
+    r->memfd = fd;
+    r->hdr = h;
+    r->map_bytes = total;
+    memset(h, 0, sizeof(phiq_hdr_t));
+    h->magic = PHIQ_MAGIC;
+    h->version = PHIQ_VERSION;
+    atomic_store(&h->seq, 0);
+    atomic_store(&h->wpos, 0);
+    atomic_store(&h->rpos, 0); /* deprecated ABI mirror */
+    h->capacity = (uint32_t)capacity_bytes;
+    h->fmt = (uint32_t)fmt;
+    h->bytes_per_samp = phiq_fmt_bytes(fmt);
+    h->channels = 1;
+    h->sample_rate = sr;
+    h->center_freq = cf;
+    ph_ring_meta_init_iq(h);
     return 0;
 }
 
-static void iq_ring_close_locked(void) {
-    if (g_hdr && g_hdr != MAP_FAILED) munmap(g_hdr, g_map_bytes);
-    if (g_memfd >= 0) close(g_memfd);
-    g_hdr = NULL;
-    g_memfd = -1;
-    g_map_bytes = 0;
+/* reuse ring k if it already matches, so consumers keep their map */
+static int iq_ring_want(int k, double sr, double cf, uint32_t fmt) {
+    phiq_hdr_t *h = g_ring[k].hdr;
+    if (h && h->fmt == fmt && h->sample_rate == sr && h->center_freq == cf) return 0;
+    return iq_ring_open(&g_ring[k], 8u << 20, sr, cf, fmt);
 }
 
 static int soapy_list(char *out, size_t outcap) {
@@ -194,173 +298,698 @@ static int soapy_list(char *out, size_t outcap) {
     return 0;
 }
 
+/* ---------- stream ownership ---------- */
+/* Take the stream back from the RX thread: it finishes its current read
+ * (at most the 10 ms read timeout), then leaves the device alone. Commands
+ * it had not applied yet are applied here. */
+static void rxq_drain(SoapySDRDevice *d, size_t ch, phiq_hdr_t *h);
+
+static void rx_park(void) {
+    atomic_store(&g_active, RX_IDLE);
+    while (atomic_load(&g_rx_busy)) ph_msleep(1);
+    if (g_rx.dev) rxq_drain(g_rx.dev, g_rx.chan, g_rx.hdr);
+    atomic_store(&g_rx.overflows_ps, 0);
+    atomic_store(&g_rx.late_ps, 0);
+}
+
+static void ses_close(void) {
+    for (int i = 0; i < g_ses.ndev; i++) {
+        ses_dev_t *d = &g_ses.d[i];
+        if (d->rx) {
+            SoapySDRDevice_deactivateStream(d->dev, d->rx, 0, 0);
+            SoapySDRDevice_closeStream(d->dev, d->rx);
+        }
+        if (d->owned && d->dev) SoapySDRDevice_unmake(d->dev);
+        d->rx = NULL;
+        d->dev = NULL;
+    }
+    g_ses.ndev = 0;
+}
+
+static void stream_close(void) {
+    rx_park();
+    if (g_dev.dev && g_dev.rx) {
+        SoapySDRDevice_deactivateStream(g_dev.dev, g_dev.rx, 0, 0);
+        SoapySDRDevice_closeStream(g_dev.dev, g_dev.rx);
+    }
+    g_dev.rx = NULL;
+    g_rx.rx = NULL;
+    ses_close();
+}
+
 static int soapy_open_idx(int idx) {
-    pthread_mutex_lock(&g_dev_mu);
+    stream_close();
     if (g_dev.dev) {
-        if (g_dev.rx) {
-            SoapySDRDevice_deactivateStream(g_dev.dev, g_dev.rx, 0, 0);
-            SoapySDRDevice_closeStream(g_dev.dev, g_dev.rx);
-            g_dev.rx = NULL;
-        }
         SoapySDRDevice_unmake(g_dev.dev);
         g_dev.dev = NULL;
+        g_rx.dev = NULL;
     }
     size_t n = 0;
     SoapySDRKwargs *res = SoapySDRDevice_enumerate(NULL, &n);
-    if (idx < 0 || (size_t)idx >= n) { SoapySDRKwargsList_clear(res, n); pthread_mutex_unlock(&g_dev_mu); return -1; }
+    if (idx < 0 || (size_t)idx >= n) { SoapySDRKwargsList_clear(res, n); return -1; }
     g_dev.dev = SoapySDRDevice_make(&res[idx]);
     SoapySDRKwargsList_clear(res, n);
-    if (!g_dev.dev) { pthread_mutex_unlock(&g_dev_mu); return -1; }
+    if (!g_dev.dev) return -1;
+    g_dev.idx = idx;
     g_dev.chan = 0;
     g_dev.sr = 2.4e6;
     g_dev.cf = 100e6;
     g_dev.bw = 0.0;
+    g_dev.gain_set = false;
     g_dev.antenna_id = 0;
-    g_dev.read_errors = 0;
-    g_dev.hw_timestamps = 0;
-    g_dev.host_timestamps = 0;
-    pthread_mutex_unlock(&g_dev_mu);
+    atomic_store(&g_rx.read_errors, 0);
+    atomic_store(&g_rx.overflows, 0);
+    atomic_store(&g_rx.late, 0);
+    atomic_store(&g_rx.hw_timestamps, 0);
+    atomic_store(&g_rx.host_timestamps, 0);
     return 0;
 }
 
-static int soapy_apply_params_locked(void) {
+/* Runs on whichever thread owns the device: RX while streaming, else control. */
+static int dev_apply(SoapySDRDevice *d, size_t ch, phiq_hdr_t *h, const rxc_t *c) {
+    int rc = 0;
+    switch (c->op) {
+    case RXC_FREQ:
+        rc = SoapySDRDevice_setFrequency(d, SOAPY_SDR_RX, ch, c->v, NULL);
+        if (rc == 0 && h) h->center_freq = c->v;
+        break;
+    case RXC_RATE:
+        rc = SoapySDRDevice_setSampleRate(d, SOAPY_SDR_RX, ch, c->v);
+        if (rc == 0) { g_rx.sr = c->v; if (h) h->sample_rate = c->v; }
+        break;
+    case RXC_BW:      rc = SoapySDRDevice_setBandwidth(d, SOAPY_SDR_RX, ch, c->v); break;
+    case RXC_GAIN:    rc = SoapySDRDevice_setGain(d, SOAPY_SDR_RX, ch, c->v); break;
+    case RXC_CLOCK:   rc = SoapySDRDevice_setClockSource(d, c->s); break;
+    case RXC_TIME:    rc = SoapySDRDevice_setTimeSource(d, c->s); break;
+    case RXC_ANTENNA: g_rx.antenna_id = (uint32_t)c->v; break;
+    }
+    atomic_fetch_add(rc == 0 ? &g_rx.cmds_applied : &g_rx.cmds_failed, 1);
+    return rc;
+}
+
+static void rxq_drain(SoapySDRDevice *d, size_t ch, phiq_hdr_t *h) {
+    uint32_t hd = atomic_load_explicit(&g_rxq.head, memory_order_relaxed);
+    while (hd != atomic_load_explicit(&g_rxq.tail, memory_order_acquire)) {
+        dev_apply(d, ch, h, &g_rxq.slot[hd % RXQ_SLOTS]);
+        atomic_store_explicit(&g_rxq.head, ++hd, memory_order_release);
+    }
+}
+
+/* Apply now if nothing is streaming, else queue it for the RX thread.
+ * 0, -1 (device refused), 1 (queue full) or 2 (session running: kept in
+ * g_dev for its next start, as retuning members one by one would break
+ * their alignment). */
+static int dev_set(const rxc_t *c) {
+    if (!g_dev.dev) return 0;   /* kept in g_dev; applied on start */
+    int a = atomic_load(&g_active);
+    if (a == RX_SESSION) return 2;
+    if (a) return rxq_push(c) ? 0 : 1;
+    return dev_apply(g_dev.dev, (size_t)g_dev.chan, g_ring[0].hdr, c) == 0 ? 0 : -1;
+}
+
+static int soapy_apply_params(void) {
+    if (!g_dev.dev) return -1;
+    rxc_t c = { .op = RXC_FREQ, .v = g_dev.cf };
+    if (g_dev.cf > 0) dev_set(&c);
+    c = (rxc_t){ .op = RXC_RATE, .v = g_dev.sr };
+    if (g_dev.sr > 0) dev_set(&c);
+    c = (rxc_t){ .op = RXC_BW, .v = g_dev.bw };
+    if (g_dev.bw > 0) dev_set(&c);
+    c = (rxc_t){ .op = RXC_GAIN, .v = g_dev.gain };
+    if (g_dev.gain_set) dev_set(&c);
+    c = (rxc_t){ .op = RXC_CLOCK };
+    snprintf(c.s, sizeof c.s, "%s", g_dev.clock_source);
+    if (g_dev.clock_source[0]) dev_set(&c);
+    c = (rxc_t){ .op = RXC_TIME };
+    snprintf(c.s, sizeof c.s, "%s", g_dev.time_source);
+    if (g_dev.time_source[0]) dev_set(&c);
+    return 0;
+}
+
+static const char *soapy_fmt_str(uint32_t fmt) {
+    switch (fmt) {
+    case PHIQ_FMT_CF32: return SOAPY_SDR_CF32;
+    case PHIQ_FMT_CS16: return SOAPY_SDR_CS16;
+    case PHIQ_FMT_CU8:  return SOAPY_SDR_CU8;
+    case PHIQ_FMT_CS8:  return SOAPY_SDR_CS8;
+    default:            return NULL;
+    }
+}
+
+/* The device's own sample format, 0 if the ring cannot carry it. */
+static uint32_t dev_native_fmt(double *full) {
+    char *nf = SoapySDRDevice_getNativeStreamFormat(g_dev.dev, SOAPY_SDR_RX, (size_t)g_dev.chan, full);
+    uint32_t fmt = 0;
+    for (uint32_t f = PHIQ_FMT_CF32; nf && f <= PHIQ_FMT_CS8; f++)
+        if (strcmp(nf, soapy_fmt_str(f)) == 0) fmt = f;
+    free(nf);
+    return fmt;
+}
+
+/* `fmt native`: so 8-bit receivers stay 2 bytes per frame end to end; CS16
+ * when the native format is not one the ring carries. */
+static uint32_t native_fmt(void) {
+    double full = 0.0;
+    uint32_t fmt = dev_native_fmt(&full);
+    return fmt ? fmt : PHIQ_FMT_CS16;
+}
+
+static SoapySDRStream *stream_setup(uint32_t fmt, size_t ch) {
+    SoapySDRStream *s = SoapySDRDevice_setupStream(g_dev.dev, SOAPY_SDR_RX, soapy_fmt_str(fmt), &ch, 1, NULL);
+    if (s && SoapySDRDevice_activateStream(g_dev.dev, s, 0, 0, 0) != 0) {
+        SoapySDRDevice_closeStream(g_dev.dev, s);
+        s = NULL;
+    }
+    return s;
+}
+
+static int soapy_start(uint32_t fmt) {
     if (!g_dev.dev) return -1;
-    if (g_dev.cf > 0) SoapySDRDevice_setFrequency(g_dev.dev, SOAPY_SDR_RX, (size_t)g_dev.chan, g_dev.cf, NULL);
-    if (g_dev.sr > 0) SoapySDRDevice_setSampleRate(g_dev.dev, SOAPY_SDR_RX, (size_t)g_dev.chan, g_dev.sr);
-    if (g_dev.bw > 0) SoapySDRDevice_setBandwidth(g_dev.dev, SOAPY_SDR_RX, (size_t)g_dev.chan, g_dev.bw);
-    if (g_dev.clock_source[0]) SoapySDRDevice_setClockSource(g_dev.dev, g_dev.clock_source);
-    if (g_dev.time_source[0]) SoapySDRDevice_setTimeSource(g_dev.dev, g_dev.time_source);
-    if (g_hdr) {
-        g_hdr->sample_rate = g_dev.sr;
-        g_hdr->center_freq = g_dev.cf;
+    stream_close();
+    if (fmt == 0) fmt = native_fmt();
+
+    if (iq_ring_want(0, g_dev.sr, g_dev.cf, fmt) != 0) return -1;
+    g_ring[0].antenna_id = g_dev.antenna_id;
+
+    if (soapy_apply_params() != 0) return -1;
+
+    /* Direct buffer access hands out the driver's buffers in the native
+     * format, so the stream is opened native when the ring can take it as
+     * is or widened to CF32 on the way in; the driver converts otherwise. */
+    size_t ch = (size_t)g_dev.chan;
+    double full = 0.0;
+    uint32_t nat = g_dma ? dev_native_fmt(&full) : 0;
+    bool direct = false;
+    g_rx.src_fmt = fmt;
+    g_rx.src_scale = 1.0f;
+    if (nat && (nat == fmt || fmt == PHIQ_FMT_CF32)) {
+        g_dev.rx = stream_setup(nat, ch);
+        if (g_dev.rx && SoapySDRDevice_getNumDirectAccessBuffers(g_dev.dev, g_dev.rx) > 0) {
+            direct = true;
+            g_rx.src_fmt = nat;
+            if (nat != PHIQ_FMT_CF32) g_rx.src_scale = 1.0f / (float)(full > 0.0 ? full : (nat == PHIQ_FMT_CS16 ? 32768.0 : 128.0));
+        } else if (g_dev.rx && nat != fmt) {
+            SoapySDRDevice_deactivateStream(g_dev.dev, g_dev.rx, 0, 0);
+            SoapySDRDevice_closeStream(g_dev.dev, g_dev.rx);
+            g_dev.rx = NULL;
+        }
     }
+    if (!g_dev.rx) g_dev.rx = stream_setup(fmt, ch);
+    if (!g_dev.rx) return -1;
+    g_rx.dev = g_dev.dev;
+    g_rx.rx = g_dev.rx;
+    g_rx.hdr = g_ring[0].hdr;
+    g_rx.chan = ch;
+    g_rx.sr = g_dev.sr;
+    g_rx.antenna_id = g_dev.antenna_id;
+    atomic_store(&g_rx.direct, direct);
+    atomic_store(&g_active, RX_SINGLE);   /* hands the stream to the RX thread */
+    publish_iq_memfd(0);
     return 0;
 }
 
-static int soapy_start(phiq_fmt_t fmt) {
-    int ok = -1;
-    pthread_mutex_lock(&g_dev_mu);
-    if (!g_dev.dev) goto out;
+/* ---------- session start ---------- */
+/* Every device is tuned from g_dev, its stream set up over its member
+ * channels, and all streams are activated at one hardware time `delay`
+ * ms ahead of device 0's clock. With several devices that only lines up
+ * if their clocks agree: share a time source (`time`) and let `sync`
+ * zero them together first, immediately (`now`) or on the next PPS edge
+ * (`pps`, driver-dependent). A driver that refuses a timed activation is
+ * started immediately and the session reports timed=false. */
+static int ses_start(char *err, size_t errcap) {
+    if (!g_dev.dev) { snprintf(err, errcap, "session: select a device first"); return -1; }
+    stream_close();
+    uint32_t fmt = atomic_load(&g_fmt);
+    if (fmt == 0) fmt = native_fmt();
 
-    if (g_dev.rx) {
-        atomic_store(&g_active, 0);
-        SoapySDRDevice_deactivateStream(g_dev.dev, g_dev.rx, 0, 0);
-        SoapySDRDevice_closeStream(g_dev.dev, g_dev.rx);
-        g_dev.rx = NULL;
+    size_t nenum = 0;
+    SoapySDRKwargs *res = SoapySDRDevice_enumerate(NULL, &nenum);
+    int rc = 0;
+    for (int k = 0; k < g_ses.n && rc == 0; k++) {
+        int i = 0;
+        while (i < g_ses.ndev && g_ses.d[i].idx != g_ses.dev[k]) i++;
+        ses_dev_t *d = &g_ses.d[i];
+        if (i == g_ses.ndev) {
+            *d = (ses_dev_t){ .idx = g_ses.dev[k], .owned = g_ses.dev[k] != g_dev.idx };
+            if (!d->owned) d->dev = g_dev.dev;
+            else if ((size_t)d->idx < nenum) d->dev = SoapySDRDevice_make(&res[d->idx]);
+            if (!d->dev) { snprintf(err, errcap, "session: cannot open device %d", d->idx); rc = -1; break; }
+            g_ses.ndev++;
+        }
+        d->chan[d->nch] = (size_t)g_ses.chan[k];
+        d->member[d->nch++] = k;
+    }
+    SoapySDRKwargsList_clear(res, nenum);
+
+    for (int i = 0; i < g_ses.ndev && rc == 0; i++) {
+        ses_dev_t *d = &g_ses.d[i];
+        for (size_t c = 0; c < d->nch && rc == 0; c++) {
+            rxc_t q = { .op = RXC_RATE, .v = g_dev.sr };
+            rc |= dev_apply(d->dev, d->chan[c], NULL, &q);
+            q = (rxc_t){ .op = RXC_FREQ, .v = g_dev.cf };
+            rc |= dev_apply(d->dev, d->chan[c], NULL, &q);
+            q = (rxc_t){ .op = RXC_BW, .v = g_dev.bw };
+            if (g_dev.bw > 0) dev_apply(d->dev, d->chan[c], NULL, &q);
+            q = (rxc_t){ .op = RXC_GAIN, .v = g_dev.gain };
+            if (g_dev.gain_set) dev_apply(d->dev, d->chan[c], NULL, &q);
+        }
+        if (g_dev.clock_source[0]) SoapySDRDevice_setClockSource(d->dev, g_dev.clock_source);
+        if (g_dev.time_source[0]) SoapySDRDevice_setTimeSource(d->dev, g_dev.time_source);
+        if (rc) { snprintf(err, errcap, "session: device %d refused sr/cf", d->idx); break; }
+        d->rx = SoapySDRDevice_setupStream(d->dev, SOAPY_SDR_RX, soapy_fmt_str(fmt), d->chan, d->nch, NULL);
+        if (!d->rx) { snprintf(err, errcap, "session: device %d stream setup failed", d->idx); rc = -1; }
     }
+    for (int k = 0; k < g_ses.n && rc == 0; k++) {
+        if (iq_ring_want(k, g_dev.sr, g_dev.cf, fmt) != 0) { snprintf(err, errcap, "session: ring %d", k); rc = -1; }
+        g_ring[k].antenna_id = (uint32_t)k;
+    }
+    if (rc) { ses_close(); return -1; }
 
-    if (!g_hdr || g_hdr->fmt != (uint32_t)fmt || g_hdr->sample_rate != g_dev.sr || g_hdr->center_freq != g_dev.cf) {
-        size_t cap = 8u << 20;
-        if (iq_ring_open_locked(cap, g_dev.sr, g_dev.cf, fmt) != 0) goto out;
+    if (strcmp(g_ses.sync, "none") != 0) {
+        bool pps = strcmp(g_ses.sync, "pps") == 0;
+        for (int i = 0; i < g_ses.ndev; i++)
+            SoapySDRDevice_setHardwareTime(g_ses.d[i].dev, 0, pps ? "PPS" : "");
+        if (pps) ph_msleep(1100);   /* let the edge pass */
     }
 
-    if (soapy_apply_params_locked() != 0) goto out;
+    g_ses.t_start = SoapySDRDevice_getHardwareTime(g_ses.d[0].dev, "") + (long long)g_ses.delay_ms * 1000000ll;
+    g_ses.timed = true;
+    for (int i = 0; i < g_ses.ndev && rc == 0; i++) {
+        ses_dev_t *d = &g_ses.d[i];
+        if (SoapySDRDevice_activateStream(d->dev, d->rx, SOAPY_SDR_HAS_TIME, g_ses.t_start, 0) == 0) continue;
+        g_ses.timed = false;
+        if (SoapySDRDevice_activateStream(d->dev, d->rx, 0, 0, 0) != 0) {
+            snprintf(err, errcap, "session: device %d activation failed", d->idx);
+            rc = -1;
+        }
+    }
+    if (rc) { ses_close(); return -1; }
 
-    const char *soap_fmt = (fmt == PHIQ_FMT_CF32) ? SOAPY_SDR_CF32 : SOAPY_SDR_CS16;
-    size_t ch = (size_t)g_dev.chan;
-    g_dev.rx = SoapySDRDevice_setupStream(g_dev.dev, SOAPY_SDR_RX, soap_fmt, &ch, 1, NULL);
-    if (!g_dev.rx) goto out;
-    if (SoapySDRDevice_activateStream(g_dev.dev, g_dev.rx, 0, 0, 0) != 0) {
-        SoapySDRDevice_closeStream(g_dev.dev, g_dev.rx);
-        g_dev.rx = NULL;
-        goto out;
+    for (int i = 0; i < g_ses.ndev; i++) {
+        ses_dev_t *d = &g_ses.d[i];
+        d->n = 0; d->t_first = 0; d->next_ts = 0;
+        atomic_store(&d->has_ts, 0);
+        atomic_store(&d->skew_ns, 0);
     }
-    atomic_store(&g_active, 1);
-    ok = 0;
-out:
-    pthread_mutex_unlock(&g_dev_mu);
-    if (ok == 0) publish_iq_memfd();
-    return ok;
+    atomic_store(&g_ses.ts_jumps, 0);
+    atomic_store(&g_ses.start_err_ns, 0);
+    g_rx.dev = g_dev.dev;
+    g_rx.rx = NULL;
+    g_rx.hdr = g_ring[0].hdr;
+    g_rx.chan = (size_t)g_dev.chan;
+    g_rx.sr = g_dev.sr;
+    g_rx.src_fmt = fmt;
+    atomic_store(&g_rx.direct, 0);
+    atomic_store(&g_active, RX_SESSION);
+    for (int k = 0; k < g_ses.n; k++) {
+        char feed[32];
+        ring_feed(k, feed, sizeof feed);
+        if (k) ph_create_feed(g_ctrl.fd, feed);
+        publish_iq_memfd(k);
+    }
+    return 0;
 }
 
 static void soapy_stop(void) {
-    pthread_mutex_lock(&g_dev_mu);
-    atomic_store(&g_active, 0);
-    if (g_dev.dev && g_dev.rx) {
-        SoapySDRDevice_deactivateStream(g_dev.dev, g_dev.rx, 0, 0);
-        SoapySDRDevice_closeStream(g_dev.dev, g_dev.rx);
-        g_dev.rx = NULL;
-    }
-    pthread_mutex_unlock(&g_dev_mu);
+    stream_close();
 }
 
 /* ---------- RX thread ---------- */
+/* n frames of the stream format into the ring format; only CF32 is ever
+ * produced from another format (see soapy_start). */
+static void rx_widen(uint8_t *dst, const uint8_t *src, size_t n) {
+    float *o = (float *)dst;
+    const float k = g_rx.src_scale;
+    switch (g_rx.src_fmt) {
+    case PHIQ_FMT_CS16: {
+        const int16_t *s = (const int16_t *)src;
+        for (size_t i = 0; i < 2*n; i++) o[i] = (float)s[i] * k;
+        break;
+    }
+    case PHIQ_FMT_CU8:
+        for (size_t i = 0; i < 2*n; i++) o[i] = ((float)src[i] - 127.5f) * k;
+        break;
+    case PHIQ_FMT_CS8: {
+        const int8_t *s = (const int8_t *)src;
+        for (size_t i = 0; i < 2*n; i++) o[i] = (float)s[i] * k;
+        break;
+    }
+    default:
+        memcpy(dst, src, n * 8u);
+    }
+}
+
+/* One copy from src (the stream format) into ring h (the ring format). */
+static void rx_write(phiq_hdr_t *h, uint32_t antenna_id, const uint8_t *src, int got, int flags, long long ts_ns) {
+    const size_t bps = h->bytes_per_samp;
+    const size_t bytes = (size_t)got * bps;
+    const uint32_t cap = h->capacity;
+    if (bytes > cap) {
+        ph_ring_meta_add_drop_raw(h->reserved, bytes);
+        return;
+    }
+
+    uint64_t w = atomic_load(&h->wpos);
+    size_t mod = (size_t)(w % cap);
+    size_t first = bytes;
+    if (mod + bytes > cap) first = cap - mod;
+
+    if (g_rx.src_fmt == h->fmt) {
+        memcpy(h->data + mod, src, first);
+        if (first < bytes) memcpy(h->data, src + first, bytes - first);
+    } else {
+        /* wpos and capacity are whole frames, so the wrap splits on one */
+        size_t n1 = first / bps;
+        rx_widen(h->data + mod, src, n1);
+        if (first < bytes) rx_widen(h->data, src + n1 * phiq_fmt_bytes(g_rx.src_fmt), (size_t)got - n1);
+    }
+
+    ph_timestamp_v0_t pts;
+    if (flags & SOAPY_SDR_HAS_TIME) {
+        pts = (ph_timestamp_v0_t){
+            .ns = (int64_t)ts_ns,
+            .sample_frac = 0.0,
+            .clock_domain = PH_CLOCK_SOAPY_HW,
+            .antenna_id = antenna_id,
+            .quality = PH_TS_QUALITY_VALID | PH_TS_QUALITY_HARDWARE,
+            .flags = 0
+        };
+        atomic_fetch_add_explicit(&g_rx.hw_timestamps, 1, memory_order_relaxed);
+    } else {
+        pts = ph_timestamp_from_clock(CLOCK_MONOTONIC, PH_CLOCK_HOST_MONOTONIC,
+                                      antenna_id, PH_TS_QUALITY_ESTIMATED);
+        atomic_fetch_add_explicit(&g_rx.host_timestamps, 1, memory_order_relaxed);
+    }
+    ph_ring_meta_set_timestamp_raw(h->reserved, &pts);
+
+    atomic_store(&h->wpos, w + bytes);
+    h->used = (uint32_t)(((w + bytes) < cap) ? (w + bytes) : cap);
+    atomic_fetch_add(&h->seq, 1);
+}
+
+/* Count one read result: 1 if it delivered frames, -1 if the stream's
+ * rings should record a glitch, else 0. t0/t1 bracket the read, last_end
+ * is when the previous read of this stream returned. */
+static int rx_count(int got, uint64_t t0, uint64_t t1, uint64_t *last_end) {
+    int r = 0;
+    if (got == SOAPY_SDR_OVERFLOW) {
+        atomic_fetch_add_explicit(&g_rx.overflows, 1, memory_order_relaxed);
+        r = -1;
+    } else if (got == SOAPY_SDR_TIME_ERROR) {
+        atomic_fetch_add_explicit(&g_rx.late, 1, memory_order_relaxed);
+    } else if (got < 0 && got != SOAPY_SDR_TIMEOUT) {
+        atomic_fetch_add_explicit(&g_rx.read_errors, 1, memory_order_relaxed);
+        r = -1;
+    } else if (got > 0) {
+        /* late: we spent longer away from the device than this block lasted */
+        if (*last_end && g_rx.sr > 0 && (double)(t0 - *last_end) > (double)got * 1e9 / g_rx.sr)
+            atomic_fetch_add_explicit(&g_rx.late, 1, memory_order_relaxed);
+        r = 1;
+    }
+    *last_end = got > 0 ? t1 : 0;
+    return r;
+}
+
+static void rx_read_single(uint8_t *tmp, size_t tmpcap, uint64_t *last_end) {
+    int flags = 0;
+    long long ts_ns = 0;
+    const uint8_t *src = tmp;
+    size_t handle = 0;
+    bool acquired = false;
+    uint64_t t0 = mono_ns();
+    int got;
+    if (atomic_load_explicit(&g_rx.direct, memory_order_relaxed)) {
+        const void *dma[1] = { NULL };
+        got = SoapySDRDevice_acquireReadBuffer(g_rx.dev, g_rx.rx, &handle, dma, &flags, &ts_ns, 10000);
+        if (got == SOAPY_SDR_NOT_SUPPORTED) {
+            atomic_store(&g_rx.direct, 0);   /* readStream from now on, same stream format */
+            return;
+        }
+        acquired = got >= 0;
+        src = dma[0];
+    } else {
+        void *buffs[1] = { tmp };
+        size_t elems = tmpcap / phiq_fmt_bytes(g_rx.src_fmt);
+        got = SoapySDRDevice_readStream(g_rx.dev, g_rx.rx, buffs, elems, &flags, &ts_ns, 10000);
+    }
+    int r = rx_count(got, t0, mono_ns(), last_end);
+    if (r < 0) ph_ring_meta_add_glitch_raw(g_rx.hdr->reserved, 1);
+    else if (r > 0 && src) rx_write(g_rx.hdr, g_rx.antenna_id, src, got, flags, ts_ns);
+    if (acquired) SoapySDRDevice_releaseReadBuffer(g_rx.dev, g_rx.rx, handle);
+}
+
+/* One read per session stream, in device order. Each hardware timestamp
+ * gives the time of the stream's frame 0 (block time minus frames already
+ * delivered); its difference to device 0's is the stream's skew. A block
+ * whose time is not where the previous one ended counts as a ts jump. */
+static void rx_read_session(uint8_t (*buf)[1<<16], uint64_t *last_end) {
+    const double ns_per = 1e9 / g_rx.sr;
+    const double tol = g_ses.tol_ns > 0 ? g_ses.tol_ns : ns_per;
+    const size_t elems = sizeof buf[0] / g_rx.hdr->bytes_per_samp;
+    for (int i = 0; i < g_ses.ndev; i++) {
+        ses_dev_t *d = &g_ses.d[i];
+        void *buffs[SOAPY_MAX_RX];
+        for (size_t c = 0; c < d->nch; c++) buffs[c] = buf[d->member[c]];
+        int flags = 0;
+        long long ts = 0;
+        uint64_t t0 = mono_ns();
+        int got = SoapySDRDevice_readStream(d->dev, d->rx, buffs, elems, &flags, &ts, 10000);
+        int r = rx_count(got, t0, mono_ns(), &last_end[i]);
+        if (r < 0) {
+            for (size_t c = 0; c < d->nch; c++) ph_ring_meta_add_glitch_raw(g_ring[d->member[c]].hdr->reserved, 1);
+        }
+        if (r <= 0) continue;
+
+        if (flags & SOAPY_SDR_HAS_TIME) {
+            if (d->next_ts && (double)llabs(ts - d->next_ts) > tol)
+                atomic_fetch_add_explicit(&g_ses.ts_jumps, 1, memory_order_relaxed);
+            if (i == 0 && d->n == 0 && g_ses.timed)
+                atomic_store_explicit(&g_ses.start_err_ns, ts - g_ses.t_start, memory_order_relaxed);
+            d->t_first = ts - (long long)((double)d->n * ns_per);
+            d->next_ts = ts + (long long)((double)got * ns_per);
+            atomic_store_explicit(&d->has_ts, 1, memory_order_relaxed);
+            if (atomic_load_explicit(&g_ses.d[0].has_ts, memory_order_relaxed))
+                atomic_store_explicit(&d->skew_ns, d->t_first - g_ses.d[0].t_first, memory_order_relaxed);
+        } else {
+            d->next_ts = 0;
+            atomic_store_explicit(&d->has_ts, 0, memory_order_relaxed);
+        }
+        for (size_t c = 0; c < d->nch; c++) {
+            int k = d->member[c];
+            rx_write(g_ring[k].hdr, (uint32_t)k, buf[k], got, flags, ts);
+        }
+        d->n += (uint64_t)got;
+    }
+}
+
 static void *rx_thread(void *arg) {
     (void)arg;
-    uint8_t tmp[1<<16];
-    void *buffs[1] = { tmp };
+    uint64_t last_end[SOAPY_MAX_RX] = {0};       /* previous read returned, per stream */
+    uint64_t win_t0 = 0, win_ovf = 0, win_late = 0;
 
     while (atomic_load(&g_run)) {
-        if (!atomic_load(&g_active)) { ph_msleep(1); continue; }
-
-        pthread_mutex_lock(&g_dev_mu);
-        if (!atomic_load(&g_active) || !g_dev.dev || !g_dev.rx || !g_hdr) {
-            pthread_mutex_unlock(&g_dev_mu);
+        atomic_store(&g_rx_busy, 1);
+        int mode = atomic_load(&g_active);
+        if (mode == RX_IDLE) {
+            atomic_store(&g_rx_busy, 0);
+            memset(last_end, 0, sizeof last_end);
             ph_msleep(1);
             continue;
         }
 
-        int elems = (g_hdr->fmt == PHIQ_FMT_CF32)
-                  ? (int)(sizeof(tmp) / (2*sizeof(float)))
-                  : (int)(sizeof(tmp) / (2*sizeof(int16_t)));
+        if (mode == RX_SESSION) {
+            rx_read_session(g_rxbuf, last_end);
+        } else {
+            rxq_drain(g_rx.dev, g_rx.chan, g_rx.hdr);
+            rx_read_single(g_rxbuf[0], sizeof g_rxbuf[0], last_end);
+        }
 
-        int flags = 0;
-        long long ts_ns = 0;
-        int got = SoapySDRDevice_readStream(g_dev.dev, g_dev.rx, buffs, elems, &flags, &ts_ns, 10000);
-        if (got <= 0) {
-            if (got < 0) {
-                g_dev.read_errors++;
-                ph_ring_meta_add_glitch_raw(g_hdr->reserved, 1);
+        uint64_t t1 = mono_ns();
+        if (t1 - win_t0 >= 1000000000ull) {
+            uint64_t o = atomic_load_explicit(&g_rx.overflows, memory_order_relaxed);
+            uint64_t l = atomic_load_explicit(&g_rx.late, memory_order_relaxed);
+            if (win_t0) {
+                atomic_store_explicit(&g_rx.overflows_ps, o - win_ovf, memory_order_relaxed);
+                atomic_store_explicit(&g_rx.late_ps, l - win_late, memory_order_relaxed);
             }
-            pthread_mutex_unlock(&g_dev_mu);
-            continue;
+            win_t0 = t1; win_ovf = o; win_late = l;
         }
+        atomic_store(&g_rx_busy, 0);
+    }
+    return NULL;
+}
 
-        const size_t bytes = (size_t)got * g_hdr->bytes_per_samp;
-        const uint32_t cap = g_hdr->capacity;
-        if (bytes > cap) {
-            ph_ring_meta_add_drop_raw(g_hdr->reserved, bytes);
-            pthread_mutex_unlock(&g_dev_mu);
-            continue;
-        }
+/* ---------- RX real-time options ---------- */
+static int parse_cpus(const char *s, cpu_set_t *set) {
+    CPU_ZERO(set);
+    while (*s) {
+        char *e;
+        long a = strtol(s, &e, 10), b = a;
+        if (e == s || a < 0) return -1;
+        if (*e == '-') { s = e + 1; b = strtol(s, &e, 10); if (e == s || b < a) return -1; }
+        if (b >= CPU_SETSIZE) return -1;
+        for (long i = a; i <= b; i++) CPU_SET((int)i, set);
+        s = e;
+        if (*s == ',') s++;
+        else if (*s) return -1;
+    }
+    return CPU_COUNT(set) ? 0 : -1;
+}
 
-        uint64_t w = atomic_load(&g_hdr->wpos);
-        size_t mod = (size_t)(w % cap);
-        size_t first = bytes;
-        if (mod + bytes > cap) first = cap - mod;
+/* mlock covers what the RX path writes every block: the staging buffers and
+ * the IQ rings (rings opened later are locked as they are mapped). Only this
+ * addon's memory; the rest of ph-core is left alone. */
+static int rt_mlock(bool on) {
+    int rc = on ? mlock(g_rxbuf, sizeof g_rxbuf) : munlock(g_rxbuf, sizeof g_rxbuf);
+    for (int k = 0; rc == 0 && k < SOAPY_MAX_RX; k++) {
+        if (!g_ring[k].hdr) continue;
+        rc = on ? mlock(g_ring[k].hdr, g_ring[k].map_bytes) : munlock(g_ring[k].hdr, g_ring[k].map_bytes);
+    }
+    if (rc != 0 && on) { int e = errno; rt_mlock(false); errno = e; }
+    return rc;
+}
 
-        memcpy(g_hdr->data + mod, tmp, first);
-        if (first < bytes) memcpy(g_hdr->data, tmp + first, bytes - first);
+/* rt [fifo=<prio>|other] [cpus=<list>|cpus=all] [mlock=on|off] */
+static void rt_cmd(ph_ctrl_t *c, const char *p) {
+    if (!atomic_load(&g_rx_started)) { ph_reply_err(c, "rx thread not running"); return; }
+    char tok[64];
+    int n = 0;
+    while (sscanf(p, " %63s%n", tok, &n) == 1) {
+        p += n;
+        if (strncmp(tok, "fifo=", 5) == 0 || strcmp(tok, "other") == 0) {
+            int prio = 0;
+            if (tok[0] == 'f' && (!parse_int(tok + 5, &prio) || prio < sched_get_priority_min(SCHED_FIFO) ||
+                                  prio > sched_get_priority_max(SCHED_FIFO))) {
+                ph_reply_err(c, "fifo priority out of range"); return;
+            }
+            struct sched_param sp = { .sched_priority = prio };
+            int rc = pthread_setschedparam(g_rxthr, prio ? SCHED_FIFO : SCHED_OTHER, &sp);
+            if (rc) { ph_reply_errf(c, "SCHED_FIFO: %s", strerror(rc)); return; }
+            g_rt.prio = prio;
+        } else if (strncmp(tok, "cpus=", 5) == 0) {
+            cpu_set_t set;
+            if (strcmp(tok + 5, "all") == 0) {
+                CPU_ZERO(&set);
+                for (long i = 0, nc = sysconf(_SC_NPROCESSORS_ONLN); i < nc && i < CPU_SETSIZE; i++) CPU_SET((int)i, &set);
+            } else if (parse_cpus(tok + 5, &set) < 0) {
+                ph_reply_err(c, "cpus: want e.g. 2 or 2-3,6"); return;
+            }
+            int rc = pthread_setaffinity_np(g_rxthr, sizeof set, &set);
+            if (rc) { ph_reply_errf(c, "affinity: %s", strerror(rc)); return; }
+            snprintf(g_rt.cpus, sizeof g_rt.cpus, "%s", tok + 5);
+        } else if (strcmp(tok, "mlock=on") == 0) {
+            if (rt_mlock(true) != 0) { ph_reply_errf(c, "mlock: %s", strerror(errno)); return; }
+            g_rt.mlock = true;
+        } else if (strcmp(tok, "mlock=off") == 0) {
+            if (g_rt.mlock) rt_mlock(false);
+            g_rt.mlock = false;
+        } else {
+            ph_reply_errf(c, "rt: unknown option %s", tok); return;
+        }
+    }
+    ph_reply_okf(c, "rt policy=%s prio=%d cpus=%s mlock=%s", g_rt.prio ? "fifo" : "other",
+                 g_rt.prio, g_rt.cpus[0] ? g_rt.cpus : "all", g_rt.mlock ? "on" : "off");
+}
 
-        ph_timestamp_v0_t pts;
-        if (flags & SOAPY_SDR_HAS_TIME) {
-            pts = (ph_timestamp_v0_t){
-                .ns = (int64_t)ts_ns,
-                .sample_frac = 0.0,
-                .clock_domain = PH_CLOCK_SOAPY_HW,
-                .antenna_id = g_dev.antenna_id,
-                .quality = PH_TS_QUALITY_VALID | PH_TS_QUALITY_HARDWARE,
-                .flags = 0
-            };
-            g_dev.hw_timestamps++;
+/* ---------- session commands ---------- */
+/* session <dev>:<chan>[,<dev>:<chan>...] [delay=<ms>] [sync=none|now|pps] [tol=<ns>]
+ * session off */
+static void session_cmd(ph_ctrl_t *c, const char *p) {
+    while (*p == ' ') p++;
+    if (strcmp(p, "off") == 0) {
+        if (atomic_load(&g_active) == RX_SESSION) stream_close();
+        g_ses.n = 0;
+        ph_reply_ok(c, "session off");
+        return;
+    }
+    int n = 0, dev[SOAPY_MAX_RX], chan[SOAPY_MAX_RX];
+    int delay = g_ses.delay_ms;
+    double tol = g_ses.tol_ns;
+    const char *sync = g_ses.sync;
+    char tok[128];
+    int used = 0;
+    while (sscanf(p, " %127s%n", tok, &used) == 1) {
+        p += used;
+        if (strncmp(tok, "delay=", 6) == 0) {
+            if (!parse_int(tok + 6, &delay) || delay < 0) { ph_reply_err(c, "session: bad delay"); return; }
+        } else if (strncmp(tok, "tol=", 4) == 0) {
+            tol = strtod(tok + 4, NULL);
+            if (tol < 0) { ph_reply_err(c, "session: bad tol"); return; }
+        } else if (strncmp(tok, "sync=", 5) == 0) {
+            static const char *const modes[] = { "none", "now", "pps" };
+            sync = NULL;
+            for (size_t i = 0; i < sizeof modes / sizeof modes[0]; i++)
+                if (strcmp(tok + 5, modes[i]) == 0) sync = modes[i];
+            if (!sync) { ph_reply_err(c, "session: sync=none|now|pps"); return; }
         } else {
-            pts = ph_timestamp_from_clock(CLOCK_MONOTONIC, PH_CLOCK_HOST_MONOTONIC,
-                                          g_dev.antenna_id, PH_TS_QUALITY_ESTIMATED);
-            g_dev.host_timestamps++;
+            for (char *q = tok; *q; ) {
+                char *e;
+                long d = strtol(q, &e, 10), ch = -1;
+                if (e != q && *e == ':') ch = strtol(q = e + 1, &e, 10);
+                if (e == q || d < 0 || ch < 0 || (*e && *e != ',')) { ph_reply_errf(c, "session: bad member %s", tok); return; }
+                if (n == SOAPY_MAX_RX) { ph_reply_errf(c, "session: at most %d members", SOAPY_MAX_RX); return; }
+                for (int k = 0; k < n; k++)
+                    if (dev[k] == d && chan[k] == ch) { ph_reply_errf(c, "session: %ld:%ld twice", d, ch); return; }
+                dev[n] = (int)d; chan[n++] = (int)ch;
+                q = *e ? e + 1 : e;
+            }
         }
-        ph_ring_meta_set_timestamp_raw(g_hdr->reserved, &pts);
+    }
+    if (n == 0 && g_ses.n == 0) { ph_reply_err(c, "session: want <dev>:<chan>[,...]"); return; }
+    if (atomic_load(&g_active) == RX_SESSION) stream_close();   /* restart with `start` */
+    if (n) {
+        memcpy(g_ses.dev, dev, sizeof dev);
+        memcpy(g_ses.chan, chan, sizeof chan);
+        g_ses.n = n;
+    }
+    g_ses.delay_ms = delay;
+    g_ses.tol_ns = tol;
+    g_ses.sync = sync;
+    ph_reply_okf(c, "session members=%d delay=%d sync=%s (start to arm)", g_ses.n, delay, sync);
+}
 
-        atomic_store(&g_hdr->wpos, w + bytes);
-        g_hdr->used = (uint32_t)(((w + bytes) < cap) ? (w + bytes) : cap);
-        atomic_fetch_add(&g_hdr->seq, 1);
-        g_hdr->sample_rate = g_dev.sr;
-        g_hdr->center_freq = g_dev.cf;
-        pthread_mutex_unlock(&g_dev_mu);
+/* the "session" object of `status` */
+static void ses_status(char *out, size_t cap) {
+    size_t p = 0;
+    bool on = atomic_load(&g_active) == RX_SESSION;
+    double tol = g_ses.tol_ns > 0 ? g_ses.tol_ns : (g_dev.sr > 0 ? 1e9 / g_dev.sr : 0);
+    int64_t max_skew = 0;
+    bool all_ts = on;
+    for (int i = 0; on && i < g_ses.ndev; i++) {
+        int64_t sk = atomic_load(&g_ses.d[i].skew_ns);
+        if (!atomic_load(&g_ses.d[i].has_ts)) all_ts = false;
+        if (llabs(sk) > max_skew) max_skew = llabs(sk);
     }
-    return NULL;
+    p += (size_t)snprintf(out + p, cap > p ? cap - p : 0,
+        "\"session\":{\"members\":%d,\"running\":%d,\"timed\":%s,\"t_start\":%lld,"
+        "\"delay_ms\":%d,\"sync\":\"%s\",\"start_err_ns\":%lld,\"aligned\":%s,"
+        "\"max_skew_ns\":%lld,\"tol_ns\":%.0f,\"ts_jumps\":%llu,\"rx\":[",
+        g_ses.n, on, on && g_ses.timed ? "true" : "false", on ? g_ses.t_start : 0LL,
+        g_ses.delay_ms, g_ses.sync, (long long)atomic_load(&g_ses.start_err_ns),
+        !all_ts ? "null" : (double)max_skew <= tol ? "true" : "false",
+        (long long)max_skew, tol, (unsigned long long)atomic_load(&g_ses.ts_jumps));
+    for (int k = 0; k < g_ses.n; k++) {
+        char feed[32];
+        ring_feed(k, feed, sizeof feed);
+        long long skew = 0;
+        for (int i = 0; on && i < g_ses.ndev; i++)
+            if (g_ses.d[i].idx == g_ses.dev[k]) skew = (long long)atomic_load(&g_ses.d[i].skew_ns);
+        phiq_hdr_t *h = g_ring[k].hdr;
+        p += (size_t)snprintf(out + p, cap > p ? cap - p : 0,
+            "%s{\"dev\":%d,\"chan\":%d,\"antenna_id\":%d,\"feed\":\"%s\",\"wpos\":%llu,\"skew_ns\":%lld}",
+            k ? "," : "", g_ses.dev[k], g_ses.chan[k], k, feed,
+            h ? (unsigned long long)atomic_load(&h->wpos) : 0ULL, skew);
+    }
+    snprintf(out + p, cap > p ? cap - p : 0, "]}");
 }
 
 /* ---------- command handler ---------- */
+static void reply_set(ph_ctrl_t *c, int rc, const char *what) {
+    if (rc == 2) ph_reply_errf(c, "%s: session running, applies at its next start", what);
+    else if (rc == 1) ph_reply_errf(c, "%s: rx command queue full", what);
+    else if (rc < 0) ph_reply_errf(c, "%s failed", what);
+}
+
 static void on_cmd(ph_ctrl_t *c, const char *line, void *user) {
     (void)user;
     while (*line == ' ' || *line == '\t') line++;
@@ -370,8 +999,10 @@ static void on_cmd(ph_ctrl_t *c, const char *line, void *user) {
 
     if (strncmp(line, "help", 4) == 0) {
         ph_reply(c, "{\"ok\":true,"
-                    "\"help\":\"help|list|select <idx>|chan <n>|set sr=<Hz> cf=<Hz> [bw=<Hz>]|"
-                              "fmt <cf32|cs16>|clock <source>|time <source>|antenna <id>|"
+                    "\"help\":\"help|list|select <idx>|chan <n>|set sr=<Hz> cf=<Hz> [bw=<Hz>] [gain=<dB>]|"
+                              "fmt <cf32|cs16|cu8|cs8|native>|dma on|off|clock <source>|time <source>|antenna <id>|"
+                              "rt [fifo=<prio>|other] [cpus=<list>] [mlock=on|off]|"
+                              "session <dev>:<chan>[,...] [delay=<ms>] [sync=none|now|pps] [tol=<ns>]|session off|"
                               "start|stop|open|status|subscribe monitor <feed>|unsubscribe monitor\"}");
         return;
     }
@@ -388,9 +1019,7 @@ static void on_cmd(ph_ctrl_t *c, const char *line, void *user) {
         int idx = -1;
         if (!parse_int(line+7, &idx)) { ph_reply_err(c, "invalid index"); return; }
         if (soapy_open_idx(idx) == 0) {
-            pthread_mutex_lock(&g_dev_mu);
-            soapy_apply_params_locked();
-            pthread_mutex_unlock(&g_dev_mu);
+            soapy_apply_params();
             ph_reply_ok(c, "selected");
         } else ph_reply_err(c, "select failed");
         return;
@@ -399,75 +1028,106 @@ static void on_cmd(ph_ctrl_t *c, const char *line, void *user) {
     if (strncmp(line, "chan ", 5) == 0) {
         int ch = 0;
         if (!parse_int(line+5, &ch) || ch < 0) { ph_reply_err(c, "invalid channel"); return; }
-        pthread_mutex_lock(&g_dev_mu);
-        g_dev.chan = ch;
-        pthread_mutex_unlock(&g_dev_mu);
+        g_dev.chan = ch;   /* takes effect on the next start */
         ph_reply_okf(c, "chan=%d", ch);
         return;
     }
 
     if (strncmp(line, "set ", 4) == 0) {
-        pthread_mutex_lock(&g_dev_mu);
-        double sr = g_dev.sr, cf = g_dev.cf, bw = g_dev.bw;
+        if (!g_dev.dev) { ph_reply_err(c, "set failed: no device?"); return; }
+        double sr = g_dev.sr, cf = g_dev.cf, bw = g_dev.bw, gain = g_dev.gain;
+        bool has_gain = false;
         const char *p = line + 4;
         while (*p) {
             while (*p == ' ') p++;
             if (strncmp(p, "sr=", 3) == 0) sr = strtod(p+3, (char**)&p);
             else if (strncmp(p, "cf=", 3) == 0) cf = strtod(p+3, (char**)&p);
             else if (strncmp(p, "bw=", 3) == 0) bw = strtod(p+3, (char**)&p);
+            else if (strncmp(p, "gain=", 5) == 0) { gain = strtod(p+5, (char**)&p); has_gain = true; }
             else { while (*p && *p != ' ') p++; }
         }
+        rxc_t q[4];
+        int nq = 0;
+        if (cf != g_dev.cf && cf > 0) q[nq++] = (rxc_t){ .op = RXC_FREQ, .v = cf };
+        if (sr != g_dev.sr && sr > 0) q[nq++] = (rxc_t){ .op = RXC_RATE, .v = sr };
+        if (bw != g_dev.bw && bw > 0) q[nq++] = (rxc_t){ .op = RXC_BW,   .v = bw };
+        if (has_gain)                 q[nq++] = (rxc_t){ .op = RXC_GAIN, .v = gain };
         g_dev.sr = sr; g_dev.cf = cf; g_dev.bw = bw;
-        int rc = soapy_apply_params_locked();
-        pthread_mutex_unlock(&g_dev_mu);
-        if (rc == 0) ph_reply_okf(c, "set sr=%.0f cf=%.0f bw=%.0f", sr, cf, bw);
-        else ph_reply_err(c, "set failed: no device?");
+        if (has_gain) { g_dev.gain = gain; g_dev.gain_set = true; }
+        int rc = 0;
+        for (int i = 0; i < nq && rc == 0; i++) rc = dev_set(&q[i]);
+        if (rc) { reply_set(c, rc, "set"); return; }
+        ph_reply_okf(c, "set sr=%.0f cf=%.0f bw=%.0f%s", sr, cf, bw,
+                     atomic_load(&g_active) ? " (queued to rx)" : "");
         return;
     }
 
     if (strncmp(line, "fmt ", 4) == 0) {
         const char *p = line + 4; while (*p == ' ' || *p == '\t') p++;
-        if (strncasecmp(p, "cf32", 4) == 0) { atomic_store(&g_fmt, PHIQ_FMT_CF32); ph_reply_ok(c, "fmt=CF32"); }
-        else if (strncasecmp(p, "cs16", 4) == 0) { atomic_store(&g_fmt, PHIQ_FMT_CS16); ph_reply_ok(c, "fmt=CS16"); }
-        else ph_reply_err(c, "fmt arg");
+        char w[16] = {0};
+        sscanf(p, "%15s", w);
+        uint32_t f = 0;
+        if (strcasecmp(w, "native") != 0) {
+            for (f = PHIQ_FMT_CS8; f && strcasecmp(w, phiq_fmt_name(f)) != 0; f--) ;
+            if (!f) { ph_reply_err(c, "fmt arg: cf32|cs16|cu8|cs8|native"); return; }
+        }
+        atomic_store(&g_fmt, f);
+        ph_reply_okf(c, "fmt=%s", f ? soapy_fmt_str(f) : "native");
         return;
     }
 
-    if (strncmp(line, "clock ", 6) == 0) {
-        char src[64] = {0};
-        sscanf(line+6, "%63s", src);
-        pthread_mutex_lock(&g_dev_mu);
-        snprintf(g_dev.clock_source, sizeof g_dev.clock_source, "%s", src);
-        int rc = g_dev.dev ? SoapySDRDevice_setClockSource(g_dev.dev, g_dev.clock_source) : 0;
-        pthread_mutex_unlock(&g_dev_mu);
-        if (rc == 0) ph_reply_okf(c, "clock=%s", src); else ph_reply_err(c, "clock source failed");
+    if (strncmp(line, "dma ", 4) == 0) {
+        const char *p = line + 4; while (*p == ' ' || *p == '\t') p++;
+        if (strncasecmp(p, "on", 2) == 0) g_dma = true;
+        else if (strncasecmp(p, "off", 3) == 0) g_dma = false;
+        else { ph_reply_err(c, "dma arg: on|off"); return; }
+        ph_reply_okf(c, "dma=%s", g_dma ? "on" : "off");   /* takes effect on the next start */
         return;
     }
 
-    if (strncmp(line, "time ", 5) == 0) {
-        char src[64] = {0};
-        sscanf(line+5, "%63s", src);
-        pthread_mutex_lock(&g_dev_mu);
-        snprintf(g_dev.time_source, sizeof g_dev.time_source, "%s", src);
-        int rc = g_dev.dev ? SoapySDRDevice_setTimeSource(g_dev.dev, g_dev.time_source) : 0;
-        pthread_mutex_unlock(&g_dev_mu);
-        if (rc == 0) ph_reply_okf(c, "time=%s", src); else ph_reply_err(c, "time source failed");
+    if (strncmp(line, "clock ", 6) == 0 || strncmp(line, "time ", 5) == 0) {
+        bool clk = line[0] == 'c';
+        rxc_t q = { .op = clk ? RXC_CLOCK : RXC_TIME };
+        sscanf(line + (clk ? 6 : 5), "%63s", q.s);
+        snprintf(clk ? g_dev.clock_source : g_dev.time_source, sizeof g_dev.clock_source, "%s", q.s);
+        int rc = dev_set(&q);
+        if (rc == 0) ph_reply_okf(c, "%s=%s", clk ? "clock" : "time", q.s);
+        else reply_set(c, rc, clk ? "clock source" : "time source");
         return;
     }
 
     if (strncmp(line, "antenna ", 8) == 0) {
         int id = 0;
         if (!parse_int(line+8, &id) || id < 0) { ph_reply_err(c, "invalid antenna id"); return; }
-        pthread_mutex_lock(&g_dev_mu);
         g_dev.antenna_id = (uint32_t)id;
-        pthread_mutex_unlock(&g_dev_mu);
-        ph_reply_okf(c, "antenna_id=%d", id);
+        rxc_t q = { .op = RXC_ANTENNA, .v = id };
+        int rc = atomic_load(&g_active) ? dev_set(&q) : 0;   /* else taken from g_dev at start */
+        if (rc == 0) { g_ring[0].antenna_id = (uint32_t)id; ph_reply_okf(c, "antenna_id=%d", id); }
+        else reply_set(c, rc, "antenna");
+        return;
+    }
+
+    if (strncmp(line, "rt", 2) == 0 && (line[2] == '\0' || line[2] == ' ')) {
+        rt_cmd(c, line + 2);
+        return;
+    }
+
+    if (strncmp(line, "session", 7) == 0 && (line[7] == '\0' || line[7] == ' ')) {
+        session_cmd(c, line + 7);
         return;
     }
 
     if (strncmp(line, "start", 5) == 0) {
-        if (soapy_start(atomic_load(&g_fmt)) == 0) ph_reply_ok(c, "started");
-        else ph_reply_err(c, "start failed");
+        char err[128];
+        if (g_ses.n == 0) {
+            if (soapy_start(atomic_load(&g_fmt)) == 0) ph_reply_ok(c, "started");
+            else ph_reply_err(c, "start failed");
+        } else if (ses_start(err, sizeof err) == 0) {
+            ph_reply_okf(c, "session started members=%d devices=%d%s", g_ses.n, g_ses.ndev,
+                         g_ses.timed ? "" : " (untimed)");
+        } else {
+            ph_reply_err(c, err);
+        }
         return;
     }
 
@@ -478,36 +1138,52 @@ static void on_cmd(ph_ctrl_t *c, const char *line, void *user) {
     }
 
     if (strncmp(line, "open", 4) == 0) {
-        publish_iq_memfd();
+        for (int k = 0; k < SOAPY_MAX_RX; k++) publish_iq_memfd(k);
         ph_reply_ok(c, "republished");
         return;
     }
 
     if (strncmp(line, "status", 6) == 0) {
-        char js[768];
-        pthread_mutex_lock(&g_dev_mu);
+        char js[3072], ses[1536];
         ph_ring_meta_v0_t m = {0};
-        uint64_t w = g_hdr ? atomic_load(&g_hdr->wpos) : 0;
-        uint32_t used = g_hdr ? g_hdr->used : 0;
-        uint32_t bps = g_hdr ? g_hdr->bytes_per_samp : 0;
-        if (g_hdr) ph_ring_meta_get_iq(g_hdr, &m);
+        phiq_hdr_t *h = g_ring[0].hdr;
+        uint64_t w = h ? atomic_load(&h->wpos) : 0;
+        uint32_t used = h ? (uint32_t)(w < h->capacity ? w : h->capacity) : 0;   /* as rx_write sets it */
+        uint32_t bps = h ? h->bytes_per_samp : 0;
+        if (h) ph_ring_meta_get_iq(h, &m);
+        ses_status(ses, sizeof ses);
+        uint32_t qd = atomic_load(&g_rxq.tail) - atomic_load(&g_rxq.head);
         snprintf(js, sizeof js,
             "{\"ok\":true,\"sr\":%.1f,\"cf\":%.1f,\"bw\":%.1f,"
-            "\"chan\":%d,\"active\":%d,\"fmt\":%u,\"bps\":%u,"
+            "\"chan\":%d,\"active\":%d,\"fmt\":%u,\"encoding\":\"%s\",\"bps\":%u,"
+            "\"dma\":\"%s\",\"direct\":%d,\"stream_fmt\":\"%s\","
             "\"wpos\":%llu,\"used\":%u,\"overrun_bytes\":%llu,\"drop_bytes\":%llu,"
-            "\"glitches\":%llu,\"read_errors\":%llu,\"hw_ts\":%llu,\"host_ts\":%llu,"
-            "\"antenna_id\":%u,\"clock\":\"%s\",\"time\":\"%s\"}",
-            g_dev.sr, g_dev.cf, g_dev.bw, g_dev.chan, (int)atomic_load(&g_active),
-            (unsigned)atomic_load(&g_fmt), bps, (unsigned long long)w, used,
+            "\"glitches\":%llu,\"read_errors\":%llu,\"overflows\":%llu,\"late\":%llu,"
+            "\"overflows_per_s\":%llu,\"late_per_s\":%llu,"
+            "\"cmds_applied\":%llu,\"cmds_failed\":%llu,\"cmds_queued\":%u,"
+            "\"hw_ts\":%llu,\"host_ts\":%llu,"
+            "\"rt\":{\"policy\":\"%s\",\"prio\":%d,\"cpus\":\"%s\",\"mlock\":%s},"
+            "\"antenna_id\":%u,\"clock\":\"%s\",\"time\":\"%s\",%s}",
+            g_dev.sr, g_dev.cf, g_dev.bw, g_dev.chan, atomic_load(&g_active) != RX_IDLE,
+            (unsigned)atomic_load(&g_fmt), h ? phiq_fmt_name(h->fmt) : "none", bps,
+            g_dma ? "on" : "off", (int)atomic_load(&g_rx.direct),
+            g_dev.rx ? phiq_fmt_name(g_rx.src_fmt) : "none", (unsigned long long)w, used,
             (unsigned long long)ph_u32_pair_get(m.overrun_lo, m.overrun_hi),
             (unsigned long long)ph_u32_pair_get(m.drop_lo, m.drop_hi),
             (unsigned long long)ph_u32_pair_get(m.glitch_lo, m.glitch_hi),
-            (unsigned long long)g_dev.read_errors,
-            (unsigned long long)g_dev.hw_timestamps,
-            (unsigned long long)g_dev.host_timestamps,
+            (unsigned long long)atomic_load(&g_rx.read_errors),
+            (unsigned long long)atomic_load(&g_rx.overflows),
+            (unsigned long long)atomic_load(&g_rx.late),
+            (unsigned long long)atomic_load(&g_rx.overflows_ps),
+            (unsigned long long)atomic_load(&g_rx.late_ps),
+            (unsigned long long)atomic_load(&g_rx.cmds_applied),
+            (unsigned long long)atomic_load(&g_rx.cmds_failed), qd,
+            (unsigned long long)atomic_load(&g_rx.hw_timestamps),
+            (unsigned long long)atomic_load(&g_rx.host_timestamps),
+            g_rt.prio ? "fifo" : "other", g_rt.prio, g_rt.cpus[0] ? g_rt.cpus : "all",
+            g_rt.mlock ? "true" : "false",
             g_dev.antenna_id,
-            g_dev.clock_source, g_dev.time_source);
-        pthread_mutex_unlock(&g_dev_mu);
+            g_dev.clock_source, g_dev.time_source, ses);
         ph_reply(c, js);
         return;
     }
@@ -523,7 +1199,7 @@ static void *run(void *arg) {
     ph_create_feed(fd, FEED_IQ_INFO);
 
     atomic_store(&g_run, 1);
-    if (pthread_create(&g_rxthr, NULL, rx_thread, NULL) == 0) {
+    if (ph_thread_start(&g_rxthr, "rx", PH_WORKER_RT_IO, rx_thread, NULL) == 0) {
         atomic_store(&g_rx_started, 1);
     } else {
         atomic_store(&g_run, 0);
@@ -538,7 +1214,7 @@ static void *run(void *arg) {
 
     soapy_stop();
     if (atomic_exchange(&g_rx_started, 0)) pthread_join(g_rxthr, NULL);
-    close(fd);
+    ph_conn_close(fd);
     return NULL;
 }
 
@@ -553,7 +1229,7 @@ bool plugin_init(const plugin_ctx_t *ctx, plugin_caps_t *out) {
     if (out) {
         out->caps_size = sizeof(*out);
         out->name = plugin_name();
-        out->version = "0.4.2-rt";
+        out->version = "0.6.0";
         out->consumes = CONS;
         out->produces = PROD;
         out->feat_bits = PH_FEAT_IQ;
@@ -562,15 +1238,14 @@ bool plugin_init(const plugin_ctx_t *ctx, plugin_caps_t *out) {
 }
 
 bool plugin_start(void) {
-    return pthread_create(&g_thr, NULL, run, NULL) == 0;
+    return ph_thread_start(&g_thr, "ctrl", PH_WORKER_BACKGROUND, run, NULL) == 0;
 }
 
 void plugin_stop(void) {
     atomic_store(&g_run, 0);
-    soapy_stop();
-    pthread_join(g_thr, NULL);
+    pthread_join(g_thr, NULL);   /* run() stops the stream and joins the RX thread */
 
-    pthread_mutex_lock(&g_dev_mu);
+    if (g_rt.mlock) { rt_mlock(false); g_rt.mlock = false; }
     if (g_dev.dev) {
         if (g_dev.rx) {
             SoapySDRDevice_closeStream(g_dev.dev, g_dev.rx);
@@ -579,6 +1254,7 @@ void plugin_stop(void) {
         SoapySDRDevice_unmake(g_dev.dev);
         g_dev.dev = NULL;
     }
-    iq_ring_close_locked();
-    pthread_mutex_unlock(&g_dev_mu);
+    g_rx = (rx_t){0};
+    for (int k = 0; k < SOAPY_MAX_RX; k++) iq_ring_close(&g_ring[k]);
+    g_ses.n = 0;
 }
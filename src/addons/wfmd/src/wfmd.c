@@ -58,6 +58,10 @@ static pthread_t   g_dsp_thr;
 static ph_ctrl_t   g_ctrl;         // control-plane ctx
 static _Atomic bool g_ctrl_started = false;
 static _Atomic bool g_dsp_started = false;
+/* fused into a core pipeline: plugin_process() runs the DSP, dsp_run idles */
+static _Atomic bool g_fused = false;
+static pthread_mutex_t g_dsp_mu = PTHREAD_MUTEX_INITIALIZER;   /* one DSP pass at a time */
+static ph_span_t  *g_out = NULL;   /* next stage's buffer during plugin_process, else NULL */
 
 /* runtime toggles */
 static _Atomic bool g_swapiq = false;   // swap I/Q
@@ -74,6 +78,7 @@ static _Atomic double g_fs   = 2400000.0;
 static _Atomic double g_foff_hz = 0.0;   // digital fine-tune (Hz) pre-disc
 static _Atomic double g_bw_hz   = 110e3; // complex LPF cutoff (Hz) for WFM mono ~110 kHz
 static _Atomic int    g_tau_us  = 50;    // de-emphasis µs (50 EU / 75 US)
+static _Atomic double g_out_rate = 48000.0; // exact audio rate via resampler; 0 = native D1/D2 rate
 
 /* IQ shared map */
 typedef struct { int memfd; phiq_hdr_t *hdr; size_t map_bytes; } iq_ring_t;
@@ -192,6 +197,7 @@ static void ring_push_f32(ring_t *r, const float *x, size_t n_frames){
 typedef struct {
     float *taps; int ntaps;
     float *zb;   int zpos;
+    int phase;   /* inputs since last output, carried across blocks */
     int R;
 } firdec_t;
 
@@ -218,7 +224,8 @@ static size_t firdec_push(firdec_t *d, const float *in, size_t ns, float *out, s
     for(size_t i=0;i<ns;i++){
         d->zb[d->zpos]=in[i];
         d->zpos=(d->zpos+1)%d->ntaps;
-        if(((i+1)%d->R)==0){
+        if(++d->phase >= d->R){
+            d->phase=0;
             float acc=0.0f; int idx=d->zpos;
             for(int t=0;t<d->ntaps;t++){ idx--; if(idx<0) idx=d->ntaps-1; acc += d->taps[t]*d->zb[idx]; }
             if(out_n<out_cap) out[out_n++]=acc;
@@ -227,24 +234,52 @@ static size_t firdec_push(firdec_t *d, const float *in, size_t ns, float *out, s
     return out_n;
 }
 
-/* NCO: shared DSP recursive oscillator, no per-sample sin/cos. */
-/* complex FIR decimator (pre-discriminator channel filter) */
+/* ---------- per-block parameter snapshot ---------- */
+/* Runtime toggles are atomics written by the control thread. The DSP thread
+   loads them once per block here; nothing below touches an atomic per sample. */
+typedef struct {
+    bool   swapiq, flipq, neg, deemph;
+    int    taps1, tau_us, debug;
+    float  gain;
+    double foff_hz, bw_hz, out_rate;
+} wfmd_params_t;
+
+static void wfmd_params_snapshot(wfmd_params_t *p){
+    p->swapiq  = atomic_load_explicit(&g_swapiq, memory_order_relaxed);
+    p->flipq   = atomic_load_explicit(&g_flipq,  memory_order_relaxed);
+    p->neg     = atomic_load_explicit(&g_neg,    memory_order_relaxed);
+    p->deemph  = atomic_load_explicit(&g_deemph, memory_order_relaxed);
+    p->taps1   = atomic_load_explicit(&g_taps1,  memory_order_relaxed);
+    p->tau_us  = atomic_load_explicit(&g_tau_us, memory_order_relaxed);
+    p->debug   = atomic_load_explicit(&g_debug,  memory_order_relaxed);
+    p->gain    = atomic_load_explicit(&g_gain,   memory_order_relaxed);
+    p->foff_hz = atomic_load_explicit(&g_foff_hz, memory_order_relaxed);
+    p->bw_hz   = atomic_load_explicit(&g_bw_hz,  memory_order_relaxed);
+    p->out_rate = atomic_load_explicit(&g_out_rate, memory_order_relaxed);
+}
+
+/* complex FIR decimator (pre-discriminator channel filter)
+   Planar linear history: x[0..ntaps-2] holds the tail of the previous block,
+   the current block is written right after it, so every output is a plain
+   contiguous dot product (no modulo ring index in the inner loop). */
 typedef struct {
     float *taps; int ntaps;
-    float *ziI,*ziQ; int zpos;
+    float *xI,*xQ; size_t xcap;   /* ntaps-1 history + current block */
+    int phase;                    /* inputs since last output, carried across blocks */
     int R;
 } cfirdec_t;
 
 static void cfirdec_free(cfirdec_t *d){
     if(!d) return;
     free(d->taps);
-    free(d->ziI);
-    free(d->ziQ);
+    free(d->xI);
+    free(d->xQ);
     d->taps = NULL;
-    d->ziI  = NULL;
-    d->ziQ  = NULL;
+    d->xI   = NULL;
+    d->xQ   = NULL;
+    d->xcap  = 0;
     d->ntaps = 0;
-    d->zpos  = 0;
+    d->phase = 0;
     d->R     = 1;
 }
 static int cfirdec_init(cfirdec_t *d, int ntaps, float fs_in, float fc, int R){
@@ -253,9 +288,7 @@ static int cfirdec_init(cfirdec_t *d, int ntaps, float fs_in, float fc, int R){
     d->ntaps = ntaps | 1;
     d->R = (R < 1) ? 1 : R;
     d->taps=(float*)malloc((size_t)d->ntaps*sizeof(float));
-    d->ziI =(float*)calloc((size_t)d->ntaps,sizeof(float));
-    d->ziQ =(float*)calloc((size_t)d->ntaps,sizeof(float));
-    if(!d->taps||!d->ziI||!d->ziQ) return -1;
+    if(!d->taps) return -1;
     int M=d->ntaps, m2=(M-1)/2; double fn=fc/fs_in; if(fn>0.49) fn=0.49;
     double sum=0; for(int n=0;n<M;n++){ int k=n-m2;
         double w=0.54-0.46*cos(2.0*M_PI*n/(M-1));
@@ -265,43 +298,131 @@ static int cfirdec_init(cfirdec_t *d, int ntaps, float fs_in, float fc, int R){
     for(int n=0;n<M;n++) d->taps[n]/=(float)sum;
     return 0;
 }
+static int cfirdec_reserve(cfirdec_t *d, size_t ns){
+    size_t need = (size_t)(d->ntaps - 1) + ns;
+    if(d->xcap >= need) return 0;
+    size_t ncap = d->xcap ? d->xcap : 4096;
+    while(ncap < need) ncap <<= 1;
+    float *nI = (float*)realloc(d->xI, ncap*sizeof(float));
+    if(!nI) return -1;
+    d->xI = nI;
+    float *nQ = (float*)realloc(d->xQ, ncap*sizeof(float));
+    if(!nQ) return -1;
+    d->xQ = nQ;
+    if(!d->xcap){   /* fresh filter: zero history */
+        memset(d->xI, 0, (size_t)(d->ntaps-1)*sizeof(float));
+        memset(d->xQ, 0, (size_t)(d->ntaps-1)*sizeof(float));
+    }
+    d->xcap = ncap;
+    return 0;
+}
 
-/* mix→complex FIR decimate; returns #complex frames written to outIQ (interleaved)
-   NOTE: limiter removed from here (applied AFTER channel filtering) */
-static size_t cfirdec_mix_and_push(cfirdec_t *d, ph_dsp_nco_f32_t *nco,
-                                   const float *iq, size_t ns,
-                                   float *outIQ, size_t out_cap /* interleaved I,Q */)
-{
-    size_t out_n=0;
-    const int R = d->R;
-    for(size_t i=0;i<ns;i++){
-        float I=iq[2*i+0], Q=iq[2*i+1];
+/* Dot product with 8 independent partial sums: no reassociation is needed for
+   the compiler to map the lanes onto SIMD registers. */
+static inline float dot_f32(const float *restrict a, const float *restrict b, int n){
+    float acc[8] = {0};
+    int t = 0;
+    for(; t + 8 <= n; t += 8)
+        for(int k = 0; k < 8; k++) acc[k] += a[t+k]*b[t+k];
+    float s = ((acc[0]+acc[1])+(acc[2]+acc[3])) + ((acc[4]+acc[5])+(acc[6]+acc[7]));
+    for(; t < n; t++) s += a[t]*b[t];
+    return s;
+}
+
+/* ---------- specialized mix kernels ----------
+   One body, instantiated per (input format, swapiq, flipq) with the switches as
+   compile-time constants, so each variant is a branch-free elementwise loop.
+   Input is raw ring data (CF32, CS16, CU8 or CS8) widened in the same pass;
+   output is planar mixed I/Q. */
+enum { MIX_IN_CF32, MIX_IN_CS16, MIX_IN_CU8, MIX_IN_CS8, MIX_IN_N };
+
+static int mix_in(uint32_t fmt){
+    switch(fmt){
+    case PHIQ_FMT_CF32: return MIX_IN_CF32;
+    case PHIQ_FMT_CS16: return MIX_IN_CS16;
+    case PHIQ_FMT_CU8:  return MIX_IN_CU8;
+    case PHIQ_FMT_CS8:  return MIX_IN_CS8;
+    default:            return -1;
+    }
+}
 
-        /* optional swap/flip */
-        if(atomic_load(&g_swapiq)){ float t=I; I=Q; Q=t; }
-        if(atomic_load(&g_flipq)) Q = -Q;
+typedef void (*mix_kernel_fn)(const void *src, const float *restrict nc, const float *restrict ns_,
+                              float *restrict xI, float *restrict xQ, size_t n);
 
+static inline __attribute__((always_inline))
+void mix_kernel(const void *src, const float *restrict nc, const float *restrict ns_,
+                float *restrict xI, float *restrict xQ, size_t n,
+                const int in, const int swap, const int flip)
+{
+    const float   *f  = (const float*)src;
+    const int16_t *s  = (const int16_t*)src;
+    const uint8_t *u8 = (const uint8_t*)src;
+    const int8_t  *s8 = (const int8_t*)src;
+    for(size_t i=0;i<n;i++){
+        float I, Q;
+        if(in == MIX_IN_CS16){      I = (float)s[2*i+0] * (1.0f/32768.0f); Q = (float)s[2*i+1] * (1.0f/32768.0f); }
+        else if(in == MIX_IN_CU8){  I = ((float)u8[2*i+0] - 127.5f) * (1.0f/128.0f); Q = ((float)u8[2*i+1] - 127.5f) * (1.0f/128.0f); }
+        else if(in == MIX_IN_CS8){  I = (float)s8[2*i+0] * (1.0f/128.0f); Q = (float)s8[2*i+1] * (1.0f/128.0f); }
+        else {                      I = f[2*i+0]; Q = f[2*i+1]; }
+        if(swap){ float t=I; I=Q; Q=t; }
+        if(flip) Q = -Q;
         /* NCO mix (shift desired to DC) */
-        float cs,sn; ph_dsp_nco_f32_next(nco,&cs,&sn);
-        float Ir =  I*cs + Q*sn;
-        float Qr = -I*sn + Q*cs;
-
-        /* complex FIR */
-        d->ziI[d->zpos]=Ir; d->ziQ[d->zpos]=Qr;
-        d->zpos = (d->zpos + 1) % d->ntaps;
-
-        if(((i+1)%R)==0){
-            float accI=0, accQ=0; int idx=d->zpos;
-            for(int t=0;t<d->ntaps;t++){ idx--; if(idx<0) idx=d->ntaps-1;
-                accI += d->taps[t]*d->ziI[idx];
-                accQ += d->taps[t]*d->ziQ[idx];
-            }
-            if(out_n+2 <= out_cap){
-                outIQ[out_n+0]=accI; outIQ[out_n+1]=accQ; out_n+=2;
-            }
-        }
+        xI[i] =  I*nc[i] + Q*ns_[i];
+        xQ[i] = -I*ns_[i] + Q*nc[i];
     }
-    return out_n/2; /* complex frames */
+}
+
+#define WFMD_MIX_VARIANT(name, in, swap, flip) \
+    static void name(const void *src, const float *restrict nc, const float *restrict ns_, \
+                     float *restrict xI, float *restrict xQ, size_t n) \
+    { mix_kernel(src, nc, ns_, xI, xQ, n, in, swap, flip); }
+
+WFMD_MIX_VARIANT(mix_cf32,      MIX_IN_CF32, 0, 0)
+WFMD_MIX_VARIANT(mix_cf32_f,    MIX_IN_CF32, 0, 1)
+WFMD_MIX_VARIANT(mix_cf32_s,    MIX_IN_CF32, 1, 0)
+WFMD_MIX_VARIANT(mix_cf32_sf,   MIX_IN_CF32, 1, 1)
+WFMD_MIX_VARIANT(mix_cs16,      MIX_IN_CS16, 0, 0)
+WFMD_MIX_VARIANT(mix_cs16_f,    MIX_IN_CS16, 0, 1)
+WFMD_MIX_VARIANT(mix_cs16_s,    MIX_IN_CS16, 1, 0)
+WFMD_MIX_VARIANT(mix_cs16_sf,   MIX_IN_CS16, 1, 1)
+WFMD_MIX_VARIANT(mix_cu8,       MIX_IN_CU8,  0, 0)
+WFMD_MIX_VARIANT(mix_cu8_f,     MIX_IN_CU8,  0, 1)
+WFMD_MIX_VARIANT(mix_cu8_s,     MIX_IN_CU8,  1, 0)
+WFMD_MIX_VARIANT(mix_cu8_sf,    MIX_IN_CU8,  1, 1)
+WFMD_MIX_VARIANT(mix_cs8,       MIX_IN_CS8,  0, 0)
+WFMD_MIX_VARIANT(mix_cs8_f,     MIX_IN_CS8,  0, 1)
+WFMD_MIX_VARIANT(mix_cs8_s,     MIX_IN_CS8,  1, 0)
+WFMD_MIX_VARIANT(mix_cs8_sf,    MIX_IN_CS8,  1, 1)
+#undef WFMD_MIX_VARIANT
+
+/* [MIX_IN_*][swapiq][flipq] */
+static const mix_kernel_fn k_mix_kernels[MIX_IN_N][2][2] = {
+    { { mix_cf32, mix_cf32_f }, { mix_cf32_s, mix_cf32_sf } },
+    { { mix_cs16, mix_cs16_f }, { mix_cs16_s, mix_cs16_sf } },
+    { { mix_cu8,  mix_cu8_f  }, { mix_cu8_s,  mix_cu8_sf  } },
+    { { mix_cs8,  mix_cs8_f  }, { mix_cs8_s,  mix_cs8_sf  } },
+};
+
+/* complex FIR decimate the mixed block already staged in d->x{I,Q};
+   returns #complex frames written to outIQ (interleaved).
+   Taps are a symmetric windowed sinc, so correlation == convolution here.
+   NOTE: limiter is applied AFTER channel filtering */
+static size_t cfirdec_run(cfirdec_t *d, size_t ns, float *outIQ, size_t out_cap /* complex frames */)
+{
+    const int M = d->ntaps, R = d->R;
+    size_t out_n = 0;
+    /* first input index that completes a decimation period */
+    size_t j = (size_t)(R - 1 - d->phase);
+    for(; j < ns && out_n < out_cap; j += (size_t)R){
+        outIQ[2*out_n+0] = dot_f32(d->taps, d->xI + j, M);
+        outIQ[2*out_n+1] = dot_f32(d->taps, d->xQ + j, M);
+        out_n++;
+    }
+    d->phase = (int)((d->phase + ns) % (size_t)R);
+    /* slide the last ntaps-1 inputs to the front as next block's history */
+    memmove(d->xI, d->xI + ns, (size_t)(M-1)*sizeof(float));
+    memmove(d->xQ, d->xQ + ns, (size_t)(M-1)*sizeof(float));
+    return out_n;
 }
 
 /* ---------- work buffers (persistent) ---------- */
@@ -309,8 +430,10 @@ typedef struct {
     float   *bb;      size_t bb_cap;     /* I,Q after channel decim (interleaved) */
     float   *dphi;    size_t dphi_cap;   /* discriminator output @ fs_ch */
     float   *y1;      size_t y1_cap;     /* after a1 */
-    float   *y2;      size_t y2_cap;     /* after a2 (final audio to push) */
-    float   *tmp_f;   size_t tmp_f_cap;  /* CS16→float conversion scratch */
+    float   *y2;      size_t y2_cap;     /* after a2 (native-rate audio) */
+    float   *y3;      size_t y3_cap;     /* after resampler (exact-rate audio) */
+    float   *nco_c;   size_t nco_c_cap;  /* per-block NCO cos/sin (planar) */
+    float   *nco_s;   size_t nco_s_cap;
     uint8_t *iq_raw;  size_t iq_raw_cap; /* raw IQ bytes copied from ring, reused across calls */
 } workbuf_t;
 
@@ -328,6 +451,9 @@ static int ensure_cap(float **ptr, size_t *cap, size_t need){
 /* ---------- demod ---------- */
 static cfirdec_t rf_ch; static ph_dsp_nco_f32_t nco;
 static firdec_t  a1, a2;   // audio post-discriminator filters
+static ph_dsp_resamp_f32_t rs;   // native → exact output rate
+static int       rs_inited=0;
+static double    rs_fs_in=0, rs_fs_out=0;
 static int       ch_inited=0, ainit=0;
 static double    last_fs_in=0, last_bw=0, last_fo=0;
 static int       last_D1=0, last_D2=0, last_taps1=0;
@@ -338,15 +464,22 @@ static float     dsp_y_em=0.0f;              /* de-emphasis IIR state */
 static unsigned  dsp_dbg_ctr=0;             /* periodic debug print counter */
 
 static void demod_state_reset(void){
-    cfirdec_free(&rf_ch); firdec_free(&a1); firdec_free(&a2);
-    ch_inited=0; ainit=0;
+    cfirdec_free(&rf_ch); firdec_free(&a1); firdec_free(&a2); ph_dsp_resamp_f32_free(&rs);
+    ch_inited=0; ainit=0; rs_inited=0; rs_fs_in=0.0; rs_fs_out=0.0;
     last_fs_in=0.0; last_bw=0.0; last_fo=0.0;
     last_D1=0; last_D2=0; last_taps1=0;
     dc_x1=0.0f; dc_y1=0.0f;
     dsp_ip=0.0f; dsp_qp=0.0f; dsp_y_em=0.0f; dsp_dbg_ctr=0;
 }
 
-static void push_audio(const float *y, size_t n){ ring_push_f32(&g_ring, y, n); }
+static void push_audio(const float *y, size_t n, float fs){
+    if(!g_out){ ring_push_f32(&g_ring, y, n); return; }
+    size_t room = (g_out->cap - g_out->bytes) / sizeof(float);
+    if(n > room) n = room;   /* guard only: fused reads are sized to fit */
+    memcpy((uint8_t*)g_out->data + g_out->bytes, y, n * sizeof(float));
+    g_out->bytes += n * sizeof(float);
+    g_out->sample_rate = fs;
+}
 
 /* post-channel limiter (constant envelope), vectorized */
 static inline void limit_iq_vec(float *iq, size_t n_complex){
@@ -363,7 +496,7 @@ static inline void limit_iq_vec(float *iq, size_t n_complex){
     }
 }
 
-static void demod_block(const float *iq, size_t nsamp, double fs_in){
+static void demod_block(const void *iq, int in, size_t nsamp, double fs_in, const wfmd_params_t *p){
     if(nsamp < 32) return;
 
     /* ---- Stage A: channelize BEFORE discriminator ---- */
@@ -371,8 +504,8 @@ static void demod_block(const float *iq, size_t nsamp, double fs_in){
     int Rch = (int)floor(fs_in / 240000.0); if(Rch<1) Rch=1;
     double fs_ch = fs_in / (double)Rch;
 
-    double foff = atomic_load(&g_foff_hz);
-    double bw   = atomic_load(&g_bw_hz);
+    double foff = p->foff_hz;
+    double bw   = p->bw_hz;
 
     /* (re)init channelizer when fs/bw/fo changed */
     if(!ch_inited || fabs(last_fs_in - fs_in) > 1.0 || fabs(last_bw - bw) > 1.0 || last_fo != foff){
@@ -384,10 +517,16 @@ static void demod_block(const float *iq, size_t nsamp, double fs_in){
         ph_dsp_nco_f32_set_freq(&nco, fs_in, foff);
     }
 
-    /* channelize to fs_ch */
+    /* channelize to fs_ch: NCO block → specialized mix kernel → FIR decimate */
     size_t max_out = nsamp/Rch + 8;
     if(ensure_cap(&g_wb.bb, &g_wb.bb_cap, max_out*2)) return;
-    size_t nbb = cfirdec_mix_and_push(&rf_ch, &nco, iq, nsamp, g_wb.bb, max_out*2);
+    if(ensure_cap(&g_wb.nco_c, &g_wb.nco_c_cap, nsamp)) return;
+    if(ensure_cap(&g_wb.nco_s, &g_wb.nco_s_cap, nsamp)) return;
+    if(cfirdec_reserve(&rf_ch, nsamp)) return;
+    ph_dsp_nco_f32_fill(&nco, g_wb.nco_c, g_wb.nco_s, nsamp);
+    const mix_kernel_fn mix = k_mix_kernels[in][p->swapiq ? 1 : 0][p->flipq ? 1 : 0];
+    mix(iq, g_wb.nco_c, g_wb.nco_s, rf_ch.xI + rf_ch.ntaps - 1, rf_ch.xQ + rf_ch.ntaps - 1, nsamp);
+    size_t nbb = cfirdec_run(&rf_ch, nsamp, g_wb.bb, max_out);
     if(nbb==0) return;
 
     /* limiter AFTER channel LPF (on decimated IQ) */
@@ -395,13 +534,13 @@ static void demod_block(const float *iq, size_t nsamp, double fs_in){
 
     /* ---- Discriminator at fs_ch ---- */
     if(ensure_cap(&g_wb.dphi, &g_wb.dphi_cap, nbb)) return;
-    const bool neg = atomic_load(&g_neg);
+    const float disc_sign = p->neg ? -1.0f : 1.0f;
     for(size_t i=0;i<nbb;i++){
         float I0=g_wb.bb[2*i+0], Q0=g_wb.bb[2*i+1];
         float re = dsp_ip*I0 + dsp_qp*Q0;
         float im = dsp_ip*Q0 - dsp_qp*I0;
         float ph = (re==0.0f && im==0.0f) ? 0.0f : atan2f(im, re);
-        g_wb.dphi[i]  = neg ? -ph : ph;
+        g_wb.dphi[i]  = disc_sign * ph;
         dsp_ip = I0; dsp_qp = Q0;
     }
 
@@ -413,7 +552,7 @@ static void demod_block(const float *iq, size_t nsamp, double fs_in){
     double fs1 = fs_ch / (double)D1;
     double fs2 = fs1   / (double)D2;  /* final audio Fs */
 
-    int cur_taps1 = atomic_load(&g_taps1);
+    int cur_taps1 = p->taps1;
 
     /* re-init audio filters when fs_in changed, or D1/D2, or taps1 changed */
     if(!ainit || fabs(last_fs_in - fs_in) > 1.0 || last_D1!=D1 || last_D2!=D2 || last_taps1!=cur_taps1){
@@ -445,33 +584,46 @@ static void demod_block(const float *iq, size_t nsamp, double fs_in){
     size_t n2 = firdec_push(&a2, g_wb.y1, n1, g_wb.y2, cap2);
 
     float Fs_audio = (float)(fs2>0.0?fs2:48000.0f);
-
-    /* keep audio ring metadata in sync if drifted */
-    if(g_ring.hdr && fabs(g_ring.hdr->sample_rate - (double)Fs_audio) > 0.5){
+    float *aud = g_wb.y2;
+
+    if(p->out_rate > 0.0){
+        /* exact output rate: the ring rate is fixed at config time, never here */
+        if(!rs_inited || rs_fs_in != fs2 || rs_fs_out != p->out_rate){
+            ph_dsp_resamp_f32_free(&rs);
+            if(ph_dsp_resamp_f32_init(&rs, 1, fs2, p->out_rate, 32)!=0) return;
+            rs_inited=1; rs_fs_in=fs2; rs_fs_out=p->out_rate;
+        }
+        size_t cap3 = ph_dsp_resamp_f32_max_out(&rs, n2);
+        if(ensure_cap(&g_wb.y3, &g_wb.y3_cap, cap3)) return;
+        n2 = ph_dsp_resamp_f32_process(&rs, g_wb.y2, n2, g_wb.y3, cap3);
+        aud = g_wb.y3;
+        Fs_audio = (float)p->out_rate;
+    }else if(g_ring.hdr && fabs(g_ring.hdr->sample_rate - (double)Fs_audio) > 0.5){
+        /* native mode: keep audio ring metadata in sync if drifted */
         g_ring.hdr->sample_rate = (double)Fs_audio;
     }
 
     /* de-emphasis (single-pole IIR) + DC blocker + gain + clip */
-    int tau_us = atomic_load(&g_tau_us); if(tau_us!=50 && tau_us!=75) tau_us=50;
-    float a = expf((float)(-1.0/(Fs_audio*((float)tau_us*1e-6f))));
-    const bool do_deemph = atomic_load(&g_deemph);
-    const float gain = atomic_load(&g_gain);
+    int tau_us = p->tau_us; if(tau_us!=50 && tau_us!=75) tau_us=50;
+    /* deemph off == pole at 0, keeps the loop free of a per-sample branch */
+    float a = p->deemph ? expf((float)(-1.0/(Fs_audio*((float)tau_us*1e-6f)))) : 0.0f;
+    const float gain = p->gain;
     for(size_t i=0;i<n2;i++){
-        float xin = g_wb.y2[i];
+        float xin = aud[i];
         /* DC blocker */
         const float r=0.995f; float ydc = xin - dc_x1 + r*dc_y1; dc_x1=xin; dc_y1=ydc;
         float x = ydc;
-        if(do_deemph) dsp_y_em = a*dsp_y_em + (1.0f - a)*x; else dsp_y_em = x;
+        dsp_y_em = a*dsp_y_em + (1.0f - a)*x;
         float y = gain * dsp_y_em;
         if(y >  1.0f) y =  1.0f;
         if(y < -1.0f) y = -1.0f;
-        g_wb.y2[i]=y;
+        aud[i]=y;
     }
-    if(n2) push_audio(g_wb.y2, n2);
+    if(n2) push_audio(aud, n2, Fs_audio);
 
-    if(atomic_load(&g_debug)){
+    if(p->debug){
         if(++dsp_dbg_ctr % 10 == 0){
-            double rms=0; for(size_t ii=0;ii<n2;ii++){ double v=g_wb.y2[ii]; rms+=v*v; }
+            double rms=0; for(size_t ii=0;ii<n2;ii++){ double v=aud[ii]; rms+=v*v; }
             rms = n2? sqrt(rms/n2) : 0.0;
             uint64_t aw = g_ring.hdr? atomic_load(&g_ring.hdr->wpos):0;
             uint32_t au = g_ring.hdr? g_ring.hdr->used:0;
@@ -512,31 +664,36 @@ static size_t demod_from_iq_ring(void){
     if (ph_ring_meta_get_iq(h, &meta) == 0)
         g_last_iq_ts = ph_ring_meta_timestamp(&meta);
 
-    uint64_t lost = 0;
-    size_t bytes = ph_iq_ring_consume_copy(h, &g_iq_consumer, g_wb.iq_raw, max_bytes, &lost);
-    (void)lost;
     uint32_t fmt = h->fmt;
     double fs = h->sample_rate; if(!(fs>0.0)) fs = atomic_load(&g_fs);
+    size_t want = max_bytes;
+    if(g_out){
+        /* fused: take only as much IQ as decimates into the next stage's
+           block (the audio rate never exceeds the IQ rate); the rest stays
+           in the ring for the next round */
+        double out_fs = atomic_load(&g_out_rate);
+        if(!(out_fs > 0.0) || out_fs > fs) out_fs = fs;
+        size_t room = (g_out->cap - g_out->bytes) / sizeof(float);
+        room = room > 64 ? room - 64 : 0;   /* resampler/filter phase slack */
+        double ns = (double)room * fs / out_fs;
+        if(ns < (double)(want / bps)) want = (size_t)ns * bps;
+        if(want == 0){ pthread_mutex_unlock(&g_iq_mu); return 0; }
+    }
+
+    uint64_t lost = 0;
+    size_t bytes = ph_iq_ring_consume_copy(h, &g_iq_consumer, g_wb.iq_raw, want, &lost);
+    (void)lost;
     pthread_mutex_unlock(&g_iq_mu);
 
     if(bytes == 0) return 0;
 
     size_t nsamp = bytes / bps;
-    if(fmt == PHIQ_FMT_CF32){
-        demod_block((const float*)g_wb.iq_raw, nsamp, fs);
-    }else if(fmt == PHIQ_FMT_CS16){
-        size_t need = nsamp * 2;
-        if(ensure_cap(&g_wb.tmp_f, &g_wb.tmp_f_cap, need)) return bytes;
-        const int16_t *s = (const int16_t*)g_wb.iq_raw;
-        const float scale = 1.0f/32768.0f;
-        for(size_t i=0;i<nsamp;i++){
-            g_wb.tmp_f[2*i+0] = (float)s[2*i+0] * scale;
-            g_wb.tmp_f[2*i+1] = (float)s[2*i+1] * scale;
-        }
-        demod_block((const float*)g_wb.tmp_f, nsamp, fs);
-    }else{
-        /* unknown format: copied then intentionally ignored */
-    }
+    wfmd_params_t prm;
+    wfmd_params_snapshot(&prm);   /* one snapshot per block */
+    /* integer formats are widened inside the mix kernel, no separate float pass;
+       an unknown format is copied then intentionally ignored */
+    int in = mix_in(fmt);
+    if(in >= 0) demod_block(g_wb.iq_raw, in, nsamp, fs, &prm);
     return bytes;
 }
 
@@ -553,6 +710,7 @@ static void wfmd_publish_memfd(int fd){
           "\"type\":\"publish\","
           "\"feed\":\"%s\","
           "\"subtype\":\"shm_map\","
+          "\"retain\":true,"
           "\"proto\":\"" PH_PROTO_AUDIO_RING "\","
           "\"version\":\"0.1\","
           "\"size\":%u,"
@@ -588,7 +746,7 @@ static void on_cmd(ph_ctrl_t *c, const char *line, void *user){
                      "\"help\":\"help|open|start|stop|status|"
                               "subscribe <usage> <feed>|unsubscribe <usage>|"
                               "gain <f>|swapiq <0|1>|flipq <0|1>|neg <0|1>|deemph <0|1>|"
-                              "taps1 <odd>|debug <int>|foff <Hz>|bw <Hz>|tau <50|75>\"}");
+                              "taps1 <odd>|debug <int>|foff <Hz>|bw <Hz>|tau <50|75>|rate <Hz|0>\"}");
         return;
     }
     if(strncmp(line,"open",4)==0){ wfmd_publish_memfd(c->fd); ph_reply_ok(c,"republished"); return; }
@@ -632,6 +790,16 @@ static void on_cmd(ph_ctrl_t *c, const char *line, void *user){
         return;
     }
 
+    if(strncmp(line,"rate ",5)==0){
+        int r = 0; if(!parse_int(line+5,&r)){ ph_reply_err(c,"rate expects Hz or 0"); return; }
+        if(r!=0 && (r<8000 || r>192000)){ ph_reply_err(c,"rate must be 0 or 8000..192000"); return; }
+        g_out_rate = (double)r;
+        /* exact mode: the ring rate changes only here, then consumers re-open */
+        if(r>0 && g_ring.hdr){ g_ring.hdr->sample_rate = (double)r; wfmd_publish_memfd(c->fd); }
+        if(r>0) ph_reply_okf(c,"rate=%d Hz", r); else ph_reply_ok(c,"rate=native");
+        return;
+    }
+
     if(strncmp(line,"status",6)==0){
         char js[1024];
         uint64_t iq_w = 0, iq_lag_bytes = 0;
@@ -662,8 +830,8 @@ static void on_cmd(ph_ctrl_t *c, const char *line, void *user){
               "\"gain\":%.3f,\"fs_hint\":%.1f,"
               "\"swapiq\":%d,\"flipq\":%d,\"neg\":%d,\"deemph\":%d,"
               "\"taps1\":%d,\"debug\":%d,"
-              "\"foff_hz\":%.1f,\"bw_hz\":%.1f,\"tau_us\":%d,"
-              "\"active\":%d,\"iq_wpos\":%llu,\"iq_lag_ms\":%.3f,"
+              "\"foff_hz\":%.1f,\"bw_hz\":%.1f,\"tau_us\":%d,\"out_rate\":%.0f,"
+              "\"active\":%d,\"fused\":%d,\"iq_wpos\":%llu,\"iq_lag_ms\":%.3f,"
               "\"iq_lost_bytes\":%llu,\"iq_overrun_events\":%llu,"
               "\"iq_meta_overrun_bytes\":%llu,\"iq_meta_drop_bytes\":%llu,"
               "\"audio_wpos\":%llu,\"audio_used\":%u,"
@@ -672,7 +840,8 @@ static void on_cmd(ph_ctrl_t *c, const char *line, void *user){
             (int)g_swapiq,(int)g_flipq,(int)g_neg,(int)g_deemph,
             (int)atomic_load(&g_taps1),(int)g_debug,
             (double)atomic_load(&g_foff_hz),(double)atomic_load(&g_bw_hz),(int)atomic_load(&g_tau_us),
-            (int)atomic_load(&g_active), (unsigned long long)iq_w, iq_lag_ms,
+            atomic_load(&g_out_rate),
+            (int)atomic_load(&g_active), (int)atomic_load(&g_fused), (unsigned long long)iq_w, iq_lag_ms,
             (unsigned long long)iq_lost,
             (unsigned long long)iq_overrun_events,
             (unsigned long long)ph_u32_pair_get(iq_meta.overrun_lo, iq_meta.overrun_hi),
@@ -696,24 +865,26 @@ static void wfmd_free_runtime(void){
     pthread_mutex_unlock(&g_iq_mu);
     ring_close(&g_ring);
     demod_state_reset();   /* zeroes DSP IIR/feedback state so restart is clean */
-    free(g_wb.bb); free(g_wb.dphi); free(g_wb.y1); free(g_wb.y2); free(g_wb.tmp_f); free(g_wb.iq_raw);
+    free(g_wb.bb); free(g_wb.dphi); free(g_wb.y1); free(g_wb.y2); free(g_wb.y3); free(g_wb.nco_c); free(g_wb.nco_s); free(g_wb.iq_raw);
     memset(&g_wb, 0, sizeof(g_wb));
 }
 
 static void *dsp_run(void *arg){
     (void)arg;
     while(atomic_load(&g_run)){
-        if(!atomic_load(&g_active)){
+        if(!atomic_load(&g_active) || atomic_load(&g_fused)){
             ph_msleep(2);
             continue;
         }
 
         size_t total = 0;
+        pthread_mutex_lock(&g_dsp_mu);
         for(int k = 0; k < 8; k++){
             size_t n = demod_from_iq_ring();
             total += n;
             if(n == 0) break;
         }
+        pthread_mutex_unlock(&g_dsp_mu);
         if(total == 0) ph_msleep(1);
     }
     return NULL;
@@ -728,7 +899,8 @@ static void *ctrl_run(void *arg){
 
     ph_create_feed(fd, "wfmd.audio-info");
 
-    const double audio_fs = 48000.0;
+    const double out_rate = atomic_load(&g_out_rate);
+    const double audio_fs = out_rate > 0.0 ? out_rate : 48000.0;
     const size_t audio_sec = 8; /* was 2; more headroom prevents overrun from brief rate spikes */
     const size_t ring_bytes = (size_t)(audio_fs * audio_sec * sizeof(float));
     ring_close(&g_ring);
@@ -768,7 +940,7 @@ static void *ctrl_run(void *arg){
         if(infd>=0) close(infd);
     }
 
-    close(fd);
+    ph_conn_close(fd);
     return NULL;
 }
 
@@ -777,7 +949,8 @@ const char* plugin_name(void){ return "wfmd"; }
 
 bool plugin_init(const plugin_ctx_t *ctx, plugin_caps_t *out){
     PH_ENSURE_ABI(ctx);
-    static const char *CONS[] = { "wfmd.config.in", NULL };
+    /* data feeds: the IQ sources it is usually subscribed to (autoload order) */
+    static const char *CONS[] = { "wfmd.config.in", "soapy.IQ-info", "filesource.IQ-info", NULL };
     static const char *PROD[] = { "wfmd.config.out","wfmd.audio-info", NULL };
     g_sock = ctx->sock_path;
     if(out){
@@ -793,12 +966,12 @@ bool plugin_init(const plugin_ctx_t *ctx, plugin_caps_t *out){
 
 bool plugin_start(void){
     atomic_store(&g_run, 1);
-    if(pthread_create(&g_ctrl_thr, NULL, ctrl_run, NULL)!=0){
+    if(ph_thread_start(&g_ctrl_thr, "ctrl", PH_WORKER_BACKGROUND, ctrl_run, NULL)!=0){
         atomic_store(&g_run, 0);
         return false;
     }
     atomic_store(&g_ctrl_started, true);
-    if(pthread_create(&g_dsp_thr, NULL, dsp_run, NULL)!=0){
+    if(ph_thread_start(&g_dsp_thr, "dsp", PH_WORKER_DSP, dsp_run, NULL)!=0){
         atomic_store(&g_run, 0);
         pthread_join(g_ctrl_thr, NULL);
         atomic_store(&g_ctrl_started, false);
@@ -808,6 +981,45 @@ bool plugin_start(void){
     return true;
 }
 
+/* pipeline stage: IQ block in (or our subscribed ring when first), audio out
+ * (or our audio ring when last) */
+int plugin_process(const plugin_ctx_t *ctx, const ph_spans_t *in, ph_spans_t *out){
+    (void)ctx;
+    if(!atomic_load(&g_active)) return 0;
+    pthread_mutex_lock(&g_dsp_mu);
+    if(out->n){
+        g_out = &out->v[0];
+        g_out->bytes = 0;
+        g_out->kind = PH_SPAN_PCM;
+        g_out->fmt = PHAU_FMT_F32;
+        g_out->channels = 1;
+    }
+    if(!in->n){
+        demod_from_iq_ring();
+    }else{
+        const ph_span_t *s = &in->v[0];
+        uint32_t bps = phiq_fmt_bytes(s->fmt);
+        if(s->kind == PH_SPAN_IQ && bps && mix_in(s->fmt) >= 0){
+            wfmd_params_t prm;
+            wfmd_params_snapshot(&prm);
+            if(s->ts.quality & PH_TS_QUALITY_VALID) g_last_iq_ts = s->ts;
+            double fs = s->sample_rate > 0.0 ? s->sample_rate : atomic_load(&g_fs);
+            demod_block(s->data, mix_in(s->fmt), s->bytes / bps, fs, &prm);
+        }
+    }
+    if(g_out) g_out->ts = g_last_iq_ts;
+    g_out = NULL;
+    pthread_mutex_unlock(&g_dsp_mu);
+    return 0;
+}
+
+bool plugin_fuse(bool on){
+    atomic_store(&g_fused, on);
+    pthread_mutex_lock(&g_dsp_mu);     /* wait out a pass dsp_run already began */
+    pthread_mutex_unlock(&g_dsp_mu);
+    return true;
+}
+
 void plugin_stop(void){
     atomic_store(&g_active, false);
     atomic_store(&g_run, 0);
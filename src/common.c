@@ -1,6 +1,8 @@
 #define _GNU_SOURCE
 #include "ph_uds_protocol.h"
 #include "common.h"
+#include "ph_inproc.h"
+#include "ph_sched.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -13,6 +15,53 @@
 #include <arpa/inet.h>
 #include <time.h>
 #include <limits.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/eventfd.h>
+
+/* ---------- logging ----------
+ * log_msg() formats into a per-thread ring and returns; a writer thread
+ * timestamps, merges and writes the lines, so a DSP or I/O thread never waits
+ * on a slow terminal or pipe. Each image that links common.c (ph-core, every
+ * addon) runs its own writer; the destructor drains and joins it, which makes
+ * dlclose() of an addon safe. A full ring drops the line and counts it. */
+
+#define PH_LOG_SLOTS   256
+#define PH_LOG_TEXT    (512 - 16)
+#define PH_LOG_REPEAT_NS 1000000000ull   /* identical lines within 1 s are folded */
+
+typedef struct {
+    uint64_t ns;                  /* CLOCK_MONOTONIC at the call */
+    uint16_t len;
+    uint8_t  lvl;
+    char     text[PH_LOG_TEXT];
+} logrec_t;
+
+typedef struct logq {
+    _Atomic uint32_t head, tail;  /* head: writer, tail: owning thread */
+    atomic_bool      live;        /* owned by a running thread */
+    _Atomic uint64_t dropped;
+    struct logq     *next;        /* registry, push-only */
+    /* repeat folding: the owner counts, whoever swaps rep_n to 0 reports */
+    uint64_t         rep_hash, rep_since;
+    _Atomic uint64_t rep_n, rep_last;
+    atomic_int       rep_lvl;
+    logrec_t rec[PH_LOG_SLOTS];
+} logq_t;
+
+enum { LOGW_OFF, LOGW_RUN, LOGW_STOPPED };
+
+static _Atomic(logq_t*)  g_logqs;
+static _Thread_local logq_t *t_logq;
+static pthread_once_t    g_log_once = PTHREAD_ONCE_INIT;
+static pthread_key_t     g_log_key;
+static pthread_t         g_log_tid;
+static atomic_int        g_log_state = LOGW_OFF;
+static atomic_int        g_log_min = LOG_DEBUG;
+static atomic_bool       g_log_stop, g_log_sleeping;
+static int               g_log_efd = -1;
 
 static const char *lvl_name(int lvl){
     switch(lvl){
@@ -23,19 +72,302 @@ static const char *lvl_name(int lvl){
     }
 }
 
-void log_msg(log_level_t lvl, const char *fmt, ...){
+static uint64_t mono_ns(void){
     struct timespec ts;
-    clock_gettime(CLOCK_REALTIME, &ts);
-    struct tm tm;
-    localtime_r(&ts.tv_sec, &tm);
-    char tbuf[64];
-    strftime(tbuf, sizeof tbuf, "%Y-%m-%d %H:%M:%S", &tm);
-    fprintf(stderr, "[%s.%03ld] %s: ", tbuf, ts.tv_nsec/1000000, lvl_name(lvl));
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int parse_level(const char *s, int *out){
+    static const char *names[] = { "debug", "info", "warn", "error" };
+    for(int i = 0; i < 4; i++) if(strcmp(s, names[i]) == 0){ *out = i; return 0; }
+    return -1;
+}
+
+/* "[2024-01-02 03:04:05.678] INF: " for a monotonic stamp; sec caches strftime */
+typedef struct { time_t sec; char date[32]; } logclock_t;
+
+static size_t log_prefix(char *out, size_t cap, logclock_t *lc, uint64_t mono, int lvl){
+    struct timespec rt;
+    clock_gettime(CLOCK_REALTIME, &rt);
+    int64_t real = (int64_t)rt.tv_sec * 1000000000ll + rt.tv_nsec - (int64_t)(mono_ns() - mono);
+    time_t sec = (time_t)(real / 1000000000ll);
+    if(sec != lc->sec){
+        struct tm tm;
+        localtime_r(&sec, &tm);
+        strftime(lc->date, sizeof lc->date, "%Y-%m-%d %H:%M:%S", &tm);
+        lc->sec = sec;
+    }
+    int n = snprintf(out, cap, "[%s.%03d] %s: ", lc->date, (int)(real % 1000000000ll / 1000000), lvl_name(lvl));
+    return n < 0 ? 0 : (size_t)n < cap ? (size_t)n : cap - 1;
+}
+
+static void write_all(int fd, const char *p, size_t n){
+    while(n){
+        ssize_t w = write(fd, p, n);
+        if(w < 0){
+            if(errno == EINTR) continue;
+            if(errno == EAGAIN){ struct pollfd pf = { fd, POLLOUT, 0 }; poll(&pf, 1, 100); continue; }
+            return;
+        }
+        p += w; n -= (size_t)w;
+    }
+}
+
+/* ---- writer ---- */
+
+typedef struct {
+    char       buf[PIPE_BUF];     /* whole lines per write(): no tearing on a shared pipe */
+    size_t     n;
+    logclock_t clock;
+} logout_t;
+
+static void out_line(logout_t *o, uint64_t ns, int lvl, const char *text, size_t len){
+    char pre[64];
+    size_t pn = log_prefix(pre, sizeof pre, &o->clock, ns, lvl);
+    if(pn + len + 1 > sizeof o->buf) len = sizeof o->buf - pn - 1;
+    if(o->n + pn + len + 1 > sizeof o->buf){ write_all(STDERR_FILENO, o->buf, o->n); o->n = 0; }
+    memcpy(o->buf + o->n, pre, pn);       o->n += pn;
+    memcpy(o->buf + o->n, text, len);     o->n += len;
+    o->buf[o->n++] = '\n';
+}
+
+static size_t repeats_text(char *t, size_t cap, uint64_t n){
+    int k = snprintf(t, cap, "last message repeated %llu times", (unsigned long long)n);
+    return k < 0 ? 0 : (size_t)k;
+}
+
+static void out_repeats(logout_t *o, int lvl, uint64_t ns, uint64_t n){
+    char t[64];
+    out_line(o, ns, lvl, t, repeats_text(t, sizeof t, n));
+}
+
+static uint64_t text_hash(int lvl, const char *s, size_t n){
+    uint64_t h = 1469598103934665603ull ^ (uint64_t)lvl;
+    for(size_t i = 0; i < n; i++){ h ^= (unsigned char)s[i]; h *= 1099511628211ull; }
+    return h;
+}
+
+/* a burst that went quiet: report its count here, since its thread may not log again */
+static void out_idle_repeats(logout_t *o, logq_t *q, uint64_t now, bool force){
+    if(!atomic_load_explicit(&q->rep_n, memory_order_relaxed)) return;
+    if(atomic_load_explicit(&q->head, memory_order_relaxed) != atomic_load_explicit(&q->tail, memory_order_acquire)) return;
+    uint64_t last = atomic_load_explicit(&q->rep_last, memory_order_relaxed);
+    if(!force && now - last < PH_LOG_REPEAT_NS) return;
+    int lvl = atomic_load_explicit(&q->rep_lvl, memory_order_relaxed);
+    uint64_t n = atomic_exchange_explicit(&q->rep_n, 0, memory_order_acquire);
+    if(n) out_repeats(o, lvl, last, n);
+}
+
+/* write every queued line, oldest first across threads; returns lines written */
+static size_t log_drain(logout_t *o){
+    size_t done = 0;
+    for(;;){
+        logq_t *best = NULL;
+        uint64_t best_ns = 0;
+        for(logq_t *q = atomic_load_explicit(&g_logqs, memory_order_acquire); q; q = q->next){
+            uint32_t h = atomic_load_explicit(&q->head, memory_order_relaxed);
+            if(h == atomic_load_explicit(&q->tail, memory_order_acquire)) continue;
+            uint64_t ns = q->rec[h % PH_LOG_SLOTS].ns;
+            if(!best || ns < best_ns){ best = q; best_ns = ns; }
+        }
+        if(!best) break;
+        uint32_t h = atomic_load_explicit(&best->head, memory_order_relaxed);
+        const logrec_t *r = &best->rec[h % PH_LOG_SLOTS];
+        out_line(o, r->ns, r->lvl, r->text, r->len);
+        atomic_store_explicit(&best->head, h + 1, memory_order_release);
+        done++;
+    }
+    uint64_t now = mono_ns();
+    for(logq_t *q = atomic_load_explicit(&g_logqs, memory_order_acquire); q; q = q->next){
+        uint64_t d = atomic_exchange_explicit(&q->dropped, 0, memory_order_relaxed);
+        if(d){
+            char t[64];
+            int n = snprintf(t, sizeof t, "log: %llu messages dropped (ring full)", (unsigned long long)d);
+            out_line(o, now, LOG_WARN, t, (size_t)n);
+        }
+        out_idle_repeats(o, q, now, false);
+    }
+    if(o->n){ write_all(STDERR_FILENO, o->buf, o->n); o->n = 0; }
+    return done;
+}
+
+static bool log_pending(void){
+    for(logq_t *q = atomic_load_explicit(&g_logqs, memory_order_acquire); q; q = q->next)
+        if(atomic_load_explicit(&q->head, memory_order_relaxed) !=
+           atomic_load_explicit(&q->tail, memory_order_acquire)) return true;
+    return false;
+}
+
+static void *log_writer(void *arg){
+    (void)arg;
+    static logout_t out;
+    for(;;){
+        log_drain(&out);
+        if(atomic_load(&g_log_stop) && !log_pending()) break;
+        atomic_store(&g_log_sleeping, true);
+        if(log_pending()){ atomic_store(&g_log_sleeping, false); continue; }
+        /* the timeout folds up "repeated" summaries once a burst goes quiet */
+        struct pollfd pf = { g_log_efd, POLLIN, 0 };
+        if(poll(&pf, 1, 250) > 0){ uint64_t v; ssize_t r = read(g_log_efd, &v, sizeof v); (void)r; }
+        atomic_store(&g_log_sleeping, false);
+    }
+    for(logq_t *q = atomic_load(&g_logqs); q; q = q->next) out_idle_repeats(&out, q, 0, true);
+    if(out.n) write_all(STDERR_FILENO, out.buf, out.n);
+    return NULL;
+}
+
+static void log_kick(void){
+    uint64_t one = 1;
+    ssize_t r = write(g_log_efd, &one, sizeof one);
+    (void)r;
+}
+
+/* producers only pay the eventfd write when the writer is about to sleep */
+static void log_wake(void){
+    if(atomic_exchange(&g_log_sleeping, false)) log_kick();
+}
+
+static void logq_release(void *p){ atomic_store(&((logq_t*)p)->live, false); }
+
+static void log_start(void){
+    const char *env = getenv("PH_LOG_LEVEL");
+    int lvl;
+    if(env && parse_level(env, &lvl) == 0) atomic_store(&g_log_min, lvl);
+    if(pthread_key_create(&g_log_key, logq_release) != 0) return;
+    g_log_efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if(g_log_efd < 0) return;
+    /* signals (SIGINT in ph-core) stay with the application's threads */
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    int rc = pthread_create(&g_log_tid, NULL, log_writer, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if(rc != 0){ close(g_log_efd); g_log_efd = -1; return; }
+    atomic_store(&g_log_state, LOGW_RUN);
+}
+
+__attribute__((destructor))
+static void log_stop(void){
+    if(atomic_load(&g_log_state) != LOGW_RUN) return;
+    atomic_store(&g_log_stop, true);
+    log_kick();
+    pthread_join(g_log_tid, NULL);
+    atomic_store(&g_log_state, LOGW_STOPPED);
+    pthread_key_delete(g_log_key);
+    close(g_log_efd);
+    /* rings of exited threads can go; a live thread may still hold its own */
+    logq_t *keep = NULL;
+    for(logq_t *q = atomic_exchange(&g_logqs, NULL), *nx; q; q = nx){
+        nx = q->next;
+        if(atomic_load(&q->live)){ q->next = keep; keep = q; }
+        else free(q);
+    }
+    atomic_store(&g_logqs, keep);
+}
+
+/* this thread's ring: reuse one whose thread exited, else add a new one */
+static logq_t *log_queue(void){
+    if(t_logq) return t_logq;
+    logq_t *q = atomic_load_explicit(&g_logqs, memory_order_acquire);
+    for(; q; q = q->next){
+        bool idle = false;
+        if(atomic_compare_exchange_strong(&q->live, &idle, true)) break;
+    }
+    if(!q){
+        q = (logq_t*)calloc(1, sizeof *q);
+        if(!q) return NULL;
+        atomic_store(&q->live, true);
+        q->next = atomic_load(&g_logqs);
+        while(!atomic_compare_exchange_weak(&g_logqs, &q->next, q)) {}
+    }
+    pthread_setspecific(g_log_key, q);
+    return t_logq = q;
+}
+
+static void log_sync(int lvl, uint64_t ns, const char *fmt, va_list ap){
+    char line[PH_LOG_TEXT + 64];
+    logclock_t lc = { 0 };
+    size_t n = log_prefix(line, sizeof line, &lc, ns, lvl);
+    int m = vsnprintf(line + n, sizeof line - n - 1, fmt, ap);
+    if(m > 0) n += (size_t)m < sizeof line - n - 1 ? (size_t)m : sizeof line - n - 2;
+    line[n++] = '\n';
+    write_all(STDERR_FILENO, line, n);
+}
+
+void log_set_level(log_level_t lvl){
+    pthread_once(&g_log_once, log_start);
+    atomic_store(&g_log_min, (int)lvl);
+}
+
+int log_parse_level(const char *s, log_level_t *out){
+    int lvl;
+    if(!s || parse_level(s, &lvl) < 0) return -1;
+    *out = (log_level_t)lvl;
+    return 0;
+}
+
+void log_flush(int timeout_ms){
+    if(atomic_load(&g_log_state) != LOGW_RUN) return;
+    uint64_t until = mono_ns() + (uint64_t)timeout_ms * 1000000ull;
+    while(log_pending() && mono_ns() < until){
+        log_kick();
+        struct timespec d = { 0, 1000000 };
+        nanosleep(&d, NULL);
+    }
+}
+
+static int log_push(logq_t *q, uint64_t ns, int lvl, const char *text, size_t len){
+    uint32_t t = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    if(t - atomic_load_explicit(&q->head, memory_order_acquire) >= PH_LOG_SLOTS){
+        atomic_fetch_add_explicit(&q->dropped, 1, memory_order_relaxed);
+        return -1;
+    }
+    logrec_t *r = &q->rec[t % PH_LOG_SLOTS];
+    memcpy(r->text, text, len);
+    r->len = (uint16_t)len;
+    r->lvl = (uint8_t)lvl;
+    r->ns  = ns;
+    atomic_store_explicit(&q->tail, t + 1, memory_order_release);
+    return 0;
+}
+
+void log_msg(log_level_t lvl, const char *fmt, ...){
+    pthread_once(&g_log_once, log_start);
+    if((int)lvl < atomic_load_explicit(&g_log_min, memory_order_relaxed)) return;
+    uint64_t ns = mono_ns();
     va_list ap;
     va_start(ap, fmt);
-    vfprintf(stderr, fmt, ap);
+    logq_t *q = atomic_load_explicit(&g_log_state, memory_order_acquire) == LOGW_RUN ? log_queue() : NULL;
+    if(!q){
+        log_sync(lvl, ns, fmt, ap);
+        va_end(ap);
+        return;
+    }
+    char text[PH_LOG_TEXT];
+    int n = vsnprintf(text, sizeof text, fmt, ap);
     va_end(ap);
-    fputc('\n', stderr);
+    size_t len = n < 0 ? 0 : (size_t)n < sizeof text ? (size_t)n : sizeof text - 1;
+
+    /* an identical line within the window only bumps a counter: a message
+     * spun in a loop can't fill the ring and push out the ones after it */
+    uint64_t h = text_hash(lvl, text, len);
+    if(h == q->rep_hash && ns - q->rep_since < PH_LOG_REPEAT_NS){
+        atomic_store_explicit(&q->rep_lvl, (int)lvl, memory_order_relaxed);
+        atomic_store_explicit(&q->rep_last, ns, memory_order_relaxed);
+        atomic_fetch_add_explicit(&q->rep_n, 1, memory_order_release);
+        return;
+    }
+    uint64_t reps = atomic_exchange_explicit(&q->rep_n, 0, memory_order_acquire);
+    if(reps){
+        char t[64];
+        log_push(q, atomic_load_explicit(&q->rep_last, memory_order_relaxed),
+                 atomic_load_explicit(&q->rep_lvl, memory_order_relaxed), t, repeats_text(t, sizeof t, reps));
+    }
+    q->rep_hash  = h;
+    q->rep_since = ns;
+    log_push(q, ns, (int)lvl, text, len);
+    log_wake();
 }
 
 int set_nonblock(int fd){
@@ -119,6 +451,92 @@ static int wait_writable(int fd, int timeout_ms){
     }
 }
 
+// ---- named worker threads (plugin ABI >= 1.3) ----
+static const ph_sched_api_t *g_sched_api;
+static char g_sched_owner[32];
+
+void ph_sched_use(const ph_sched_api_t *api, const char *owner){
+    snprintf(g_sched_owner, sizeof g_sched_owner, "%s", owner ? owner : "");
+    g_sched_api = api;
+}
+
+int ph_thread_start(pthread_t *t, const char *name, ph_worker_class_t cls,
+                    void *(*fn)(void *), void *arg){
+    char full[64];
+    if(g_sched_owner[0]) snprintf(full, sizeof full, "%s.%s", g_sched_owner, name);
+    else                 snprintf(full, sizeof full, "%s", name);
+    if(g_sched_api) return g_sched_api->spawn(t, full, (uint32_t)cls, fn, arg);
+    int rc = pthread_create(t, NULL, fn, arg);
+    if(rc == 0){
+        char comm[16];   /* kernel limit, NUL included */
+        memcpy(comm, full, sizeof comm - 1);
+        comm[sizeof comm - 1] = '\0';
+        pthread_setname_np(*t, comm);
+    }
+    return rc;
+}
+
+// ---- in-process endpoints (plugin ABI >= 1.1) ----
+/* Set once by PH_ENSURE_ABI in an addon's copy of this file. Connections made
+ * through ph_connect_retry() to the core's own socket path become in-process
+ * endpoints; the framing helpers below look their fd up here first. */
+#define PH_IP_SLOTS 8
+
+static const ph_inproc_api_t *g_ip_api;
+static char g_ip_sock[108];
+static char g_ip_name[64];
+static struct {
+    atomic_int              fd1;   /* fd + 1; 0 = free */
+    ph_inproc_ep_t *_Atomic ep;
+} g_ip[PH_IP_SLOTS];
+static pthread_mutex_t g_ip_mu = PTHREAD_MUTEX_INITIALIZER;   /* writers only */
+
+void ph_inproc_use(const ph_inproc_api_t *api, const char *sock_path, const char *name){
+    snprintf(g_ip_sock, sizeof g_ip_sock, "%s", sock_path ? sock_path : PH_SOCK_PATH);
+    snprintf(g_ip_name, sizeof g_ip_name, "%s", name ? name : "addon");
+    g_ip_api = api;
+}
+
+static ph_inproc_ep_t *ip_lookup(int fd){
+    if(!g_ip_api || fd < 0) return NULL;
+    for(int i = 0; i < PH_IP_SLOTS; i++)
+        if(atomic_load_explicit(&g_ip[i].fd1, memory_order_acquire) == fd + 1)
+            return atomic_load_explicit(&g_ip[i].ep, memory_order_relaxed);
+    return NULL;
+}
+
+static int ip_register(int fd, ph_inproc_ep_t *ep){
+    int rc = -1;
+    pthread_mutex_lock(&g_ip_mu);
+    for(int i = 0; i < PH_IP_SLOTS && rc < 0; i++){
+        if(atomic_load_explicit(&g_ip[i].fd1, memory_order_relaxed) != 0) continue;
+        atomic_store_explicit(&g_ip[i].ep, ep, memory_order_relaxed);
+        atomic_store_explicit(&g_ip[i].fd1, fd + 1, memory_order_release);
+        rc = 0;
+    }
+    pthread_mutex_unlock(&g_ip_mu);
+    return rc;
+}
+
+static ph_inproc_ep_t *ip_unregister(int fd){
+    if(!g_ip_api || fd < 0) return NULL;
+    ph_inproc_ep_t *ep = NULL;
+    pthread_mutex_lock(&g_ip_mu);
+    for(int i = 0; i < PH_IP_SLOTS && !ep; i++){
+        if(atomic_load_explicit(&g_ip[i].fd1, memory_order_relaxed) != fd + 1) continue;
+        ep = atomic_load_explicit(&g_ip[i].ep, memory_order_relaxed);
+        atomic_store_explicit(&g_ip[i].fd1, 0, memory_order_release);
+    }
+    pthread_mutex_unlock(&g_ip_mu);
+    return ep;
+}
+
+int ph_conn_close(int fd){
+    ph_inproc_ep_t *ep = ip_unregister(fd);
+    if(ep){ g_ip_api->close(ep); return 0; }
+    return close(fd);
+}
+
 static int send_all(int fd, const void *buf, size_t len){
     const uint8_t *p=(const uint8_t*)buf;
     size_t off=0;
@@ -137,12 +555,21 @@ static int send_all(int fd, const void *buf, size_t len){
 
 int send_frame_json(int fd, const char *json_str, size_t len){
     if(!json_str || len>UINT32_MAX){ errno=EMSGSIZE; return -1; }
+    ph_inproc_ep_t *ep = ip_lookup(fd);
+    if(ep) return g_ip_api->send(ep, NULL, 0, json_str, len, false, NULL, 0, 1000);
     uint32_t be=htonl((uint32_t)len);
     if(send_all(fd,&be,sizeof be)<0) return -1;
     return send_all(fd,json_str,len);
 }
 
 int recv_frame_json(int fd, char *buf, size_t bufcap, int timeout_ms){
+    ph_inproc_ep_t *ep = ip_lookup(fd);
+    if(ep){
+        bool bin = false;
+        size_t nf = 0;
+        int n = g_ip_api->recv(ep, buf, bufcap, &bin, NULL, &nf, timeout_ms);
+        return bin ? -1 : n;
+    }
     int64_t dl = make_deadline_ns(timeout_ms);
     uint32_t be;
     if(read_full_dl(fd, &be, 4, dl) < 0) return -1;
@@ -175,21 +602,245 @@ void intvec_free(intvec_t *iv){
 
 // ---- feeds ----
 #include <pthread.h>
-static void feed_init(feed_t *f){ f->name[0]='\0'; intvec_init(&f->subs); }
+static void feed_init(feed_t *f){
+    f->name[0]='\0'; f->hash=0; intvec_init(&f->subs); intvec_init(&f->exact);
+    f->ret_json=NULL; f->ret_len=0; f->ret_nfds=0; f->ret_owner=-1;
+}
+
+static void pat_free(struct feedpat *n);
+
+static void feed_drop_retained(feedtab_t *t, feed_t *f){
+    if(!f->ret_json) return;
+    free(f->ret_json); f->ret_json=NULL; f->ret_len=0;
+    for(size_t k=0;k<f->ret_nfds;k++) close(f->ret_fds[k]);
+    f->ret_nfds=0; f->ret_owner=-1;
+    t->n_retained--;
+}
+
+static uint32_t feed_hash(const char *s){
+    uint32_t h = 2166136261u;
+    while(*s){ h ^= (uint8_t)*s++; h *= 16777619u; }
+    return h;
+}
+uint32_t feedtab_hash(const char *name){ return feed_hash(name); }
 
 void feedtab_init(feedtab_t *t){
     t->v=NULL; t->n=t->cap=0;
+    t->slots=NULL; t->slot_cap=0;
+    t->byfd=NULL; t->byfd_cap=0;
+    t->n_retained=0;
+    t->pats=NULL; t->n_patsubs=0;
+    t->gen=0;
     pthread_mutex_init(&t->mu, NULL);
 }
 void feedtab_free(feedtab_t *t){
-    for(size_t i=0;i<t->n;i++){ intvec_free(&t->v[i].subs); }
+    for(size_t i=0;i<t->n;i++){ intvec_free(&t->v[i].subs); intvec_free(&t->v[i].exact); feed_drop_retained(t, &t->v[i]); }
+    for(size_t i=0;i<t->byfd_cap;i++){ intvec_free(&t->byfd[i]); }
     free(t->v);
+    free(t->slots);
+    free(t->byfd);
+    pat_free(t->pats);
     pthread_mutex_destroy(&t->mu);
 }
+
+/* rebuild the slot array at a new power-of-two size; feed indices don't move */
+static int feedtab_rehash(feedtab_t *t, size_t ncap){
+    int *ns = (int*)malloc(ncap*sizeof(int));
+    if(!ns) return -1;
+    for(size_t i=0;i<ncap;i++) ns[i] = -1;
+    for(size_t i=0;i<t->n;i++){
+        size_t k = t->v[i].hash & (ncap-1);
+        while(ns[k] >= 0) k = (k+1) & (ncap-1);
+        ns[k] = (int)i;
+    }
+    free(t->slots);
+    t->slots = ns; t->slot_cap = ncap;
+    return 0;
+}
+
 static int feedtab_find_nolock(feedtab_t *t, const char *name){
-    for(size_t i=0;i<t->n;i++) if(strcmp(t->v[i].name, name)==0) return (int)i;
+    if(!t->slot_cap) return -1;
+    uint32_t h = feed_hash(name);
+    for(size_t k = h & (t->slot_cap-1); t->slots[k] >= 0; k = (k+1) & (t->slot_cap-1)){
+        const feed_t *f = &t->v[t->slots[k]];
+        if(f->hash == h && strcmp(f->name, name)==0) return t->slots[k];
+    }
     return -1;
 }
+
+static intvec_t *feedtab_fd_index(feedtab_t *t, int fd){
+    if(fd < 0) return NULL;
+    if((size_t)fd >= t->byfd_cap){
+        size_t nc = t->byfd_cap? t->byfd_cap: 64;
+        while(nc <= (size_t)fd) nc *= 2;
+        intvec_t *nv = (intvec_t*)realloc(t->byfd, nc*sizeof(intvec_t));
+        if(!nv) return NULL;
+        for(size_t i=t->byfd_cap;i<nc;i++) intvec_init(&nv[i]);
+        t->byfd = nv; t->byfd_cap = nc;
+    }
+    return &t->byfd[fd];
+}
+
+static void intvec_remove_value(intvec_t *iv, int x){
+    for(size_t j=0;j<iv->n;j++) if(iv->v[j]==x){ intvec_erase(iv, j); return; }
+}
+static int intvec_has(const intvec_t *iv, int x){
+    for(size_t j=0;j<iv->n;j++) if(iv->v[j]==x) return 1;
+    return 0;
+}
+
+// ---- pattern trie ----
+typedef struct feedpat {
+    char seg[POC_MAX_FEED];
+    struct feedpat *kids, *next;   // exact-segment children, sibling list
+    struct feedpat *star, *rest;   // "*" and ">" children
+    intvec_t fds;                  // subscribers whose pattern ends here
+} feedpat_t;
+
+static size_t seg_len(const char *s){ const char *e = strchr(s, '.'); return e ? (size_t)(e - s) : strlen(s); }
+static int seg_is(const char *s, size_t n, const char *w){ return n == strlen(w) && memcmp(s, w, n) == 0; }
+
+int feedtab_is_pattern(const char *name){
+    for(const char *s = name;; ){
+        size_t n = seg_len(s);
+        if(seg_is(s, n, "*") || seg_is(s, n, ">")) return 1;
+        if(!s[n]) return 0;
+        s += n + 1;
+    }
+}
+
+/* no empty segments, ">" only last */
+static int pat_valid(const char *p){
+    if(!*p || strlen(p) >= POC_MAX_FEED) return 0;
+    for(const char *s = p;; ){
+        size_t n = seg_len(s);
+        if(n == 0) return 0;
+        if(seg_is(s, n, ">") && s[n]) return 0;
+        if(!s[n]) return 1;
+        s += n + 1;
+    }
+}
+
+static int pat_match(const char *p, const char *name){
+    for(;;){
+        size_t pn = seg_len(p), nn = seg_len(name);
+        if(seg_is(p, pn, ">")) return nn > 0;
+        if(!seg_is(p, pn, "*") && (pn != nn || memcmp(p, name, pn) != 0)) return 0;
+        if(!p[pn] || !name[nn]) return !p[pn] && !name[nn];
+        p += pn + 1; name += nn + 1;
+    }
+}
+
+static feedpat_t *pat_node(const char *seg, size_t n){
+    feedpat_t *x = (feedpat_t*)calloc(1, sizeof *x);
+    if(!x) return NULL;
+    memcpy(x->seg, seg, n); x->seg[n] = '\0';
+    intvec_init(&x->fds);
+    return x;
+}
+
+static feedpat_t **pat_slot(feedpat_t *n, const char *seg, size_t len){
+    if(seg_is(seg, len, "*")) return &n->star;
+    if(seg_is(seg, len, ">")) return &n->rest;
+    feedpat_t **pp = &n->kids;
+    while(*pp && !seg_is(seg, len, (*pp)->seg)) pp = &(*pp)->next;
+    return pp;
+}
+
+static void pat_free(feedpat_t *n){
+    while(n){
+        feedpat_t *nx = n->next;
+        pat_free(n->kids); pat_free(n->star); pat_free(n->rest);
+        intvec_free(&n->fds);
+        free(n);
+        n = nx;
+    }
+}
+
+static int pat_empty(const feedpat_t *n){ return !n->fds.n && !n->kids && !n->star && !n->rest; }
+
+/* every fd whose pattern matches name; one step per segment plus wildcard branches */
+static void pat_collect(const feedpat_t *n, const char *name, intvec_t *out){
+    size_t len = seg_len(name);
+    int last = name[len] == '\0';
+    if(n->rest) for(size_t i=0;i<n->rest->fds.n;i++) intvec_push(out, n->rest->fds.v[i]);
+    const feedpat_t *next[2] = { n->star, NULL };
+    for(const feedpat_t *k = n->kids; k; k = k->next) if(seg_is(name, len, k->seg)){ next[1] = k; break; }
+    for(int j=0;j<2;j++){
+        const feedpat_t *c = next[j];
+        if(!c) continue;
+        if(last) for(size_t i=0;i<c->fds.n;i++) intvec_push(out, c->fds.v[i]);
+        else pat_collect(c, name + len + 1, out);
+    }
+}
+
+/* drop fd from the pattern's node; prunes emptied nodes. 1 if fd was there */
+static int pat_remove(feedpat_t **np, const char *p, int fd){
+    feedpat_t *n = *np;
+    if(!n) return 0;
+    int hit;
+    if(!*p){
+        hit = intvec_has(&n->fds, fd);
+        intvec_remove_value(&n->fds, fd);
+    } else {
+        size_t len = seg_len(p);
+        hit = pat_remove(pat_slot(n, p, len), p[len] ? p + len + 1 : p + len, fd);
+    }
+    if(pat_empty(n) && n->seg[0] != '\0'){
+        *np = n->next;
+        n->next = NULL;
+        pat_free(n);
+    }
+    return hit;
+}
+
+/* drop fd from every pattern (disconnect); returns how many it held */
+static size_t pat_purge_fd(feedpat_t **np, int fd){
+    size_t n = 0;
+    while(*np){
+        feedpat_t *x = *np;
+        if(intvec_has(&x->fds, fd)){ intvec_remove_value(&x->fds, fd); n++; }
+        n += pat_purge_fd(&x->kids, fd);
+        n += pat_purge_fd(&x->star, fd);
+        n += pat_purge_fd(&x->rest, fd);
+        if(pat_empty(x) && x->seg[0] != '\0'){
+            *np = x->next;
+            x->next = NULL;
+            pat_free(x);
+        } else {
+            np = &x->next;
+        }
+    }
+    return n;
+}
+
+// ---- subscriptions (t->mu held) ----
+static int sub_add_nolock(feedtab_t *t, int idx, int fd){
+    feed_t *f = &t->v[idx];
+    if(intvec_has(&f->subs, fd)) return 0;
+    intvec_t *rev = feedtab_fd_index(t, fd);
+    if(!rev) return 0;
+    intvec_push(&f->subs, fd);
+    intvec_push(rev, idx);
+    t->gen++;
+    return 1;
+}
+static void sub_del_nolock(feedtab_t *t, int idx, int fd){
+    intvec_remove_value(&t->v[idx].subs, fd);
+    if(fd >= 0 && (size_t)fd < t->byfd_cap) intvec_remove_value(&t->byfd[fd], idx);
+    t->gen++;
+}
+/* fd still wants feed idx: by name, or through one of its patterns */
+static int sub_wanted_nolock(feedtab_t *t, int idx, int fd){
+    if(intvec_has(&t->v[idx].exact, fd)) return 1;
+    if(!t->pats) return 0;
+    intvec_t m; intvec_init(&m);
+    pat_collect(t->pats, t->v[idx].name, &m);
+    int hit = intvec_has(&m, fd);
+    intvec_free(&m);
+    return hit;
+}
+
 int feedtab_find(feedtab_t *t, const char *name){
     pthread_mutex_lock(&t->mu);
     int idx = feedtab_find_nolock(t, name);
@@ -200,71 +851,271 @@ int feedtab_ensure(feedtab_t *t, const char *name){
     pthread_mutex_lock(&t->mu);
     int idx = feedtab_find_nolock(t, name);
     if(idx>=0){ pthread_mutex_unlock(&t->mu); return idx; }
+    /* keep load factor <= 1/2 so probe chains stay short */
+    if((t->n+1)*2 > t->slot_cap){
+        if(feedtab_rehash(t, t->slot_cap? t->slot_cap*2: 64) < 0){
+            pthread_mutex_unlock(&t->mu);
+            return -1;
+        }
+    }
     if(t->n == t->cap){
         size_t nc = t->cap? t->cap*2: 8;
         t->v = (feed_t*)realloc(t->v, nc*sizeof(feed_t));
         t->cap = nc;
     }
-    feed_init(&t->v[t->n]);
-    strncpy(t->v[t->n].name, name, sizeof(t->v[t->n].name)-1);
+    feed_t *f = &t->v[t->n];
+    feed_init(f);
+    strncpy(f->name, name, sizeof(f->name)-1);
+    f->hash = feed_hash(f->name);
     idx = (int)t->n;
     t->n++;
+    size_t k = f->hash & (t->slot_cap-1);
+    while(t->slots[k] >= 0) k = (k+1) & (t->slot_cap-1);
+    t->slots[k] = idx;
+    t->gen++;
+    /* pattern subscribers join the new feed before anyone can publish on it */
+    intvec_t joined; intvec_init(&joined);
+    if(t->n_patsubs){
+        intvec_t m; intvec_init(&m);
+        pat_collect(t->pats, f->name, &m);
+        for(size_t i=0;i<m.n;i++) if(sub_add_nolock(t, idx, m.v[i])) intvec_push(&joined, m.v[i]);
+        intvec_free(&m);
+    }
     pthread_mutex_unlock(&t->mu);
     log_msg(LOG_INFO, "feed created: %s", name);
+    for(size_t i=0;i<joined.n;i++) log_msg(LOG_INFO, "fd=%d subscribed to %s by pattern", joined.v[i], name);
+    intvec_free(&joined);
     return idx;
 }
-void feedtab_sub(feedtab_t *t, const char *name, int fd){
+int feedtab_sub(feedtab_t *t, const char *name, int fd){
     int idx = feedtab_ensure(t, name);
+    if(idx < 0) return -1;
     pthread_mutex_lock(&t->mu);
-    // prevent duplicates
-    for(size_t i=0;i<t->v[idx].subs.n;i++) if(t->v[idx].subs.v[i]==fd){ pthread_mutex_unlock(&t->mu); return; }
-    intvec_push(&t->v[idx].subs, fd);
+    if(!intvec_has(&t->v[idx].exact, fd)) intvec_push(&t->v[idx].exact, fd);
+    // already subscribed (by name or pattern): nothing to replay
+    int added = sub_add_nolock(t, idx, fd);
     pthread_mutex_unlock(&t->mu);
-    log_msg(LOG_INFO, "fd=%d subscribed to %s", fd, name);
+    if(added) log_msg(LOG_INFO, "fd=%d subscribed to %s", fd, name);
+    return added;
 }
 void feedtab_unsub_all_fd(feedtab_t *t, int fd){
     pthread_mutex_lock(&t->mu);
-    for(size_t i=0;i<t->n;i++){
-        for(size_t j=0;j<t->v[i].subs.n;){
-            if(t->v[i].subs.v[j]==fd) intvec_erase(&t->v[i].subs, j);
-            else j++;
+    if(fd >= 0 && (size_t)fd < t->byfd_cap){
+        intvec_t *rev = &t->byfd[fd];
+        for(size_t i=0;i<rev->n;i++){
+            intvec_remove_value(&t->v[rev->v[i]].subs, fd);
+            intvec_remove_value(&t->v[rev->v[i]].exact, fd);
         }
+        if(rev->n) t->gen++;
+        rev->n = 0;
     }
+    if(t->n_patsubs) t->n_patsubs -= pat_purge_fd(&t->pats, fd);
     pthread_mutex_unlock(&t->mu);
 }
 
 void feedtab_unsub(feedtab_t *t, const char *name, int fd){
     pthread_mutex_lock(&t->mu);
     int idx = feedtab_find_nolock(t, name);
-    if(idx >= 0){
-        intvec_t *iv = &t->v[idx].subs;
-        for(size_t j = 0; j < iv->n; ){
-            if(iv->v[j] == fd) intvec_erase(iv, j);
-            else j++;
+    if(idx >= 0 && fd >= 0 && (size_t)fd < t->byfd_cap){
+        intvec_remove_value(&t->v[idx].exact, fd);
+        if(!sub_wanted_nolock(t, idx, fd)) sub_del_nolock(t, idx, fd);
+    }
+    pthread_mutex_unlock(&t->mu);
+}
+
+int feedtab_sub_pattern(feedtab_t *t, const char *pattern, int fd, intvec_t *added){
+    if(!pat_valid(pattern) || fd < 0) return -1;
+    pthread_mutex_lock(&t->mu);
+    if(!t->pats && !(t->pats = pat_node("", 0))){ pthread_mutex_unlock(&t->mu); return -1; }
+    feedpat_t *n = t->pats;
+    for(const char *s = pattern; *s; ){
+        size_t len = seg_len(s);
+        feedpat_t **pp = pat_slot(n, s, len);
+        if(!*pp && !(*pp = pat_node(s, len))){ pthread_mutex_unlock(&t->mu); return -1; }
+        n = *pp;
+        s += len + (s[len] ? 1 : 0);
+    }
+    if(intvec_has(&n->fds, fd)){ pthread_mutex_unlock(&t->mu); return 0; }
+    intvec_push(&n->fds, fd);
+    t->n_patsubs++;
+    size_t nmatch = 0;
+    for(size_t i=0;i<t->n;i++){
+        if(!pat_match(pattern, t->v[i].name)) continue;
+        nmatch++;
+        if(sub_add_nolock(t, (int)i, fd) && added) intvec_push(added, (int)i);
+    }
+    pthread_mutex_unlock(&t->mu);
+    log_msg(LOG_INFO, "fd=%d subscribed to pattern %s (%zu existing feeds)", fd, pattern, nmatch);
+    return 1;
+}
+
+void feedtab_unsub_pattern(feedtab_t *t, const char *pattern, int fd){
+    if(!pat_valid(pattern)) return;
+    pthread_mutex_lock(&t->mu);
+    if(pat_remove(&t->pats, pattern, fd)){
+        t->n_patsubs--;
+        if(fd >= 0 && (size_t)fd < t->byfd_cap){
+            /* walk a copy: sub_del_nolock edits byfd[fd] */
+            intvec_t mine; intvec_init(&mine);
+            for(size_t i=0;i<t->byfd[fd].n;i++) intvec_push(&mine, t->byfd[fd].v[i]);
+            for(size_t i=0;i<mine.n;i++){
+                int idx = mine.v[i];
+                if(pat_match(pattern, t->v[idx].name) && !sub_wanted_nolock(t, idx, fd))
+                    sub_del_nolock(t, idx, fd);
+            }
+            intvec_free(&mine);
+        }
+    }
+    pthread_mutex_unlock(&t->mu);
+}
+
+int feedtab_pattern_matches(feedtab_t *t, const char *name){
+    pthread_mutex_lock(&t->mu);
+    int hit = 0;
+    if(t->n_patsubs){
+        intvec_t m; intvec_init(&m);
+        pat_collect(t->pats, name, &m);
+        hit = m.n > 0;
+        intvec_free(&m);
+    }
+    pthread_mutex_unlock(&t->mu);
+    return hit;
+}
+static int dup_fds(const int *src, int *dst, size_t n){
+    for(size_t k=0;k<n;k++){
+        dst[k] = fcntl(src[k], F_DUPFD_CLOEXEC, 0);
+        if(dst[k] < 0){ while(k--) close(dst[k]); return -1; }
+    }
+    return 0;
+}
+
+int feedtab_retain(feedtab_t *t, const char *name, int owner, const char *json, size_t len,
+                   const int *fds, size_t nfds){
+    if(nfds > 16) nfds = 16;
+    char *copy = (char*)malloc(len + 1);
+    int dups[16];
+    if(!copy) return -1;
+    if(nfds && dup_fds(fds, dups, nfds) < 0){ free(copy); return -1; }
+    memcpy(copy, json, len); copy[len] = '\0';
+
+    int idx = feedtab_ensure(t, name);
+    if(idx < 0){ free(copy); for(size_t k=0;k<nfds;k++) close(dups[k]); return -1; }
+    pthread_mutex_lock(&t->mu);
+    feed_t *f = &t->v[idx];
+    feed_drop_retained(t, f);
+    f->ret_json = copy; f->ret_len = len;
+    memcpy(f->ret_fds, dups, nfds*sizeof(int)); f->ret_nfds = nfds;
+    f->ret_owner = owner;
+    t->n_retained++;
+    pthread_mutex_unlock(&t->mu);
+    return 0;
+}
+
+int feedtab_retained(feedtab_t *t, const char *name, char **json, size_t *len,
+                     int *fds, size_t *nfds){
+    int rc = -1;
+    pthread_mutex_lock(&t->mu);
+    int idx = feedtab_find_nolock(t, name);
+    if(idx >= 0 && t->v[idx].ret_json){
+        const feed_t *f = &t->v[idx];
+        char *copy = (char*)malloc(f->ret_len + 1);
+        if(copy && dup_fds(f->ret_fds, fds, f->ret_nfds) == 0){
+            memcpy(copy, f->ret_json, f->ret_len + 1);
+            *json = copy; *len = f->ret_len; *nfds = f->ret_nfds;
+            rc = 0;
+        } else {
+            free(copy);
         }
     }
     pthread_mutex_unlock(&t->mu);
+    return rc;
+}
+
+void feedtab_drop_retained_fd(feedtab_t *t, int fd){
+    pthread_mutex_lock(&t->mu);
+    /* retained values are few (ring announcements); skip the scan when there are none */
+    for(size_t i=0;t->n_retained && i<t->n;i++)
+        if(t->v[i].ret_json && t->v[i].ret_owner == fd) feed_drop_retained(t, &t->v[i]);
+    pthread_mutex_unlock(&t->mu);
 }
-void feedtab_list(feedtab_t *t, int fd){
+
+static size_t snapshot_subs_nolock(feedtab_t *t, int idx, int *out, size_t cap){
+    if(idx < 0 || (size_t)idx >= t->n) return 0;
+    const intvec_t *iv = &t->v[idx].subs;
+    size_t n = iv->n < cap ? iv->n : cap;
+    memcpy(out, iv->v, n*sizeof(int));
+    return iv->n;
+}
+size_t feedtab_snapshot_subs(feedtab_t *t, const char *name, int *out, size_t cap){
+    pthread_mutex_lock(&t->mu);
+    size_t total = snapshot_subs_nolock(t, feedtab_find_nolock(t, name), out, cap);
+    pthread_mutex_unlock(&t->mu);
+    return total;
+}
+size_t feedtab_snapshot_subs_idx(feedtab_t *t, int idx, char *name, size_t namecap,
+                                 int *out, size_t cap){
+    pthread_mutex_lock(&t->mu);
+    size_t total = 0;
+    if(idx >= 0 && (size_t)idx < t->n){
+        if(name && namecap) snprintf(name, namecap, "%s", t->v[idx].name);
+        total = snapshot_subs_nolock(t, idx, out, cap);
+    } else if(name && namecap){
+        name[0] = '\0';
+    }
+    pthread_mutex_unlock(&t->mu);
+    return total;
+}
+typedef struct { char name[POC_MAX_FEED]; size_t subs_n; int retained; } feedsnap_t;
+
+/* rebuild pattern strings depth-first; path holds the segments so far */
+static void pat_snapshot(const feedpat_t *n, char *path, size_t plen, feedsnap_t *out, size_t *nout, size_t cap){
+    for(; n && *nout < cap; n = n->next){
+        size_t l = plen;
+        path[plen] = '\0';
+        if(n->seg[0]){
+            int w = snprintf(path + plen, POC_MAX_FEED - plen, "%s%s", plen ? "." : "", n->seg);
+            if(w < 0 || (size_t)w >= POC_MAX_FEED - plen) continue;
+            l += (size_t)w;
+        }
+        if(n->fds.n && *nout < cap){
+            memcpy(out[*nout].name, path, l + 1);
+            out[*nout].subs_n = n->fds.n;
+            (*nout)++;
+        }
+        pat_snapshot(n->kids, path, l, out, nout, cap);
+        pat_snapshot(n->star, path, l, out, nout, cap);
+        pat_snapshot(n->rest, path, l, out, nout, cap);
+    }
+}
+
+void feedtab_list(feedtab_t *t, int fd, int (*sendf)(int fd, const char *json, size_t len)){
     /* Snapshot under lock so we never hold the mutex during socket I/O.
      * A blocked sender could otherwise stall every publish/subscribe on this broker. */
-    typedef struct { char name[POC_MAX_FEED]; size_t subs_n; } snap_t;
-    snap_t snap[128];
-    size_t snap_n;
+    feedsnap_t snap[128], pats[32];
+    size_t snap_n, pats_n = 0;
+    char path[POC_MAX_FEED] = "";
     pthread_mutex_lock(&t->mu);
     snap_n = t->n < 128 ? t->n : 128;
     for(size_t i=0;i<snap_n;i++){
         memcpy(snap[i].name, t->v[i].name, POC_MAX_FEED);
         snap[i].subs_n = t->v[i].subs.n;
+        snap[i].retained = t->v[i].ret_json != NULL;
     }
+    pat_snapshot(t->pats, path, 0, pats, &pats_n, 32);
     pthread_mutex_unlock(&t->mu);
 
     char buf[POC_MAX_JSON];
     for(size_t i=0;i<snap_n;i++){
-        int len = snprintf(buf, sizeof buf, "{\"type\":\"info\",\"feed\":\"%s\",\"subs\":%zu}",
-                           snap[i].name, snap[i].subs_n);
+        int len = snprintf(buf, sizeof buf, "{\"type\":\"info\",\"feed\":\"%s\",\"subs\":%zu,\"retained\":%s}",
+                           snap[i].name, snap[i].subs_n, snap[i].retained ? "true" : "false");
+        if(len > 0 && (size_t)len < sizeof buf)
+            sendf(fd, buf, (size_t)len);
+    }
+    for(size_t i=0;i<pats_n;i++){
+        int len = snprintf(buf, sizeof buf, "{\"type\":\"info\",\"pattern\":\"%s\",\"subs\":%zu}",
+                           pats[i].name, pats[i].subs_n);
         if(len > 0 && (size_t)len < sizeof buf)
-            send_frame_json(fd, buf, (size_t)len);
+            sendf(fd, buf, (size_t)len);
     }
 }
 
@@ -439,6 +1290,8 @@ int send_frame_json_with_fds(int fd, const char *json_str, size_t len, const int
         return send_frame_json(fd, json_str, len);
     }
     if(nfds > 16) nfds = 16;
+    ph_inproc_ep_t *ep = ip_lookup(fd);
+    if(ep) return g_ip_api->send(ep, NULL, 0, json_str, len, false, fds, nfds, 1000);
 
     /* 1) Send the framed length first. */
     if(len>UINT32_MAX){ errno=EMSGSIZE; return -1; }
@@ -493,12 +1346,23 @@ static int recv_all_dl(int fd, void *buf, size_t len, int64_t dl){
     return 0;
 }
 
-int recv_frame_json_with_fds(int fd, char *json_out, size_t outcap,
-                             int *fds_out, size_t *nfds_inout, int timeout_ms){
+int recv_frame_any_with_fds(int fd, char *json_out, size_t outcap, int *is_bin,
+                            int *fds_out, size_t *nfds_inout, int timeout_ms){
+    ph_inproc_ep_t *ep = ip_lookup(fd);
+    if(ep){
+        bool bin = false;
+        size_t none = 0;
+        int n = g_ip_api->recv(ep, json_out, outcap, &bin, fds_out,
+                               nfds_inout ? nfds_inout : &none, timeout_ms);
+        if(is_bin) *is_bin = bin;
+        return n;
+    }
     int64_t dl = make_deadline_ns(timeout_ms);
     uint32_t be = 0;
     if(recv_all_dl(fd, &be, 4, dl)<0) return -1;
     uint32_t len = ntohl(be);
+    if(is_bin) *is_bin = (len & PH_FRAME_BIN) != 0;
+    len &= PH_FRAME_LEN_MASK;
     if(len >= outcap) return -1;
 
     size_t capfds = nfds_inout ? *nfds_inout : 0;
@@ -541,6 +1405,140 @@ int recv_frame_json_with_fds(int fd, char *json_out, size_t outcap,
     return (int)len;
 }
 
+int recv_frame_json_with_fds(int fd, char *json_out, size_t outcap,
+                             int *fds_out, size_t *nfds_inout, int timeout_ms){
+    int bin = 0;
+    size_t cap = nfds_inout ? *nfds_inout : 0;
+    int n = recv_frame_any_with_fds(fd, json_out, outcap, &bin, fds_out, nfds_inout, timeout_ms);
+    if(n >= 0 && bin){
+        /* only negotiated clients get binary frames; drop it, don't leak fds */
+        for(size_t i = 0; nfds_inout && i < *nfds_inout && i < cap; i++) close(fds_out[i]);
+        if(nfds_inout) *nfds_inout = 0;
+        return -1;
+    }
+    return n;
+}
+
+// ---- binary frames ----
+void ph_bin_hdr_pack(uint8_t out[PH_BIN_HDR_LEN], const ph_bin_hdr_t *h){
+    uint16_t fl = htons(h->flags);
+    uint32_t id = htonl(h->feed_id);
+    out[0] = h->version;
+    out[1] = h->op;
+    memcpy(out + 2, &fl, 2);
+    memcpy(out + 4, &id, 4);
+}
+
+int ph_bin_hdr_unpack(const uint8_t *in, size_t len, ph_bin_hdr_t *h){
+    if(len < PH_BIN_HDR_LEN) return -1;
+    uint16_t fl; uint32_t id;
+    memcpy(&fl, in + 2, 2);
+    memcpy(&id, in + 4, 4);
+    h->version = in[0];
+    h->op      = in[1];
+    h->flags   = ntohs(fl);
+    h->feed_id = ntohl(id);
+    return h->version == PH_BIN_VERSION ? 0 : -1;
+}
+
+int send_frame_bin(int fd, const ph_bin_hdr_t *h, const void *payload, size_t len,
+                   const int *fds, size_t nfds){
+    if(len + PH_BIN_HDR_LEN >= POC_MAX_JSON){ errno=EMSGSIZE; return -1; }
+    if(nfds > 16) nfds = 16;
+    uint8_t hdr[PH_BIN_HDR_LEN];
+    ph_bin_hdr_pack(hdr, h);
+    ph_inproc_ep_t *ep = ip_lookup(fd);
+    if(ep) return g_ip_api->send(ep, hdr, sizeof hdr, payload, len, true, fds, nfds, 1000);
+    uint32_t be = htonl((uint32_t)(PH_BIN_HDR_LEN + len) | PH_FRAME_BIN);
+    if(send_all(fd,&be,sizeof be)<0) return -1;
+
+    /* header + payload in one sendmsg(); descriptors ride on it like JSON frames */
+    struct iovec iov[2] = { { hdr, PH_BIN_HDR_LEN }, { (void*)payload, len } };
+    char cbuf[CMSG_SPACE(sizeof(int)*16)];
+    struct msghdr msg; memset(&msg, 0, sizeof msg);
+    msg.msg_iov = iov; msg.msg_iovlen = len ? 2 : 1;
+    if(fds && nfds){
+        msg.msg_control = cbuf; msg.msg_controllen = CMSG_SPACE(sizeof(int)*nfds);
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type  = SCM_RIGHTS;
+        cmsg->cmsg_len   = CMSG_LEN(sizeof(int)*nfds);
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(int)*nfds);
+    }
+    ssize_t s;
+    for(;;){
+        s=sendmsg(fd,&msg,MSG_NOSIGNAL);
+        if(s<0 && errno==EINTR) continue;
+        if(s<0 && (errno==EAGAIN || errno==EWOULDBLOCK)){
+            if(wait_writable(fd,1000)<0) return -1;
+            continue;
+        }
+        break;
+    }
+    if(s<=0) return -1;
+    size_t sent=(size_t)s;
+    if(sent < PH_BIN_HDR_LEN){
+        if(send_all(fd,hdr+sent,PH_BIN_HDR_LEN-sent)<0) return -1;
+        sent = PH_BIN_HDR_LEN;
+    }
+    sent -= PH_BIN_HDR_LEN;
+    if(sent<len && send_all(fd,(const uint8_t*)payload+sent,len-sent)<0) return -1;
+    return 0;
+}
+
+/* Wait for a JSON reply of the given type, skipping unrelated traffic.
+ * The reply (truncated to cap) is copied to out. */
+static int await_reply(int fd, const char *want, char *out, size_t cap, int64_t dl){
+    char *buf = (char*)malloc(POC_MAX_JSON);
+    if(!buf) return -1;
+    int rc = -1;
+    for(;;){
+        int rem = deadline_ms_left(dl);
+        if(rem == 0) break;
+        int bin = 0;
+        size_t nf = 0;
+        int n = recv_frame_any_with_fds(fd, buf, POC_MAX_JSON, &bin, NULL, &nf, rem);
+        if(n < 0) break;
+        char type[32];
+        if(!bin && json_get_type(buf, type, sizeof type)==0 && strcmp(type, want)==0){
+            snprintf(out, cap, "%s", buf);
+            rc = 0;
+            break;
+        }
+    }
+    free(buf);
+    return rc;
+}
+
+int ph_bin_hello(int fd, int timeout_ms){
+    const char *hello = "{\"type\":\"hello\",\"bin\":1}";
+    if(send_frame_json(fd, hello, strlen(hello))<0) return -1;
+    char buf[512], v[16];
+    if(await_reply(fd, "hello", buf, sizeof buf, make_deadline_ns(timeout_ms))<0) return -1;
+    if(json_get_string(buf, "bin", v, sizeof v)<0 || atoi(v) < 1) return -1;
+    return 0;
+}
+
+int ph_feed_id(int fd, const char *feed, uint32_t *id_out, int timeout_ms){
+    char esc[POC_MAX_FEED*2], req[POC_MAX_FEED*2 + 64], buf[512], v[16], got[POC_MAX_FEED];
+    ph_json_escape_string(feed, esc, sizeof esc);
+    int n = snprintf(req, sizeof req, "{\"type\":\"feed_id\",\"feed\":\"%s\"}", esc);
+    if(n <= 0 || (size_t)n >= sizeof req) return -1;
+    if(send_frame_json(fd, req, (size_t)n)<0) return -1;
+    int64_t dl = make_deadline_ns(timeout_ms);
+    for(;;){
+        if(await_reply(fd, "feed_id", buf, sizeof buf, dl)<0) return -1;
+        if(json_get_string(buf, "feed", got, sizeof got)!=0 || strcmp(got, feed)!=0) continue;
+        /* refused ("error") or, from older brokers, "id":-1 */
+        if(json_get_string(buf, "id", v, sizeof v)!=0) return -1;
+        char *end;
+        long id = strtol(v, &end, 10);
+        if(end == v || id < 0 || (unsigned long)id > UINT32_MAX) return -1;
+        *id_out = (uint32_t)id;
+        return 0;
+    }
+}
+
 void ph_msleep(int ms){
     struct timespec ts;
     if (ms <= 0) {
@@ -558,6 +1556,12 @@ int ph_connect_retry(const char *sock, int attempts, int delay_ms){
     if(delay_ms < 0) delay_ms = 0;
     if(!sock) sock = PH_SOCK_PATH;
     int fd = -1;
+    if(g_ip_api && strcmp(sock, g_ip_sock) == 0){
+        ph_inproc_ep_t *ep = g_ip_api->open(g_ip_name, &fd);
+        if(ep && ip_register(fd, ep) == 0) return fd;
+        if(ep) g_ip_api->close(ep);
+        fd = -1;   /* fall back to the socket */
+    }
     for(int i = 0; i < attempts; ++i){
         fd = uds_connect(sock);
         if(fd >= 0) break;
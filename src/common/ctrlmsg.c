@@ -34,7 +34,7 @@ void ph_unsubscribe(int fd, const char *feed) {
 }
 
 void ph_publish(int fd, const char *feed, const char *data_json) {
-    char fesc[192], js[1024]; escape_feed(feed,fesc,sizeof fesc);
+    char fesc[192], js[8192]; escape_feed(feed,fesc,sizeof fesc);
     int n = snprintf(js, sizeof js,
         "{\"type\":\"publish\",\"feed\":\"%s\",\"data\":%s}", fesc, data_json);
     if (n > 0 && (size_t)n < sizeof js) send_frame_json(fd, js, (size_t)n);
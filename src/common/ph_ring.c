@@ -29,7 +29,7 @@ int ph_iq_ring_create(const char *tag,
     h->version     = PHIQ_VERSION;
     h->capacity    = (uint32_t)cap;
     h->fmt         = fmt;
-    h->bytes_per_samp = (fmt == PHIQ_FMT_CF32) ? 8u : 4u;
+    h->bytes_per_samp = phiq_fmt_bytes(fmt);
     h->channels    = chans;
     h->sample_rate = sr;
     atomic_store(&h->seq, 0);
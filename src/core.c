@@ -2,9 +2,21 @@
 #include "ph_uds_protocol.h"
 #include "common.h"
 #include "plugin.h"
+#include "core_client.h"
+#include "core_inproc.h"
+#include "core_rcu.h"
+#include "core_route.h"
+#include "core_stats.h"
+#include "core_addons.h"
+#include "core_pipeline.h"
+#include "core_sched.h"
+#include "core_autoload.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdatomic.h>
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
@@ -12,11 +24,11 @@
 #include <pthread.h>
 #include <dlfcn.h>
 #include <sys/epoll.h>
-#include <dirent.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <time.h>
 #include <execinfo.h>
 
 #include "ph_version.h"
@@ -24,21 +36,6 @@
 #define PH_GIT_SHA "unknown"
 #endif
 
-/* ========= Small utilities ========= */
-
-// Safe path copy (trunc-safe): returns 0 on success, -1 on truncation.
-static int path_copy(char *dst, size_t cap, const char *src){
-    size_t n = strlen(src);
-    if (n >= cap) { // needs space for '\0'
-        if (cap) { dst[0] = '\0'; }
-        return -1;
-    }
-    memcpy(dst, src, n+1);
-    return 0;
-}
-
-static void json_send_kv_list(int fd, const char *type, const char *key, char **items, int n);
-
 /* ========= Plugin table ========= */
 
 typedef struct {
@@ -47,8 +44,12 @@ typedef struct {
     plugin_init_fn  f_init;
     plugin_start_fn f_start;
     plugin_stop_fn  f_stop;
+    plugin_process_fn f_process;  /* optional (ABI 1.2), with f_fuse */
+    plugin_fuse_fn    f_fuse;
+    uint16_t abi_minor;           /* plugin_abi_minor, 0 when not exported (< 1.3) */
     char name[64];
     char path[512]; /* store exact load path for diagnostics */
+    uint32_t init_us, start_us;   /* plugin_init / plugin_start wall time */
 } plug_t;
 
 typedef struct {
@@ -58,7 +59,9 @@ typedef struct {
 
 static void plugtab_init(plugtab_t *t){ t->v=NULL; t->n=t->cap=0; pthread_mutex_init(&t->mu,NULL); }
 static void plugtab_free(plugtab_t *t){
-    for(size_t i=0;i<t->n;i++){
+    pipeline_stop_all();
+    /* reverse load order: consumers stop before the producers they read from */
+    for(size_t i=t->n;i-- > 0;){
         if(t->v[i].f_stop) t->v[i].f_stop();
         if(t->v[i].dl) dlclose(t->v[i].dl);
     }
@@ -84,11 +87,12 @@ static void plugtab_remove(plugtab_t *t, size_t idx){
 
 /* ========= Global state ========= */
 
-static volatile sig_atomic_t g_run = 1;
+static atomic_int g_run = 1;   /* read by every loop thread; set from signals */
 static void on_sigint(int s){ (void)s; g_run = 0; }
 
 static void crash_handler(int sig) {
     void *bt[64];
+    log_flush(200);   /* lines queued before the fault */
     int n = backtrace(bt, 64);
     char **syms = backtrace_symbols(bt, n);
     dprintf(STDERR_FILENO, "\n[ph-core] FATAL signal %d — backtrace:\n", sig);
@@ -102,117 +106,98 @@ static void crash_handler(int sig) {
 static feedtab_t g_feeds;
 static plugtab_t g_plugins;
 static int g_listen_fd = -1;
-static int g_client_count = 0;
+static int g_inproc_fd = -1;   /* adoption eventfd for in-process endpoints */
 #define PH_MAX_CLIENTS 512
 
 /* ========= Feeds ========= */
 
-/* RT pipeline can have many consumers on a feed (TDOA array elements, etc.) */
-#define PH_MAX_SNAP_SUBS 1024
-
+/* Lock-free: the routing snapshot stays valid until this loop thread's next
+   quiescent point, and client_send never blocks, so a slow subscriber only
+   fills its own queue. */
 static void broadcast_to_subs(const char *feed, const char *json, size_t len, int *fds, size_t nfds){
-    /* Snapshot subscriber list under lock, then send outside lock.
-       Prevents a slow subscriber from blocking all others. */
-    int snap[PH_MAX_SNAP_SUBS]; size_t snap_n = 0;
-    pthread_mutex_lock(&g_feeds.mu);
-    for(size_t i = 0; i < g_feeds.n; i++){
-        if(strcmp(g_feeds.v[i].name, feed) == 0){
-            intvec_t *iv = &g_feeds.v[i].subs;
-            if(iv->n > PH_MAX_SNAP_SUBS)
-                log_msg(LOG_WARN, "feed %s: %zu subscribers exceed snapshot cap %d; extras dropped",
-                        feed, iv->n, PH_MAX_SNAP_SUBS);
-            snap_n = iv->n < PH_MAX_SNAP_SUBS ? iv->n : PH_MAX_SNAP_SUBS;
-            for(size_t j = 0; j < snap_n; j++) snap[j] = iv->v[j];
-            break;
-        }
+    uint64_t t0 = stats_now_ns();
+    const ph_route_t *r = route_get();
+    const ph_route_feed_t *rf = route_find(r, feed);
+    if(!rf) return;
+    clients_borrow();
+    for(uint32_t i = 0; i < rf->nsubs; i++){
+        client_send(rf->subs[i], feed, json, len, fds, nfds);
     }
-    pthread_mutex_unlock(&g_feeds.mu);
+    clients_flush();   /* json and fds belong to the publisher's frame */
+    stats_publish((uint32_t)(rf - r->feeds), len, nfds, rf->nsubs, stats_now_ns() - t0);
+}
 
-    for(size_t i = 0; i < snap_n; i++){
-        if(nfds > 0)
-            send_frame_json_with_fds(snap[i], json, len, fds, nfds);
-        else
-            send_frame_json(snap[i], json, len);
-    }
-}
-
-/* ========= Add-on discovery (autoload) ========= */
-
-/* Match only unversioned .so files — strstr would hit libfoo.so.1.2.3 */
-static int name_ends_with_so(const char *name){
-    size_t n = strlen(name);
-    return n > 3 && strcmp(name + n - 3, ".so") == 0;
-}
-
-static int scan_addon_paths(char paths[][512], int maxn){
-    int n=0;
-    const char *roots[] = {"./src/addons", "./addons", "./"};
-    for(size_t r=0;r<sizeof(roots)/sizeof(roots[0]);r++){
-        DIR *d = opendir(roots[r]);
-        if(!d) continue;
-        struct dirent *de;
-        while((de=readdir(d))){
-            if(de->d_name[0]=='.') continue;
-            char sub[512];
-            int ok = snprintf(sub, sizeof sub, "%s/%s", roots[r], de->d_name);
-            if(ok < 0 || (size_t)ok >= sizeof sub) continue;
-
-            struct stat st; if(stat(sub,&st)<0) continue;
-            if(S_ISDIR(st.st_mode)){
-                DIR *d2 = opendir(sub); if(!d2) continue;
-                struct dirent *de2;
-                while((de2=readdir(d2))){
-                    if(de2->d_name[0]=='.') continue;
-                    if(!name_ends_with_so(de2->d_name)) continue;
-                    char so[512];
-                    ok = snprintf(so, sizeof so, "%s/%s", sub, de2->d_name);
-                    if(ok < 0 || (size_t)ok >= sizeof so) continue;
-                    if(access(so,R_OK)==0 && n<maxn){
-                        path_copy(paths[n++], 512, so);
-                    }
-                }
-                closedir(d2);
-            } else if(S_ISREG(st.st_mode)){
-                if(name_ends_with_so(de->d_name) && access(sub,R_OK)==0 && n<maxn){
-                    path_copy(paths[n++], 512, sub);
+/* Binary publish: route on feed id, forward the frame untouched to binary
+   clients and transcode once to base64 JSON for everyone else (CLI monitors). */
+static void broadcast_bin(int fd, const char *frame, size_t len, const ph_bin_hdr_t *h,
+                          int *fds, size_t nfds){
+    uint64_t t0 = stats_now_ns();
+    const ph_route_feed_t *rf = route_at(route_get(), h->feed_id);
+    if(!rf){
+        log_msg(LOG_WARN, "fd=%d: binary publish to unknown feed id %u", fd, (unsigned)h->feed_id);
+        return;
+    }
+    const char *feed = rf->name;
+
+    char *js = NULL; int js_len = -1;
+    clients_borrow();
+    for(uint32_t i = 0; i < rf->nsubs; i++){
+        int sfd = rf->subs[i];
+        if(client_is_bin(sfd)){
+            client_send_bin(sfd, feed, frame, len, fds, nfds);
+            continue;
+        }
+        if(js_len == -1){
+            const uint8_t *pl = (const uint8_t*)frame + PH_BIN_HDR_LEN;
+            size_t pl_len = len - PH_BIN_HDR_LEN, b64_len = 0;
+            char feed_esc[POC_MAX_FEED * 2];
+            ph_json_escape_string(feed, feed_esc, sizeof feed_esc);
+            js_len = -2;
+            if(b64_encoded_len(pl_len) + sizeof feed_esc + 96 < POC_MAX_JSON && (js = malloc(POC_MAX_JSON))){
+                int n = snprintf(js, POC_MAX_JSON,
+                    "{\"type\":\"publish\",\"feed\":\"%s\",\"encoding\":\"base64\",\"bin\":true,\"data\":\"", feed_esc);
+                if(n > 0 && b64_encode(pl, pl_len, js + n, &b64_len) == 0){
+                    memcpy(js + n + b64_len, "\"}", 2);
+                    js_len = n + (int)b64_len + 2;
                 }
             }
+            if(js_len < 0) log_msg(LOG_DEBUG, "feed %s: binary payload too large for JSON subscribers", feed);
         }
-        closedir(d);
+        if(js_len > 0) client_send(sfd, feed, js, (size_t)js_len, fds, nfds);
     }
-    return n;
+    clients_flush();
+    free(js);
+    stats_publish(h->feed_id, len, nfds, rf->nsubs, stats_now_ns() - t0);
 }
 
+/* Retain the stats page on core.stats so every subscriber gets the memfd,
+   the same way add-ons hand out their shm_map buffers. */
+static void stats_announce(void){
+    int sfd = stats_fd();
+    if(sfd < 0) return;
+    char js[256];
+    int n = snprintf(js, sizeof js,
+        "{\"type\":\"publish\",\"feed\":\"" PH_STATS_FEED "\",\"subtype\":\"shm_map\","
+        "\"proto\":\"" PH_STATS_PROTO "\",\"version\":\"%d.%d\",\"size\":%zu,"
+        "\"desc\":\"broker counters\",\"mode\":\"r\"}",
+        PH_STATS_VMAJOR, PH_STATS_VMINOR, stats_page_bytes());
+    if(n <= 0 || (size_t)n >= sizeof js) return;
+    if(feedtab_retain(&g_feeds, PH_STATS_FEED, -1, js, (size_t)n, &sfd, 1) < 0)
+        log_msg(LOG_WARN, "stats: could not retain %s", PH_STATS_FEED);
+    route_sync();
+}
 
-static int resolve_addon_arg(const char *arg, char out[512]){
-    if(!arg || !out) return -1;
-    out[0] = '\0';
-
-    if(strstr(arg, ".so") && access(arg, R_OK)==0){
-        return path_copy(out, 512, arg);
-    }
+/* ========= Loader / Unloader (centralized) =========
+ * Loading is split in steps so autoload can run them for many addons at once:
+ * plug_open (dlopen, symbols, duplicate check) stays serial, plug_init and
+ * plug_start may run on worker threads. Each step cleans up after itself. */
 
-    char want1[512], want2[512];
-    int n1 = snprintf(want1, sizeof want1, "ph-lib%s.so", arg);
-    int n2 = snprintf(want2, sizeof want2, "%s.so", arg);
-    if(n1 < 0 || n2 < 0 || (size_t)n1 >= sizeof want1 || (size_t)n2 >= sizeof want2)
-        return -1;
-
-    char paths[128][512];
-    int n = scan_addon_paths(paths, 128);
-    for(int i=0;i<n;i++){
-        const char *base = strrchr(paths[i], '/');
-        base = base ? base + 1 : paths[i];
-        if(strcmp(base, want1)==0 || strcmp(base, want2)==0 || strcmp(base, arg)==0){
-            return path_copy(out, 512, paths[i]);
-        }
-    }
-    return -1;
+static uint32_t elapsed_us(uint64_t since_ns){
+    uint64_t d = (stats_now_ns() - since_ns) / 1000u;
+    return d > UINT32_MAX ? UINT32_MAX : (uint32_t)d;
 }
 
-/* ========= Loader / Unloader (centralized) ========= */
-
-static int load_plugin_from_path(const char *so_path){
+static int plug_open(const char *so_path, plug_t *p){
     if(!so_path || !strstr(so_path, ".so") || access(so_path, R_OK)!=0){
         log_msg(LOG_ERROR, "load: invalid or unreadable path: %s", so_path?so_path:"(null)");
         return -1;
@@ -221,111 +206,465 @@ static int load_plugin_from_path(const char *so_path){
     void *dl = dlopen(so_path, RTLD_NOW);
     if(!dl){ log_msg(LOG_ERROR, "dlopen(%s): %s", so_path, dlerror()); return -2; }
 
-    plug_t p = (plug_t){0};
-    p.dl     = dl;
-    p.f_name = (plugin_name_fn)dlsym(dl, "plugin_name");
-    p.f_init = (plugin_init_fn)dlsym(dl, "plugin_init");
-    p.f_start= (plugin_start_fn)dlsym(dl, "plugin_start");
-    p.f_stop = (plugin_stop_fn)dlsym(dl, "plugin_stop");
-
-    if(!p.f_name || !p.f_init || !p.f_start || !p.f_stop){
+    *p = (plug_t){0};
+    p->dl     = dl;
+    p->f_name = (plugin_name_fn)dlsym(dl, "plugin_name");
+    p->f_init = (plugin_init_fn)dlsym(dl, "plugin_init");
+    p->f_start= (plugin_start_fn)dlsym(dl, "plugin_start");
+    p->f_stop = (plugin_stop_fn)dlsym(dl, "plugin_stop");
+    p->f_process = (plugin_process_fn)dlsym(dl, "plugin_process");
+    p->f_fuse    = (plugin_fuse_fn)dlsym(dl, "plugin_fuse");
+    if(!p->f_process || !p->f_fuse){ p->f_process = NULL; p->f_fuse = NULL; }
+    const uint16_t *minor = (const uint16_t*)dlsym(dl, "plugin_abi_minor");
+    p->abi_minor = minor ? *minor : 0;
+
+    if(!p->f_name || !p->f_init || !p->f_start || !p->f_stop){
         log_msg(LOG_ERROR,"bad plugin ABI in %s", so_path);
         dlclose(dl);
         return -3;
     }
 
-    snprintf(p.name, sizeof p.name, "%s", p.f_name());
-    if(plugtab_find(&g_plugins, p.name) >= 0){
-        log_msg(LOG_INFO, "skip %s (already loaded)", p.name);
+    snprintf(p->name, sizeof p->name, "%s", p->f_name());
+    pthread_mutex_lock(&g_plugins.mu);
+    int dup = plugtab_find(&g_plugins, p->name) >= 0;
+    pthread_mutex_unlock(&g_plugins.mu);
+    if(dup){
+        log_msg(LOG_INFO, "skip %s (already loaded)", p->name);
         dlclose(dl);
         return 1; /* not an error, just a skip */
     }
 
-    snprintf(p.path, sizeof p.path, "%s", so_path);
+    snprintf(p->path, sizeof p->path, "%s", so_path);
+    return 0;
+}
 
-    /* Build ctx for ABI 1.0 */
+/* An addon older than 1.3 checks abi_minor against its own and exports no
+ * plugin_abi_minor: it gets a 1.0 context, which every 1.x addon accepts. */
+static plugin_ctx_t plug_ctx(const char *name, uint16_t addon_minor){
+    uint16_t minor = addon_minor < PLUGIN_ABI_MINOR ? addon_minor : PLUGIN_ABI_MINOR;
     plugin_ctx_t ctx = {
         .abi_major     = PLUGIN_ABI_MAJOR,
-        .abi_minor     = PLUGIN_ABI_MINOR,
+        .abi_minor     = minor,
         .ctx_size      = sizeof(plugin_ctx_t),
         .sock_path     = PH_SOCK_PATH,
-        .name          = p.name,
-        .core_features = 0u
+        .name          = name,
     };
+    if(minor >= 1 && g_inproc_fd >= 0){ ctx.core_features |= PH_CORE_FEAT_INPROC; ctx.inproc = &ph_core_inproc_api; }
+    if(minor >= 2) ctx.core_features |= PH_CORE_FEAT_PROCESS;
+    if(minor >= 3){ ctx.core_features |= PH_CORE_FEAT_SCHED; ctx.sched = &ph_core_sched_api; }
+    return ctx;
+}
 
-    plugin_caps_t caps = (plugin_caps_t){0};
-    if(!p.f_init(&ctx, &caps)){
-        log_msg(LOG_ERROR, "plugin %s: plugin_init failed", p.name);
-        dlclose(dl);
+static int plug_init(plug_t *p, plugin_caps_t *caps){
+    uint64_t t0 = stats_now_ns();
+    plugin_ctx_t ctx = plug_ctx(p->name, p->abi_minor);
+
+    *caps = (plugin_caps_t){0};
+    if(!p->f_init(&ctx, caps)){
+        log_msg(LOG_ERROR, "plugin %s: plugin_init failed", p->name);
+        dlclose(p->dl);
         return -4;
     }
 
-    if (caps.caps_size < sizeof(plugin_caps_t)) {
+    if (caps->caps_size < sizeof(plugin_caps_t)) {
         log_msg(LOG_ERROR,
                 "plugin %s: incompatible caps (size=%u < core=%zu); refusing (core ABI %u.%u)",
-                p.name, (unsigned)caps.caps_size, sizeof(plugin_caps_t),
+                p->name, (unsigned)caps->caps_size, sizeof(plugin_caps_t),
                 (unsigned)PLUGIN_ABI_MAJOR, (unsigned)PLUGIN_ABI_MINOR);
-        dlclose(dl);
+        dlclose(p->dl);
         return -5;
     }
 
-    if (!caps.name)    caps.name    = p.name;
-    if (!caps.version) caps.version = "(unknown)";
+    if (!caps->name)    caps->name    = p->name;
+    if (!caps->version) caps->version = "(unknown)";
+    p->init_us = elapsed_us(t0);
+    addons_note_caps(p->path, p->name, caps->version, caps->consumes, caps->produces);
 
-    log_msg(LOG_INFO, "caps %s v%s", caps.name, caps.version);
+    log_msg(LOG_INFO, "caps %s v%s", caps->name, caps->version);
+    return 0;
+}
 
-    if(!p.f_start()){
-        log_msg(LOG_ERROR, "plugin %s: plugin_start failed", p.name);
-        if(p.f_stop) p.f_stop();
-        dlclose(dl);
+static int plug_start(plug_t *p){
+    uint64_t t0 = stats_now_ns();
+    if(!p->f_start()){
+        log_msg(LOG_ERROR, "plugin %s: plugin_start failed", p->name);
+        if(p->f_stop) p->f_stop();
+        dlclose(p->dl);
         return -6;
     }
+    p->start_us = elapsed_us(t0);
+    return 0;
+}
 
-    plugtab_add(&g_plugins, p);
-    log_msg(LOG_INFO, "loaded plugin %s (%s)", p.name, p.path[0]?p.path:"(unknown)");
+static void plug_register(const plug_t *p){
+    pthread_mutex_lock(&g_plugins.mu);
+    plugtab_add(&g_plugins, *p);
+    pthread_mutex_unlock(&g_plugins.mu);
+    log_msg(LOG_INFO, "loaded plugin %s (%s) in %.2f ms (init %.2f, start %.2f)",
+            p->name, p->path[0]?p->path:"(unknown)",
+            (p->init_us + p->start_us) / 1000.0, p->init_us / 1000.0, p->start_us / 1000.0);
+}
+
+static int load_plugin_from_path(const char *so_path){
+    plug_t p;
+    plugin_caps_t caps;
+    int rc = plug_open(so_path, &p);
+    if(rc != 0) return rc;
+    if((rc = plug_init(&p, &caps)) != 0) return rc;
+    if((rc = plug_start(&p)) != 0) return rc;
+    plug_register(&p);
     return 0;
 }
 
 static int unload_plugin_by_name(const char *name){
+    pthread_mutex_lock(&g_plugins.mu);
     int idx = plugtab_find(&g_plugins, name);
-    if(idx < 0) return -1;
-    plug_t *pl = &g_plugins.v[idx];
-    if(pl->f_stop) pl->f_stop();
-    if(pl->dl) dlclose(pl->dl);
-    log_msg(LOG_INFO, "unloaded plugin %s (from %s)", pl->name, pl->path[0]?pl->path:"(unknown)");
+    if(idx < 0){ pthread_mutex_unlock(&g_plugins.mu); return -1; }
+    plug_t pl = g_plugins.v[idx];
     plugtab_remove(&g_plugins, (size_t)idx);
+    pthread_mutex_unlock(&g_plugins.mu);
+    pipeline_stop_using(pl.name);
+    if(pl.f_stop) pl.f_stop();
+    if(pl.dl) dlclose(pl.dl);
+    log_msg(LOG_INFO, "unloaded plugin %s (from %s)", pl.name, pl.path[0]?pl.path:"(unknown)");
     return 0;
 }
 
-/* ========= Autoload ========= */
+/* ========= Autoload =========
+ * Every addon's plugin_init runs on its own thread. The caps then decide the
+ * start order (core_autoload.h): an addon that consumes a feed another one
+ * produces starts in a later wave. Addons within a wave start in parallel. */
+
+typedef struct {
+    plug_t        p;
+    plugin_caps_t caps;
+    int           rc;        /* step result; nonzero drops the addon */
+    int           wave;
+    pthread_t     tid;
+} autoload_t;
+
+static void *autoload_init_main(void *arg){
+    autoload_t *a = (autoload_t*)arg;
+    a->rc = plug_init(&a->p, &a->caps);
+    return NULL;
+}
+
+static void *autoload_start_main(void *arg){
+    autoload_t *a = (autoload_t*)arg;
+    a->rc = plug_start(&a->p);
+    return NULL;
+}
+
+/* run fn for every addon in wave w (or w < 0: every live one), in parallel */
+static void autoload_each(autoload_t *v, int n, int w, void *(*fn)(void*)){
+    for(int i = 0; i < n; i++){
+        autoload_t *a = &v[i];
+        a->tid = 0;
+        if(a->rc != 0 || (w >= 0 && a->wave != w)) continue;
+        if(pthread_create(&a->tid, NULL, fn, a) != 0){ a->tid = 0; fn(a); }
+    }
+    for(int i = 0; i < n; i++) if(v[i].tid) pthread_join(v[i].tid, NULL);
+}
+
+/* caps lists and liveness side by side for autoload_waves() */
+static int autoload_plan(autoload_t *v, int m){
+    const char *const **cons = (const char *const **)calloc((size_t)m + 1, sizeof *cons);
+    const char *const **prod = (const char *const **)calloc((size_t)m + 1, sizeof *prod);
+    bool *live = (bool*)calloc((size_t)m + 1, sizeof *live);
+    bool *cyc  = (bool*)calloc((size_t)m + 1, sizeof *cyc);
+    int  *wave = (int*)calloc((size_t)m + 1, sizeof *wave);
+    int waves = 0;
+    if(!cons || !prod || !live || !cyc || !wave){
+        /* no plan: everything in one wave */
+        for(int i = 0; i < m; i++) v[i].wave = 0;
+        waves = m > 0;
+    } else {
+        for(int i = 0; i < m; i++){
+            cons[i] = v[i].caps.consumes; prod[i] = v[i].caps.produces; live[i] = v[i].rc == 0;
+        }
+        waves = autoload_waves(m, cons, prod, live, wave, cyc);
+        for(int i = 0; i < m; i++){
+            v[i].wave = wave[i];
+            if(cyc[i]) log_msg(LOG_WARN, "autoload: %s starts unordered (consumes/produces cycle)", v[i].p.name);
+        }
+    }
+    free(cons); free(prod); free(live); free(cyc); free(wave);
+    return waves;
+}
 
 static void autoload_addons(void){
-    char paths[128][512];
-    int n = scan_addon_paths(paths, 128);
-    for(int i=0;i<n;i++){
-        (void)load_plugin_from_path(paths[i]);
+    uint64_t t0 = stats_now_ns();
+    char **paths;
+    size_t n = addons_paths(&paths);
+    autoload_t *v = (autoload_t*)calloc(n ? n : 1, sizeof *v);
+    if(!v){ addons_paths_free(paths, n); log_msg(LOG_ERROR, "autoload: out of memory"); return; }
+
+    /* dlopen serialises on the loader lock anyway; this also drops duplicates */
+    int m = 0;
+    for(size_t i = 0; i < n; i++){
+        autoload_t *a = &v[m];
+        if(plug_open(paths[i], &a->p) != 0) continue;
+        bool dup = false;
+        for(int k = 0; k < m && !dup; k++) dup = strcmp(v[k].p.name, a->p.name) == 0;
+        if(dup){
+            log_msg(LOG_INFO, "skip %s (already loaded)", a->p.name);
+            dlclose(a->p.dl);
+            continue;
+        }
+        m++;
+    }
+    addons_paths_free(paths, n);
+
+    autoload_each(v, m, -1, autoload_init_main);
+    int waves = autoload_plan(v, m);
+
+    int loaded = 0;
+    for(int w = 0; w < waves; w++){
+        autoload_each(v, m, w, autoload_start_main);
+        for(int i = 0; i < m; i++)
+            if(v[i].wave == w && v[i].rc == 0){
+                log_msg(LOG_DEBUG, "autoload: %s started in wave %d", v[i].p.name, w);
+                plug_register(&v[i].p); loaded++;
+            }
     }
+    free(v);
+    log_msg(LOG_INFO, "autoload: %d addon%s in %.1f ms (%d wave%s)", loaded, loaded == 1 ? "" : "s",
+            elapsed_us(t0) / 1000.0, waves, waves == 1 ? "" : "s");
+}
+
+/* ========= Management thread =========
+ * dlopen, plugin_init and plugin_start may block for as long as an addon
+ * likes (device probing, file scans). They run on the main thread, fed by this
+ * queue, so no event loop ever waits on an addon lifecycle operation. Replies
+ * go back through a client token and are dropped if the requester left. */
+
+typedef enum { MJ_AUTOLOAD, MJ_LOAD, MJ_UNLOAD, MJ_PIPE_START, MJ_PIPE_STOP } mjob_kind_t;
+
+typedef struct mjob {
+    mjob_kind_t  kind;
+    char         arg[256];
+    uint64_t     reply;       /* client_token(), 0 = nobody */
+    struct mjob *next;
+} mjob_t;
+
+static pthread_mutex_t g_mq_mu = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  g_mq_cv = PTHREAD_COND_INITIALIZER;
+static mjob_t         *g_mq_head, **g_mq_tail = &g_mq_head;
+
+static int mgmt_post(mjob_kind_t kind, const char *arg, uint64_t reply){
+    mjob_t *j = (mjob_t*)calloc(1, sizeof *j);
+    if(!j){ log_msg(LOG_ERROR, "mgmt: out of memory"); return -1; }
+    j->kind = kind;
+    snprintf(j->arg, sizeof j->arg, "%s", arg ? arg : "");
+    j->reply = reply;
+    pthread_mutex_lock(&g_mq_mu);
+    *g_mq_tail = j;
+    g_mq_tail = &j->next;
+    pthread_cond_signal(&g_mq_cv);
+    pthread_mutex_unlock(&g_mq_mu);
+    return 0;
+}
+
+static void mgmt_wake(void){
+    pthread_mutex_lock(&g_mq_mu);
+    pthread_cond_broadcast(&g_mq_cv);
+    pthread_mutex_unlock(&g_mq_mu);
+}
+
+static void mgmt_reply(uint64_t tok, const char *fmt, ...){
+    if(!tok) return;
+    char buf[POC_MAX_JSON];
+    va_list ap;
+    va_start(ap, fmt);
+    int len = vsnprintf(buf, sizeof buf, fmt, ap);
+    va_end(ap);
+    if(len > 0 && (size_t)len < sizeof buf) client_reply_token(tok, buf, (size_t)len);
+}
+
+/* "a b c" (or "a > b > c") -> stages from the plugin table; -1 with bad filled in */
+static int pipe_stages(char *arg, pipe_stage_t *st, size_t *n, char *bad, size_t bad_cap){
+    *n = 0;
+    char *save = NULL;
+    for(char *tok = strtok_r(arg, " \t>", &save); tok; tok = strtok_r(NULL, " \t>", &save)){
+        if(*n == PH_PIPE_STAGES){ snprintf(bad, bad_cap, "more than %d stages", PH_PIPE_STAGES); return -1; }
+        pthread_mutex_lock(&g_plugins.mu);
+        int idx = plugtab_find(&g_plugins, tok);
+        plug_t pl = idx >= 0 ? g_plugins.v[idx] : (plug_t){0};
+        pthread_mutex_unlock(&g_plugins.mu);
+        if(idx < 0){ snprintf(bad, bad_cap, "%s is not loaded", tok); return -1; }
+        if(!pl.f_process){ snprintf(bad, bad_cap, "%s has no plugin_process", pl.name); return -1; }
+        pipe_stage_t *s = &st[(*n)++];
+        snprintf(s->name, sizeof s->name, "%s", pl.name);
+        s->ctx       = plug_ctx(s->name, pl.abi_minor);
+        s->f_process = pl.f_process;
+        s->f_fuse    = pl.f_fuse;
+    }
+    if(!*n){ snprintf(bad, bad_cap, "usage: pipeline <addon> <addon>..."); return -1; }
+    return 0;
+}
+
+static void mgmt_run_job(const mjob_t *j){
+    switch(j->kind){
+    case MJ_AUTOLOAD:
+        autoload_addons();
+        break;
+
+    case MJ_LOAD: {
+        char resolved[512], arg_esc[512];
+        ph_json_escape_string(j->arg,arg_esc,sizeof arg_esc);
+        if(addons_resolve(j->arg, resolved, sizeof resolved)!=0){
+            log_msg(LOG_ERROR, "load: addon '%s' not found; use available-addons or pass a readable .so path", j->arg);
+            mgmt_reply(j->reply, "{\"type\":\"error\",\"msg\":\"addon not found: %s\"}", arg_esc);
+            break;
+        }
+        int rc = load_plugin_from_path(resolved);
+        char resolved_esc[1024];
+        ph_json_escape_string(resolved,resolved_esc,sizeof resolved_esc);
+        if(rc==0 || rc==1)
+            mgmt_reply(j->reply, "{\"type\":\"info\",\"msg\":\"loaded %s\"}", resolved_esc);
+        else
+            mgmt_reply(j->reply, "{\"type\":\"error\",\"msg\":\"failed to load %s (rc=%d)\"}", resolved_esc, rc);
+        break;
+    }
+
+    case MJ_UNLOAD: {
+        char name_esc[256];
+        ph_json_escape_string(j->arg,name_esc,sizeof name_esc);
+        if(unload_plugin_by_name(j->arg)<0){
+            log_msg(LOG_WARN, "unload: %s not found", j->arg);
+            mgmt_reply(j->reply, "{\"type\":\"error\",\"msg\":\"addon not loaded: %s\"}", name_esc);
+        } else {
+            mgmt_reply(j->reply, "{\"type\":\"info\",\"msg\":\"unloaded %s\"}", name_esc);
+        }
+        break;
+    }
+
+    case MJ_PIPE_START: {
+        char arg[sizeof j->arg], bad[128] = "not started, see the core log";
+        pipe_stage_t st[PH_PIPE_STAGES];
+        size_t n;
+        snprintf(arg, sizeof arg, "%s", j->arg);
+        int ok = pipe_stages(arg, st, &n, bad, sizeof bad) == 0;
+        int id = ok ? pipeline_start(st, n) : -1;
+        if(id > 0){
+            mgmt_reply(j->reply, "{\"type\":\"info\",\"msg\":\"pipeline %d started\",\"id\":%d}", id, id);
+        } else {
+            char esc[256];
+            ph_json_escape_string(bad, esc, sizeof esc);
+            if(!ok) log_msg(LOG_WARN, "pipeline: %s", bad);
+            mgmt_reply(j->reply, "{\"type\":\"error\",\"msg\":\"pipeline: %s\"}", esc);
+        }
+        break;
+    }
+
+    case MJ_PIPE_STOP: {
+        int id = atoi(j->arg);
+        if(pipeline_stop(id) < 0)
+            mgmt_reply(j->reply, "{\"type\":\"error\",\"msg\":\"no pipeline %d\"}", id);
+        else
+            mgmt_reply(j->reply, "{\"type\":\"info\",\"msg\":\"pipeline %d stopped\"}", id);
+        break;
+    }
+    }
+}
+
+/* runs on the main thread until shutdown; pending jobs are discarded */
+static void mgmt_loop(void){
+    pthread_mutex_lock(&g_mq_mu);
+    while(g_run){
+        if(!g_mq_head){
+            /* g_run is also flipped by signals, which don't signal the cv */
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_nsec += 200 * 1000000L;
+            if(ts.tv_nsec >= 1000000000L){ ts.tv_sec++; ts.tv_nsec -= 1000000000L; }
+            pthread_cond_timedwait(&g_mq_cv, &g_mq_mu, &ts);
+            pthread_mutex_unlock(&g_mq_mu);
+            pipeline_reap();   /* fuse calls belong on this thread */
+            pthread_mutex_lock(&g_mq_mu);
+            continue;
+        }
+        mjob_t *j = g_mq_head;
+        g_mq_head = j->next;
+        if(!g_mq_head) g_mq_tail = &g_mq_head;
+        pthread_mutex_unlock(&g_mq_mu);
+        mgmt_run_job(j);
+        free(j);
+        pthread_mutex_lock(&g_mq_mu);
+    }
+    while(g_mq_head){ mjob_t *j = g_mq_head; g_mq_head = j->next; free(j); }
+    g_mq_tail = &g_mq_head;
+    pthread_mutex_unlock(&g_mq_mu);
 }
 
 /* ========= Command handling (broker JSON) ========= */
 
+/* replay a feed's retained value (JSON + descriptors) to a new subscriber */
+static void replay_retained(int fd, const char *name){
+    char *rj; size_t rlen, rn = 0; int rfds[16];
+    if(feedtab_retained(&g_feeds, name, &rj, &rlen, rfds, &rn)==0){
+        client_send(fd, name, rj, rlen, rfds, rn);
+        for(size_t k = 0; k < rn; k++) close(rfds[k]);
+        free(rj);
+    }
+}
+
 static void handle_msg(int fd, const char *js, int *fds, size_t nfds){
     char type[32]; if(json_get_type(js, type, sizeof type)<0){ log_msg(LOG_WARN, "bad message"); return; }
 
     if(strcmp(type,"create_feed")==0){
-        char name[POC_MAX_FEED]; if(json_get_string(js,"feed",name,sizeof name)==0) feedtab_ensure(&g_feeds, name);
+        char name[POC_MAX_FEED];
+        if(json_get_string(js,"feed",name,sizeof name)==0){ feedtab_ensure(&g_feeds, name); route_sync(); }
 
     } else if(strcmp(type,"subscribe")==0){
-        char name[POC_MAX_FEED]; if(json_get_string(js,"feed",name,sizeof name)==0) feedtab_sub(&g_feeds, name, fd);
+        char name[POC_MAX_FEED];
+        if(json_get_string(js,"feed",name,sizeof name)<0) return;
+        if(feedtab_is_pattern(name)){
+            /* "*" = one segment, trailing ">" = the rest; also joins feeds created later */
+            intvec_t added; intvec_init(&added);
+            int rc = feedtab_sub_pattern(&g_feeds, name, fd, &added);
+            if(rc < 0){
+                char esc[POC_MAX_FEED * 2], err[POC_MAX_FEED * 2 + 96];
+                ph_json_escape_string(name, esc, sizeof esc);
+                int n = snprintf(err, sizeof err, "{\"type\":\"error\",\"op\":\"subscribe\",\"feed\":\"%s\",\"msg\":\"bad pattern\"}", esc);
+                if(n > 0 && (size_t)n < sizeof err) client_reply(fd, err, (size_t)n);
+            }
+            if(rc == 1) route_sync();
+            for(size_t i = 0; i < added.n; i++){
+                char fname[POC_MAX_FEED];
+                int none;
+                feedtab_snapshot_subs_idx(&g_feeds, added.v[i], fname, sizeof fname, &none, 0);
+                replay_retained(fd, fname);
+            }
+            intvec_free(&added);
+        } else if(feedtab_sub(&g_feeds, name, fd)==1){
+            route_sync();
+            replay_retained(fd, name);
+        }
 
     } else if(strcmp(type,"unsubscribe")==0){
         char name[POC_MAX_FEED];
-        if(json_get_string(js,"feed",name,sizeof name)==0)
-            feedtab_unsub(&g_feeds, name, fd);
+        if(json_get_string(js,"feed",name,sizeof name)==0){
+            if(feedtab_is_pattern(name)) feedtab_unsub_pattern(&g_feeds, name, fd);
+            else feedtab_unsub(&g_feeds, name, fd);
+            route_sync();
+        }
 
     } else if(strcmp(type,"publish")==0){
         char name[POC_MAX_FEED];
         if(json_get_string(js,"feed",name,sizeof name)==0){
+            char retain[16];
+            if(json_get_string(js,"retain",retain,sizeof retain)==0 &&
+               (!strcmp(retain,"true") || !strcmp(retain,"1"))){
+                if(feedtab_retain(&g_feeds, name, fd, js, strlen(js), fds, nfds) < 0)
+                    log_msg(LOG_WARN, "feed %s: could not retain publish", name);
+                route_sync();   /* retaining may have created the feed */
+            } else if(!route_find(route_get(), name) && feedtab_pattern_matches(&g_feeds, name)){
+                /* first publish on an undeclared feed a pattern covers: intern it
+                 * so the pattern's subscribers join before it is routed */
+                feedtab_ensure(&g_feeds, name);
+                route_sync();
+            }
             broadcast_to_subs(name, js, strlen(js), fds, nfds);
             /* CLI publishers can request a broker-level dispatch acknowledgement.
              * It confirms ordered delivery into subscriber sockets, not addon success. */
@@ -336,7 +675,7 @@ static void handle_msg(int fd, const char *js, int *fds, size_t nfds){
                 ph_json_escape_string(name, feed_esc, sizeof feed_esc);
                 int n = snprintf(ack,sizeof ack,
                     "{\"type\":\"ack\",\"op\":\"publish\",\"feed\":\"%s\"}", feed_esc);
-                if(n > 0 && (size_t)n < sizeof ack) (void)send_frame_json(fd,ack,(size_t)n);
+                if(n > 0 && (size_t)n < sizeof ack) (void)client_reply(fd,ack,(size_t)n);
             }
         }
 
@@ -346,65 +685,89 @@ static void handle_msg(int fd, const char *js, int *fds, size_t nfds){
         char cmd[256]; if(json_get_string(js,"data",cmd,sizeof cmd)<0) return;
 
         if(strcmp(cmd,"help")==0){
-            const char *h = "{\"type\":\"info\",\"msg\":\"commands: help, feeds, load <path>, unload <name>, plugins, available-addons, exit\"}";
-            send_frame_json(fd, h, strlen(h));
+            const char *h = "{\"type\":\"info\",\"msg\":\"commands: help, feeds, load <path>, unload <name>, plugins, available-addons, pipeline <addon>..., pipeline stop <id>, pipelines, clients, stats, threads, qpolicy <drop-oldest|disconnect|coalesce>, qmax <frames>, exit\"}";
+            client_reply(fd, h, strlen(h));
 
         } else if(strcmp(cmd,"feeds")==0 || strcmp(cmd,"list feeds")==0){
-            feedtab_list(&g_feeds, fd);
+            feedtab_list(&g_feeds, fd, client_reply);
 
         } else if(strcmp(cmd,"plugins")==0 || strcmp(cmd,"list addons")==0){
             char buf[POC_MAX_JSON];
+            pthread_mutex_lock(&g_plugins.mu);
             for(size_t i=0;i<g_plugins.n;i++){
                 char ne[128], pe[1024];
                 ph_json_escape_string(g_plugins.v[i].name, ne, sizeof ne);
                 ph_json_escape_string(g_plugins.v[i].path[0]?g_plugins.v[i].path:"", pe, sizeof pe);
-                int len = snprintf(buf, sizeof buf, "{\"type\":\"info\",\"plugin\":\"%s\",\"path\":\"%s\"}",
-                                   ne, pe);
-                if(len > 0 && (size_t)len < sizeof buf) send_frame_json(fd, buf, (size_t)len);
+                int len = snprintf(buf, sizeof buf, "{\"type\":\"info\",\"plugin\":\"%s\",\"path\":\"%s\","
+                                   "\"init_ms\":%.2f,\"start_ms\":%.2f}",
+                                   ne, pe, g_plugins.v[i].init_us / 1000.0, g_plugins.v[i].start_us / 1000.0);
+                if(len > 0 && (size_t)len < sizeof buf) client_reply(fd, buf, (size_t)len);
             }
+            pthread_mutex_unlock(&g_plugins.mu);
 
         } else if(strcmp(cmd,"available-addons")==0){
-            char paths[128][512]; int n = scan_addon_paths(paths, 128);
-            char *items[128]; for(int i=0;i<n;i++) items[i]=paths[i];
-            json_send_kv_list(fd, "available-addons", "paths", items, n);
+            addons_report(fd);
 
         } else if(strncmp(cmd,"load ",5)==0){
-            char arg[256]; snprintf(arg,sizeof arg,"%s",cmd+5);
-            char resolved[512], arg_esc[512];
-            ph_json_escape_string(arg,arg_esc,sizeof arg_esc);
-            if(resolve_addon_arg(arg, resolved)!=0){
-                log_msg(LOG_ERROR, "load: addon '%s' not found; use available-addons or pass a readable .so path", arg);
-                char buf[POC_MAX_JSON];
-                int len = snprintf(buf, sizeof buf, "{\"type\":\"error\",\"msg\":\"addon not found: %s\"}", arg_esc);
-                if(len > 0 && (size_t)len < sizeof buf) send_frame_json(fd, buf, (size_t)len);
-            } else {
-                int rc = load_plugin_from_path(resolved);
-                char buf[POC_MAX_JSON], resolved_esc[1024];
-                ph_json_escape_string(resolved,resolved_esc,sizeof resolved_esc);
-                int len;
-                if(rc==0 || rc==1)
-                    len = snprintf(buf, sizeof buf, "{\"type\":\"info\",\"msg\":\"loaded %s\"}", resolved_esc);
-                else
-                    len = snprintf(buf, sizeof buf, "{\"type\":\"error\",\"msg\":\"failed to load %s (rc=%d)\"}", resolved_esc, rc);
-                if(len > 0 && (size_t)len < sizeof buf) send_frame_json(fd, buf, (size_t)len);
+            /* lifecycle runs on the management thread; it replies when done */
+            if(mgmt_post(MJ_LOAD, cmd+5, client_token(fd)) < 0){
+                const char *e = "{\"type\":\"error\",\"msg\":\"load: out of memory\"}";
+                client_reply(fd, e, strlen(e));
             }
 
         } else if(strncmp(cmd,"unload ",7)==0){
-            char name[256]; snprintf(name,sizeof name,"%s",cmd+7);
-            int rc = unload_plugin_by_name(name);
-            char buf[POC_MAX_JSON], name_esc[256];
-            ph_json_escape_string(name,name_esc,sizeof name_esc);
-            if(rc<0){
-                log_msg(LOG_WARN, "unload: %s not found", name);
-                int len = snprintf(buf, sizeof buf, "{\"type\":\"error\",\"msg\":\"addon not loaded: %s\"}", name_esc);
-                if(len > 0 && (size_t)len < sizeof buf) send_frame_json(fd, buf, (size_t)len);
+            if(mgmt_post(MJ_UNLOAD, cmd+7, client_token(fd)) < 0){
+                const char *e = "{\"type\":\"error\",\"msg\":\"unload: out of memory\"}";
+                client_reply(fd, e, strlen(e));
+            }
+
+        } else if(strncmp(cmd,"pipeline ",9)==0){
+            int stop = strncmp(cmd,"pipeline stop ",14)==0;
+            if(mgmt_post(stop ? MJ_PIPE_STOP : MJ_PIPE_START, cmd + (stop ? 14 : 9), client_token(fd)) < 0){
+                const char *e = "{\"type\":\"error\",\"msg\":\"pipeline: out of memory\"}";
+                client_reply(fd, e, strlen(e));
+            }
+
+        } else if(strcmp(cmd,"pipelines")==0){
+            pipeline_report(fd);
+
+        } else if(strcmp(cmd,"clients")==0){
+            clients_list(fd);
+
+        } else if(strcmp(cmd,"stats")==0){
+            stats_report(fd);
+
+        } else if(strcmp(cmd,"threads")==0){
+            sched_report(fd);
+
+        } else if(strncmp(cmd,"qpolicy ",8)==0){
+            ph_qpolicy_t pol;
+            char buf[POC_MAX_JSON];
+            int len;
+            if(clients_parse_policy(cmd+8, &pol)==0){
+                clients_set_policy(pol);
+                log_msg(LOG_INFO, "client queue overflow policy: %s", clients_policy_name(pol));
+                len = snprintf(buf, sizeof buf, "{\"type\":\"info\",\"msg\":\"qpolicy %s\"}", clients_policy_name(pol));
+            } else {
+                len = snprintf(buf, sizeof buf, "{\"type\":\"error\",\"msg\":\"qpolicy: drop-oldest|disconnect|coalesce\"}");
+            }
+            if(len > 0 && (size_t)len < sizeof buf) client_reply(fd, buf, (size_t)len);
+
+        } else if(strncmp(cmd,"qmax ",5)==0){
+            char buf[POC_MAX_JSON];
+            int len;
+            long v = strtol(cmd+5, NULL, 10);
+            if(v >= 2 && v <= 65536){
+                clients_set_qmax((size_t)v);
+                len = snprintf(buf, sizeof buf, "{\"type\":\"info\",\"msg\":\"qmax %zu\"}", clients_qmax());
             } else {
-                int len = snprintf(buf, sizeof buf, "{\"type\":\"info\",\"msg\":\"unloaded %s\"}", name_esc);
-                if(len > 0 && (size_t)len < sizeof buf) send_frame_json(fd, buf, (size_t)len);
+                len = snprintf(buf, sizeof buf, "{\"type\":\"error\",\"msg\":\"qmax: 2..65536 frames\"}");
             }
+            if(len > 0 && (size_t)len < sizeof buf) client_reply(fd, buf, (size_t)len);
 
         } else if(strcmp(cmd,"exit")==0){
             g_run = 0;
+            mgmt_wake();
 
         } else {
             log_msg(LOG_WARN, "unknown command: %s", cmd);
@@ -412,32 +775,182 @@ static void handle_msg(int fd, const char *js, int *fds, size_t nfds){
 
     } else if(strcmp(type,"ping")==0){
         const char *pong = "{\"type\":\"pong\"}";
-        send_frame_json(fd, pong, strlen(pong));
+        client_reply(fd, pong, strlen(pong));
+
+    } else if(strcmp(type,"hello")==0){
+        /* capability negotiation; currently only binary frames */
+        char v[16]; int bin = 0;
+        if(json_get_string(js,"bin",v,sizeof v)==0) bin = atoi(v) >= 1 || !strcmp(v,"true");
+        client_set_bin(fd, bin);
+        char buf[128];
+        int len = snprintf(buf, sizeof buf, "{\"type\":\"hello\",\"bin\":%d}", bin ? PH_BIN_VERSION : 0);
+        if(len > 0 && (size_t)len < sizeof buf) client_reply(fd, buf, (size_t)len);
+
+    } else if(strcmp(type,"feed_id")==0){
+        char name[POC_MAX_FEED];
+        if(json_get_string(js,"feed",name,sizeof name)<0) return;
+        int id = feedtab_ensure(&g_feeds, name);
+        route_sync();   /* the id must route before the client learns it */
+        char feed_esc[POC_MAX_FEED * 2], buf[POC_MAX_FEED * 2 + 64];
+        ph_json_escape_string(name, feed_esc, sizeof feed_esc);
+        int len = id < 0
+            ? snprintf(buf, sizeof buf, "{\"type\":\"feed_id\",\"feed\":\"%s\",\"error\":\"cannot create feed\"}", feed_esc)
+            : snprintf(buf, sizeof buf, "{\"type\":\"feed_id\",\"feed\":\"%s\",\"id\":%d}", feed_esc, id);
+        if(len > 0 && (size_t)len < sizeof buf) client_reply(fd, buf, (size_t)len);
+    }
+}
+
+static void handle_bin(int fd, const char *buf, size_t len, int *fds, size_t nfds){
+    ph_bin_hdr_t h;
+    if(ph_bin_hdr_unpack((const uint8_t*)buf, len, &h) < 0){
+        log_msg(LOG_WARN, "fd=%d: bad binary frame", fd);
+        return;
+    }
+    if(h.op != PH_BIN_OP_PUBLISH) return;
+    broadcast_bin(fd, buf, len, &h, fds, nfds);
+    if(h.flags & PH_BIN_F_ACK){
+        ph_bin_hdr_t a = { PH_BIN_VERSION, PH_BIN_OP_ACK, 0, h.feed_id };
+        uint8_t ack[PH_BIN_HDR_LEN];
+        ph_bin_hdr_pack(ack, &a);
+        client_send_bin(fd, NULL, ack, sizeof ack, NULL, 0);
+    }
+}
+
+static void on_frame(int fd, const char *buf, size_t len, bool bin, int *fds, size_t nfds){
+    if(bin) handle_bin(fd, buf, len, fds, nfds);
+    else    handle_msg(fd, buf, fds, nfds);
+}
+
+/* ========= Event loops ========= */
+
+#define PH_LOOPS_MAX          16
+#define PH_LOOPS_DEFAULT_MAX  4
+
+static void adopt_inproc(void){
+    for(ph_inproc_ep_t *ep = inproc_take_pending(), *nx; ep; ep = nx){
+        nx = inproc_next(ep);
+        if(client_count() >= PH_MAX_CLIENTS){
+            log_msg(LOG_WARN, "client limit %d reached, rejecting in-process %s",
+                    PH_MAX_CLIENTS, inproc_name(ep));
+            inproc_release(ep);
+            continue;
+        }
+        int cfd = client_add_inproc(ep);
+        if(cfd < 0) inproc_release(ep);
+        else log_msg(LOG_INFO, "client connected fd=%d in-process (%s) (total=%d)",
+                     cfd, inproc_name(ep), client_count());
     }
 }
 
-/* ========= JSON list helper ========= */
+static void accept_client(void){
+    int cfd = accept(g_listen_fd, NULL, NULL);
+    if(cfd < 0) return;
+    if(client_count() >= PH_MAX_CLIENTS){
+        log_msg(LOG_WARN, "client limit %d reached, rejecting fd=%d", PH_MAX_CLIENTS, cfd);
+        close(cfd);
+        return;
+    }
+    set_nonblock(cfd);
+    if(client_add(cfd) < 0){
+        close(cfd);
+    } else {
+        log_msg(LOG_INFO,"client connected fd=%d (total=%d)", cfd, client_count());
+    }
+}
 
-static void json_send_kv_list(int fd, const char *type, const char *key, char **items, int n){
-    char buf[POC_MAX_JSON]; size_t pos=0; int w;
-    w = snprintf(buf, sizeof buf, "{\"type\":\"%s\",\"%s\":[", type, key);
-    if(w < 0 || (size_t)w >= sizeof buf) return;
-    pos = (size_t)w;
-    for(int i=0;i<n;i++){
-        char esc[512];
-        ph_json_escape_string(items[i], esc, sizeof esc);
-        const char *comma = (i+1<n)?",":"";
-        w = snprintf(buf+pos, sizeof buf - pos, "\"%s\"%s", esc, comma);
-        if(w < 0 || (size_t)w >= sizeof buf - pos) break;
-        pos += (size_t)w;
+/* One per shard. Shard 0 also owns the listening socket and in-process
+   adoption; a client then lives on shard fd % loops for its whole life. */
+static void *loop_main(void *arg){
+    int shard = (int)(intptr_t)arg;
+    int epfd  = clients_epfd(shard);
+    int wake  = clients_wake_fd(shard);
+    char nm[32];
+    snprintf(nm, sizeof nm, "core.loop%d", shard);
+    int slot = sched_enter(nm, SCHED_CLASS_BROKER);
+    rcu_register_thread();
+    clients_thread_init();
+
+    struct epoll_event evbuf[64];
+    while(g_run){
+        rcu_offline();
+        int nr = epoll_wait(epfd, evbuf, 64, 200);
+        rcu_online();
+        if(nr < 0){
+            if(errno==EINTR) continue;
+            log_msg(LOG_ERROR,"epoll_wait: %s", strerror(errno));
+            g_run = 0;
+            break;
+        }
+
+        for(int ei = 0; ei < nr; ei++){
+            int fd = evbuf[ei].data.fd;
+
+            if(fd == wake){ clients_wake_ack(shard); continue; }
+            if(fd == g_listen_fd){ accept_client(); continue; }
+            if(fd == g_inproc_fd){ adopt_inproc(); continue; }
+            if(!client_known(fd)) continue;  /* closed earlier in this batch */
+
+            if(evbuf[ei].events & EPOLLOUT) client_on_writable(fd);
+            if(evbuf[ei].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                client_on_readable(fd, on_frame);
+        }
+        clients_flush();
+        clients_reap(shard);
+        rcu_quiescent();
+        rcu_poll();
     }
-    if(pos + 2 < sizeof buf){ buf[pos++]=']'; buf[pos++]='}'; }
-    send_frame_json(fd, buf, pos);
+    clients_thread_exit();
+    rcu_unregister_thread();
+    sched_leave(slot);
+    return NULL;
+}
+
+static int default_loops(void){
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if(n < 1) n = 1;
+    return n > PH_LOOPS_DEFAULT_MAX ? PH_LOOPS_DEFAULT_MAX : (int)n;
 }
 
 /* ========= Main ========= */
 
-int main(void){
+static void usage(const char *argv0){
+    fprintf(stderr, "usage: %s [-j|--loops N] [--io auto|uring|epoll] [--log-level LEVEL] [--addon-path DIR]... [--sched FILE]\n"
+                    "  -j, --loops N   event-loop threads, 1..%d (default %d)\n"
+                    "  --io BACKEND    outbound socket writes: io_uring batches or direct (default auto)\n"
+                    "  --log-level L   debug|info|warn|error, also for add-ons (default $PH_LOG_LEVEL or debug)\n"
+                    "  --addon-path D  search D for add-ons; repeatable (default $PH_ADDON_PATH or "
+                    PH_ADDON_ROOTS_DEFAULT ")\n"
+                    "  --sched FILE    thread placement: CPU sets and policies per class or thread\n"
+                    "                  (default $PH_SCHED_CONF, else isolated CPUs for rt-io/dsp)\n",
+            argv0, PH_LOOPS_MAX, default_loops());
+}
+
+int main(int argc, char **argv){
+    int loops = default_loops();
+    const char *io = "auto";
+    const char *sched_conf = NULL;
+    for(int i = 1; i < argc; i++){
+        if((!strcmp(argv[i],"-j") || !strcmp(argv[i],"--loops")) && i + 1 < argc){
+            loops = atoi(argv[++i]);
+            if(loops < 1 || loops > PH_LOOPS_MAX){ usage(argv[0]); return 2; }
+        } else if(!strcmp(argv[i],"--io") && i + 1 < argc){
+            io = argv[++i];
+            if(strcmp(io,"auto") && strcmp(io,"uring") && strcmp(io,"epoll")){ usage(argv[0]); return 2; }
+        } else if(!strcmp(argv[i],"--log-level") && i + 1 < argc){
+            log_level_t lvl;
+            if(log_parse_level(argv[++i], &lvl) < 0){ usage(argv[0]); return 2; }
+            log_set_level(lvl);
+            setenv("PH_LOG_LEVEL", argv[i], 1);   /* add-ons each run their own logger */
+        } else if(!strcmp(argv[i],"--addon-path") && i + 1 < argc){
+            if(addons_add_root(argv[++i]) < 0){ usage(argv[0]); return 2; }
+        } else if(!strcmp(argv[i],"--sched") && i + 1 < argc){
+            sched_conf = argv[++i];
+        } else {
+            usage(argv[0]);
+            return strcmp(argv[i],"-h") && strcmp(argv[i],"--help") ? 2 : 0;
+        }
+    }
+
     signal(SIGINT,  on_sigint);
     signal(SIGTERM, on_sigint);
     signal(SIGSEGV, crash_handler);
@@ -445,78 +958,61 @@ int main(void){
     signal(SIGBUS,  crash_handler);
     feedtab_init(&g_feeds);
     plugtab_init(&g_plugins);
+    if(sched_load(sched_conf) < 0) return 1;
+    sched_enter("core.mgmt", SCHED_CLASS_BROKER);   /* this thread; workers inherit nothing from it */
 
     g_listen_fd = uds_listen_create(PH_SOCK_PATH);
     if(g_listen_fd<0){ log_msg(LOG_ERROR, "failed to create UDS server"); return 1; }
-    log_msg(LOG_INFO, "PhaseHound-core %s (%s)  listening on %s", PH_VERSION_STRING, PH_GIT_SHA, PH_SOCK_PATH);
+    log_msg(LOG_INFO, "PhaseHound-core %s (%s)  listening on %s, %d event loop%s",
+            PH_VERSION_STRING, PH_GIT_SHA, PH_SOCK_PATH, loops, loops == 1 ? "" : "s");
 
     /* core subscribes to cli-control */
     feedtab_ensure(&g_feeds, "cli-control");
 
-    /* autoload addons present */
-    autoload_addons();
+    if(stats_init() < 0) log_msg(LOG_WARN, "stats: disabled (%s)", strerror(errno));
+    addons_init();
 
-    /* event loop — epoll-based, no FD_SETSIZE limit */
-    int epfd = epoll_create1(EPOLL_CLOEXEC);
-    if(epfd < 0){ log_msg(LOG_ERROR,"epoll_create1: %s", strerror(errno)); return 1; }
+    g_inproc_fd = inproc_init();
+    if(clients_init(loops, &g_feeds) < 0){ log_msg(LOG_ERROR, "failed to set up event loops"); return 1; }
+    clients_set_io(io);
+    route_init(&g_feeds);
+    stats_announce();
 
     { struct epoll_event ev = {0}; ev.events = EPOLLIN; ev.data.fd = g_listen_fd;
-      epoll_ctl(epfd, EPOLL_CTL_ADD, g_listen_fd, &ev); }
-
-    struct epoll_event evbuf[64];
-    for(;;){
-        if(!g_run) break;
-        int nr = epoll_wait(epfd, evbuf, 64, 200);
-        if(nr < 0){ if(errno==EINTR) continue; log_msg(LOG_ERROR,"epoll_wait: %s", strerror(errno)); break; }
-
-        for(int ei = 0; ei < nr; ei++){
-            int fd = evbuf[ei].data.fd;
+      epoll_ctl(clients_epfd(0), EPOLL_CTL_ADD, g_listen_fd, &ev); }
+    if(g_inproc_fd >= 0){
+        struct epoll_event ev = {0}; ev.events = EPOLLIN; ev.data.fd = g_inproc_fd;
+        epoll_ctl(clients_epfd(0), EPOLL_CTL_ADD, g_inproc_fd, &ev);
+    }
 
-            if(fd == g_listen_fd){
-                int cfd = accept(g_listen_fd, NULL, NULL);
-                if(cfd >= 0){
-                    if(g_client_count >= PH_MAX_CLIENTS){
-                        log_msg(LOG_WARN, "client limit %d reached, rejecting fd=%d", PH_MAX_CLIENTS, cfd);
-                        close(cfd);
-                    } else {
-                        set_nonblock(cfd);
-                        struct epoll_event cev = {0};
-                        cev.events = EPOLLIN;
-                        cev.data.fd = cfd;
-                        if(epoll_ctl(epfd, EPOLL_CTL_ADD, cfd, &cev) < 0){
-                            log_msg(LOG_ERROR,"epoll_ctl add: %s", strerror(errno));
-                            close(cfd);
-                        } else {
-                            g_client_count++;
-                            log_msg(LOG_INFO,"client connected fd=%d (total=%d)", cfd, g_client_count);
-                        }
-                    }
-                }
-            } else {
-                char js[POC_MAX_JSON];
-                int ancfds[16];
-                size_t anccnt = sizeof(ancfds)/sizeof(ancfds[0]);
-                int got = recv_frame_json_with_fds(fd, js, sizeof js-1, ancfds, &anccnt, 10);
-                if(got <= 0){
-                    g_client_count--;
-                    log_msg(LOG_INFO,"client fd=%d disconnected (total=%d)", fd, g_client_count);
-                    feedtab_unsub_all_fd(&g_feeds, fd);
-                    epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
-                    close(fd);
-                } else {
-                    handle_msg(fd, js, ancfds, anccnt);
-                    for(size_t k = 0; k < anccnt; k++) if(ancfds[k] >= 0) close(ancfds[k]);
-                }
-            }
+    pthread_t tids[PH_LOOPS_MAX];
+    int started = 0;
+    for(; started < loops; started++){
+        if(pthread_create(&tids[started], NULL, loop_main, (void*)(intptr_t)started) != 0){
+            log_msg(LOG_ERROR, "loop thread %d: %s", started, strerror(errno));
+            g_run = 0;
+            break;
         }
     }
-    close(epfd);
+
+    /* autoload addons present, then serve lifecycle requests on this thread */
+    if(g_run) mgmt_post(MJ_AUTOLOAD, NULL, 0);
+    mgmt_loop();
+
+    for(int i = 0; i < started; i++) pthread_join(tids[i], NULL);
 
     printf ("\t(8D)\n");
     log_msg(LOG_INFO, "core shutting down...");
     close(g_listen_fd);
     plugtab_free(&g_plugins);
+    rcu_barrier();
+    clients_free();
+    inproc_shutdown();
+    route_free();
     feedtab_free(&g_feeds);
+    addons_free();
+    sched_free();
+    stats_free();
     unlink(PH_SOCK_PATH);
     return 0;
 }
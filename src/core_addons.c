@@ -0,0 +1,340 @@
+#define _GNU_SOURCE
+#include "core_addons.h"
+#include "core_client.h"
+#include "common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <limits.h>
+
+typedef struct {
+    char  *path;              /* root/file.so or root/sub/file.so */
+    const char *base;         /* file name, inside path */
+    dev_t  dev;
+    ino_t  ino;
+    /* from the last plugin_init() of this file; NULL until loaded once */
+    char  *plugin, *version;
+    char  *consumes, *produces;   /* JSON arrays */
+} addon_ent_t;
+
+typedef struct {
+    addon_ent_t *v;
+    size_t       n, cap;
+} addon_vec_t;
+
+#define PH_ADDON_WATCH (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | \
+                        IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF)
+
+static pthread_mutex_t g_mu = PTHREAD_MUTEX_INITIALIZER;
+static char          **g_roots;
+static size_t          g_nroots;
+static addon_vec_t     g_idx;
+static int             g_ino = -1;     /* inotify; -1: rescan on every query */
+static bool            g_stale = true;
+
+/* ---------- index ---------- */
+
+static void ent_free(addon_ent_t *e){
+    free(e->path); free(e->plugin); free(e->version); free(e->consumes); free(e->produces);
+}
+
+static void vec_free(addon_vec_t *v){
+    for(size_t i = 0; i < v->n; i++) ent_free(&v->v[i]);
+    free(v->v);
+    *v = (addon_vec_t){0};
+}
+
+static int vec_push(addon_vec_t *v, const char *path, const struct stat *st){
+    for(size_t i = 0; i < v->n; i++)   /* "./" sees ./addons again as a subdirectory */
+        if(v->v[i].dev == st->st_dev && v->v[i].ino == st->st_ino) return 0;
+    if(v->n == v->cap){
+        size_t nc = v->cap ? v->cap * 2 : 16;
+        addon_ent_t *nv = (addon_ent_t*)realloc(v->v, nc * sizeof *nv);
+        if(!nv) return -1;
+        v->v = nv; v->cap = nc;
+    }
+    addon_ent_t *e = &v->v[v->n];
+    *e = (addon_ent_t){0};
+    if(!(e->path = strdup(path))) return -1;
+    const char *s = strrchr(e->path, '/');
+    e->base = s ? s + 1 : e->path;
+    e->dev  = st->st_dev;
+    e->ino  = st->st_ino;
+    v->n++;
+    return 0;
+}
+
+/* Match only unversioned .so files — strstr would hit libfoo.so.1.2.3 */
+static bool name_ends_with_so(const char *name){
+    size_t n = strlen(name);
+    return n > 3 && strcmp(name + n - 3, ".so") == 0;
+}
+
+static int path_cmp(const void *a, const void *b){
+    return strcmp(((const addon_ent_t*)a)->path, ((const addon_ent_t*)b)->path);
+}
+
+static void watch_dir(const char *dir){
+    if(g_ino >= 0 && inotify_add_watch(g_ino, dir, PH_ADDON_WATCH | IN_ONLYDIR) < 0 && errno != ENOENT)
+        log_msg(LOG_WARN, "addons: cannot watch %s: %s", dir, strerror(errno));
+}
+
+/* a root that doesn't exist yet: its parent tells us when it appears */
+static void watch_parent(const char *root){
+    char parent[PATH_MAX];
+    snprintf(parent, sizeof parent, "%s", root);
+    size_t n = strlen(parent);
+    while(n > 1 && parent[n - 1] == '/') parent[--n] = '\0';
+    char *s = strrchr(parent, '/');
+    if(!s) snprintf(parent, sizeof parent, ".");
+    else if(s == parent) s[1] = '\0';
+    else *s = '\0';
+    watch_dir(parent);
+}
+
+static void scan_dir(addon_vec_t *v, const char *dir, bool descend){
+    DIR *d = opendir(dir);
+    if(!d) return;
+    watch_dir(dir);
+    struct dirent *de;
+    while((de = readdir(d))){
+        if(de->d_name[0] == '.') continue;
+        char sub[PATH_MAX];
+        int ok = snprintf(sub, sizeof sub, "%s/%s", dir, de->d_name);
+        if(ok < 0 || (size_t)ok >= sizeof sub) continue;
+        struct stat st;
+        if(stat(sub, &st) < 0) continue;
+        if(S_ISDIR(st.st_mode)){
+            if(descend) scan_dir(v, sub, false);
+        } else if(S_ISREG(st.st_mode) && name_ends_with_so(de->d_name) && access(sub, R_OK) == 0){
+            if(vec_push(v, sub, &st) < 0) log_msg(LOG_ERROR, "addons: out of memory indexing %s", sub);
+        }
+    }
+    closedir(d);
+}
+
+static void rescan_locked(void){
+    addon_vec_t nv = {0};
+    for(size_t r = 0; r < g_nroots; r++){
+        size_t from = nv.n;
+        struct stat st;
+        if(stat(g_roots[r], &st) < 0) watch_parent(g_roots[r]);
+        scan_dir(&nv, g_roots[r], true);
+        qsort(nv.v + from, nv.n - from, sizeof *nv.v, path_cmp);
+    }
+    /* keep what earlier loads reported about files that are still there */
+    for(size_t i = 0; i < nv.n; i++){
+        for(size_t k = 0; k < g_idx.n; k++){
+            addon_ent_t *o = &g_idx.v[k];
+            if(!o->plugin || o->dev != nv.v[i].dev || o->ino != nv.v[i].ino) continue;
+            nv.v[i].plugin   = o->plugin;   o->plugin   = NULL;
+            nv.v[i].version  = o->version;  o->version  = NULL;
+            nv.v[i].consumes = o->consumes; o->consumes = NULL;
+            nv.v[i].produces = o->produces; o->produces = NULL;
+            break;
+        }
+    }
+    vec_free(&g_idx);
+    g_idx = nv;
+    g_stale = g_ino < 0;
+}
+
+/* drain inotify; any event in a watched directory invalidates the index */
+static void refresh_locked(void){
+    if(g_ino >= 0){
+        char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        ssize_t r;
+        while((r = read(g_ino, buf, sizeof buf)) > 0) g_stale = true;
+    }
+    if(g_stale) rescan_locked();
+}
+
+/* ---------- lifecycle ---------- */
+
+int addons_add_root(const char *dir){
+    if(!dir || !dir[0]) return -1;
+    char **nr = (char**)realloc(g_roots, (g_nroots + 1) * sizeof *nr);
+    if(!nr) return -1;
+    g_roots = nr;
+    if(!(g_roots[g_nroots] = strdup(dir))) return -1;
+    g_nroots++;
+    return 0;
+}
+
+int addons_init(void){
+    if(!g_nroots){
+        const char *env = getenv("PH_ADDON_PATH");
+        char *list = strdup(env && env[0] ? env : PH_ADDON_ROOTS_DEFAULT);
+        if(!list) return -1;
+        for(char *sv = NULL, *t = strtok_r(list, ":", &sv); t; t = strtok_r(NULL, ":", &sv))
+            addons_add_root(t);
+        free(list);
+    }
+    g_ino = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(g_ino < 0) log_msg(LOG_WARN, "addons: inotify unavailable (%s); rescanning on every lookup", strerror(errno));
+    pthread_mutex_lock(&g_mu);
+    rescan_locked();
+    size_t n = g_idx.n;
+    pthread_mutex_unlock(&g_mu);
+    for(size_t r = 0; r < g_nroots; r++) log_msg(LOG_DEBUG, "addons: search path %s", g_roots[r]);
+    log_msg(LOG_INFO, "addons: %zu found in %zu search path%s", n, g_nroots, g_nroots == 1 ? "" : "s");
+    return 0;
+}
+
+void addons_free(void){
+    pthread_mutex_lock(&g_mu);
+    vec_free(&g_idx);
+    for(size_t r = 0; r < g_nroots; r++) free(g_roots[r]);
+    free(g_roots); g_roots = NULL; g_nroots = 0;
+    if(g_ino >= 0){ close(g_ino); g_ino = -1; }
+    g_stale = true;
+    pthread_mutex_unlock(&g_mu);
+}
+
+/* ---------- queries ---------- */
+
+int addons_resolve(const char *arg, char *out, size_t cap){
+    if(!arg || !out || !cap) return -1;
+    out[0] = '\0';
+    if(strstr(arg, ".so") && access(arg, R_OK) == 0){
+        if(strlen(arg) >= cap) return -1;
+        snprintf(out, cap, "%s", arg);
+        return 0;
+    }
+
+    char want1[PATH_MAX], want2[PATH_MAX];
+    int n1 = snprintf(want1, sizeof want1, "ph-lib%s.so", arg);
+    int n2 = snprintf(want2, sizeof want2, "%s.so", arg);
+    if(n1 < 0 || n2 < 0 || (size_t)n1 >= sizeof want1 || (size_t)n2 >= sizeof want2)
+        return -1;
+
+    int rc = -1;
+    pthread_mutex_lock(&g_mu);
+    refresh_locked();
+    for(size_t i = 0; i < g_idx.n; i++){
+        const addon_ent_t *e = &g_idx.v[i];
+        if(strcmp(e->base, want1) && strcmp(e->base, want2) && strcmp(e->base, arg) &&
+           !(e->plugin && strcmp(e->plugin, arg) == 0)) continue;
+        if(strlen(e->path) < cap){ snprintf(out, cap, "%s", e->path); rc = 0; }
+        break;
+    }
+    pthread_mutex_unlock(&g_mu);
+    return rc;
+}
+
+size_t addons_paths(char ***out){
+    *out = NULL;
+    pthread_mutex_lock(&g_mu);
+    refresh_locked();
+    size_t n = 0;
+    char **v = (char**)calloc(g_idx.n ? g_idx.n : 1, sizeof *v);
+    if(v){
+        for(; n < g_idx.n; n++) if(!(v[n] = strdup(g_idx.v[n].path))) break;
+    }
+    pthread_mutex_unlock(&g_mu);
+    *out = v;
+    return n;
+}
+
+void addons_paths_free(char **v, size_t n){
+    for(size_t i = 0; i < n; i++) free(v[i]);
+    free(v);
+}
+
+static char *json_list(const char *const *items){
+    size_t cap = 3;
+    for(size_t i = 0; items && items[i]; i++) cap += strlen(items[i]) * 2 + 3;
+    char *s = (char*)malloc(cap), *p = s;
+    if(!s) return NULL;
+    *p++ = '[';
+    for(size_t i = 0; items && items[i]; i++){
+        if(i) *p++ = ',';
+        *p++ = '"';
+        p += ph_json_escape_string(items[i], p, cap - (size_t)(p - s) - 2);
+        *p++ = '"';
+    }
+    *p++ = ']'; *p = '\0';
+    return s;
+}
+
+void addons_note_caps(const char *path, const char *name, const char *version,
+                      const char *const *consumes, const char *const *produces){
+    struct stat st;
+    if(!path || stat(path, &st) < 0) return;
+    pthread_mutex_lock(&g_mu);
+    refresh_locked();
+    for(size_t i = 0; i < g_idx.n; i++){
+        addon_ent_t *e = &g_idx.v[i];
+        if(e->dev != st.st_dev || e->ino != st.st_ino) continue;
+        free(e->plugin); free(e->version); free(e->consumes); free(e->produces);
+        e->plugin   = name ? strdup(name) : NULL;
+        e->version  = version ? strdup(version) : NULL;
+        e->consumes = json_list(consumes);
+        e->produces = json_list(produces);
+        break;
+    }
+    pthread_mutex_unlock(&g_mu);
+}
+
+/* {"type":"available-addons","paths":[...],"addons":[{"path","name",...}]}
+ * "paths" keeps the old shape; entries are cut (and "truncated" set) rather
+ * than overflowing one frame. */
+void addons_report(int fd){
+    char *buf = (char*)malloc(POC_MAX_JSON);
+    if(!buf) return;
+    const size_t cap = POC_MAX_JSON - 32;   /* room for the closing brackets */
+    size_t pos = 0, listed = 0;
+    bool cut = false;
+    int w;
+
+    pthread_mutex_lock(&g_mu);
+    refresh_locked();
+    pos = (size_t)snprintf(buf, cap, "{\"type\":\"available-addons\",\"paths\":[");
+    for(size_t i = 0; i < g_idx.n; i++){
+        char esc[PATH_MAX * 2];
+        ph_json_escape_string(g_idx.v[i].path, esc, sizeof esc);
+        w = snprintf(buf + pos, cap - pos, "%s\"%s\"", i ? "," : "", esc);
+        if(w < 0 || (size_t)w >= cap - pos){ cut = true; break; }
+        pos += (size_t)w;
+        listed++;
+    }
+    w = snprintf(buf + pos, cap - pos, "],\"addons\":[");
+    if(w > 0 && (size_t)w < cap - pos) pos += (size_t)w;
+    for(size_t i = 0; i < listed; i++){
+        const addon_ent_t *e = &g_idx.v[i];
+        char pe[PATH_MAX * 2], ne[256], ve[128];
+        ph_json_escape_string(e->path, pe, sizeof pe);
+        if(e->plugin) ph_json_escape_string(e->plugin, ne, sizeof ne);
+        else {
+            /* ph-lib<name>.so until a load says otherwise */
+            const char *b = strncmp(e->base, "ph-lib", 6) == 0 ? e->base + 6 : e->base;
+            char nm[256];
+            snprintf(nm, sizeof nm, "%.*s", (int)(strlen(b) - 3), b);
+            ph_json_escape_string(nm, ne, sizeof ne);
+        }
+        if(e->plugin){
+            ph_json_escape_string(e->version ? e->version : "", ve, sizeof ve);
+            w = snprintf(buf + pos, cap - pos,
+                         "%s{\"path\":\"%s\",\"name\":\"%s\",\"version\":\"%s\",\"consumes\":%s,\"produces\":%s}",
+                         i ? "," : "", pe, ne, ve, e->consumes ? e->consumes : "[]",
+                         e->produces ? e->produces : "[]");
+        } else {
+            w = snprintf(buf + pos, cap - pos, "%s{\"path\":\"%s\",\"name\":\"%s\"}", i ? "," : "", pe, ne);
+        }
+        if(w < 0 || (size_t)w >= cap - pos){ cut = true; break; }
+        pos += (size_t)w;
+    }
+    pthread_mutex_unlock(&g_mu);
+
+    pos += (size_t)snprintf(buf + pos, POC_MAX_JSON - pos, "]%s}", cut ? ",\"truncated\":true" : "");
+    client_reply(fd, buf, pos);
+    free(buf);
+}
@@ -0,0 +1,33 @@
+#ifndef PH_CORE_ADDONS_H
+#define PH_CORE_ADDONS_H
+
+/* Addon discovery index (ph-core only).
+ *
+ * The search roots are scanned once into memory: every readable *.so directly
+ * in a root or one directory below it. An inotify watch on each scanned
+ * directory marks the index stale, and the next query rescans, so `load <name>`
+ * and `available-addons` are lookups rather than directory walks. Without
+ * inotify every query rescans, as before. The index has no size limit. */
+
+#include <stddef.h>
+
+#define PH_ADDON_ROOTS_DEFAULT "./src/addons:./addons:./"
+
+int  addons_add_root(const char *dir);   /* before addons_init(); replaces the defaults */
+int  addons_init(void);                  /* no roots added: $PH_ADDON_PATH, else the defaults */
+void addons_free(void);
+
+/* name ("dummy"), file name ("ph-libdummy.so") or readable path -> path */
+int  addons_resolve(const char *arg, char *out, size_t cap);
+
+/* snapshot of the indexed paths in search order; free with addons_paths_free() */
+size_t addons_paths(char ***out);
+void   addons_paths_free(char **v, size_t n);
+
+/* remember what plugin_init() reported for a file; available-addons shows it */
+void addons_note_caps(const char *path, const char *name, const char *version,
+                      const char *const *consumes, const char *const *produces);
+
+void addons_report(int fd);              /* `available-addons` */
+
+#endif
@@ -0,0 +1,48 @@
+#include "core_autoload.h"
+
+#include <stddef.h>
+#include <string.h>
+
+static bool feed_listed(const char *const *list, const char *feed){
+    for(size_t i = 0; list && list[i]; i++) if(strcmp(list[i], feed) == 0) return true;
+    return false;
+}
+
+/* does a consume something b produces? */
+static bool needs(const char *const *a_consumes, const char *const *b_produces){
+    for(size_t i = 0; a_consumes && a_consumes[i]; i++)
+        if(feed_listed(b_produces, a_consumes[i])) return true;
+    return false;
+}
+
+int autoload_waves(int n, const char *const *const *consumes, const char *const *const *produces,
+                   const bool *live, int *wave, bool *cyc){
+    int waves = 0, left = 0;
+    for(int i = 0; i < n; i++){
+        wave[i] = -1;
+        if(cyc) cyc[i] = false;
+        if(live[i]) left++;
+    }
+    /* a producer placed in this same pass still blocks its consumers */
+    while(left){
+        int placed = 0;
+        for(int i = 0; i < n; i++){
+            if(!live[i] || wave[i] >= 0) continue;
+            bool ready = true;
+            for(int k = 0; k < n && ready; k++){
+                if(k == i || !live[k]) continue;
+                if((wave[k] < 0 || wave[k] == waves) && needs(consumes[i], produces[k])) ready = false;
+            }
+            if(ready){ wave[i] = waves; placed++; }
+        }
+        if(!placed){
+            for(int i = 0; i < n; i++) if(live[i] && wave[i] < 0){
+                if(cyc) cyc[i] = true;
+                wave[i] = waves; placed++;
+            }
+        }
+        left -= placed;
+        waves++;
+    }
+    return waves;
+}
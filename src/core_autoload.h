@@ -0,0 +1,20 @@
+#ifndef PH_CORE_AUTOLOAD_H
+#define PH_CORE_AUTOLOAD_H
+
+/* Autoload start order (ph-core only).
+ *
+ * Addon i starts in a later wave than every addon whose caps.produces names a
+ * feed in i's caps.consumes, so ring announcements exist before their readers
+ * subscribe. Addons within a wave start in parallel. When only addons caught
+ * in (or behind) a consumes/produces cycle are left, they share the last wave. */
+
+#include <stdbool.h>
+
+/* consumes[i]/produces[i]: addon i's NULL-terminated caps lists (either may be
+ * NULL). Addons with live[i] false are left out and get wave[i] = -1.
+ * cyc[i] (optional) is set for the addons in that last cycle wave.
+ * Returns the number of waves. */
+int autoload_waves(int n, const char *const *const *consumes, const char *const *const *produces,
+                   const bool *live, int *wave, bool *cyc);
+
+#endif
@@ -0,0 +1,1040 @@
+#define _GNU_SOURCE
+#include "core_client.h"
+#include "core_inproc.h"
+#include "core_rcu.h"
+#include "core_route.h"
+#include "core_stats.h"
+#include "core_uring.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <arpa/inet.h>
+
+#define PH_MAX_FRAME_FDS 16
+
+/* ---------- per-client queue ---------- */
+
+typedef struct {
+    uint8_t     hdr[4];       /* big-endian length prefix */
+    const char *body;
+    size_t      len;          /* body length */
+    size_t      off;          /* bytes of hdr+body already written */
+    int         fds[PH_MAX_FRAME_FDS];
+    size_t      nfds;         /* still to be sent with the body */
+    bool        own_body;     /* queued frames hold private copies */
+    bool        own_fds;
+    char        feed[POC_MAX_FEED];
+} outmsg_t;
+
+typedef struct {
+    int      fd;
+    uint64_t at;              /* stream offset just past the read that carried it */
+} rxfd_t;
+
+/* Clients are sharded by fd across the event-loop threads. The owner shard
+ * alone touches the inbound state; the outbound queue may be fed from any
+ * thread (a publish is routed by whichever loop received it), so it sits
+ * behind a per-client lock. */
+typedef struct {
+    pthread_mutex_t mu;       /* outbound queue, pollout, gen */
+    atomic_bool used, closing;
+    atomic_bool bin;          /* negotiated binary frames */
+    bool      pollout;
+    const intvec_t *dirty;    /* the loop io_uring flush list it is on, or NULL */
+    int       shard;
+    uint32_t  gen;            /* bumped per connection on this fd */
+    ph_inproc_ep_t *ip;       /* co-resident addon: queues instead of a socket */
+    /* inbound (owner shard only): rbuf[0] sits at stream offset rbase */
+    char     *rbuf;
+    size_t    rlen, rcap;
+    uint64_t  rbase;
+    rxfd_t   *rfds;
+    size_t    rfds_n, rfds_cap;
+    outmsg_t *q;              /* ring: q[(qhead+i) % qcap] */
+    size_t    qhead, qn, qcap;
+    size_t    qbytes;
+    /* metrics */
+    size_t    q_hwm;
+    uint64_t  sent, dropped, coalesced;
+    uint64_t  pollout_since;  /* stats_now_ns() when EPOLLOUT was armed */
+    ph_stats_client_t *st;    /* this connection's slot in the stats page */
+} client_t;
+
+typedef struct {
+    int             epfd;
+    int             wake_fd;  /* eventfd: a close was requested from another thread */
+    pthread_mutex_t mu;       /* closing */
+    intvec_t        closing;
+} shard_t;
+
+/* The table is paged so client_t addresses never move while other threads
+ * hold them; pages are only released in clients_free(). */
+#define PH_CLI_PAGE_SHIFT 8
+#define PH_CLI_PAGE       (1u << PH_CLI_PAGE_SHIFT)
+#define PH_CLI_PAGES      1024
+
+static client_t *_Atomic g_pages[PH_CLI_PAGES];
+static pthread_mutex_t   g_pages_mu = PTHREAD_MUTEX_INITIALIZER;
+static atomic_int        g_cli_n;
+static shard_t          *g_shards;
+static int               g_nshards;
+static feedtab_t        *g_feedtab;
+static atomic_int        g_policy = PH_QPOL_DROP_OLDEST;
+static atomic_size_t     g_qmax   = PH_CLIENT_QMAX_DEFAULT;
+static size_t            g_qbytes = PH_CLIENT_QBYTES_DEFAULT;
+
+/* io_uring backend: loop threads with a ring batch their socket writes */
+static atomic_bool                g_uring_on;
+static atomic_int                 g_uring_loops;
+static _Thread_local ph_uring_t  *t_ring;
+static _Thread_local intvec_t     t_dirty;
+static _Thread_local bool         t_borrow;   /* see clients_borrow() */
+
+static client_t *cli_slot(int fd, bool create){
+    if(fd < 0 || (size_t)fd >= (size_t)PH_CLI_PAGES * PH_CLI_PAGE) return NULL;
+    size_t pi = (size_t)fd >> PH_CLI_PAGE_SHIFT;
+    client_t *pg = atomic_load_explicit(&g_pages[pi], memory_order_acquire);
+    if(!pg && create){
+        pthread_mutex_lock(&g_pages_mu);
+        pg = atomic_load(&g_pages[pi]);
+        if(!pg && (pg = (client_t*)calloc(PH_CLI_PAGE, sizeof *pg))){
+            for(size_t i = 0; i < PH_CLI_PAGE; i++) pthread_mutex_init(&pg[i].mu, NULL);
+            atomic_store_explicit(&g_pages[pi], pg, memory_order_release);
+        }
+        pthread_mutex_unlock(&g_pages_mu);
+    }
+    return pg ? &pg[(size_t)fd & (PH_CLI_PAGE - 1)] : NULL;
+}
+
+static client_t *cli_get(int fd){
+    client_t *c = cli_slot(fd, false);
+    return (c && atomic_load(&c->used)) ? c : NULL;
+}
+
+static outmsg_t *q_at(client_t *c, size_t i){ return &c->q[(c->qhead + i) % c->qcap]; }
+
+static void outmsg_release(outmsg_t *m){
+    if(m->own_body) free((void*)m->body);
+    if(m->own_fds) for(size_t k = 0; k < m->nfds; k++) close(m->fds[k]);
+    m->body = NULL; m->nfds = 0;
+}
+
+static int q_grow(client_t *c){
+    size_t nc = c->qcap ? c->qcap * 2 : 16;
+    outmsg_t *nq = (outmsg_t*)malloc(nc * sizeof *nq);
+    if(!nq) return -1;
+    for(size_t i = 0; i < c->qn; i++) nq[i] = *q_at(c, i);
+    free(c->q);
+    c->q = nq; c->qcap = nc; c->qhead = 0;
+    return 0;
+}
+
+/* remove logical entry i, keeping order */
+static void q_remove(client_t *c, size_t i){
+    outmsg_t *m = q_at(c, i);
+    c->qbytes -= 4 + m->len;
+    outmsg_release(m);
+    for(size_t k = i; k + 1 < c->qn; k++) *q_at(c, k) = *q_at(c, k + 1);
+    c->qn--;
+    if(c->qn == 0) c->qhead = 0;
+}
+
+static void q_pop(client_t *c){
+    outmsg_t *m = q_at(c, 0);
+    c->qbytes -= 4 + m->len;
+    outmsg_release(m);
+    c->qhead = (c->qhead + 1) % c->qcap;
+    c->qn--;
+}
+
+static void set_pollout(int fd, client_t *c, bool on){
+    if(c->pollout == on) return;
+    struct epoll_event ev = {0};
+    ev.events  = EPOLLIN | (on ? EPOLLOUT : 0);
+    ev.data.fd = fd;
+    if(epoll_ctl(g_shards[c->shard].epfd, EPOLL_CTL_MOD, fd, &ev) != 0) return;
+    c->pollout = on;
+    if(on) c->pollout_since = stats_now_ns();
+    else   stats_add(&c->st->blocked_ns, stats_now_ns() - c->pollout_since);
+}
+
+/* one frame of `len` body bytes handed to the client */
+static void note_sent(client_t *c, size_t len){
+    c->sent++;
+    stats_add(&c->st->tx_frames, 1);
+    stats_add(&c->st->tx_bytes, 4 + len);
+}
+
+/* ---------- non-blocking frame writer ----------
+ * Same wire shape as send_frame_json_with_fds(): the length prefix goes out on
+ * its own and SCM_RIGHTS rides on the first body write, so receivers that
+ * read the header with plain recv() never lose descriptors. */
+
+typedef struct {
+    struct msghdr msg;
+    struct iovec  iov[2];
+    char          cbuf[CMSG_SPACE(sizeof(int) * PH_MAX_FRAME_FDS)];
+} outwrite_t;
+
+/* describe the next write of m; points into m, so m must not move until done */
+static void outmsg_prep(outmsg_t *m, outwrite_t *ow){
+    size_t total = 4 + m->len;
+    int niov = 0;
+    memset(&ow->msg, 0, sizeof ow->msg);
+    if(m->off < 4){
+        ow->iov[niov].iov_base = m->hdr + m->off; ow->iov[niov].iov_len = 4 - m->off; niov++;
+        if(!m->nfds){ ow->iov[niov].iov_base = (void*)m->body; ow->iov[niov].iov_len = m->len; niov++; }
+    } else {
+        ow->iov[niov].iov_base = (void*)(m->body + (m->off - 4)); ow->iov[niov].iov_len = total - m->off; niov++;
+        if(m->nfds){
+            ow->msg.msg_control    = ow->cbuf;
+            ow->msg.msg_controllen = CMSG_SPACE(sizeof(int) * m->nfds);
+            struct cmsghdr *cm = CMSG_FIRSTHDR(&ow->msg);
+            cm->cmsg_level = SOL_SOCKET;
+            cm->cmsg_type  = SCM_RIGHTS;
+            cm->cmsg_len   = CMSG_LEN(sizeof(int) * m->nfds);
+            memcpy(CMSG_DATA(cm), m->fds, sizeof(int) * m->nfds);
+        }
+    }
+    ow->msg.msg_iov = ow->iov; ow->msg.msg_iovlen = (size_t)niov;
+}
+
+/* account w bytes written by ow; true once the whole frame is out */
+static bool outmsg_wrote(outmsg_t *m, const outwrite_t *ow, size_t w){
+    if(ow->msg.msg_control){
+        /* descriptors went out with this write */
+        if(m->own_fds) for(size_t k = 0; k < m->nfds; k++) close(m->fds[k]);
+        m->nfds = 0;
+    }
+    m->off += w;
+    return m->off >= 4 + m->len;
+}
+
+/* Returns 1 when the frame is fully written, 0 on EAGAIN, -1 on error. */
+static int outmsg_write(int fd, outmsg_t *m){
+    while(m->off < 4 + m->len){
+        outwrite_t ow;
+        outmsg_prep(m, &ow);
+        ssize_t w = sendmsg(fd, &ow.msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if(w < 0){
+            if(errno == EINTR) continue;
+            if(errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            return -1;
+        }
+        if(w == 0) return 0;
+        outmsg_wrote(m, &ow, (size_t)w);
+    }
+    return 1;
+}
+
+/* take private copies so the frame outlives the caller's buffers */
+static int outmsg_own(outmsg_t *m){
+    if(!m->own_body){
+        char *b = (char*)malloc(m->len ? m->len : 1);
+        if(!b) return -1;
+        memcpy(b, m->body, m->len);
+        m->body = b; m->own_body = true;
+    }
+    if(m->nfds && !m->own_fds){
+        for(size_t k = 0; k < m->nfds; k++){
+            int d = fcntl(m->fds[k], F_DUPFD_CLOEXEC, 0);
+            if(d < 0){
+                while(k--) close(m->fds[k]);
+                m->nfds = 0;
+                return -1;
+            }
+            m->fds[k] = d;
+        }
+        m->own_fds = true;
+    }
+    return 0;
+}
+
+static void close_locked(int fd, client_t *c);
+
+/* write queued frames until the socket is full; caller holds c->mu */
+static void drain_locked(int fd, client_t *c){
+    while(!atomic_load(&c->closing) && c->qn){
+        int rc = outmsg_write(fd, q_at(c, 0));
+        if(rc < 0){ close_locked(fd, c); break; }
+        if(rc == 0) break;
+        size_t len = q_at(c, 0)->len;
+        q_pop(c);
+        note_sent(c, len);
+    }
+    if(c->qn == 0 && !atomic_load(&c->closing)){
+        c->qhead = 0;
+        set_pollout(fd, c, false);
+    }
+}
+
+/* ---------- overflow ---------- */
+
+static void note_drop(int fd, client_t *c, const char *what){
+    stats_add(&c->st->dropped, 1);
+    /* log the 1st, 2nd, 4th, 8th... event so a stuck client can't flood stderr */
+    uint64_t n = c->dropped + c->coalesced;
+    if((n & (n - 1)) == 0)
+        log_msg(LOG_WARN, "client fd=%d slow: %s (depth=%zu dropped=%llu coalesced=%llu)",
+                fd, what, c->qn, (unsigned long long)c->dropped, (unsigned long long)c->coalesced);
+}
+
+static bool q_full(const client_t *c, size_t add){
+    return c->qn > 0 && (c->qn >= g_qmax || c->qbytes + add > g_qbytes);
+}
+
+/* first entry that may be dropped: the head is untouchable once partly written */
+static size_t q_first_idle(const client_t *c){
+    return (c->qn && c->q[c->qhead].off > 0) ? 1 : 0;
+}
+
+/* 0 = room made, 1 = new frame should be discarded, -1 = client closed */
+static int make_room(int fd, client_t *c, const char *feed, size_t add){
+    if(!q_full(c, add)) return 0;
+    if(g_policy == PH_QPOL_DISCONNECT){
+        log_msg(LOG_WARN, "client fd=%d outbound queue full (depth=%zu bytes=%zu); disconnecting",
+                fd, c->qn, c->qbytes);
+        close_locked(fd, c);
+        return -1;
+    }
+    if(g_policy == PH_QPOL_COALESCE && feed && feed[0]){
+        for(size_t i = q_first_idle(c); i < c->qn; i++){
+            if(strcmp(q_at(c, i)->feed, feed) == 0){
+                q_remove(c, i);
+                c->coalesced++;
+                note_drop(fd, c, "coalesced");
+                break;
+            }
+        }
+    }
+    while(q_full(c, add)){
+        size_t i = q_first_idle(c);
+        if(i >= c->qn) return c->qn >= g_qmax ? 1 : 0;
+        q_remove(c, i);
+        c->dropped++;
+        note_drop(fd, c, "dropped oldest");
+    }
+    return 0;
+}
+
+/* ---------- table ---------- */
+
+int clients_init(int nshards, feedtab_t *feeds){
+    if(nshards < 1) nshards = 1;
+    g_shards = (shard_t*)calloc((size_t)nshards, sizeof *g_shards);
+    if(!g_shards) return -1;
+    g_nshards = nshards;
+    g_feedtab = feeds;
+    for(int i = 0; i < nshards; i++){
+        shard_t *sh = &g_shards[i];
+        sh->epfd    = epoll_create1(EPOLL_CLOEXEC);
+        sh->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        pthread_mutex_init(&sh->mu, NULL);
+        intvec_init(&sh->closing);
+        if(sh->epfd < 0 || sh->wake_fd < 0){
+            log_msg(LOG_ERROR, "shard %d: %s", i, strerror(errno));
+            return -1;
+        }
+        struct epoll_event ev = {0};
+        ev.events = EPOLLIN; ev.data.fd = sh->wake_fd;
+        epoll_ctl(sh->epfd, EPOLL_CTL_ADD, sh->wake_fd, &ev);
+    }
+    return 0;
+}
+
+int clients_shards(void){ return g_nshards; }
+int clients_epfd(int shard){ return g_shards[shard].epfd; }
+int clients_wake_fd(int shard){ return g_shards[shard].wake_fd; }
+
+void clients_wake_ack(int shard){
+    uint64_t v;
+    ssize_t r;
+    do r = read(g_shards[shard].wake_fd, &v, sizeof v); while(r < 0 && errno == EINTR);
+}
+
+static void client_free_outbound(client_t *c){
+    while(c->qn) q_pop(c);
+    free(c->q);
+    c->q = NULL; c->qcap = c->qhead = 0; c->qbytes = 0;
+}
+
+static void client_free_inbound(client_t *c){
+    for(size_t i = 0; i < c->rfds_n; i++) close(c->rfds[i].fd);
+    free(c->rfds); c->rfds = NULL; c->rfds_n = c->rfds_cap = 0;
+    free(c->rbuf); c->rbuf = NULL; c->rlen = c->rcap = 0;
+}
+
+/* after all loop threads are joined */
+void clients_free(void){
+    for(size_t pi = 0; pi < PH_CLI_PAGES; pi++){
+        client_t *pg = atomic_load(&g_pages[pi]);
+        if(!pg) continue;
+        for(size_t i = 0; i < PH_CLI_PAGE; i++){
+            client_t *c = &pg[i];
+            if(atomic_load(&c->used)){
+                client_free_outbound(c);
+                client_free_inbound(c);
+                if(c->ip) inproc_release(c->ip);
+                else close((int)(pi * PH_CLI_PAGE + i));
+            }
+            pthread_mutex_destroy(&c->mu);
+        }
+        free(pg);
+        atomic_store(&g_pages[pi], NULL);
+    }
+    atomic_store(&g_cli_n, 0);
+    for(int i = 0; i < g_nshards; i++){
+        close(g_shards[i].epfd);
+        close(g_shards[i].wake_fd);
+        pthread_mutex_destroy(&g_shards[i].mu);
+        intvec_free(&g_shards[i].closing);
+    }
+    free(g_shards); g_shards = NULL; g_nshards = 0;
+}
+
+static int client_add_ep(int fd, ph_inproc_ep_t *ep){
+    client_t *c = cli_slot(fd, true);
+    if(!c){
+        log_msg(LOG_ERROR, "client fd=%d: outside the client table", fd);
+        return -1;
+    }
+    pthread_mutex_lock(&c->mu);
+    /* reaped slots were already emptied; reset the rest field by field (mu stays) */
+    atomic_store(&c->closing, false);
+    atomic_store(&c->bin, false);
+    c->pollout = false;
+    c->dirty = NULL;
+    c->gen++;
+    c->ip = ep;
+    c->shard = fd % g_nshards;
+    c->rbase = 0;
+    c->q_hwm = 0;
+    c->sent = c->dropped = c->coalesced = 0;
+    c->st = stats_client_open(fd, c->shard, ep != NULL);
+    atomic_store(&c->used, true);
+    pthread_mutex_unlock(&c->mu);
+    atomic_fetch_add(&g_cli_n, 1);
+
+    struct epoll_event ev = {0};
+    ev.events = EPOLLIN; ev.data.fd = fd;
+    if(epoll_ctl(g_shards[c->shard].epfd, EPOLL_CTL_ADD, fd, &ev) < 0){
+        log_msg(LOG_ERROR, "epoll_ctl add: %s", strerror(errno));
+        atomic_store(&c->used, false);
+        atomic_fetch_sub(&g_cli_n, 1);
+        return -1;
+    }
+    return 0;
+}
+
+int client_add(int fd){ return client_add_ep(fd, NULL); }
+
+int client_add_inproc(ph_inproc_ep_t *ep){
+    int fd = inproc_core_fd(ep);
+    if(client_add_ep(fd, ep) < 0) return -1;
+    inproc_yield(ep);   /* frames may have been queued before adoption */
+    return fd;
+}
+
+int client_known(int fd){
+    client_t *c = cli_get(fd);
+    return c && !atomic_load(&c->closing);
+}
+
+int client_count(void){ return atomic_load(&g_cli_n); }
+
+uint64_t client_token(int fd){
+    client_t *c = cli_get(fd);
+    if(!c) return 0;
+    pthread_mutex_lock(&c->mu);
+    uint64_t t = ((uint64_t)c->gen << 32) | (uint32_t)fd;
+    pthread_mutex_unlock(&c->mu);
+    return t;
+}
+
+/* In-process clients own a fixed lock-free queue the core can't wait on, so a
+ * full queue is resolved at once: disconnect or drop the new frame. */
+static int inproc_queue(int fd, client_t *c, const outmsg_t *m, bool bin){
+    ph_ipmsg_t *im = inproc_msg_new(m->body, m->len, bin, m->fds, m->nfds);
+    if(!im){
+        log_msg(LOG_ERROR, "client fd=%d: out of memory queueing frame", fd);
+        return -1;
+    }
+    int rc = inproc_push(c->ip, im);
+    if(rc == 0){
+        size_t d = inproc_depth(c->ip);
+        if(d > c->q_hwm) c->q_hwm = d;
+        note_sent(c, m->len);
+        return 0;
+    }
+    inproc_msg_free(im);
+    if(rc < 0){ close_locked(fd, c); return -1; }
+    if(g_policy == PH_QPOL_DISCONNECT){
+        log_msg(LOG_WARN, "client fd=%d in-process queue full; disconnecting", fd);
+        close_locked(fd, c);
+        return -1;
+    }
+    c->dropped++;
+    note_drop(fd, c, "dropped newest");
+    return 0;
+}
+
+/* caller holds c->mu */
+static int queue_locked(int fd, client_t *c, const char *feed, const char *json, size_t len,
+                        uint32_t lenflag, const int *fds, size_t nfds){
+    if(!atomic_load(&c->used) || atomic_load(&c->closing) || !json) return -1;
+    if(len > PH_FRAME_LEN_MASK){ errno = EMSGSIZE; return -1; }
+    if(nfds > PH_MAX_FRAME_FDS) nfds = PH_MAX_FRAME_FDS;
+
+    outmsg_t m;
+    memset(&m, 0, sizeof m);
+    uint32_t be = htonl((uint32_t)len | lenflag);
+    memcpy(m.hdr, &be, 4);
+    m.body = json; m.len = len;
+    if(fds && nfds){ memcpy(m.fds, fds, nfds * sizeof(int)); m.nfds = nfds; }
+    if(feed) snprintf(m.feed, sizeof m.feed, "%s", feed);
+
+    if(c->ip) return inproc_queue(fd, c, &m, lenflag != 0);
+
+    if(t_ring){
+        /* batched: the frame goes out with clients_flush() at the end of this
+         * event batch. A burst that would overflow the queue is written now,
+         * so batching never drops what a direct write would have delivered. */
+        if(c->dirty && q_full(c, 4 + len)){
+            drain_locked(fd, c);
+            if(atomic_load(&c->closing)) return -1;
+        }
+    } else if(c->qn == 0){
+        /* fast path: nothing queued ahead of us, write straight to the socket */
+        int rc = outmsg_write(fd, &m);
+        if(rc < 0){ close_locked(fd, c); return -1; }
+        if(rc == 1){ note_sent(c, len); return 0; }
+    }
+
+    int room = make_room(fd, c, m.feed, 4 + len);
+    if(room < 0) return -1;
+    if(room > 0){ c->dropped++; note_drop(fd, c, "dropped newest"); return 0; }
+
+    /* Under clients_borrow() the frame keeps pointing at the caller's buffers
+     * if this loop's own flush will send it; one another loop will flush, or
+     * one waiting for EPOLLOUT, is copied now. */
+    bool borrow = t_borrow && t_ring && !c->pollout && (!c->dirty || c->dirty == &t_dirty);
+    if((!borrow && outmsg_own(&m) < 0) || (c->qn == c->qcap && q_grow(c) < 0)){
+        outmsg_release(&m);
+        log_msg(LOG_ERROR, "client fd=%d: out of memory queueing frame", fd);
+        close_locked(fd, c);
+        return -1;
+    }
+    *q_at(c, c->qn) = m;
+    c->qn++;
+    c->qbytes += 4 + len;
+    if(c->qn > c->q_hwm) c->q_hwm = c->qn;
+    if(t_ring && !c->pollout){
+        if(!c->dirty){ c->dirty = &t_dirty; intvec_push(&t_dirty, fd); }
+    } else set_pollout(fd, c, true);
+    return 0;
+}
+
+static int client_queue(int fd, const char *feed, const char *json, size_t len, uint32_t lenflag,
+                        const int *fds, size_t nfds){
+    client_t *c = cli_get(fd);
+    if(!c) return -1;
+    pthread_mutex_lock(&c->mu);
+    int rc = queue_locked(fd, c, feed, json, len, lenflag, fds, nfds);
+    pthread_mutex_unlock(&c->mu);
+    return rc;
+}
+
+int client_send(int fd, const char *feed, const char *json, size_t len,
+                const int *fds, size_t nfds){
+    return client_queue(fd, feed, json, len, 0, fds, nfds);
+}
+
+int client_send_bin(int fd, const char *feed, const void *frame, size_t len,
+                    const int *fds, size_t nfds){
+    client_t *c = cli_get(fd);
+    if(!c || !atomic_load(&c->bin)) return -1;
+    return client_queue(fd, feed, (const char*)frame, len, PH_FRAME_BIN, fds, nfds);
+}
+
+void client_set_bin(int fd, int on){
+    client_t *c = cli_get(fd);
+    if(c) atomic_store(&c->bin, on != 0);
+}
+
+int client_is_bin(int fd){
+    client_t *c = cli_get(fd);
+    return c && atomic_load(&c->bin);
+}
+
+int client_reply(int fd, const char *json, size_t len){
+    return client_send(fd, NULL, json, len, NULL, 0);
+}
+
+int client_reply_token(uint64_t token, const char *json, size_t len){
+    int fd = (int)(uint32_t)token;
+    client_t *c = cli_get(fd);
+    if(!c) return -1;
+    pthread_mutex_lock(&c->mu);
+    int rc = c->gen == (uint32_t)(token >> 32)
+           ? queue_locked(fd, c, NULL, json, len, 0, NULL, 0) : -1;
+    pthread_mutex_unlock(&c->mu);
+    return rc;
+}
+
+/* ---------- inbound: resumable frame parser ---------- */
+
+#define PH_RX_FRAME_MAX  (4 + (size_t)POC_MAX_JSON)  /* largest legal frame */
+#define PH_RX_BUDGET     (256u * 1024)               /* bytes per wakeup, for fairness */
+
+static int rx_push_fd(client_t *c, int fd, uint64_t at){
+    if(c->rfds_n == c->rfds_cap){
+        size_t nc = c->rfds_cap ? c->rfds_cap * 2 : 8;
+        rxfd_t *nv = (rxfd_t*)realloc(c->rfds, nc * sizeof *nv);
+        if(!nv){ close(fd); return -1; }
+        c->rfds = nv; c->rfds_cap = nc;
+    }
+    c->rfds[c->rfds_n].fd = fd;
+    c->rfds[c->rfds_n].at = at;
+    c->rfds_n++;
+    return 0;
+}
+
+/* One non-blocking recvmsg into the free tail of rbuf.
+ * Returns bytes read, 0 on EOF, -1 on error, -2 on EAGAIN. */
+static ssize_t rx_read(int fd, client_t *c){
+    if(c->rcap - c->rlen < 2){
+        /* +1 keeps room for the NUL the parser writes after a body */
+        size_t nc = c->rcap ? c->rcap * 2 : 4096;
+        if(nc > PH_RX_FRAME_MAX + 1) nc = PH_RX_FRAME_MAX + 1;
+        if(nc <= c->rcap) return -1;
+        char *nb = (char*)realloc(c->rbuf, nc);
+        if(!nb) return -1;
+        c->rbuf = nb; c->rcap = nc;
+    }
+    struct iovec iov = { .iov_base = c->rbuf + c->rlen, .iov_len = c->rcap - c->rlen - 1 };
+    char cbuf[CMSG_SPACE(sizeof(int) * PH_MAX_FRAME_FDS)];
+    struct msghdr msg; memset(&msg, 0, sizeof msg);
+    msg.msg_iov = &iov; msg.msg_iovlen = 1;
+    msg.msg_control = cbuf; msg.msg_controllen = sizeof cbuf;
+
+    ssize_t g;
+    do g = recvmsg(fd, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+    while(g < 0 && errno == EINTR);
+    if(g < 0) return (errno == EAGAIN || errno == EWOULDBLOCK) ? -2 : -1;
+    if(g == 0) return 0;
+
+    stats_add(&c->st->rx_bytes, (uint64_t)g);
+    c->rlen += (size_t)g;
+    /* A unix stream read stops after the skb that carried descriptors, so they
+     * belong to the frame holding the last byte of this read. */
+    uint64_t at = c->rbase + c->rlen;
+    for(struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)){
+        if(cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_RIGHTS) continue;
+        size_t cnt = (cm->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        int arr[PH_MAX_FRAME_FDS];
+        if(cnt > PH_MAX_FRAME_FDS) cnt = PH_MAX_FRAME_FDS;
+        memcpy(arr, CMSG_DATA(cm), cnt * sizeof(int));
+        for(size_t k = 0; k < cnt; k++) rx_push_fd(c, arr[k], at);
+    }
+    return g;
+}
+
+/* Dispatch every complete frame in rbuf. Returns -1 on a protocol error. */
+static int rx_parse(int fd, client_t *c, ph_frame_fn on_frame){
+    size_t pos = 0;
+    while(!atomic_load(&c->closing) && c->rlen - pos >= 4){
+        uint32_t be;
+        memcpy(&be, c->rbuf + pos, 4);
+        size_t len = ntohl(be) & PH_FRAME_LEN_MASK;
+        bool bin = (ntohl(be) & PH_FRAME_BIN) != 0;
+        if(bin && !atomic_load(&c->bin)){
+            log_msg(LOG_WARN, "client fd=%d: binary frame without hello", fd);
+            return -1;
+        }
+        if(len >= POC_MAX_JSON){
+            log_msg(LOG_WARN, "client fd=%d: frame of %zu bytes exceeds limit", fd, len);
+            return -1;
+        }
+        if(c->rlen - pos < 4 + len) break;
+
+        /* claim descriptors that arrived with this frame's bytes */
+        uint64_t end = c->rbase + pos + 4 + len;
+        int fds[PH_MAX_FRAME_FDS]; size_t nfds = 0, k = 0;
+        for(; k < c->rfds_n && c->rfds[k].at <= end; k++){
+            if(nfds < PH_MAX_FRAME_FDS) fds[nfds++] = c->rfds[k].fd;
+            else close(c->rfds[k].fd);
+        }
+        if(k){
+            memmove(c->rfds, c->rfds + k, (c->rfds_n - k) * sizeof *c->rfds);
+            c->rfds_n -= k;
+        }
+
+        char *body = c->rbuf + pos + 4;
+        char saved = body[len];
+        body[len] = '\0';
+        stats_add(&c->st->rx_frames, 1);
+        on_frame(fd, body, len, bin, fds, nfds);
+        body[len] = saved;
+        for(size_t i = 0; i < nfds; i++) if(fds[i] >= 0) close(fds[i]);
+        pos += 4 + len;
+    }
+    if(pos){
+        memmove(c->rbuf, c->rbuf + pos, c->rlen - pos);
+        c->rlen -= pos;
+        c->rbase += pos;
+    }
+    return 0;
+}
+
+/* drain the addon->core queue; same budget and hello rule as the socket path */
+static void inproc_readable(int fd, client_t *c, ph_frame_fn on_frame){
+    ph_inproc_ep_t *ep = c->ip;
+    size_t budget = PH_RX_BUDGET;
+    inproc_begin_read(ep);
+    for(;;){
+        ph_ipmsg_t *m = inproc_pop(ep);
+        if(!m){
+            if(inproc_addon_closed(ep)) client_close(fd);
+            return;
+        }
+        if(m->bin && !atomic_load(&c->bin)){
+            log_msg(LOG_WARN, "client fd=%d: binary frame without hello", fd);
+            inproc_msg_free(m);
+            client_close(fd);
+            return;
+        }
+        stats_add(&c->st->rx_frames, 1);
+        stats_add(&c->st->rx_bytes, 4 + m->len);
+        on_frame(fd, m->data, m->len, m->bin, m->fds, m->nfds);
+        size_t used = 4 + m->len;
+        inproc_msg_free(m);
+        if(atomic_load(&c->closing)) return;
+        if(used >= budget){ inproc_yield(ep); return; }
+        budget -= used;
+    }
+}
+
+void client_on_readable(int fd, ph_frame_fn on_frame){
+    client_t *c = cli_get(fd);
+    if(!c || atomic_load(&c->closing)) return;
+    if(c->ip){ inproc_readable(fd, c, on_frame); return; }
+    size_t budget = PH_RX_BUDGET;
+    for(;;){
+        ssize_t g = rx_read(fd, c);
+        if(g == -2) return;                      /* drained; partial frame waits */
+        if(g > 0 && rx_parse(fd, c, on_frame) == 0){
+            if(atomic_load(&c->closing)) return;
+            if((size_t)g >= budget) return;      /* level-triggered: resumes next wakeup */
+            budget -= (size_t)g;
+            continue;
+        }
+        if(g == 0) rx_parse(fd, c, on_frame);    /* flush what's complete, then close */
+        client_close(fd);
+        return;
+    }
+}
+
+void client_on_writable(int fd){
+    client_t *c = cli_get(fd);
+    if(!c) return;
+    pthread_mutex_lock(&c->mu);
+    drain_locked(fd, c);
+    pthread_mutex_unlock(&c->mu);
+}
+
+/* hand the fd to its owner shard; only that thread tears a client down */
+static void close_locked(int fd, client_t *c){
+    if(atomic_exchange(&c->closing, true)) return;
+    shard_t *sh = &g_shards[c->shard];
+    pthread_mutex_lock(&sh->mu);
+    intvec_push(&sh->closing, fd);
+    pthread_mutex_unlock(&sh->mu);
+    uint64_t one = 1;
+    ssize_t w;
+    do w = write(sh->wake_fd, &one, sizeof one); while(w < 0 && errno == EINTR);
+}
+
+void client_close(int fd){
+    client_t *c = cli_get(fd);
+    if(!c) return;
+    pthread_mutex_lock(&c->mu);
+    close_locked(fd, c);
+    pthread_mutex_unlock(&c->mu);
+}
+
+static void rcu_close_fd(void *arg){ close((int)(intptr_t)arg); }
+static void rcu_release_ep(void *arg){ inproc_release((ph_inproc_ep_t*)arg); }
+
+/* The fd number stays open (or the endpoint referenced) until every loop
+ * thread has moved past any routing snapshot that still lists it, so a
+ * concurrent publish can never reach a new connection that reused the fd. */
+void clients_reap(int shard){
+    shard_t *sh = &g_shards[shard];
+    pthread_mutex_lock(&sh->mu);
+    intvec_t gone = sh->closing;
+    intvec_init(&sh->closing);
+    pthread_mutex_unlock(&sh->mu);
+    if(!gone.n){ intvec_free(&gone); return; }
+
+    for(size_t i = 0; i < gone.n; i++){
+        int fd = gone.v[i];
+        client_t *c = cli_get(fd);
+        if(!c) continue;
+        pthread_mutex_lock(&c->mu);
+        client_free_outbound(c);
+        c->dirty = NULL;
+        atomic_store(&c->used, false);
+        pthread_mutex_unlock(&c->mu);
+        client_free_inbound(c);
+        stats_client_close(fd);
+        int n = atomic_fetch_sub(&g_cli_n, 1) - 1;
+        log_msg(LOG_INFO, "client fd=%d disconnected (total=%d)", fd, n);
+        if(g_feedtab){
+            feedtab_unsub_all_fd(g_feedtab, fd);
+            feedtab_drop_retained_fd(g_feedtab, fd);
+        }
+        epoll_ctl(sh->epfd, EPOLL_CTL_DEL, fd, NULL);
+    }
+    route_sync();
+    for(size_t i = 0; i < gone.n; i++){
+        int fd = gone.v[i];
+        client_t *c = cli_slot(fd, false);
+        if(!c) continue;
+        if(c->ip){ rcu_defer(rcu_release_ep, c->ip); c->ip = NULL; }  /* closes fd with the last ref */
+        else rcu_defer(rcu_close_fd, (void*)(intptr_t)fd);
+    }
+    intvec_free(&gone);
+}
+
+/* ---------- batched sends (io_uring) ----------
+ * A loop thread with a ring queues frames while it routes and remembers the
+ * clients it touched. clients_flush() then sends the head frame of every one
+ * of them with a single io_uring_enter(), round after round, so a publish to
+ * N subscribers costs one submission instead of N sendmsg() calls. A socket
+ * that fills up is handed to EPOLLOUT exactly as on the direct path.
+ *
+ * Publishes flush right after their fan-out (clients_borrow()), so their
+ * frames go out from the publisher's buffer; only what is still queued when
+ * the flush ends is copied. */
+
+#define PH_URING_ENTRIES 256
+#define PH_URING_ROUNDS  16   /* frames per client per batch before EPOLLOUT takes over */
+
+typedef struct {
+    int         fd;
+    client_t   *c;
+    outwrite_t  ow;
+} flushent_t;
+
+static _Thread_local flushent_t *t_fe;
+static _Thread_local size_t      t_fe_cap;
+
+static int cmp_fd(const void *a, const void *b){
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+/* one submission round over e[0..n); returns how many clients have more queued */
+static size_t flush_round(flushent_t *e, size_t n){
+    unsigned cap = uring_capacity(t_ring);
+    size_t i = 0, more = 0;
+    while(i < n){
+        unsigned k = 0;
+        for(; i < n && k < cap; i++){
+            client_t *c = e[i].c;
+            if(!c->qn || c->pollout || atomic_load(&c->closing)) continue;
+            outmsg_prep(q_at(c, 0), &e[i].ow);
+            if(uring_prep_sendmsg(t_ring, e[i].fd, &e[i].ow.msg,
+                                  MSG_NOSIGNAL | MSG_DONTWAIT, i) < 0) break;
+            k++;
+        }
+        if(!k) break;
+        if(uring_submit_wait(t_ring, k) < 0){
+            /* SQEs may be left pointing at our stack of writes: drop the ring */
+            log_msg(LOG_WARN, "io_uring submit: %s; this loop writes directly", strerror(errno));
+            uring_close(t_ring);
+            t_ring = NULL;
+            atomic_fetch_sub(&g_uring_loops, 1);
+            return 0;
+        }
+        uint64_t ud;
+        int32_t  res;
+        while(uring_next_cqe(t_ring, &ud, &res)){
+            flushent_t *f = &e[ud];
+            client_t   *c = f->c;
+            if(res == -EINTR){ more++; continue; }
+            if(res == -EAGAIN || res == -EWOULDBLOCK || res == 0){ set_pollout(f->fd, c, true); continue; }
+            if(res < 0){ close_locked(f->fd, c); continue; }
+            if(outmsg_wrote(q_at(c, 0), &f->ow, (size_t)res)){
+                size_t len = q_at(c, 0)->len;
+                q_pop(c);
+                note_sent(c, len);
+                if(c->qn) more++;
+            } else set_pollout(f->fd, c, true);   /* short write: socket buffer full */
+        }
+    }
+    return more;
+}
+
+/* the borrowed buffers are about to go: copy the frames still queued */
+static void q_own_locked(int fd, client_t *c){
+    for(size_t i = 0; i < c->qn && !atomic_load(&c->closing); i++){
+        if(outmsg_own(q_at(c, i)) == 0) continue;
+        log_msg(LOG_ERROR, "client fd=%d: out of memory queueing frame", fd);
+        close_locked(fd, c);
+    }
+}
+
+void clients_borrow(void){
+    t_borrow = t_ring != NULL;
+}
+
+void clients_flush(void){
+    bool borrowed = t_borrow;
+    t_borrow = false;
+    if(!t_ring || !t_dirty.n) return;
+    if(t_fe_cap < t_dirty.n){
+        flushent_t *ne = (flushent_t*)realloc(t_fe, t_dirty.n * sizeof *ne);
+        if(ne){ t_fe = ne; t_fe_cap = t_dirty.n; }
+    }
+    /* every dirty client stays locked until its frames are reaped; taking the
+     * locks in fd order keeps two flushing loops from deadlocking */
+    qsort(t_dirty.v, t_dirty.n, sizeof(int), cmp_fd);
+    size_t n = 0;
+    for(size_t i = 0; i < t_dirty.n; i++){
+        int fd = t_dirty.v[i];
+        client_t *c = cli_slot(fd, false);
+        if(!c) continue;
+        pthread_mutex_lock(&c->mu);
+        c->dirty = NULL;
+        if(!atomic_load(&c->used) || atomic_load(&c->closing)){ pthread_mutex_unlock(&c->mu); continue; }
+        if(n < t_fe_cap){ t_fe[n].fd = fd; t_fe[n].c = c; n++; continue; }
+        drain_locked(fd, c);   /* no room to batch it (out of memory) */
+        if(borrowed) q_own_locked(fd, c);
+        pthread_mutex_unlock(&c->mu);
+    }
+    t_dirty.n = 0;
+
+    for(int r = 0; r < PH_URING_ROUNDS && t_ring && flush_round(t_fe, n); r++){}
+
+    for(size_t i = 0; i < n; i++){
+        client_t *c = t_fe[i].c;
+        if(borrowed) q_own_locked(t_fe[i].fd, c);
+        if(!atomic_load(&c->closing)){
+            if(c->qn) set_pollout(t_fe[i].fd, c, true);
+            else { c->qhead = 0; set_pollout(t_fe[i].fd, c, false); }
+        }
+        pthread_mutex_unlock(&c->mu);
+    }
+}
+
+int clients_set_io(const char *name){
+    bool any  = strcmp(name, "auto") == 0;
+    bool want = any || strcmp(name, "uring") == 0;
+    if(!want && strcmp(name, "epoll") != 0) return -1;
+    if(want){
+        ph_uring_t *r = uring_open(PH_URING_ENTRIES);
+        if(!r){
+            log_msg(any ? LOG_INFO : LOG_WARN, "io_uring unavailable (%s); using epoll", strerror(errno));
+            want = false;
+        }
+        uring_close(r);
+    }
+    atomic_store(&g_uring_on, want);
+    return 0;
+}
+
+const char *clients_io_name(void){
+    return atomic_load(&g_uring_loops) > 0 ? "uring" : "epoll";
+}
+
+void clients_thread_init(void){
+    if(!atomic_load(&g_uring_on)) return;
+    t_ring = uring_open(PH_URING_ENTRIES);
+    if(!t_ring) log_msg(LOG_WARN, "io_uring: %s; this loop writes directly", strerror(errno));
+    else atomic_fetch_add(&g_uring_loops, 1);
+}
+
+void clients_thread_exit(void){
+    clients_flush();
+    if(t_ring){
+        uring_close(t_ring);
+        t_ring = NULL;
+        atomic_fetch_sub(&g_uring_loops, 1);
+    }
+    intvec_free(&t_dirty);
+    free(t_fe); t_fe = NULL; t_fe_cap = 0;
+}
+
+/* ---------- policy ---------- */
+
+static const char *k_policy_names[] = { "drop-oldest", "disconnect", "coalesce" };
+
+ph_qpolicy_t clients_policy(void){ return (ph_qpolicy_t)atomic_load(&g_policy); }
+void clients_set_policy(ph_qpolicy_t p){ atomic_store(&g_policy, (int)p); }
+const char *clients_policy_name(ph_qpolicy_t p){
+    return (unsigned)p < sizeof k_policy_names / sizeof k_policy_names[0] ? k_policy_names[p] : "?";
+}
+int clients_parse_policy(const char *s, ph_qpolicy_t *out){
+    for(size_t i = 0; i < sizeof k_policy_names / sizeof k_policy_names[0]; i++)
+        if(strcmp(s, k_policy_names[i]) == 0){ *out = (ph_qpolicy_t)i; return 0; }
+    return -1;
+}
+size_t clients_qmax(void){ return atomic_load(&g_qmax); }
+void clients_set_qmax(size_t frames){ g_qmax = frames < 2 ? 2 : frames; }
+
+void clients_each(void (*fn)(int fd, void *arg), void *arg){
+    for(size_t pi = 0; pi < PH_CLI_PAGES; pi++){
+        client_t *pg = atomic_load(&g_pages[pi]);
+        if(!pg) continue;
+        for(size_t i = 0; i < PH_CLI_PAGE; i++)
+            if(atomic_load(&pg[i].used)) fn((int)(pi * PH_CLI_PAGE + i), arg);
+    }
+}
+
+void clients_list(int fd){
+    char buf[POC_MAX_JSON];
+    size_t pos = 0;
+    int w = snprintf(buf, sizeof buf,
+                     "{\"type\":\"clients\",\"policy\":\"%s\",\"qmax\":%zu,\"qbytes\":%zu,\"loops\":%d,\"io\":\"%s\",\"n\":%d,\"clients\":[",
+                     clients_policy_name(clients_policy()), clients_qmax(), g_qbytes, g_nshards,
+                     clients_io_name(),
+                     client_count());
+    if(w < 0 || (size_t)w >= sizeof buf) return;
+    pos = (size_t)w;
+    const char *sep = "";
+    bool full = false;
+    for(size_t pi = 0; pi < PH_CLI_PAGES && !full; pi++){
+        client_t *pg = atomic_load(&g_pages[pi]);
+        if(!pg) continue;
+        for(size_t i = 0; i < PH_CLI_PAGE && !full; i++){
+            client_t *c = &pg[i];
+            if(!atomic_load(&c->used)) continue;
+            pthread_mutex_lock(&c->mu);
+            w = snprintf(buf + pos, sizeof buf - pos,
+                         "%s{\"fd\":%zu,\"loop\":%d,\"link\":\"%s\",\"depth\":%zu,\"bytes\":%zu,\"hwm\":%zu,"
+                         "\"sent\":%llu,\"dropped\":%llu,\"coalesced\":%llu}",
+                         sep, pi * PH_CLI_PAGE + i, c->shard, c->ip ? "inproc" : "uds",
+                         c->ip ? inproc_depth(c->ip) : c->qn, c->qbytes, c->q_hwm,
+                         (unsigned long long)c->sent, (unsigned long long)c->dropped,
+                         (unsigned long long)c->coalesced);
+            pthread_mutex_unlock(&c->mu);
+            if(w < 0 || (size_t)w >= sizeof buf - pos - 2){ full = true; break; }  /* keep room for "]}" */
+            pos += (size_t)w;
+            sep = ",";
+        }
+    }
+    buf[pos++] = ']'; buf[pos++] = '}';
+    client_reply(fd, buf, pos);
+}
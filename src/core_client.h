@@ -0,0 +1,106 @@
+#ifndef PH_CORE_CLIENT_H
+#define PH_CORE_CLIENT_H
+
+/* Broker-side client table (ph-core only).
+ *
+ * Every connected socket owns a bounded outbound queue. Sends never block the
+ * event loop: a frame is written directly while the socket has room, and the
+ * unsent tail is queued and drained on EPOLLOUT. When a queue is full the
+ * overflow policy decides what gives way. With the io_uring backend a loop
+ * thread defers its writes to the end of the event batch, or of a publish's
+ * fan-out, and submits them all at once (see clients_flush()).
+ *
+ * Inbound bytes land in a per-client receive buffer; a resumable parser hands
+ * every complete frame (with its SCM_RIGHTS descriptors) to the frame handler
+ * and keeps a partial frame for the next wakeup, so no read ever waits.
+ *
+ * Clients are sharded by fd over several event-loop threads. Reads and
+ * teardown happen on the owner shard; any thread may send, serialised by a
+ * per-client lock, so a publish is routed by whichever loop received it.
+ *
+ * Co-resident addons may instead be attached through an in-process endpoint
+ * (core_inproc.h); they share the table, feeds and handlers with socket
+ * clients and differ only in transport. */
+
+#include "common.h"
+#include "ph_inproc.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    PH_QPOL_DROP_OLDEST = 0,  /* discard the oldest unsent frame */
+    PH_QPOL_DISCONNECT,       /* close the slow client */
+    PH_QPOL_COALESCE          /* replace a queued frame of the same feed, else drop oldest */
+} ph_qpolicy_t;
+
+#define PH_CLIENT_QMAX_DEFAULT    256               /* frames per client */
+#define PH_CLIENT_QBYTES_DEFAULT  (4u * 1024 * 1024) /* bytes per client */
+
+/* nshards event-loop shards, each with its own epoll set; fd % nshards owns a client */
+int  clients_init(int nshards, feedtab_t *feeds);
+void clients_free(void);
+int  clients_shards(void);
+int  clients_epfd(int shard);
+int  clients_wake_fd(int shard);  /* in the shard's epoll set; call clients_wake_ack */
+void clients_wake_ack(int shard);
+
+int  client_add(int fd);
+int  client_add_inproc(ph_inproc_ep_t *ep);   /* returns the client fd */
+int  client_known(int fd);        /* 1 if fd is a live (not closing) client */
+int  client_count(void);
+/* identifies this connection on fd; replies through it are dropped once the
+ * client is gone, even if the fd number has been reused since */
+uint64_t client_token(int fd);
+int  client_reply_token(uint64_t token, const char *json, size_t len);
+
+/* Queue one frame for fd. feed (may be NULL) tags the frame for coalescing.
+ * fds are dup'd when they have to be queued; the caller keeps ownership. */
+int  client_send(int fd, const char *feed, const char *json, size_t len,
+                 const int *fds, size_t nfds);
+/* Binary frame (ph_bin header + payload) for a client that sent hello/bin. */
+int  client_send_bin(int fd, const char *feed, const void *frame, size_t len,
+                     const int *fds, size_t nfds);
+void client_set_bin(int fd, int on);
+int  client_is_bin(int fd);
+/* convenience for direct replies */
+int  client_reply(int fd, const char *json, size_t len);
+
+/* Called once per complete frame. JSON bodies are NUL-terminated; binary
+ * bodies (bin=true) start with the packed ph_bin header. Descriptors are
+ * closed after the handler returns; set an entry to -1 to keep it. */
+typedef void (*ph_frame_fn)(int fd, const char *buf, size_t len, bool bin,
+                            int *fds, size_t nfds);
+
+/* Outbound I/O backend: "uring" batches each loop's socket writes into one
+ * io_uring submission per event batch, "epoll" writes frame by frame, "auto"
+ * is uring when available. Falls back to epoll (returning 0) when io_uring is
+ * compiled out or refused; -1 for an unknown name. Call before the loop
+ * threads start. */
+int         clients_set_io(const char *name);
+const char *clients_io_name(void);
+void        clients_thread_init(void);   /* each loop thread, on start */
+void        clients_thread_exit(void);
+void        clients_flush(void);         /* end of every event batch, before clients_reap() */
+/* The caller's frame buffers and fds stay valid until its next clients_flush():
+ * frames queued until then are sent straight from them, and only those still
+ * queued when that flush ends are copied. No-op without a ring. */
+void        clients_borrow(void);
+
+void client_on_readable(int fd, ph_frame_fn on_frame);
+void client_on_writable(int fd);
+void client_close(int fd);        /* any thread; takes effect in the owner's clients_reap() */
+void clients_reap(int shard);     /* owner loop, once per iteration */
+
+ph_qpolicy_t clients_policy(void);
+void         clients_set_policy(ph_qpolicy_t p);
+int          clients_parse_policy(const char *s, ph_qpolicy_t *out);
+const char  *clients_policy_name(ph_qpolicy_t p);
+size_t       clients_qmax(void);
+void         clients_set_qmax(size_t frames);
+
+/* one info frame per client with its queue depth metrics */
+void clients_list(int fd);
+/* fn for every live client, in fd order; walks only the allocated table pages */
+void clients_each(void (*fn)(int fd, void *arg), void *arg);
+
+#endif
@@ -0,0 +1,284 @@
+#define _GNU_SOURCE
+#include "core_inproc.h"
+#include "common.h"
+#include "ph_mpq.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/eventfd.h>
+
+struct ph_inproc_ep {
+    atomic_int   refs;            /* core + addon */
+    atomic_bool  addon_closed, core_closed;
+    atomic_bool  core_armed;      /* core drained "up" and waits on core_efd */
+    atomic_bool  addon_waiting;   /* addon drained "down" and waits on addon_efd */
+    int          core_efd, addon_efd;
+    ph_mpq_t     up, down;
+    char         name[64];
+    struct ph_inproc_ep *next;    /* pending adoption */
+};
+
+static pthread_mutex_t  g_pend_mu = PTHREAD_MUTEX_INITIALIZER;
+static ph_inproc_ep_t  *g_pend;
+static int              g_accept_efd = -1;
+
+/* ---------- helpers ---------- */
+
+static void efd_signal(int efd){
+    uint64_t one = 1;
+    ssize_t w;
+    do w = write(efd, &one, sizeof one); while(w < 0 && errno == EINTR);
+}
+
+static void efd_drain(int efd){
+    uint64_t v;
+    ssize_t r;
+    do r = read(efd, &v, sizeof v); while(r < 0 && errno == EINTR);
+}
+
+static int64_t now_ms(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void ep_drain_queue(ph_mpq_t *q){
+    ph_ipmsg_t *m;
+    while((m = (ph_ipmsg_t*)ph_mpq_pop(q))) inproc_msg_free(m);
+    ph_mpq_free(q);
+}
+
+static void ep_unref(ph_inproc_ep_t *ep){
+    if(atomic_fetch_sub(&ep->refs, 1) != 1) return;
+    ep_drain_queue(&ep->up);
+    ep_drain_queue(&ep->down);
+    close(ep->core_efd);
+    close(ep->addon_efd);
+    free(ep);
+}
+
+static ph_ipmsg_t *msg_build(const void *head, size_t hlen, const void *body, size_t len,
+                             bool bin, const int *fds, size_t nfds){
+    if(nfds > PH_INPROC_MAX_FDS) nfds = PH_INPROC_MAX_FDS;
+    ph_ipmsg_t *m = (ph_ipmsg_t*)malloc(sizeof *m + hlen + len + 1);
+    if(!m) return NULL;
+    if(hlen) memcpy(m->data, head, hlen);
+    if(len)  memcpy(m->data + hlen, body, len);
+    m->data[hlen + len] = '\0';
+    m->len = hlen + len;
+    m->bin = bin;
+    m->nfds = 0;
+    for(size_t k = 0; fds && k < nfds; k++){
+        int d = fcntl(fds[k], F_DUPFD_CLOEXEC, 0);
+        if(d < 0){ inproc_msg_free(m); return NULL; }
+        m->fds[m->nfds++] = d;
+    }
+    return m;
+}
+
+ph_ipmsg_t *inproc_msg_new(const void *body, size_t len, bool bin,
+                           const int *fds, size_t nfds){
+    return msg_build(NULL, 0, body, len, bin, fds, nfds);
+}
+
+void inproc_msg_free(ph_ipmsg_t *m){
+    if(!m) return;
+    for(size_t k = 0; k < m->nfds; k++) if(m->fds[k] >= 0) close(m->fds[k]);
+    free(m);
+}
+
+/* ---------- addon side (ph_inproc_api_t) ---------- */
+
+static ph_inproc_ep_t *ip_open(const char *name, int *fd_out){
+    if(g_accept_efd < 0 || !fd_out) return NULL;
+    ph_inproc_ep_t *ep = (ph_inproc_ep_t*)calloc(1, sizeof *ep);
+    if(!ep) return NULL;
+    ep->core_efd  = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    ep->addon_efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(ep->core_efd < 0 || ep->addon_efd < 0 ||
+       ph_mpq_init(&ep->up, PH_INPROC_QLEN) < 0 || ph_mpq_init(&ep->down, PH_INPROC_QLEN) < 0){
+        if(ep->core_efd >= 0) close(ep->core_efd);
+        if(ep->addon_efd >= 0) close(ep->addon_efd);
+        ph_mpq_free(&ep->up); ph_mpq_free(&ep->down);
+        free(ep);
+        return NULL;
+    }
+    atomic_init(&ep->refs, 2);
+    atomic_init(&ep->addon_closed, false);
+    atomic_init(&ep->core_closed, false);
+    atomic_init(&ep->core_armed, true);
+    atomic_init(&ep->addon_waiting, false);
+    snprintf(ep->name, sizeof ep->name, "%s", name ? name : "addon");
+
+    pthread_mutex_lock(&g_pend_mu);
+    ep->next = g_pend;
+    g_pend = ep;
+    pthread_mutex_unlock(&g_pend_mu);
+    efd_signal(g_accept_efd);
+
+    *fd_out = ep->addon_efd;
+    return ep;
+}
+
+static int ip_send(ph_inproc_ep_t *ep, const void *head, size_t hlen,
+                   const void *body, size_t len, bool bin,
+                   const int *fds, size_t nfds, int timeout_ms){
+    if(atomic_load(&ep->core_closed) || atomic_load(&ep->addon_closed)){ errno = EPIPE; return -1; }
+    if(hlen + len >= POC_MAX_JSON){ errno = EMSGSIZE; return -1; }
+    ph_ipmsg_t *m = msg_build(head, hlen, body, len, bin, fds, nfds);
+    if(!m) return -1;
+
+    int64_t dl = timeout_ms < 0 ? -1 : now_ms() + timeout_ms;
+    while(!ph_mpq_push(&ep->up, m)){
+        /* full: the core is behind; make sure it is awake and back off */
+        if(atomic_load(&ep->core_closed) || (dl >= 0 && now_ms() >= dl)){
+            inproc_msg_free(m);
+            errno = EAGAIN;
+            return -1;
+        }
+        efd_signal(ep->core_efd);
+        struct timespec ts = { 0, 200000 };
+        nanosleep(&ts, NULL);
+    }
+    atomic_thread_fence(memory_order_seq_cst);
+    if(atomic_exchange(&ep->core_armed, false)) efd_signal(ep->core_efd);
+    return 0;
+}
+
+static int ip_recv(ph_inproc_ep_t *ep, void *buf, size_t cap, bool *bin,
+                   int *fds, size_t *nfds, int timeout_ms){
+    int64_t dl = timeout_ms < 0 ? -1 : now_ms() + timeout_ms;
+    ph_ipmsg_t *m;
+    for(;;){
+        if((m = (ph_ipmsg_t*)ph_mpq_pop(&ep->down))) break;
+        if(atomic_load(&ep->core_closed)){ errno = EPIPE; return -1; }
+
+        atomic_store(&ep->addon_waiting, true);
+        atomic_thread_fence(memory_order_seq_cst);
+        if((m = (ph_ipmsg_t*)ph_mpq_pop(&ep->down))){
+            atomic_store(&ep->addon_waiting, false);
+            break;
+        }
+        int rem = -1;
+        if(dl >= 0){
+            int64_t left = dl - now_ms();
+            rem = left > 0 ? (int)left : 0;
+        }
+        if(rem == 0){
+            atomic_store(&ep->addon_waiting, false);
+            errno = ETIMEDOUT;
+            return -1;
+        }
+        struct pollfd p = { .fd = ep->addon_efd, .events = POLLIN };
+        if(poll(&p, 1, rem) > 0) efd_drain(ep->addon_efd);
+        atomic_store(&ep->addon_waiting, false);
+    }
+
+    size_t cap_fds = nfds ? *nfds : 0;
+    if(m->len >= cap){
+        inproc_msg_free(m);
+        if(nfds) *nfds = 0;
+        errno = EMSGSIZE;
+        return -1;
+    }
+    memcpy(buf, m->data, m->len + 1);
+    size_t got = 0;
+    for(size_t k = 0; k < m->nfds; k++){
+        if(fds && got < cap_fds) fds[got++] = m->fds[k];
+        else close(m->fds[k]);
+    }
+    if(nfds) *nfds = got;
+    if(bin) *bin = m->bin;
+    int n = (int)m->len;
+    free(m);
+    return n;
+}
+
+static void ip_close(ph_inproc_ep_t *ep){
+    if(!ep) return;
+    atomic_store(&ep->addon_closed, true);
+    efd_signal(ep->core_efd);
+    ep_unref(ep);
+}
+
+const ph_inproc_api_t ph_core_inproc_api = {
+    .api_size = sizeof(ph_inproc_api_t),
+    .open     = ip_open,
+    .send     = ip_send,
+    .recv     = ip_recv,
+    .close    = ip_close,
+};
+
+/* ---------- core side ---------- */
+
+int inproc_init(void){
+    g_accept_efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(g_accept_efd < 0) log_msg(LOG_WARN, "in-process endpoints disabled: eventfd: %s", strerror(errno));
+    return g_accept_efd;
+}
+
+void inproc_shutdown(void){
+    ph_inproc_ep_t *ep = inproc_take_pending();
+    while(ep){
+        ph_inproc_ep_t *nx = ep->next;
+        inproc_release(ep);
+        ep = nx;
+    }
+    if(g_accept_efd >= 0) close(g_accept_efd);
+    g_accept_efd = -1;
+}
+
+ph_inproc_ep_t *inproc_take_pending(void){
+    if(g_accept_efd >= 0) efd_drain(g_accept_efd);
+    pthread_mutex_lock(&g_pend_mu);
+    ph_inproc_ep_t *l = g_pend;
+    g_pend = NULL;
+    pthread_mutex_unlock(&g_pend_mu);
+    return l;
+}
+
+ph_inproc_ep_t *inproc_next(ph_inproc_ep_t *ep){ return ep ? ep->next : NULL; }
+int inproc_core_fd(const ph_inproc_ep_t *ep){ return ep->core_efd; }
+const char *inproc_name(const ph_inproc_ep_t *ep){ return ep->name; }
+
+int inproc_push(ph_inproc_ep_t *ep, ph_ipmsg_t *m){
+    if(atomic_load(&ep->addon_closed)) return -1;
+    if(!ph_mpq_push(&ep->down, m)) return 1;
+    atomic_thread_fence(memory_order_seq_cst);
+    if(atomic_load(&ep->addon_waiting)) efd_signal(ep->addon_efd);
+    return 0;
+}
+
+void inproc_begin_read(ph_inproc_ep_t *ep){ efd_drain(ep->core_efd); }
+
+ph_ipmsg_t *inproc_pop(ph_inproc_ep_t *ep){
+    ph_ipmsg_t *m = (ph_ipmsg_t*)ph_mpq_pop(&ep->up);
+    if(m) return m;
+    /* arm, then look again: a frame pushed in between would not signal us */
+    atomic_store(&ep->core_armed, true);
+    atomic_thread_fence(memory_order_seq_cst);
+    m = (ph_ipmsg_t*)ph_mpq_pop(&ep->up);
+    if(m) atomic_store(&ep->core_armed, false);
+    return m;
+}
+
+void inproc_yield(ph_inproc_ep_t *ep){ efd_signal(ep->core_efd); }
+
+bool inproc_addon_closed(ph_inproc_ep_t *ep){ return atomic_load(&ep->addon_closed); }
+
+size_t inproc_depth(ph_inproc_ep_t *ep){ return ph_mpq_depth(&ep->down); }
+
+void inproc_release(ph_inproc_ep_t *ep){
+    if(!ep) return;
+    atomic_store(&ep->core_closed, true);
+    efd_signal(ep->addon_efd);
+    ep_unref(ep);
+}
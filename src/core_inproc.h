@@ -0,0 +1,54 @@
+#ifndef PH_CORE_INPROC_H
+#define PH_CORE_INPROC_H
+
+/* Broker side of in-process endpoints (ph-core only).
+ *
+ * An endpoint is two lock-free frame queues (addon->core "up", core->addon
+ * "down") and two eventfds. The core eventfd stands in for the client socket:
+ * it sits in the broker's epoll set and its number is the client id in the
+ * client and feed tables. Each side only writes the other's eventfd when that
+ * side has announced it is about to sleep, so a busy pipeline exchanges frames
+ * without a single syscall.
+ *
+ * open() runs on addon threads; it parks the new endpoint on a pending list
+ * and pokes inproc_fd(), and the event loop adopts it like an accept(). */
+
+#include "ph_inproc.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#define PH_INPROC_QLEN     1024   /* frames per direction */
+#define PH_INPROC_MAX_FDS  16
+
+typedef struct ph_ipmsg {
+    size_t len;
+    bool   bin;
+    size_t nfds;
+    int    fds[PH_INPROC_MAX_FDS];
+    char   data[];                /* len bytes + NUL */
+} ph_ipmsg_t;
+
+extern const ph_inproc_api_t ph_core_inproc_api;
+
+int  inproc_init(void);           /* returns the adoption eventfd for epoll */
+void inproc_shutdown(void);
+
+/* endpoints opened since the last call, linked through inproc_next() */
+ph_inproc_ep_t *inproc_take_pending(void);
+ph_inproc_ep_t *inproc_next(ph_inproc_ep_t *ep);
+int             inproc_core_fd(const ph_inproc_ep_t *ep);
+const char     *inproc_name(const ph_inproc_ep_t *ep);
+
+/* core side; never blocks */
+ph_ipmsg_t *inproc_msg_new(const void *body, size_t len, bool bin,
+                           const int *fds, size_t nfds);   /* dups fds */
+void        inproc_msg_free(ph_ipmsg_t *m);                /* closes fds >= 0 */
+int         inproc_push(ph_inproc_ep_t *ep, ph_ipmsg_t *m); /* 0, 1 = full, -1 = closed */
+void        inproc_begin_read(ph_inproc_ep_t *ep);         /* consume the wakeup */
+ph_ipmsg_t *inproc_pop(ph_inproc_ep_t *ep);                /* NULL = empty, armed for wakeup */
+void        inproc_yield(ph_inproc_ep_t *ep);              /* come back on the next loop turn */
+bool        inproc_addon_closed(ph_inproc_ep_t *ep);
+size_t      inproc_depth(ph_inproc_ep_t *ep);              /* frames waiting for the addon */
+void        inproc_release(ph_inproc_ep_t *ep);            /* drop the core's reference */
+
+#endif
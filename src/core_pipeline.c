@@ -0,0 +1,252 @@
+#define _GNU_SOURCE
+#include "core_pipeline.h"
+#include "core_client.h"
+#include "core_stats.h"
+#include "core_sched.h"
+#include "common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+typedef struct {
+    pipe_stage_t     s;
+    _Atomic uint64_t calls;
+    _Atomic uint64_t ns;       /* time inside plugin_process */
+    _Atomic uint64_t bytes;    /* handed to the next stage */
+} stage_t;
+
+typedef struct pipe {
+    int              id;
+    size_t           n;
+    stage_t         *st;
+    void            *buf[2];   /* stage i writes buf[i & 1], reads buf[(i - 1) & 1] */
+    pthread_t        tid;
+    _Atomic int      run;
+    _Atomic int      failed;   /* 1 + index of the stage that returned -1; the worker has exited */
+    _Atomic uint64_t rounds;   /* blocks the first stage produced */
+    _Atomic uint64_t idle;     /* rounds it had nothing */
+    struct pipe     *next;
+} pipe_t;
+
+static pthread_mutex_t g_mu = PTHREAD_MUTEX_INITIALIZER;   /* list; not held while running */
+static pipe_t         *g_pipes;
+static int             g_next_id = 1;
+
+/* ---------- worker ---------- */
+
+static void *pipe_main(void *arg){
+    pipe_t *p = (pipe_t*)arg;
+    ph_span_t span[2];
+    char nm[32];
+    snprintf(nm, sizeof nm, "core.pipe%d", p->id);
+    int slot = sched_enter(nm, PH_WORKER_DSP);
+    while(atomic_load_explicit(&p->run, memory_order_relaxed)){
+        ph_span_t *prev = NULL;
+        int produced = 0;
+        for(size_t i = 0; i < p->n; i++){
+            stage_t *s = &p->st[i];
+            int last = i + 1 == p->n;
+            ph_span_t *o = &span[i & 1];
+            *o = (ph_span_t){ .data = p->buf[i & 1], .cap = PH_PIPE_BLOCK };
+            ph_spans_t in  = { prev, prev ? 1u : 0u };
+            ph_spans_t out = { last ? NULL : o, last ? 0u : 1u };
+
+            uint64_t t0 = stats_now_ns();
+            int rc = s->s.f_process(&s->s.ctx, &in, &out);
+            stats_add(&s->ns, stats_now_ns() - t0);
+            stats_add(&s->calls, 1);
+            if(rc < 0){
+                log_msg(LOG_ERROR, "pipeline %d: %s failed; stopping", p->id, s->s.name);
+                atomic_store(&p->failed, (int)i + 1);
+                atomic_store(&p->run, 0);
+                break;
+            }
+            if(i == 0) produced = last || (o->data && o->bytes);
+            if(last || !o->data || !o->bytes) break;   /* nothing to pass on this round */
+            if(o->bytes > o->cap && o->data == p->buf[i & 1]) o->bytes = o->cap;
+            stats_add(&s->bytes, o->bytes);
+            prev = o;
+        }
+        if(produced) stats_add(&p->rounds, 1);
+        else { stats_add(&p->idle, 1); ph_msleep(1); }
+    }
+    sched_leave(slot);
+    return NULL;
+}
+
+/* ---------- lifecycle (management thread) ---------- */
+
+static pipe_t *find_using(const char *addon){
+    for(pipe_t *p = g_pipes; p; p = p->next)
+        for(size_t i = 0; i < p->n; i++)
+            if(!strcmp(p->st[i].s.name, addon)) return p;
+    return NULL;
+}
+
+static void unfuse(stage_t *st, size_t n){
+    for(size_t i = n; i-- > 0;) st[i].s.f_fuse(false);
+}
+
+static void pipe_free(pipe_t *p){
+    free(p->buf[0]); free(p->buf[1]); free(p->st); free(p);
+}
+
+int pipeline_start(const pipe_stage_t *st, size_t n){
+    if(!n || n > PH_PIPE_STAGES) return -1;
+    pthread_mutex_lock(&g_mu);
+    for(size_t i = 0; i < n; i++){
+        pipe_t *o = find_using(st[i].name);
+        int dup = 0;
+        for(size_t k = 0; k < i; k++) dup |= !strcmp(st[k].name, st[i].name);
+        if(o || dup){
+            pthread_mutex_unlock(&g_mu);
+            log_msg(LOG_ERROR, "pipeline: %s is already in %s", st[i].name, dup ? "this chain" : "a pipeline");
+            return -1;
+        }
+    }
+    pthread_mutex_unlock(&g_mu);
+
+    pipe_t *p = (pipe_t*)calloc(1, sizeof *p);
+    if(p) p->st = (stage_t*)calloc(n, sizeof *p->st);
+    if(p && p->st){
+        p->buf[0] = aligned_alloc(64, PH_PIPE_BLOCK);
+        p->buf[1] = aligned_alloc(64, PH_PIPE_BLOCK);
+    }
+    if(!p || !p->st || !p->buf[0] || !p->buf[1]){
+        log_msg(LOG_ERROR, "pipeline: out of memory");
+        if(p) pipe_free(p);
+        return -1;
+    }
+    p->n = n;
+    for(size_t i = 0; i < n; i++){
+        p->st[i].s = st[i];
+        p->st[i].s.ctx.name = p->st[i].s.name;
+    }
+
+    /* the addons park their own workers; any that refuses undoes the rest */
+    for(size_t i = 0; i < n; i++){
+        if(!p->st[i].s.f_fuse(true)){
+            log_msg(LOG_ERROR, "pipeline: %s refused to join", p->st[i].s.name);
+            unfuse(p->st, i);
+            pipe_free(p);
+            return -1;
+        }
+    }
+
+    atomic_store(&p->run, 1);
+    pthread_mutex_lock(&g_mu);
+    p->id = g_next_id++;
+    if(pthread_create(&p->tid, NULL, pipe_main, p) != 0){
+        pthread_mutex_unlock(&g_mu);
+        log_msg(LOG_ERROR, "pipeline: pthread_create failed");
+        unfuse(p->st, n);
+        pipe_free(p);
+        return -1;
+    }
+    p->next = g_pipes;
+    g_pipes = p;
+    pthread_mutex_unlock(&g_mu);
+
+    char chain[PH_PIPE_STAGES * 65] = "";
+    for(size_t i = 0, off = 0; i < n && off < sizeof chain; i++)
+        off += (size_t)snprintf(chain + off, sizeof chain - off, "%s%s", i ? " > " : "", st[i].name);
+    log_msg(LOG_INFO, "pipeline %d: %s", p->id, chain);
+    return p->id;
+}
+
+static void pipe_stop(pipe_t *p){
+    atomic_store(&p->run, 0);
+    pthread_join(p->tid, NULL);
+    unfuse(p->st, p->n);
+    int f = atomic_load(&p->failed);
+    if(f)
+        log_msg(LOG_WARN, "pipeline %d removed after %s failed (%llu blocks); its addons run on their own threads and feeds again",
+                p->id, p->st[f - 1].s.name, (unsigned long long)atomic_load(&p->rounds));
+    else
+        log_msg(LOG_INFO, "pipeline %d stopped after %llu blocks", p->id,
+                (unsigned long long)atomic_load(&p->rounds));
+    pipe_free(p);
+}
+
+static pipe_t *unlink_pipe(pipe_t *want){
+    for(pipe_t **pp = &g_pipes; *pp; pp = &(*pp)->next)
+        if(*pp == want){ *pp = want->next; return want; }
+    return NULL;
+}
+
+int pipeline_stop(int id){
+    pthread_mutex_lock(&g_mu);
+    pipe_t *p = g_pipes;
+    while(p && p->id != id) p = p->next;
+    if(p) unlink_pipe(p);
+    pthread_mutex_unlock(&g_mu);
+    if(!p) return -1;
+    pipe_stop(p);
+    return 0;
+}
+
+void pipeline_stop_using(const char *addon){
+    pthread_mutex_lock(&g_mu);
+    pipe_t *p = find_using(addon);
+    if(p) unlink_pipe(p);
+    pthread_mutex_unlock(&g_mu);
+    if(p) pipe_stop(p);
+}
+
+void pipeline_reap(void){
+    pipe_t *dead = NULL;
+    pthread_mutex_lock(&g_mu);
+    for(pipe_t **pp = &g_pipes; *pp;){
+        pipe_t *p = *pp;
+        if(atomic_load(&p->failed)){ *pp = p->next; p->next = dead; dead = p; }
+        else pp = &p->next;
+    }
+    pthread_mutex_unlock(&g_mu);
+    while(dead){ pipe_t *nx = dead->next; pipe_stop(dead); dead = nx; }
+}
+
+void pipeline_stop_all(void){
+    pthread_mutex_lock(&g_mu);
+    pipe_t *p = g_pipes;
+    g_pipes = NULL;
+    pthread_mutex_unlock(&g_mu);
+    while(p){ pipe_t *nx = p->next; pipe_stop(p); p = nx; }
+}
+
+/* ---------- `pipelines` ---------- */
+
+void pipeline_report(int fd){
+    char buf[POC_MAX_JSON];
+    int any = 0;
+    pthread_mutex_lock(&g_mu);
+    for(pipe_t *p = g_pipes; p; p = p->next){
+        any = 1;
+        int n = snprintf(buf, sizeof buf,
+            "{\"type\":\"pipeline\",\"id\":%d,\"running\":%s,\"blocks\":%llu,\"idle\":%llu,\"stages\":[",
+            p->id, atomic_load(&p->failed) ? "false" : "true",
+            (unsigned long long)atomic_load(&p->rounds), (unsigned long long)atomic_load(&p->idle));
+        for(size_t i = 0; i < p->n && n > 0 && (size_t)n < sizeof buf; i++){
+            stage_t *s = &p->st[i];
+            char esc[128];
+            ph_json_escape_string(s->s.name, esc, sizeof esc);
+            uint64_t calls = atomic_load(&s->calls);
+            n += snprintf(buf + n, sizeof buf - (size_t)n,
+                "%s{\"addon\":\"%s\",\"calls\":%llu,\"mean_us\":%.2f,\"bytes_out\":%llu}",
+                i ? "," : "", esc, (unsigned long long)calls,
+                calls ? (double)atomic_load(&s->ns) / (double)calls / 1000.0 : 0.0,
+                (unsigned long long)atomic_load(&s->bytes));
+        }
+        if(n > 0 && (size_t)n + 2 < sizeof buf){
+            memcpy(buf + n, "]}", 2);
+            client_reply(fd, buf, (size_t)n + 2);
+        }
+    }
+    pthread_mutex_unlock(&g_mu);
+    if(!any){
+        const char *m = "{\"type\":\"info\",\"msg\":\"no pipelines\"}";
+        client_reply(fd, m, strlen(m));
+    }
+}
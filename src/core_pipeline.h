@@ -0,0 +1,34 @@
+#ifndef PH_CORE_PIPELINE_H
+#define PH_CORE_PIPELINE_H
+
+/* Fused pipelines (ph-core only).
+ *
+ * A pipeline is a declared chain of loaded addons that export plugin_process
+ * (ABI 1.2). One worker thread runs the stages in order, block by block, and
+ * passes each stage's output to the next through two PH_PIPE_BLOCK buffers
+ * that stay in cache, instead of every addon running its own thread and the
+ * chain handing off through rings. Start and stop run on the management
+ * thread, like load and unload; `pipelines` may be asked from any loop. */
+
+#include "plugin.h"
+#include <stddef.h>
+
+#define PH_PIPE_BLOCK  (64u * 1024u)   /* bytes per inter-stage buffer */
+#define PH_PIPE_STAGES 16
+
+typedef struct {
+    char              name[64];
+    plugin_ctx_t      ctx;           /* handed to plugin_process; name is re-pointed */
+    plugin_process_fn f_process;
+    plugin_fuse_fn    f_fuse;
+} pipe_stage_t;
+
+int  pipeline_start(const pipe_stage_t *st, size_t n);   /* id > 0, or -1 (logged) */
+int  pipeline_stop(int id);                               /* -1: no such pipeline */
+void pipeline_stop_using(const char *addon);              /* before unloading it */
+void pipeline_stop_all(void);
+void pipeline_reap(void);        /* unfuse pipelines whose worker stopped on a failed stage */
+
+void pipeline_report(int fd);                             /* `pipelines` */
+
+#endif
@@ -0,0 +1,113 @@
+#include "core_rcu.h"
+#include "common.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+typedef struct rcu_cb {
+    void (*fn)(void *arg);
+    void  *arg;
+    uint64_t target;          /* grace period that must be observed by all */
+    struct rcu_cb *next;
+} rcu_cb_t;
+
+/* per-thread: 0 = offline/free, else the grace period seen at the last
+ * quiescent point */
+static atomic_uint_fast64_t g_ctr[PH_RCU_MAX_THREADS];
+static atomic_bool          g_slot_used[PH_RCU_MAX_THREADS];
+static atomic_uint_fast64_t g_gp = 1;
+
+static pthread_mutex_t g_cb_mu = PTHREAD_MUTEX_INITIALIZER;
+static rcu_cb_t       *g_cb_head, **g_cb_tail = &g_cb_head;
+static atomic_size_t   g_cb_n;          /* pending callbacks, for a cheap poll */
+
+static _Thread_local int t_slot = -1;
+
+int rcu_register_thread(void){
+    for(int i = 0; i < PH_RCU_MAX_THREADS; i++){
+        bool f = false;
+        if(atomic_compare_exchange_strong(&g_slot_used[i], &f, true)){
+            t_slot = i;
+            atomic_store(&g_ctr[i], atomic_load(&g_gp));
+            return 0;
+        }
+    }
+    log_msg(LOG_ERROR, "rcu: more than %d reader threads", PH_RCU_MAX_THREADS);
+    return -1;
+}
+
+void rcu_unregister_thread(void){
+    if(t_slot < 0) return;
+    atomic_store(&g_ctr[t_slot], 0);
+    atomic_store(&g_slot_used[t_slot], false);
+    t_slot = -1;
+}
+
+void rcu_online(void){ if(t_slot >= 0) atomic_store(&g_ctr[t_slot], atomic_load(&g_gp)); }
+void rcu_offline(void){ if(t_slot >= 0) atomic_store(&g_ctr[t_slot], 0); }
+void rcu_quiescent(void){ rcu_online(); }
+
+void rcu_defer(void (*fn)(void *arg), void *arg){
+    rcu_cb_t *cb = (rcu_cb_t*)malloc(sizeof *cb);
+    if(!cb){
+        /* leaking beats freeing under a reader */
+        log_msg(LOG_ERROR, "rcu: out of memory; leaking a deferred release");
+        return;
+    }
+    cb->fn = fn; cb->arg = arg; cb->next = NULL;
+    pthread_mutex_lock(&g_cb_mu);
+    /* the caller has already unpublished arg; start a new grace period.
+     * Taken under the lock so targets stay monotonic along the list. */
+    cb->target = atomic_fetch_add(&g_gp, 1) + 1;
+    *g_cb_tail = cb;
+    g_cb_tail = &cb->next;
+    atomic_fetch_add(&g_cb_n, 1);
+    pthread_mutex_unlock(&g_cb_mu);
+}
+
+static uint64_t rcu_min_seen(void){
+    uint64_t m = UINT64_MAX;
+    for(int i = 0; i < PH_RCU_MAX_THREADS; i++){
+        uint64_t c = atomic_load(&g_ctr[i]);
+        if(c && c < m) m = c;
+    }
+    return m;
+}
+
+void rcu_poll(void){
+    if(!atomic_load_explicit(&g_cb_n, memory_order_relaxed)) return;
+    uint64_t seen = rcu_min_seen();
+    rcu_cb_t *ready = NULL, **rt = &ready;
+    pthread_mutex_lock(&g_cb_mu);
+    while(g_cb_head && g_cb_head->target <= seen){
+        rcu_cb_t *cb = g_cb_head;
+        g_cb_head = cb->next;
+        atomic_fetch_sub(&g_cb_n, 1);
+        cb->next = NULL;
+        *rt = cb; rt = &cb->next;
+    }
+    if(!g_cb_head) g_cb_tail = &g_cb_head;
+    pthread_mutex_unlock(&g_cb_mu);
+    while(ready){
+        rcu_cb_t *nx = ready->next;
+        ready->fn(ready->arg);
+        free(ready);
+        ready = nx;
+    }
+}
+
+void rcu_barrier(void){
+    pthread_mutex_lock(&g_cb_mu);
+    rcu_cb_t *l = g_cb_head;
+    g_cb_head = NULL; g_cb_tail = &g_cb_head;
+    atomic_store(&g_cb_n, 0);
+    pthread_mutex_unlock(&g_cb_mu);
+    while(l){
+        rcu_cb_t *nx = l->next;
+        l->fn(l->arg);
+        free(l);
+        l = nx;
+    }
+}
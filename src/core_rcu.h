@@ -0,0 +1,25 @@
+#ifndef PH_CORE_RCU_H
+#define PH_CORE_RCU_H
+
+/* Quiescent-state based reclamation for the broker's event-loop threads
+ * (ph-core only).
+ *
+ * Loop threads read shared routing state without locks. Anything a reader
+ * might still hold (an old routing snapshot, the fd number of a client that
+ * just went away) is handed to rcu_defer() and released only after every
+ * registered thread has passed a quiescent point: the end of an event batch,
+ * or sitting in epoll_wait (offline). */
+
+#define PH_RCU_MAX_THREADS 64
+
+int  rcu_register_thread(void);     /* once per loop thread; -1 when full */
+void rcu_unregister_thread(void);
+void rcu_online(void);              /* after epoll_wait returns */
+void rcu_offline(void);             /* before blocking */
+void rcu_quiescent(void);           /* no references held past this point */
+
+void rcu_defer(void (*fn)(void *arg), void *arg);
+void rcu_poll(void);                /* run callbacks whose grace period ended */
+void rcu_barrier(void);             /* run everything; no readers may be left */
+
+#endif
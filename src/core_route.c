@@ -0,0 +1,103 @@
+#include "core_route.h"
+#include "core_rcu.h"
+#include "core_stats.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+static feedtab_t          *g_tab;
+static ph_route_t *_Atomic g_route;
+static pthread_mutex_t     g_sync_mu = PTHREAD_MUTEX_INITIALIZER;
+
+static void route_release(void *p){ free(p); }
+
+/* one allocation: header, feed entries, slots, subscriber fds, names */
+static ph_route_t *route_build(feedtab_t *t){
+    size_t nsubs = 0, names = 0;
+    for(size_t i = 0; i < t->n; i++){
+        nsubs += t->v[i].subs.n;
+        names += strlen(t->v[i].name) + 1;
+    }
+    size_t sz = sizeof(ph_route_t)
+              + t->n * sizeof(ph_route_feed_t)
+              + t->slot_cap * sizeof(int)
+              + nsubs * sizeof(int)
+              + names;
+    char *blk = (char*)malloc(sz);
+    if(!blk) return NULL;
+
+    ph_route_t      *r  = (ph_route_t*)blk;
+    ph_route_feed_t *fe = (ph_route_feed_t*)(r + 1);
+    int             *sl = (int*)(fe + t->n);
+    int             *sb = sl + t->slot_cap;
+    char            *nm = (char*)(sb + nsubs);
+
+    if(t->slot_cap) memcpy(sl, t->slots, t->slot_cap * sizeof(int));
+    for(size_t i = 0; i < t->n; i++){
+        const feed_t *f = &t->v[i];
+        size_t ln = strlen(f->name) + 1;
+        memcpy(nm, f->name, ln);
+        if(f->subs.n) memcpy(sb, f->subs.v, f->subs.n * sizeof(int));
+        fe[i].hash  = f->hash;
+        fe[i].nsubs = (uint32_t)f->subs.n;
+        fe[i].subs  = sb;
+        fe[i].name  = nm;
+        sb += f->subs.n;
+        nm += ln;
+    }
+    r->gen      = t->gen;
+    r->nfeeds   = t->n;
+    r->slot_cap = t->slot_cap;
+    r->slots    = sl;
+    r->feeds    = fe;
+    return r;
+}
+
+void route_init(feedtab_t *t){
+    g_tab = t;
+    route_sync();
+}
+
+void route_free(void){
+    free(atomic_exchange(&g_route, NULL));
+}
+
+void route_sync(void){
+    if(!g_tab) return;
+    /* g_sync_mu orders publication: a newer build never gets replaced by an older one */
+    pthread_mutex_lock(&g_sync_mu);
+    ph_route_t *cur = atomic_load(&g_route);
+    pthread_mutex_lock(&g_tab->mu);
+    ph_route_t *nr = NULL;
+    if(!cur || cur->gen != g_tab->gen){
+        nr = route_build(g_tab);
+        if(!nr) log_msg(LOG_ERROR, "route: out of memory; keeping previous snapshot");
+    }
+    pthread_mutex_unlock(&g_tab->mu);
+    if(nr){
+        atomic_store(&g_route, nr);
+        stats_feeds_named(nr);
+        if(cur) rcu_defer(route_release, cur);
+    }
+    pthread_mutex_unlock(&g_sync_mu);
+}
+
+const ph_route_t *route_get(void){
+    return atomic_load_explicit(&g_route, memory_order_acquire);
+}
+
+const ph_route_feed_t *route_find(const ph_route_t *r, const char *name){
+    if(!r || !r->slot_cap) return NULL;
+    uint32_t h = feedtab_hash(name);
+    size_t mask = r->slot_cap - 1;
+    for(size_t k = h & mask; r->slots[k] >= 0; k = (k + 1) & mask){
+        const ph_route_feed_t *f = &r->feeds[r->slots[k]];
+        if(f->hash == h && strcmp(f->name, name) == 0) return f;
+    }
+    return NULL;
+}
+
+const ph_route_feed_t *route_at(const ph_route_t *r, uint32_t idx){
+    return (r && idx < r->nfeeds) ? &r->feeds[idx] : NULL;
+}
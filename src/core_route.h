@@ -0,0 +1,42 @@
+#ifndef PH_CORE_ROUTE_H
+#define PH_CORE_ROUTE_H
+
+/* Read-only routing snapshot (ph-core only).
+ *
+ * The feed table stays the mutable, mutex-protected source of truth. After a
+ * change to feeds or subscriptions, route_sync() copies names, hash slots and
+ * subscriber lists into one immutable block and publishes it with a single
+ * pointer swap; the previous block is freed through rcu_defer(). Publishing
+ * threads look feeds up in the snapshot without taking any lock. Feed indices
+ * match the feed table, so binary feed ids route straight to an entry. */
+
+#include "common.h"
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    uint32_t    hash;
+    uint32_t    nsubs;
+    const int  *subs;
+    const char *name;
+} ph_route_feed_t;
+
+typedef struct {
+    uint64_t               gen;       /* feed table generation it was built from */
+    size_t                 nfeeds;
+    size_t                 slot_cap;  /* power of two, or 0 */
+    const int             *slots;     /* feed index or -1 */
+    const ph_route_feed_t *feeds;
+} ph_route_t;
+
+void route_init(feedtab_t *t);
+void route_free(void);
+/* rebuild and publish if the feed table changed since the last snapshot */
+void route_sync(void);
+/* valid until the calling loop thread's next quiescent point */
+const ph_route_t *route_get(void);
+
+const ph_route_feed_t *route_find(const ph_route_t *r, const char *name);
+const ph_route_feed_t *route_at(const ph_route_t *r, uint32_t idx);
+
+#endif
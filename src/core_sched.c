@@ -0,0 +1,362 @@
+#define _GNU_SOURCE
+#include "core_sched.h"
+#include "core_client.h"
+#include "core_stats.h"
+#include "common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <ctype.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#define SCHED_CLASSES 4
+static const char *const k_class[SCHED_CLASSES] = { "rt-io", "dsp", "background", "broker" };
+
+/* ---------- placement rules ---------- */
+
+typedef struct {
+    char      key[48];     /* class or exact thread name */
+    bool      pin;         /* false: the process's original CPU set */
+    bool      spread;      /* one CPU of cpus per thread, round-robin */
+    cpu_set_t cpus;
+    int       policy;      /* SCHED_OTHER, SCHED_FIFO or SCHED_RR */
+    int       prio;        /* FIFO/RR priority */
+    bool      has_nice;
+    int       nice;
+} rule_t;
+
+static rule_t     g_class[SCHED_CLASSES];
+static rule_t    *g_named;          /* per-thread overrides */
+static size_t     g_nnamed;
+static cpu_set_t  g_all;            /* affinity ph-core was started with */
+static atomic_bool g_rt_denied;     /* warn once */
+static atomic_uint g_spread_next;   /* round-robin cursor for spread rules */
+
+static void rule_default(rule_t *r, const char *key){
+    *r = (rule_t){ .policy = SCHED_OTHER };
+    snprintf(r->key, sizeof r->key, "%s", key);
+}
+
+/* "0-3,6" -> set; -1 on syntax or range errors */
+static int cpus_parse(const char *s, cpu_set_t *out){
+    CPU_ZERO(out);
+    while(*s){
+        char *e;
+        long a = strtol(s, &e, 10), b = a;
+        if(e == s || a < 0) return -1;
+        if(*e == '-'){ s = e + 1; b = strtol(s, &e, 10); if(e == s || b < a) return -1; }
+        if(b >= CPU_SETSIZE) return -1;
+        for(long c = a; c <= b; c++) CPU_SET((int)c, out);
+        s = e;
+        if(*s == ',') s++;
+        else if(*s && !isspace((unsigned char)*s)) return -1;
+        else break;
+    }
+    return 0;
+}
+
+static void cpus_fmt(const cpu_set_t *set, char *buf, size_t cap){
+    size_t off = 0;
+    buf[0] = '\0';
+    for(int c = 0; c < CPU_SETSIZE && off < cap; c++){
+        if(!CPU_ISSET(c, set)) continue;
+        int e = c;
+        while(e + 1 < CPU_SETSIZE && CPU_ISSET(e + 1, set)) e++;
+        int n = e > c ? snprintf(buf + off, cap - off, "%s%d-%d", off ? "," : "", c, e)
+                      : snprintf(buf + off, cap - off, "%s%d", off ? "," : "", c);
+        if(n < 0) break;
+        off += (size_t)n;
+        c = e;
+    }
+}
+
+/* isolcpus= / nohz_full CPUs the kernel keeps free of ordinary tasks */
+static void cpus_isolated(cpu_set_t *out){
+    char line[256] = "";
+    CPU_ZERO(out);
+    FILE *f = fopen("/sys/devices/system/cpu/isolated", "r");
+    if(!f) return;
+    if(fgets(line, sizeof line, f)) line[strcspn(line, "\n")] = '\0';
+    fclose(f);
+    if(line[0] && cpus_parse(line, out) < 0) CPU_ZERO(out);
+}
+
+static void cpus_housekeeping(cpu_set_t *out){
+    cpu_set_t iso;
+    cpus_isolated(&iso);
+    CPU_XOR(out, &g_all, &iso);
+    CPU_AND(out, out, &g_all);
+    if(!CPU_COUNT(out)) *out = g_all;
+}
+
+/* "<class|thread> <cpus|isolated|housekeeping|all> [spread] [fifo N|rr N|other|nice N]" */
+static int rule_parse(char *line, rule_t *r){
+    char *save = NULL;
+    char *key  = strtok_r(line, " \t", &save);
+    char *cpus = strtok_r(NULL, " \t", &save);
+    if(!key || !cpus) return -1;
+    rule_default(r, key);
+    if(!strcmp(cpus, "isolated")){
+        cpus_isolated(&r->cpus);
+        r->pin = CPU_COUNT(&r->cpus) > 0;
+    } else if(!strcmp(cpus, "housekeeping")){
+        cpus_housekeeping(&r->cpus);
+        r->pin = true;
+    } else if(strcmp(cpus, "all") && strcmp(cpus, "-")){
+        if(cpus_parse(cpus, &r->cpus) < 0 || !CPU_COUNT(&r->cpus)) return -1;
+        r->pin = true;
+    }
+    for(char *w = strtok_r(NULL, " \t", &save); w; w = strtok_r(NULL, " \t", &save)){
+        if(!strcmp(w, "other")){ r->policy = SCHED_OTHER; continue; }
+        if(!strcmp(w, "spread")){ r->spread = true; continue; }
+        char *v = strtok_r(NULL, " \t", &save);
+        if(!v) return -1;
+        long n = strtol(v, NULL, 10);
+        if(!strcmp(w, "fifo") || !strcmp(w, "rr")){
+            r->policy = !strcmp(w, "fifo") ? SCHED_FIFO : SCHED_RR;
+            r->prio = (int)n;
+            if(n < sched_get_priority_min(r->policy) || n > sched_get_priority_max(r->policy)) return -1;
+        } else if(!strcmp(w, "nice")){
+            if(n < -20 || n > 19) return -1;
+            r->has_nice = true; r->nice = (int)n;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int class_index(const char *key){
+    for(int i = 0; i < SCHED_CLASSES; i++) if(!strcmp(k_class[i], key)) return i;
+    return -1;
+}
+
+/* The scheduler does not balance load across isolated CPUs: a thread pinned
+ * to the whole set stays on whichever one it first ran on. So the defaults
+ * spread rt-io and dsp workers one CPU each. */
+static void rules_defaults(void){
+    for(int i = 0; i < SCHED_CLASSES; i++) rule_default(&g_class[i], k_class[i]);
+    cpu_set_t iso;
+    cpus_isolated(&iso);
+    if(!CPU_COUNT(&iso)) return;
+    char a[128], b[128];
+    cpu_set_t hk;
+    cpus_housekeeping(&hk);
+    g_class[PH_WORKER_RT_IO].pin = g_class[PH_WORKER_DSP].pin = true;
+    g_class[PH_WORKER_RT_IO].spread = g_class[PH_WORKER_DSP].spread = true;
+    g_class[PH_WORKER_RT_IO].cpus = g_class[PH_WORKER_DSP].cpus = iso;
+    g_class[PH_WORKER_BACKGROUND].pin = g_class[SCHED_CLASS_BROKER].pin = true;
+    g_class[PH_WORKER_BACKGROUND].cpus = g_class[SCHED_CLASS_BROKER].cpus = hk;
+    cpus_fmt(&iso, a, sizeof a);
+    cpus_fmt(&hk, b, sizeof b);
+    log_msg(LOG_INFO, "sched: isolated CPUs %s for rt-io/dsp (one per thread), %s for the rest", a, b);
+}
+
+int sched_load(const char *path){
+    if(sched_getaffinity(0, sizeof g_all, &g_all) != 0){
+        CPU_ZERO(&g_all);
+        for(long c = 0, n = sysconf(_SC_NPROCESSORS_ONLN); c < n && c < CPU_SETSIZE; c++) CPU_SET((int)c, &g_all);
+    }
+    if(!path) path = getenv("PH_SCHED_CONF");
+    if(!path || !*path){ rules_defaults(); return 0; }
+
+    FILE *f = fopen(path, "r");
+    if(!f){ log_msg(LOG_ERROR, "sched: %s: %s", path, strerror(errno)); return -1; }
+    for(int i = 0; i < SCHED_CLASSES; i++) rule_default(&g_class[i], k_class[i]);
+    char line[256];
+    int lineno = 0, nrules = 0;
+    while(fgets(line, sizeof line, f)){
+        lineno++;
+        line[strcspn(line, "#\r\n")] = '\0';
+        char *p = line;
+        while(isspace((unsigned char)*p)) p++;
+        if(!*p) continue;
+        rule_t r;
+        if(rule_parse(p, &r) < 0){
+            log_msg(LOG_WARN, "sched: %s:%d: ignored (want: <class|thread> <cpus> [spread] [fifo N|rr N|other|nice N])", path, lineno);
+            continue;
+        }
+        int ci = class_index(r.key);
+        if(ci >= 0){ g_class[ci] = r; nrules++; continue; }
+        rule_t *nv = realloc(g_named, (g_nnamed + 1) * sizeof *nv);
+        if(!nv) break;
+        g_named = nv;
+        g_named[g_nnamed++] = r;
+        nrules++;
+    }
+    fclose(f);
+    log_msg(LOG_INFO, "sched: %d rules from %s", nrules, path);
+    return 0;
+}
+
+/* ---------- registry ---------- */
+
+typedef struct {
+    bool      used;
+    char      name[48];
+    uint32_t  cls;
+    pid_t     tid;
+    clockid_t clk;
+    uint64_t  t0_ns;
+    uint64_t  last_wall, last_cpu;   /* previous `threads` sample */
+} thr_t;
+
+static pthread_mutex_t g_mu = PTHREAD_MUTEX_INITIALIZER;
+static thr_t  *g_thr;
+static size_t  g_nthr;
+
+void sched_free(void){
+    pthread_mutex_lock(&g_mu);
+    free(g_thr); g_thr = NULL; g_nthr = 0;
+    pthread_mutex_unlock(&g_mu);
+    free(g_named); g_named = NULL; g_nnamed = 0;
+}
+
+static const rule_t *rule_for(const char *name, uint32_t cls){
+    for(size_t i = 0; i < g_nnamed; i++) if(!strcmp(g_named[i].key, name)) return &g_named[i];
+    return &g_class[cls < SCHED_CLASSES ? cls : PH_WORKER_BACKGROUND];
+}
+
+/* the n-th CPU of set, wrapping */
+static int cpus_nth(const cpu_set_t *set, unsigned n){
+    int cnt = CPU_COUNT(set);
+    if(cnt <= 0) return -1;
+    n %= (unsigned)cnt;
+    for(int c = 0; c < CPU_SETSIZE; c++) if(CPU_ISSET(c, set) && n-- == 0) return c;
+    return -1;
+}
+
+static void place(const char *name, const rule_t *r, pid_t tid){
+    pthread_t self = pthread_self();
+    const cpu_set_t *set = r->pin ? &r->cpus : &g_all;   /* don't inherit the creator's pin */
+    cpu_set_t one;
+    int c = r->pin && r->spread ? cpus_nth(&r->cpus, atomic_fetch_add(&g_spread_next, 1u)) : -1;
+    if(c >= 0){ CPU_ZERO(&one); CPU_SET(c, &one); set = &one; }
+    if(pthread_setaffinity_np(self, sizeof *set, set) != 0)
+        log_msg(LOG_WARN, "sched: %s: affinity not applied", name);
+    int cur = SCHED_OTHER;
+    struct sched_param sp = {0};
+    pthread_getschedparam(self, &cur, &sp);
+    if(r->policy != SCHED_OTHER || cur != SCHED_OTHER){   /* nor the creator's RT policy */
+        sp.sched_priority = r->prio;
+        int rc = pthread_setschedparam(self, r->policy, &sp);
+        if(rc == EPERM && !atomic_exchange(&g_rt_denied, true))
+            log_msg(LOG_WARN, "sched: %s: %s not permitted (needs CAP_SYS_NICE or an rtprio limit); "
+                    "real-time workers stay SCHED_OTHER", name, r->policy == SCHED_FIFO ? "SCHED_FIFO" : "SCHED_RR");
+        else if(rc && rc != EPERM)
+            log_msg(LOG_WARN, "sched: %s: policy not applied (%s)", name, strerror(rc));
+    }
+    if(r->has_nice && setpriority(PRIO_PROCESS, (id_t)tid, r->nice) != 0)
+        log_msg(LOG_WARN, "sched: %s: nice %d not applied (%s)", name, r->nice, strerror(errno));
+}
+
+int sched_enter(const char *name, uint32_t cls){
+    pid_t tid = (pid_t)syscall(SYS_gettid);
+    if(tid != getpid()){   /* renaming the main thread would rename the process */
+        char comm[16];
+        snprintf(comm, sizeof comm, "%s", name);
+        pthread_setname_np(pthread_self(), comm);
+    }
+    place(name, rule_for(name, cls), tid);
+
+    thr_t t = { .used = true, .cls = cls, .tid = tid, .t0_ns = stats_now_ns() };
+    snprintf(t.name, sizeof t.name, "%s", name);
+    if(pthread_getcpuclockid(pthread_self(), &t.clk) != 0) t.clk = CLOCK_THREAD_CPUTIME_ID;
+    t.last_wall = t.t0_ns;
+
+    int slot = -1;
+    pthread_mutex_lock(&g_mu);
+    for(size_t i = 0; i < g_nthr && slot < 0; i++) if(!g_thr[i].used) slot = (int)i;
+    if(slot < 0){
+        thr_t *nv = realloc(g_thr, (g_nthr + 1) * sizeof *nv);
+        if(nv){ g_thr = nv; slot = (int)g_nthr++; }
+    }
+    if(slot >= 0) g_thr[slot] = t;
+    pthread_mutex_unlock(&g_mu);
+    return slot;
+}
+
+void sched_leave(int slot){
+    if(slot < 0) return;
+    pthread_mutex_lock(&g_mu);
+    if((size_t)slot < g_nthr) g_thr[slot].used = false;
+    pthread_mutex_unlock(&g_mu);
+}
+
+/* ---------- ph_sched_api_t for addons ---------- */
+
+typedef struct {
+    void    *(*fn)(void *);
+    void     *arg;
+    uint32_t  cls;
+    char      name[48];
+} tramp_t;
+
+static void *tramp_main(void *a){
+    tramp_t t = *(tramp_t*)a;
+    free(a);
+    int slot = sched_enter(t.name, t.cls);
+    void *rv = t.fn(t.arg);
+    sched_leave(slot);
+    return rv;
+}
+
+static int api_spawn(pthread_t *th, const char *name, uint32_t cls, void *(*fn)(void *), void *arg){
+    tramp_t *t = (tramp_t*)malloc(sizeof *t);
+    if(!t) return ENOMEM;
+    *t = (tramp_t){ .fn = fn, .arg = arg, .cls = cls };
+    snprintf(t->name, sizeof t->name, "%s", name ? name : "addon");
+    int rc = pthread_create(th, NULL, tramp_main, t);
+    if(rc) free(t);
+    return rc;
+}
+
+const ph_sched_api_t ph_core_sched_api = {
+    .api_size = sizeof(ph_sched_api_t),
+    .spawn    = api_spawn,
+};
+
+/* ---------- `threads` ---------- */
+
+static const char *policy_name(int p){
+    return p == SCHED_FIFO ? "fifo" : p == SCHED_RR ? "rr" : p == SCHED_BATCH ? "batch" : p == SCHED_IDLE ? "idle" : "other";
+}
+
+void sched_report(int fd){
+    char buf[512];
+    pthread_mutex_lock(&g_mu);
+    uint64_t now = stats_now_ns();
+    for(size_t i = 0; i < g_nthr; i++){
+        thr_t *t = &g_thr[i];
+        if(!t->used) continue;
+        struct timespec ts;
+        uint64_t cpu = clock_gettime(t->clk, &ts) == 0 ? (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec : t->last_cpu;
+        double pct = now > t->last_wall ? 100.0 * (double)(cpu - t->last_cpu) / (double)(now - t->last_wall) : 0.0;
+        t->last_wall = now; t->last_cpu = cpu;
+
+        cpu_set_t set;
+        char cpus[128] = "?";
+        if(sched_getaffinity(t->tid, sizeof set, &set) == 0) cpus_fmt(&set, cpus, sizeof cpus);
+        struct sched_param sp = {0};
+        int pol = sched_getscheduler(t->tid);
+        sched_getparam(t->tid, &sp);
+        char esc[96];
+        ph_json_escape_string(t->name, esc, sizeof esc);
+        int n = snprintf(buf, sizeof buf,
+            "{\"type\":\"thread\",\"name\":\"%s\",\"class\":\"%s\",\"tid\":%d,\"cpus\":\"%s\","
+            "\"policy\":\"%s\",\"prio\":%d,\"cpu_ms\":%.1f,\"cpu_pct\":%.1f}",
+            esc, k_class[t->cls < SCHED_CLASSES ? t->cls : PH_WORKER_BACKGROUND], (int)t->tid, cpus,
+            policy_name(pol), sp.sched_priority, (double)cpu / 1e6, pct);
+        if(n > 0 && (size_t)n < sizeof buf) client_reply(fd, buf, (size_t)n);
+    }
+    pthread_mutex_unlock(&g_mu);
+}
@@ -0,0 +1,29 @@
+#ifndef PH_CORE_SCHED_H
+#define PH_CORE_SCHED_H
+
+/* Worker placement (ph-core only).
+ *
+ * Every thread the core starts for itself or for an addon (ph_thread_start)
+ * enters here first. It is named, recorded for `threads`, and given the CPU
+ * set and policy that its own name or its class maps to in the scheduler
+ * config. Without a config, rt-io and dsp workers go to the isolated CPUs
+ * (isolcpus=) and everything else to the housekeeping CPUs; with no isolated
+ * CPUs nothing is pinned. */
+
+#include "ph_sched.h"
+#include <stdint.h>
+
+enum { SCHED_CLASS_BROKER = 3 };   /* core event loops, after PH_WORKER_* */
+
+extern const ph_sched_api_t ph_core_sched_api;
+
+int  sched_load(const char *path);   /* NULL: $PH_SCHED_CONF, else defaults; -1 if unreadable */
+void sched_free(void);
+
+/* name, register and place the calling thread; hand the slot to sched_leave() */
+int  sched_enter(const char *name, uint32_t cls);
+void sched_leave(int slot);
+
+void sched_report(int fd);           /* `threads` */
+
+#endif
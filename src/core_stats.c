@@ -0,0 +1,241 @@
+#define _GNU_SOURCE
+#include "core_stats.h"
+#include "core_client.h"
+#include "ph_shm.h"
+#include "common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+static ph_stats_hdr_t   *g_page;
+static size_t            g_page_bytes;
+static int               g_fd = -1;
+static bool              g_private;     /* no memfd: plain anonymous memory */
+static ph_stats_client_t g_sink;        /* fds past clients_cap */
+
+uint64_t stats_now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static size_t align64(size_t n){ return (n + 63) & ~(size_t)63; }
+
+int stats_init(void){
+    size_t feeds_off   = align64(sizeof(ph_stats_hdr_t));
+    size_t clients_off = align64(feeds_off + (size_t)PH_STATS_FEEDS * sizeof(ph_stats_feed_t));
+    size_t bytes       = align64(clients_off + (size_t)PH_STATS_CLIENTS * sizeof(ph_stats_client_t));
+
+    /* pages are only backed once touched, so the generous caps cost nothing idle */
+    void *p = MAP_FAILED;
+    int fd = ph_shm_create_fd("phasehound-stats", bytes);
+    if(fd >= 0){
+        p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if(p == MAP_FAILED){ close(fd); fd = -1; }
+    }
+    if(p == MAP_FAILED){
+        log_msg(LOG_WARN, "stats: no shared page (%s); `stats` still works", strerror(errno));
+        p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(p == MAP_FAILED) return -1;
+        g_private = true;
+    }
+
+    ph_stats_hdr_t *h = (ph_stats_hdr_t*)p;
+    h->magic       = PH_STATS_MAGIC;
+    h->ver_major   = PH_STATS_VMAJOR;
+    h->ver_minor   = PH_STATS_VMINOR;
+    h->feeds_cap   = PH_STATS_FEEDS;
+    h->clients_cap = PH_STATS_CLIENTS;
+    h->page_bytes  = bytes;
+    h->feeds_off   = feeds_off;
+    h->clients_off = clients_off;
+    h->start_ns    = stats_now_ns();
+    g_page = h; g_page_bytes = bytes; g_fd = fd;
+    return 0;
+}
+
+void stats_free(void){
+    if(g_page) munmap(g_page, g_page_bytes);
+    if(g_fd >= 0) close(g_fd);
+    g_page = NULL; g_fd = -1;
+}
+
+int    stats_fd(void){ return g_private ? -1 : g_fd; }
+size_t stats_page_bytes(void){ return g_page_bytes; }
+
+void stats_feeds_named(const ph_route_t *r){
+    if(!g_page || !r) return;
+    uint32_t have = atomic_load_explicit(&g_page->nfeeds, memory_order_relaxed);
+    size_t   want = r->nfeeds < PH_STATS_FEEDS ? r->nfeeds : PH_STATS_FEEDS;
+    if(want <= have) return;
+    ph_stats_feed_t *f = ph_stats_feeds(g_page);
+    for(size_t i = have; i < want; i++)
+        snprintf(f[i].name, sizeof f[i].name, "%s", r->feeds[i].name);
+    atomic_store_explicit(&g_page->nfeeds, (uint32_t)want, memory_order_release);
+}
+
+static unsigned hist_bucket(uint64_t ns){
+    unsigned b = ns ? 63u - (unsigned)__builtin_clzll(ns) : 0;
+    return b < PH_STATS_HIST ? b : PH_STATS_HIST - 1;
+}
+
+void stats_publish(uint32_t feed, size_t bytes, size_t nfds, uint32_t nsubs, uint64_t route_ns){
+    ph_stats_hdr_t *h = g_page;
+    if(!h) return;
+    stats_add(&h->pubs, 1);
+    stats_add(&h->bytes, bytes);
+    if(nfds) stats_add(&h->fds, nfds);
+    stats_add(&h->deliveries, nsubs);
+    stats_add(&h->route_n, 1);
+    stats_add(&h->route_ns, route_ns);
+    stats_add(&h->route_hist[hist_bucket(route_ns)], 1);
+    if(feed < PH_STATS_FEEDS){
+        ph_stats_feed_t *f = &ph_stats_feeds(h)[feed];
+        stats_add(&f->pubs, 1);
+        stats_add(&f->bytes, bytes);
+        if(nfds) stats_add(&f->fds, nfds);
+        stats_add(&f->deliveries, nsubs);
+    }
+}
+
+ph_stats_client_t *stats_client_open(int fd, int loop, bool inproc){
+    if(!g_page || fd < 0 || fd >= PH_STATS_CLIENTS) return &g_sink;
+    ph_stats_client_t *c = &ph_stats_clients(g_page)[fd];
+    atomic_fetch_add_explicit(&c->seq, 1, memory_order_acq_rel);   /* odd: resetting */
+    c->loop = (uint32_t)loop;
+    c->link = inproc ? PH_STATS_LINK_INPROC : PH_STATS_LINK_UDS;
+    atomic_store_explicit(&c->tx_frames,  0, memory_order_relaxed);
+    atomic_store_explicit(&c->tx_bytes,   0, memory_order_relaxed);
+    atomic_store_explicit(&c->rx_frames,  0, memory_order_relaxed);
+    atomic_store_explicit(&c->rx_bytes,   0, memory_order_relaxed);
+    atomic_store_explicit(&c->blocked_ns, 0, memory_order_relaxed);
+    atomic_store_explicit(&c->dropped,    0, memory_order_relaxed);
+    atomic_store_explicit(&c->active, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&c->seq, 1, memory_order_release);
+    return c;
+}
+
+void stats_client_close(int fd){
+    if(!g_page || fd < 0 || fd >= PH_STATS_CLIENTS) return;
+    ph_stats_client_t *c = &ph_stats_clients(g_page)[fd];
+    atomic_fetch_add_explicit(&c->seq, 1, memory_order_acq_rel);
+    atomic_store_explicit(&c->active, 0, memory_order_relaxed);
+    atomic_fetch_add_explicit(&c->seq, 1, memory_order_release);
+}
+
+/* ---------- `stats` ---------- */
+
+static uint64_t ld(_Atomic uint64_t *c){ return atomic_load_explicit(c, memory_order_relaxed); }
+
+/* upper edge of the bucket holding quantile q */
+static uint64_t hist_quantile(const uint64_t *b, uint64_t n, double q){
+    if(!n) return 0;
+    uint64_t want = (uint64_t)(q * (double)n), acc = 0;
+    for(unsigned i = 0; i < PH_STATS_HIST; i++){
+        acc += b[i];
+        if(acc > want) return 2ull << i;
+    }
+    return 2ull << (PH_STATS_HIST - 1);
+}
+
+/* Feed and client rows go out as {"type":"stats","<key>":[...]} frames, as
+ * many rows per frame as fit, so a busy broker answers in a few frames
+ * instead of one per row against the asker's queue limit. */
+typedef struct {
+    int         fd;
+    const char *key;
+    size_t      pos, n;
+    char        buf[POC_MAX_JSON];
+} stats_batch_t;
+
+static void batch_flush(stats_batch_t *b){
+    if(!b->n) return;
+    b->buf[b->pos++] = ']';
+    b->buf[b->pos++] = '}';
+    client_reply(b->fd, b->buf, b->pos);
+    b->pos = b->n = 0;
+}
+
+static void batch_add(stats_batch_t *b, const char *row, int len){
+    if(len <= 0 || (size_t)len >= sizeof b->buf / 2) return;
+    if(b->n && b->pos + 1 + (size_t)len + 2 > sizeof b->buf) batch_flush(b);
+    if(!b->n) b->pos = (size_t)snprintf(b->buf, sizeof b->buf, "{\"type\":\"stats\",\"%s\":[", b->key);
+    else      b->buf[b->pos++] = ',';
+    memcpy(b->buf + b->pos, row, (size_t)len);
+    b->pos += (size_t)len;
+    b->n++;
+}
+
+static void client_row(int i, void *arg){
+    stats_batch_t *b = (stats_batch_t*)arg;
+    if(i >= PH_STATS_CLIENTS || !client_known(i)) return;
+    ph_stats_client_t *c = &ph_stats_clients(g_page)[i];
+    if(!atomic_load_explicit(&c->active, memory_order_acquire)) return;
+    char row[512];
+    int n = snprintf(row, sizeof row,
+        "{\"fd\":%d,\"loop\":%u,\"link\":\"%s\",\"tx_frames\":%llu,\"tx_bytes\":%llu,"
+        "\"rx_frames\":%llu,\"rx_bytes\":%llu,\"blocked_ms\":%.3f,\"dropped\":%llu}",
+        i, c->loop, c->link == PH_STATS_LINK_INPROC ? "inproc" : "uds",
+        (unsigned long long)ld(&c->tx_frames), (unsigned long long)ld(&c->tx_bytes),
+        (unsigned long long)ld(&c->rx_frames), (unsigned long long)ld(&c->rx_bytes),
+        ld(&c->blocked_ns) / 1e6, (unsigned long long)ld(&c->dropped));
+    if((size_t)n < sizeof row) batch_add(b, row, n);
+}
+
+void stats_report(int fd){
+    ph_stats_hdr_t *h = g_page;
+    if(!h){
+        const char *e = "{\"type\":\"error\",\"msg\":\"stats unavailable\"}";
+        client_reply(fd, e, strlen(e));
+        return;
+    }
+    char buf[1024];
+    uint64_t hist[PH_STATS_HIST];
+    for(unsigned i = 0; i < PH_STATS_HIST; i++) hist[i] = ld(&h->route_hist[i]);
+    uint64_t rn = ld(&h->route_n);
+    int n = snprintf(buf, sizeof buf,
+        "{\"type\":\"stats\",\"uptime_ms\":%llu,\"publishes\":%llu,\"bytes\":%llu,\"fds\":%llu,"
+        "\"deliveries\":%llu,\"route_ns\":{\"n\":%llu,\"mean\":%llu,\"p50\":%llu,\"p99\":%llu,\"p999\":%llu},"
+        "\"shm\":\"%s\",\"shm_bytes\":%zu}",
+        (unsigned long long)((stats_now_ns() - h->start_ns) / 1000000ull),
+        (unsigned long long)ld(&h->pubs), (unsigned long long)ld(&h->bytes),
+        (unsigned long long)ld(&h->fds), (unsigned long long)ld(&h->deliveries),
+        (unsigned long long)rn, (unsigned long long)(rn ? ld(&h->route_ns) / rn : 0),
+        (unsigned long long)hist_quantile(hist, rn, 0.50),
+        (unsigned long long)hist_quantile(hist, rn, 0.99),
+        (unsigned long long)hist_quantile(hist, rn, 0.999),
+        g_private ? "" : PH_STATS_FEED, g_page_bytes);
+    if(n > 0 && (size_t)n < sizeof buf) client_reply(fd, buf, (size_t)n);
+
+    stats_batch_t *b = (stats_batch_t*)malloc(sizeof *b);
+    if(!b) return;
+    b->fd = fd; b->pos = b->n = 0;
+
+    b->key = "feeds";
+    const ph_route_t *r = route_get();
+    uint32_t nf = atomic_load_explicit(&h->nfeeds, memory_order_acquire);
+    ph_stats_feed_t *f = ph_stats_feeds(h);
+    for(uint32_t i = 0; i < nf; i++){
+        char esc[PH_STATS_NAME * 2];
+        ph_json_escape_string(f[i].name, esc, sizeof esc);
+        const ph_route_feed_t *rf = route_at(r, i);
+        n = snprintf(buf, sizeof buf,
+            "{\"feed\":\"%s\",\"subs\":%u,\"pubs\":%llu,\"bytes\":%llu,"
+            "\"fds\":%llu,\"deliveries\":%llu}",
+            esc, rf ? rf->nsubs : 0u,
+            (unsigned long long)ld(&f[i].pubs), (unsigned long long)ld(&f[i].bytes),
+            (unsigned long long)ld(&f[i].fds), (unsigned long long)ld(&f[i].deliveries));
+        if(n > 0 && (size_t)n < sizeof buf) batch_add(b, buf, n);
+    }
+    batch_flush(b);
+
+    b->key = "clients";
+    clients_each(client_row, b);
+    batch_flush(b);
+    free(b);
+}
@@ -0,0 +1,39 @@
+#ifndef PH_CORE_STATS_H
+#define PH_CORE_STATS_H
+
+/* Broker metrics (ph-core only).
+ *
+ * The counters live in the shared stats page itself (ph_stats.h), so the
+ * event loops update them with relaxed atomic adds and neither the `stats`
+ * command nor an external scraper ever takes a lock the loops use. */
+
+#include "ph_stats.h"
+#include "core_route.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+int  stats_init(void);          /* map the page; -1 keeps counting into a private one */
+void stats_free(void);
+int  stats_fd(void);            /* memfd to announce, or -1 */
+size_t stats_page_bytes(void);
+
+uint64_t stats_now_ns(void);
+
+/* name feed entries added by a new routing snapshot (route_sync, serialised) */
+void stats_feeds_named(const ph_route_t *r);
+/* one routed publish: body bytes, attached fds, subscribers reached, time spent */
+void stats_publish(uint32_t feed, size_t bytes, size_t nfds, uint32_t nsubs, uint64_t route_ns);
+
+/* slot for a new connection on fd; never NULL (untracked fds share a sink) */
+ph_stats_client_t *stats_client_open(int fd, int loop, bool inproc);
+void               stats_client_close(int fd);
+
+static inline void stats_add(_Atomic uint64_t *c, uint64_t v){
+    atomic_fetch_add_explicit(c, v, memory_order_relaxed);
+}
+
+/* `stats`: totals and routing latency, then one frame per feed and per client */
+void stats_report(int fd);
+
+#endif
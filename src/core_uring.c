@@ -0,0 +1,182 @@
+#define _GNU_SOURCE
+#include "core_uring.h"
+
+#include <errno.h>
+
+#ifdef PH_HAVE_URING
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+struct ph_uring {
+    int       fd;
+    /* submission ring */
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned  sq_entries;
+    unsigned  sq_local;       /* our tail, published on submit */
+    unsigned  to_submit;
+    struct io_uring_sqe *sqes;
+    /* completion ring */
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+    /* mappings */
+    void     *sq_map, *cq_map;
+    size_t    sq_map_sz, cq_map_sz, sqes_sz;
+};
+
+/* the rings are shared with the kernel: head/tail need acquire/release */
+static unsigned ring_load(unsigned *p){
+    return atomic_load_explicit((_Atomic unsigned*)p, memory_order_acquire);
+}
+static void ring_store(unsigned *p, unsigned v){
+    atomic_store_explicit((_Atomic unsigned*)p, v, memory_order_release);
+}
+
+static int sys_setup(unsigned entries, struct io_uring_params *p){
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_enter(int fd, unsigned submit, unsigned wait, unsigned flags){
+    return (int)syscall(__NR_io_uring_enter, fd, submit, wait, flags, NULL, 0);
+}
+
+static int ring_fd(unsigned entries, struct io_uring_params *p){
+    /* ask for the cheap modes first: one issuer thread, no IPI task work,
+     * keep submitting past a failed SQE; older kernels reject unknown flags */
+    memset(p, 0, sizeof *p);
+#if defined(IORING_SETUP_SUBMIT_ALL) && defined(IORING_SETUP_COOP_TASKRUN) && defined(IORING_SETUP_SINGLE_ISSUER)
+    p->flags = IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN | IORING_SETUP_SINGLE_ISSUER;
+    int fd = sys_setup(entries, p);
+    if(fd >= 0 || errno != EINVAL) return fd;
+    memset(p, 0, sizeof *p);
+#endif
+    return sys_setup(entries, p);
+}
+
+ph_uring_t *uring_open(unsigned entries){
+    struct io_uring_params p;
+    int fd = ring_fd(entries, &p);
+    if(fd < 0) return NULL;
+
+    ph_uring_t *r = (ph_uring_t*)calloc(1, sizeof *r);
+    if(!r){ close(fd); errno = ENOMEM; return NULL; }
+    r->fd = fd;
+    r->sq_entries = p.sq_entries;
+    r->sq_map_sz  = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_map_sz  = p.cq_off.cqes  + p.cq_entries * sizeof(struct io_uring_cqe);
+    r->sqes_sz    = p.sq_entries * sizeof(struct io_uring_sqe);
+
+    bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if(single && r->cq_map_sz > r->sq_map_sz) r->sq_map_sz = r->cq_map_sz;
+    r->sq_map = mmap(NULL, r->sq_map_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     fd, IORING_OFF_SQ_RING);
+    if(r->sq_map == MAP_FAILED){ r->sq_map = NULL; goto fail; }
+    if(single) r->cq_map = r->sq_map;
+    else {
+        r->cq_map = mmap(NULL, r->cq_map_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         fd, IORING_OFF_CQ_RING);
+        if(r->cq_map == MAP_FAILED){ r->cq_map = NULL; goto fail; }
+    }
+    r->sqes = (struct io_uring_sqe*)mmap(NULL, r->sqes_sz, PROT_READ | PROT_WRITE,
+                                         MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if(r->sqes == MAP_FAILED){ r->sqes = NULL; goto fail; }
+
+    char *sq = (char*)r->sq_map, *cq = (char*)r->cq_map;
+    r->sq_head  = (unsigned*)(sq + p.sq_off.head);
+    r->sq_tail  = (unsigned*)(sq + p.sq_off.tail);
+    r->sq_mask  = (unsigned*)(sq + p.sq_off.ring_mask);
+    r->sq_array = (unsigned*)(sq + p.sq_off.array);
+    r->cq_head  = (unsigned*)(cq + p.cq_off.head);
+    r->cq_tail  = (unsigned*)(cq + p.cq_off.tail);
+    r->cq_mask  = (unsigned*)(cq + p.cq_off.ring_mask);
+    r->cqes     = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+    r->sq_local = *r->sq_tail;
+    return r;
+
+fail:;
+    int e = errno;
+    uring_close(r);
+    errno = e;
+    return NULL;
+}
+
+void uring_close(ph_uring_t *r){
+    if(!r) return;
+    if(r->sqes) munmap(r->sqes, r->sqes_sz);
+    if(r->cq_map && r->cq_map != r->sq_map) munmap(r->cq_map, r->cq_map_sz);
+    if(r->sq_map) munmap(r->sq_map, r->sq_map_sz);
+    close(r->fd);
+    free(r);
+}
+
+unsigned uring_capacity(const ph_uring_t *r){ return r ? r->sq_entries : 0; }
+
+int uring_prep_sendmsg(ph_uring_t *r, int fd, const struct msghdr *msg,
+                       unsigned flags, uint64_t user_data){
+    if(r->sq_local - ring_load(r->sq_head) >= r->sq_entries){ errno = EBUSY; return -1; }
+    unsigned idx = r->sq_local & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[idx];
+    memset(sqe, 0, sizeof *sqe);
+    sqe->opcode    = IORING_OP_SENDMSG;
+    sqe->fd        = fd;
+    sqe->addr      = (uint64_t)(uintptr_t)msg;
+    sqe->len       = 1;
+    sqe->msg_flags = flags;
+    sqe->user_data = user_data;
+    r->sq_array[idx] = idx;
+    r->sq_local++;
+    r->to_submit++;
+    return 0;
+}
+
+int uring_submit_wait(ph_uring_t *r, unsigned n){
+    ring_store(r->sq_tail, r->sq_local);
+    unsigned submit = r->to_submit;
+    while(submit || n){
+        int rc = sys_enter(r->fd, submit, n, n ? IORING_ENTER_GETEVENTS : 0);
+        if(rc < 0){
+            if(errno == EINTR) continue;
+            return -1;
+        }
+        submit -= (unsigned)rc < submit ? (unsigned)rc : submit;
+        unsigned ready = ring_load(r->cq_tail) - *r->cq_head;
+        if(ready >= n) break;
+    }
+    r->to_submit = 0;
+    return 0;
+}
+
+int uring_next_cqe(ph_uring_t *r, uint64_t *user_data, int32_t *res){
+    unsigned head = *r->cq_head;
+    if(head == ring_load(r->cq_tail)) return 0;
+    const struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+    *user_data = cqe->user_data;
+    *res       = cqe->res;
+    ring_store(r->cq_head, head + 1);
+    return 1;
+}
+
+#else /* !PH_HAVE_URING */
+
+ph_uring_t *uring_open(unsigned entries){ (void)entries; errno = ENOSYS; return NULL; }
+void uring_close(ph_uring_t *r){ (void)r; }
+unsigned uring_capacity(const ph_uring_t *r){ (void)r; return 0; }
+int uring_prep_sendmsg(ph_uring_t *r, int fd, const struct msghdr *msg,
+                       unsigned flags, uint64_t user_data){
+    (void)r; (void)fd; (void)msg; (void)flags; (void)user_data;
+    errno = ENOSYS;
+    return -1;
+}
+int uring_submit_wait(ph_uring_t *r, unsigned n){ (void)r; (void)n; errno = ENOSYS; return -1; }
+int uring_next_cqe(ph_uring_t *r, uint64_t *user_data, int32_t *res){
+    (void)r; (void)user_data; (void)res;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef PH_CORE_URING_H
+#define PH_CORE_URING_H
+
+/* Minimal io_uring submission ring for the broker's outbound path (ph-core
+ * only). Raw syscalls, no liburing: one ring per event-loop thread, used to
+ * push every frame queued by a publish or an event batch to all its sockets with a
+ * single io_uring_enter() instead of one sendmsg() per subscriber.
+ *
+ * Built when <linux/io_uring.h> is available and PH_NO_URING is not defined
+ * (make URING=0). Without it, or when the kernel refuses io_uring_setup()
+ * (old kernel, seccomp, sysctl), uring_open() returns NULL and callers keep
+ * the plain epoll + sendmsg() path. */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#if !defined(PH_NO_URING) && defined(__linux__) && defined(__has_include)
+#  if __has_include(<linux/io_uring.h>)
+#    define PH_HAVE_URING 1
+#  endif
+#endif
+
+typedef struct ph_uring ph_uring_t;
+
+/* NULL (errno set) when io_uring is compiled out or unavailable */
+ph_uring_t *uring_open(unsigned entries);
+void        uring_close(ph_uring_t *r);
+unsigned    uring_capacity(const ph_uring_t *r);
+
+/* Queue a sendmsg SQE; msg and everything it points to must stay valid until
+ * the completion is reaped. -1 when the submission queue is full. */
+int uring_prep_sendmsg(ph_uring_t *r, int fd, const struct msghdr *msg,
+                       unsigned flags, uint64_t user_data);
+/* submit everything queued and wait until n completions are available */
+int uring_submit_wait(ph_uring_t *r, unsigned n);
+/* 1 and the next completion, or 0 when the completion queue is empty */
+int uring_next_cqe(ph_uring_t *r, uint64_t *user_data, int32_t *res);
+
+#endif
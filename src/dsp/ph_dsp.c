@@ -1,5 +1,8 @@
 #include "ph_dsp.h"
+#include "ph_stream.h"
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -40,6 +43,164 @@ void ph_dsp_nco_f32_next(ph_dsp_nco_f32_t *nco, float *c, float *s) {
     *s = nco->s;
 }
 
+void ph_dsp_nco_f32_fill(ph_dsp_nco_f32_t *nco, float *c, float *s, size_t n) {
+    for (size_t i = 0; i < n; i++) ph_dsp_nco_f32_next(nco, &c[i], &s[i]);
+}
+
+/* ---------- IQ sample widening ---------- */
+size_t ph_dsp_iq_to_cf32(uint32_t fmt, const void *src, float *dst, size_t n) {
+    const size_t m = 2 * n;
+    switch (fmt) {
+    case PHIQ_FMT_CF32:
+        if (dst != src) memcpy(dst, src, m * sizeof(float));
+        return n;
+    case PHIQ_FMT_CS16: {
+        const int16_t *s = (const int16_t *)src;
+        for (size_t i = 0; i < m; i++) dst[i] = (float)s[i] * (1.0f / 32768.0f);
+        return n;
+    }
+    case PHIQ_FMT_CU8: {
+        const uint8_t *s = (const uint8_t *)src;
+        for (size_t i = 0; i < m; i++) dst[i] = ((float)s[i] - 127.5f) * (1.0f / 128.0f);
+        return n;
+    }
+    case PHIQ_FMT_CS8: {
+        const int8_t *s = (const int8_t *)src;
+        for (size_t i = 0; i < m; i++) dst[i] = (float)s[i] * (1.0f / 128.0f);
+        return n;
+    }
+    default:
+        return 0;
+    }
+}
+
+/* ---------- fractional polyphase resampler ---------- */
+#define PH_RESAMP_PHASES 128
+
+static double resamp_kernel(double t, double fc, double half) {
+    /* windowed sinc, fc in cycles/input sample, Blackman window over [-half, half] */
+    if (fabs(t) >= half) return 0.0;
+    double x = 2.0 * fc * t;
+    double sinc = (fabs(x) < 1e-12) ? 1.0 : sin(M_PI * x) / (M_PI * x);
+    double w = 0.42 + 0.5 * cos(M_PI * t / half) + 0.08 * cos(2.0 * M_PI * t / half);
+    return 2.0 * fc * sinc * w;
+}
+
+void ph_dsp_resamp_f32_reset(ph_dsp_resamp_f32_t *r) {
+    if (!r || !r->hist) return;
+    /* Prime with zeros so the first output is centred on the first input. */
+    r->hist_n = (size_t)(r->ntaps / 2 - 1);
+    memset(r->hist, 0, r->hist_n * r->channels * sizeof(float));
+    r->pos = 0.0;
+}
+
+int ph_dsp_resamp_f32_init(ph_dsp_resamp_f32_t *r, unsigned channels,
+                           double fs_in, double fs_out, int ntaps) {
+    if (!r) return -1;
+    memset(r, 0, sizeof *r);
+    if (!(fs_in > 0.0) || !(fs_out > 0.0) || channels == 0) return -1;
+    if (ntaps < 8) ntaps = 8;
+    ntaps = (ntaps + 1) & ~1;   /* even: symmetric around the fractional point */
+    r->ntaps = ntaps;
+    r->nphases = PH_RESAMP_PHASES;
+    r->channels = channels;
+    r->step = fs_in / fs_out;
+
+    r->bank = (float *)malloc((size_t)(r->nphases + 1) * (size_t)ntaps * sizeof(float));
+    r->hist_cap = 4096;
+    r->hist = (float *)malloc(r->hist_cap * channels * sizeof(float));
+    if (!r->bank || !r->hist) { ph_dsp_resamp_f32_free(r); return -1; }
+
+    /* 0.45 of the lower Nyquist keeps the transition band inside the spectrum */
+    double fc = 0.45 * (fs_out < fs_in ? fs_out / fs_in : 1.0);
+    double half = (double)ntaps / 2.0;
+    for (int p = 0; p <= r->nphases; p++) {
+        double f = (double)p / (double)r->nphases;
+        float *h = r->bank + (size_t)p * (size_t)ntaps;
+        double sum = 0.0;
+        for (int k = 0; k < ntaps; k++) {
+            double v = resamp_kernel(half - 1.0 + f - (double)k, fc, half);
+            h[k] = (float)v;
+            sum += v;
+        }
+        if (sum != 0.0)
+            for (int k = 0; k < ntaps; k++) h[k] = (float)(h[k] / sum);
+    }
+    ph_dsp_resamp_f32_reset(r);
+    return 0;
+}
+
+void ph_dsp_resamp_f32_free(ph_dsp_resamp_f32_t *r) {
+    if (!r) return;
+    free(r->bank);
+    free(r->hist);
+    memset(r, 0, sizeof *r);
+}
+
+void ph_dsp_resamp_f32_set_ratio(ph_dsp_resamp_f32_t *r, double ratio) {
+    if (!r || !(ratio > 0.0)) return;
+    r->step = 1.0 / ratio;
+}
+
+size_t ph_dsp_resamp_f32_max_out(const ph_dsp_resamp_f32_t *r, size_t n_in) {
+    if (!r || !(r->step > 0.0)) return 0;
+    return (size_t)((double)(r->hist_n + n_in) / r->step) + 2;
+}
+
+size_t ph_dsp_resamp_f32_process(ph_dsp_resamp_f32_t *r, const float *in, size_t n_in,
+                                 float *out, size_t out_cap) {
+    if (!r || !r->bank || !out) return 0;
+    const size_t ch = r->channels;
+    const int K = r->ntaps;
+
+    if (in && n_in) {
+        if (r->hist_n + n_in > r->hist_cap) {
+            size_t ncap = r->hist_cap;
+            while (ncap < r->hist_n + n_in) ncap <<= 1;
+            float *p = (float *)realloc(r->hist, ncap * ch * sizeof(float));
+            if (!p) return 0;
+            r->hist = p;
+            r->hist_cap = ncap;
+        }
+        memcpy(r->hist + r->hist_n * ch, in, n_in * ch * sizeof(float));
+        r->hist_n += n_in;
+    }
+
+    size_t out_n = 0;
+    while (out_n < out_cap) {
+        size_t i = (size_t)r->pos;
+        if (i + (size_t)K > r->hist_n) break;
+        double fp = (r->pos - (double)i) * (double)r->nphases;
+        int p = (int)fp;
+        if (p >= r->nphases) p = r->nphases - 1;
+        float a = (float)(fp - (double)p);
+        const float *h0 = r->bank + (size_t)p * (size_t)K;
+        const float *h1 = h0 + K;
+        const float *x = r->hist + i * ch;
+        for (size_t c = 0; c < ch; c++) {
+            float acc0 = 0.0f, acc1 = 0.0f;
+            for (int k = 0; k < K; k++) {
+                float v = x[(size_t)k * ch + c];
+                acc0 += h0[k] * v;
+                acc1 += h1[k] * v;
+            }
+            out[out_n * ch + c] = acc0 + a * (acc1 - acc0);
+        }
+        out_n++;
+        r->pos += r->step;
+    }
+
+    /* drop frames no future output can reach */
+    size_t drop = (size_t)r->pos;
+    if (drop > r->hist_n) drop = r->hist_n;
+    if (drop) {
+        memmove(r->hist, r->hist + drop * ch, (r->hist_n - drop) * ch * sizeof(float));
+        r->hist_n -= drop;
+        r->pos -= (double)drop;
+    }
+    return out_n;
+}
+
 static void fft_bitrev(float *buf, int N) {
     for (int i = 1, j = 0; i < N; i++) {
         int bit = N >> 1;
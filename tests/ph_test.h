@@ -0,0 +1,28 @@
+#pragma once
+/* Minimal checks for the standalone unit tests under tests/.
+ *
+ * Each test is one program that links only the sources it exercises. A
+ * failed CHECK reports file:line and the expression and carries on, so one
+ * run shows every broken property; main returns ph_test_done(). */
+#include <math.h>
+#include <stdio.h>
+
+static int ph_test_failed;
+
+#define CHECK(c) do{ \
+    if(!(c)){ fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #c); ph_test_failed++; } \
+}while(0)
+
+#define CHECK_NEAR(a, b, tol) do{ \
+    double a_ = (double)(a), b_ = (double)(b); \
+    if(!(fabs(a_ - b_) <= (double)(tol))){ \
+        fprintf(stderr, "%s:%d: %s = %g, want %s = %g (tol %g)\n", \
+                __FILE__, __LINE__, #a, a_, #b, b_, (double)(tol)); \
+        ph_test_failed++; \
+    } \
+}while(0)
+
+static inline int ph_test_done(const char *name){
+    fprintf(stderr, "%-14s %s\n", name, ph_test_failed ? "FAIL" : "ok");
+    return ph_test_failed ? 1 : 0;
+}
@@ -0,0 +1,73 @@
+#include "core_autoload.h"
+#include "ph_test.h"
+
+#include <stddef.h>
+
+/* Autoload start waves from caps.consumes/caps.produces. The lists below
+ * mirror what the bundled addons declare. */
+
+static const char *DUMMY_C[]  = { "dummy.config.in", NULL };
+static const char *DUMMY_P[]  = { "dummy.config.out", "dummy.foo", NULL };
+static const char *READER_C[] = { "reader.config.in", "dummy.foo", NULL };
+static const char *READER_P[] = { "reader.config.out", NULL };
+
+static const char *SOAPY_C[] = { "soapy.config.in", NULL };
+static const char *SOAPY_P[] = { "soapy.config.out", "soapy.IQ-info", NULL };
+static const char *WFMD_C[]  = { "wfmd.config.in", "soapy.IQ-info", "filesource.IQ-info", NULL };
+static const char *WFMD_P[]  = { "wfmd.config.out", "wfmd.audio-info", NULL };
+static const char *AU_C[]    = { "audiosink.config.in", "wfmd.audio-info", "filesource.audio-info", NULL };
+static const char *AU_P[]    = { "audiosink.config.out", NULL };
+
+static void test_producer_first(void){
+    /* consumer listed first still starts after its producer */
+    const char *const *cons[] = { READER_C, DUMMY_C };
+    const char *const *prod[] = { READER_P, DUMMY_P };
+    bool live[] = { true, true }, cyc[2];
+    int wave[2];
+    CHECK(autoload_waves(2, cons, prod, live, wave, cyc) == 2);
+    CHECK(wave[1] == 0 && wave[0] == 1);
+    CHECK(!cyc[0] && !cyc[1]);
+
+    /* producer failed to init: nothing to wait for */
+    live[1] = false;
+    CHECK(autoload_waves(2, cons, prod, live, wave, NULL) == 1);
+    CHECK(wave[0] == 0 && wave[1] == -1);
+}
+
+static void test_chain(void){
+    /* audiosink <- wfmd <- soapy, plus two independent addons */
+    const char *const *cons[] = { AU_C, DUMMY_C, WFMD_C, SOAPY_C, READER_C };
+    const char *const *prod[] = { AU_P, DUMMY_P, WFMD_P, SOAPY_P, READER_P };
+    bool live[] = { true, true, true, true, true };
+    int wave[5];
+    CHECK(autoload_waves(5, cons, prod, live, wave, NULL) == 3);
+    CHECK(wave[3] == 0 && wave[2] == 1 && wave[0] == 2);
+    CHECK(wave[1] == 0 && wave[4] == 1);
+
+    /* no IQ producer loaded: wfmd and audiosink are not held back by it */
+    live[3] = false;
+    CHECK(autoload_waves(5, cons, prod, live, wave, NULL) == 2);
+    CHECK(wave[2] == 0 && wave[0] == 1 && wave[3] == -1);
+}
+
+static void test_cycle(void){
+    static const char *A_C[] = { "b.out", NULL }, *A_P[] = { "a.out", NULL };
+    static const char *B_C[] = { "a.out", NULL }, *B_P[] = { "b.out", NULL };
+    static const char *C_C[] = { "b.out", NULL }, *C_P[] = { "c.out", NULL };
+    const char *const *cons[] = { A_C, B_C, C_C, DUMMY_C, NULL };
+    const char *const *prod[] = { A_P, B_P, C_P, DUMMY_P, NULL };
+    bool live[] = { true, true, true, true, true }, cyc[5];
+    int wave[5];
+    /* a <-> b, and c behind them, go last, after dummy and the caps-less one */
+    CHECK(autoload_waves(5, cons, prod, live, wave, cyc) == 2);
+    CHECK(wave[3] == 0 && wave[4] == 0 && !cyc[3] && !cyc[4]);
+    CHECK(wave[0] == 1 && wave[1] == 1 && wave[2] == 1);
+    CHECK(cyc[0] && cyc[1] && cyc[2]);
+}
+
+int main(void){
+    test_producer_first();
+    test_chain();
+    test_cycle();
+    return ph_test_done("test_autoload");
+}
@@ -0,0 +1,105 @@
+#include "audiosink.h"
+#include "ph_dsp.h"
+#include "ph_test.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Clock-drift compensation in audiosink: the PI controller (audiosink_drift.c)
+ * steering the fractional resampler (ph_dsp.c). The controller runs against
+ * a simulated producer/DAC clock pair; the resampler is checked for ratio,
+ * gain and live retuning. */
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* Producer runs ppm fast; the sink drains its buffer at 48 kHz * (1 + corr),
+ * as play_drift does. Returns the final correction; *lat_ms the final latency. */
+static double simulate(double ppm, double start_ms, double secs, double *lat_ms){
+    static audiosink_t s;
+    memset(&s, 0, sizeof s);
+    s.target_ms = 30.0;
+    au_drift_reset(&s);
+    const double fs = 48000.0, dt = 0.01;
+    double fill = start_ms * 1e-3 * fs, corr = 0.0;
+    for(double t = 0.0; t < secs; t += dt){
+        fill += fs * (1.0 + ppm * 1e-6) * dt;
+        fill -= fs * (1.0 + corr) * dt;
+        if(fill < 0.0) fill = 0.0;
+        corr = au_drift_update(&s, 1000.0 * fill / fs, dt);
+    }
+    *lat_ms = 1000.0 * fill / fs;
+    return corr;
+}
+
+static void test_controller(void){
+    double lat;
+    /* settles on the clock offset and holds latency at target */
+    CHECK_NEAR(simulate(150.0, 30.0, 1800.0, &lat) * 1e6, 150.0, 2.0);
+    CHECK_NEAR(lat, 30.0, 0.5);
+    CHECK_NEAR(simulate(-400.0, 30.0, 1800.0, &lat) * 1e6, -400.0, 2.0);
+    CHECK_NEAR(lat, 30.0, 0.5);
+    /* starting 40 ms over target, with no clock offset, it drains back */
+    CHECK_NEAR(simulate(0.0, 70.0, 1800.0, &lat) * 1e6, 0.0, 2.0);
+    CHECK_NEAR(lat, 30.0, 0.5);
+
+    /* the correction never exceeds +-2000 ppm, however large the error */
+    audiosink_t s;
+    memset(&s, 0, sizeof s);
+    s.target_ms = 30.0;
+    au_drift_reset(&s);
+    CHECK(s.lat_ms_avg < 0.0 && s.drift_corr == 0.0);
+    double c = 0.0;
+    for(int i = 0; i < 100000; i++) c = au_drift_update(&s, 5000.0, 0.01);
+    CHECK(c <= 2000e-6 + 1e-12 && c > 1999e-6);
+    for(int i = 0; i < 100000; i++) c = au_drift_update(&s, 0.0, 0.01);
+    CHECK(c >= -2000e-6 - 1e-12 && c < -1999e-6);
+    au_drift_reset(&s);
+    CHECK(s.drift_i == 0.0 && s.drift_corr == 0.0);
+}
+
+/* feed n frames of a sine, return frames out and the steady-state peak */
+static size_t run_sine(ph_dsp_resamp_f32_t *r, double fs_in, double f, size_t n, double *peak){
+    float *in = malloc(n * sizeof *in), *out = malloc(2 * n * sizeof *out);
+    for(size_t i = 0; i < n; i++) in[i] = (float)sin(2.0 * M_PI * f * (double)i / fs_in);
+    size_t got = 0;
+    for(size_t off = 0; off < n; off += 1000){
+        size_t k = n - off < 1000 ? n - off : 1000;
+        got += ph_dsp_resamp_f32_process(r, in + off, k, out + got, 2 * n - got);
+    }
+    *peak = 0.0;
+    for(size_t i = got / 2; i < got; i++) if(fabs(out[i]) > *peak) *peak = fabs(out[i]);
+    free(in); free(out);
+    return got;
+}
+
+static void test_resampler(void){
+    ph_dsp_resamp_f32_t r;
+    memset(&r, 0, sizeof r);
+    double peak;
+
+    CHECK(ph_dsp_resamp_f32_init(&r, 1, 48000.0, 44100.0, 32) == 0);
+    size_t got = run_sine(&r, 48000.0, 1000.0, 96000, &peak);
+    CHECK_NEAR((double)got, 96000.0 * 44100.0 / 48000.0, 20.0);
+    CHECK_NEAR(peak, 1.0, 0.01);                      /* passband gain */
+    ph_dsp_resamp_f32_free(&r);
+
+    /* a steered ratio changes throughput by the ppm asked for, bank untouched */
+    CHECK(ph_dsp_resamp_f32_init(&r, 1, 48000.0, 48000.0, 32) == 0);
+    const float *bank = r.bank;
+    ph_dsp_resamp_f32_set_ratio(&r, 1.0 / (1.0 + 1000e-6));
+    CHECK(r.bank == bank);
+    got = run_sine(&r, 48000.0, 1000.0, 480000, &peak);
+    CHECK_NEAR((double)got, 480000.0 / (1.0 + 1000e-6), 20.0);
+    CHECK_NEAR(peak, 1.0, 0.01);
+    CHECK(ph_dsp_resamp_f32_max_out(&r, 1000) >= 1000);
+    ph_dsp_resamp_f32_free(&r);
+}
+
+int main(void){
+    test_controller();
+    test_resampler();
+    return ph_test_done("test_drift");
+}
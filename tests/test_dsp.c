@@ -0,0 +1,75 @@
+#include "ph_dsp.h"
+#include "ph_stream.h"
+#include "ph_test.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/* ph_dsp_iq_to_cf32: each ring format widened to CF32 at full scale +-1.0.
+ * Endpoints and zero are exact in float, so they are compared exactly;
+ * every length up to a few vector widths checks the loop tails. */
+
+static void test_cu8(void){
+    /* zero sits at 127.5: 0 and 255 land symmetric, just inside +-1 */
+    uint8_t in[8] = { 0, 255, 127, 128, 64, 191, 1, 254 };
+    float out[8];
+    CHECK(ph_dsp_iq_to_cf32(PHIQ_FMT_CU8, in, out, 4) == 4);
+    CHECK(out[0] == -255.0f / 256.0f && out[1] == 255.0f / 256.0f);
+    CHECK(out[2] == -1.0f / 256.0f && out[3] == 1.0f / 256.0f);
+    CHECK(out[4] == -out[5]);
+    CHECK(out[6] == -out[7]);
+}
+
+static void test_cs8(void){
+    int8_t in[6] = { -128, 127, 0, -1, 64, -64 };
+    float out[6];
+    CHECK(ph_dsp_iq_to_cf32(PHIQ_FMT_CS8, in, out, 3) == 3);
+    CHECK(out[0] == -1.0f && out[1] == 127.0f / 128.0f);
+    CHECK(out[2] == 0.0f && out[3] == -1.0f / 128.0f);
+    CHECK(out[4] == 0.5f && out[5] == -0.5f);
+}
+
+static void test_cs16_cf32(void){
+    int16_t s16[4] = { -32768, 32767, 0, 16384 };
+    float out[4];
+    CHECK(ph_dsp_iq_to_cf32(PHIQ_FMT_CS16, s16, out, 2) == 2);
+    CHECK(out[0] == -1.0f && out[1] == 32767.0f / 32768.0f);
+    CHECK(out[2] == 0.0f && out[3] == 0.5f);
+
+    float f[4] = { 0.25f, -0.75f, 1.0f, -1.0f }, g[4];
+    CHECK(ph_dsp_iq_to_cf32(PHIQ_FMT_CF32, f, g, 2) == 2);
+    CHECK(memcmp(f, g, sizeof f) == 0);
+    CHECK(ph_dsp_iq_to_cf32(PHIQ_FMT_CF32, f, f, 2) == 2);   /* in place is a no-op */
+    CHECK(f[1] == -0.75f);
+}
+
+static void test_unknown_and_lengths(void){
+    uint8_t raw[2 * 67];
+    float out[2 * 67 + 2];
+    for(size_t i = 0; i < sizeof raw; i++) raw[i] = (uint8_t)(i * 37u + 11u);
+    CHECK(ph_dsp_iq_to_cf32(0, raw, out, 4) == 0);
+    CHECK(ph_dsp_iq_to_cf32(99, raw, out, 4) == 0);
+
+    int bad = 0;
+    for(size_t n = 0; n <= 67; n++){
+        out[2 * n] = out[2 * n + 1] = 12345.0f;           /* guard past the end */
+        CHECK(ph_dsp_iq_to_cf32(PHIQ_FMT_CU8, raw, out, n) == n);
+        for(size_t i = 0; i < 2 * n; i++) bad += out[i] != ((float)raw[i] - 127.5f) / 128.0f;
+        bad += out[2 * n] != 12345.0f || out[2 * n + 1] != 12345.0f;
+
+        out[2 * n] = out[2 * n + 1] = 12345.0f;
+        CHECK(ph_dsp_iq_to_cf32(PHIQ_FMT_CS8, raw, out, n) == n);
+        for(size_t i = 0; i < 2 * n; i++) bad += out[i] != (float)(int8_t)raw[i] / 128.0f;
+        bad += out[2 * n] != 12345.0f || out[2 * n + 1] != 12345.0f;
+    }
+    CHECK(bad == 0);
+}
+
+int main(void){
+    CHECK(phiq_fmt_bytes(PHIQ_FMT_CU8) == 2 && phiq_fmt_bytes(PHIQ_FMT_CS8) == 2);
+    test_cu8();
+    test_cs8();
+    test_cs16_cf32();
+    test_unknown_and_lengths();
+    return ph_test_done("test_dsp");
+}
@@ -0,0 +1,146 @@
+#define _GNU_SOURCE
+#include "common.h"
+#include "ph_test.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Pattern subscriptions in the feed table: "*" matches one segment, a
+ * trailing ">" one or more. Feeds created after a pattern are matched by the
+ * trie walk in feedtab_ensure; feeds that already exist by pat_match when the
+ * pattern is added. Both paths must agree. */
+
+static int has_sub(feedtab_t *t, const char *name, int fd){
+    int subs[64];
+    size_t n = feedtab_snapshot_subs(t, name, subs, 64);
+    for(size_t i = 0; i < n && i < 64; i++) if(subs[i] == fd) return 1;
+    return 0;
+}
+
+static void test_syntax(void){
+    CHECK(feedtab_is_pattern("a.*.c"));
+    CHECK(feedtab_is_pattern("a.>"));
+    CHECK(feedtab_is_pattern(">"));
+    CHECK(!feedtab_is_pattern("a.b.c"));
+    CHECK(!feedtab_is_pattern("a.b*"));               /* wildcards are whole segments */
+
+    feedtab_t t; feedtab_init(&t);
+    CHECK(feedtab_sub_pattern(&t, "a..b", 3, NULL) == -1);
+    CHECK(feedtab_sub_pattern(&t, "a.>.b", 3, NULL) == -1);   /* ">" only last */
+    CHECK(feedtab_sub_pattern(&t, ".a", 3, NULL) == -1);
+    CHECK(feedtab_sub_pattern(&t, "", 3, NULL) == -1);
+    CHECK(feedtab_sub_pattern(&t, "a.*", -1, NULL) == -1);
+    CHECK(feedtab_sub_pattern(&t, "a.*", 3, NULL) == 1);
+    CHECK(feedtab_sub_pattern(&t, "a.*", 3, NULL) == 0);      /* already held */
+    feedtab_free(&t);
+}
+
+static void test_existing_feeds(void){
+    feedtab_t t; feedtab_init(&t);
+    const char *feeds[] = { "radio", "radio.a.iq", "radio.b.iq", "radio.a.audio", "radio.a.iq.meta", "tv.a.iq" };
+    for(size_t i = 0; i < sizeof feeds / sizeof *feeds; i++) CHECK(feedtab_ensure(&t, feeds[i]) == (int)i);
+
+    intvec_t added; intvec_init(&added);
+    CHECK(feedtab_sub_pattern(&t, "radio.*.iq", 10, &added) == 1);
+    CHECK(added.n == 2);
+    CHECK(added.n == 2 && added.v[0] == 1 && added.v[1] == 2);
+    CHECK(has_sub(&t, "radio.a.iq", 10) && has_sub(&t, "radio.b.iq", 10));
+    CHECK(!has_sub(&t, "radio.a.audio", 10) && !has_sub(&t, "radio.a.iq.meta", 10));
+    CHECK(!has_sub(&t, "tv.a.iq", 10) && !has_sub(&t, "radio", 10));
+
+    added.n = 0;
+    CHECK(feedtab_sub_pattern(&t, "radio.>", 11, &added) == 1);
+    CHECK(added.n == 4);                              /* everything under radio, not radio */
+    CHECK(!has_sub(&t, "radio", 11) && has_sub(&t, "radio.a.iq.meta", 11));
+
+    CHECK(feedtab_pattern_matches(&t, "radio.z.iq"));
+    CHECK(feedtab_pattern_matches(&t, "radio.z"));
+    CHECK(!feedtab_pattern_matches(&t, "radio"));
+    CHECK(!feedtab_pattern_matches(&t, "tv.z.iq"));
+    intvec_free(&added);
+    feedtab_free(&t);
+}
+
+static void test_new_feeds_and_unsub(void){
+    feedtab_t t; feedtab_init(&t);
+    CHECK(feedtab_sub_pattern(&t, "radio.*.iq", 10, NULL) == 1);
+    CHECK(feedtab_sub_pattern(&t, "radio.>", 11, NULL) == 1);
+    CHECK(feedtab_sub_pattern(&t, "x.a", 12, NULL) == 1);     /* sibling exact segments */
+    CHECK(feedtab_sub_pattern(&t, "x.b", 13, NULL) == 1);
+    CHECK(feedtab_sub_pattern(&t, "*", 14, NULL) == 1);
+
+    feedtab_ensure(&t, "radio.c.iq");
+    feedtab_ensure(&t, "radio.c.iq.x");
+    feedtab_ensure(&t, "x.a");
+    feedtab_ensure(&t, "x.b");
+    feedtab_ensure(&t, "solo");
+    CHECK(has_sub(&t, "radio.c.iq", 10) && has_sub(&t, "radio.c.iq", 11));
+    CHECK(!has_sub(&t, "radio.c.iq.x", 10) && has_sub(&t, "radio.c.iq.x", 11));
+    CHECK(has_sub(&t, "x.a", 12) && !has_sub(&t, "x.a", 13));
+    CHECK(has_sub(&t, "x.b", 13) && !has_sub(&t, "x.b", 12));
+    CHECK(has_sub(&t, "solo", 14) && !has_sub(&t, "x.a", 14));
+
+    /* a name subscription outlives the pattern that also covered the feed */
+    CHECK(feedtab_sub(&t, "radio.c.iq", 10) == 0);
+    feedtab_ensure(&t, "radio.d.iq");
+    feedtab_unsub_pattern(&t, "radio.*.iq", 10);
+    CHECK(has_sub(&t, "radio.c.iq", 10));
+    CHECK(!has_sub(&t, "radio.d.iq", 10));
+    feedtab_ensure(&t, "radio.e.iq");
+    CHECK(!has_sub(&t, "radio.e.iq", 10));
+    CHECK(has_sub(&t, "radio.e.iq", 11));
+
+    /* disconnect drops the fd's patterns too */
+    feedtab_unsub_all_fd(&t, 11);
+    CHECK(!has_sub(&t, "radio.c.iq.x", 11));
+    feedtab_ensure(&t, "radio.f.iq");
+    CHECK(!has_sub(&t, "radio.f.iq", 11));
+    CHECK(t.n_patsubs == 3);                         /* x.a, x.b, * */
+    feedtab_free(&t);
+}
+
+/* random patterns and names: trie walk (pattern first) vs pat_match (feed first) */
+static void test_trie_agrees(void){
+    static const char *segs[] = { "a", "b", "c" };
+    char pats[40][32], names[120][32];
+    unsigned seed = 12345;
+    for(int i = 0; i < 40; i++){
+        int n = 1 + rand_r(&seed) % 4, o = 0;
+        for(int k = 0; k < n; k++){
+            int r = rand_r(&seed) % 5;
+            const char *s = r < 3 ? segs[r] : (r == 3 || k + 1 < n) ? "*" : ">";
+            o += snprintf(pats[i] + o, sizeof pats[i] - (size_t)o, "%s%s", k ? "." : "", s);
+        }
+    }
+    for(int i = 0; i < 120; i++){
+        int n = 1 + rand_r(&seed) % 4, o = 0;
+        for(int k = 0; k < n; k++)
+            o += snprintf(names[i] + o, sizeof names[i] - (size_t)o, "%s%s", k ? "." : "", segs[rand_r(&seed) % 3]);
+    }
+
+    feedtab_t before, after;
+    feedtab_init(&before); feedtab_init(&after);
+    for(int i = 0; i < 40; i++) feedtab_sub_pattern(&before, pats[i], 100 + i, NULL);
+    for(int i = 0; i < 120; i++){ feedtab_ensure(&before, names[i]); feedtab_ensure(&after, names[i]); }
+    for(int i = 0; i < 40; i++) feedtab_sub_pattern(&after, pats[i], 100 + i, NULL);
+
+    int diff = 0, hits = 0;
+    for(int i = 0; i < 120; i++)
+        for(int p = 0; p < 40; p++){
+            int b = has_sub(&before, names[i], 100 + p);
+            diff += b != has_sub(&after, names[i], 100 + p);
+            hits += b;
+        }
+    CHECK(diff == 0);
+    CHECK(hits > 100);                                /* the draw actually exercises matching */
+    feedtab_free(&before); feedtab_free(&after);
+}
+
+int main(void){
+    log_set_level(LOG_ERROR);
+    test_syntax();
+    test_existing_feeds();
+    test_new_feeds_and_unsub();
+    test_trie_agrees();
+    return ph_test_done("test_feedtab");
+}
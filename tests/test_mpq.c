@@ -0,0 +1,98 @@
+#define _GNU_SOURCE
+#include "ph_mpq.h"
+#include "ph_test.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* ph_mpq.h: capacity rounding, full/empty edges, FIFO order across
+ * wrap-around, then producers and consumers racing on a small queue. */
+
+#define NPROD  4
+#define NCONS  4
+#define PER    100000u
+
+static ph_mpq_t          g_q;
+static _Atomic unsigned  g_seen[NPROD][PER];
+static atomic_size_t     g_popped;
+static atomic_int        g_order_errs;
+
+/* item = producer in the top byte, sequence below; +1 keeps it non-NULL */
+static void *item(unsigned p, unsigned i){ return (void*)(uintptr_t)(((uintptr_t)p << 24 | i) + 1); }
+
+static void *producer(void *arg){
+    unsigned p = (unsigned)(uintptr_t)arg;
+    for(unsigned i = 0; i < PER; i++)
+        while(!ph_mpq_push(&g_q, item(p, i))) sched_yield();
+    return NULL;
+}
+
+static void *consumer(void *arg){
+    (void)arg;
+    long last[NPROD];
+    for(int p = 0; p < NPROD; p++) last[p] = -1;
+    while(atomic_load(&g_popped) < (size_t)NPROD * PER){
+        void *v = ph_mpq_pop(&g_q);
+        if(!v){ sched_yield(); continue; }
+        uintptr_t x = (uintptr_t)v - 1;
+        unsigned p = (unsigned)(x >> 24), i = (unsigned)(x & 0xffffffu);
+        if(p >= NPROD || i >= PER){ atomic_fetch_add(&g_order_errs, 1); continue; }
+        /* one producer's items occupy increasing slots, so any one consumer sees them in order */
+        if((long)i <= last[p]) atomic_fetch_add(&g_order_errs, 1);
+        last[p] = (long)i;
+        atomic_fetch_add(&g_seen[p][i], 1);
+        atomic_fetch_add(&g_popped, 1);
+    }
+    return NULL;
+}
+
+static void test_single_thread(void){
+    ph_mpq_t q;
+    CHECK(ph_mpq_init(&q, 5) == 0);
+    CHECK(q.mask == 7);                               /* rounded up to 8 */
+    CHECK(ph_mpq_pop(&q) == NULL);
+
+    for(unsigned i = 0; i < 8; i++) CHECK(ph_mpq_push(&q, item(0, i)));
+    CHECK(!ph_mpq_push(&q, item(0, 8)));              /* full */
+    CHECK(ph_mpq_depth(&q) == 8);
+    for(unsigned i = 0; i < 8; i++) CHECK(ph_mpq_pop(&q) == item(0, i));
+    CHECK(ph_mpq_pop(&q) == NULL);
+    CHECK(ph_mpq_depth(&q) == 0);
+
+    /* many laps around the ring, depth varying */
+    unsigned in = 0, out = 0;
+    for(unsigned round = 0; round < 1000; round++){
+        unsigned k = 1 + round % 8;
+        for(unsigned j = 0; j < k; j++) CHECK(ph_mpq_push(&q, item(1, in++)));
+        for(unsigned j = 0; j < k; j++) CHECK(ph_mpq_pop(&q) == item(1, out++));
+    }
+    CHECK(ph_mpq_pop(&q) == NULL);
+    ph_mpq_free(&q);
+    CHECK(q.cells == NULL);
+}
+
+static void test_mpmc(void){
+    CHECK(ph_mpq_init(&g_q, 64) == 0);
+    pthread_t pt[NPROD], ct[NCONS];
+    for(int i = 0; i < NCONS; i++) pthread_create(&ct[i], NULL, consumer, NULL);
+    for(int i = 0; i < NPROD; i++) pthread_create(&pt[i], NULL, producer, (void*)(uintptr_t)i);
+    for(int i = 0; i < NPROD; i++) pthread_join(pt[i], NULL);
+    for(int i = 0; i < NCONS; i++) pthread_join(ct[i], NULL);
+
+    CHECK(atomic_load(&g_order_errs) == 0);
+    CHECK(atomic_load(&g_popped) == (size_t)NPROD * PER);
+    unsigned bad = 0;
+    for(int p = 0; p < NPROD; p++)
+        for(unsigned i = 0; i < PER; i++) bad += atomic_load(&g_seen[p][i]) != 1;
+    CHECK(bad == 0);                                  /* each item exactly once */
+    CHECK(ph_mpq_pop(&g_q) == NULL);
+    ph_mpq_free(&g_q);
+}
+
+int main(void){
+    test_single_thread();
+    test_mpmc();
+    return ph_test_done("test_mpq");
+}
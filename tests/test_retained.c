@@ -0,0 +1,92 @@
+#define _GNU_SOURCE
+#include "common.h"
+#include "ph_test.h"
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/* Retained last values in the feed table: the broker keeps its own dups of
+ * the published descriptors, hands out fresh dups on replay, replaces the
+ * value on the next retained publish, and drops it when the owner leaves.
+ * Every one of those paths must leave no descriptor behind. */
+
+static int open_fds(void){
+    int n = 0;
+    DIR *d = opendir("/proc/self/fd");
+    if(!d) return -1;
+    for(struct dirent *e; (e = readdir(d)); ) n += e->d_name[0] != '.';
+    closedir(d);
+    return n - 1;   /* the DIR's own */
+}
+
+static int same_file(int a, int b){
+    struct stat sa, sb;
+    return fstat(a, &sa) == 0 && fstat(b, &sb) == 0 && sa.st_dev == sb.st_dev && sa.st_ino == sb.st_ino;
+}
+
+int main(void){
+    log_set_level(LOG_ERROR);
+    int base = open_fds();
+    int p[2];
+    CHECK(pipe(p) == 0);
+
+    feedtab_t t; feedtab_init(&t);
+    char *js; size_t len, nfds = 99; int got[16];
+    CHECK(feedtab_retained(&t, "x.info", &js, &len, got, &nfds) == -1);   /* unknown feed */
+    feedtab_ensure(&t, "x.info");
+    CHECK(feedtab_retained(&t, "x.info", &js, &len, got, &nfds) == -1);   /* nothing retained */
+
+    const char *v1 = "{\"type\":\"publish\",\"feed\":\"x.info\",\"n\":1}";
+    CHECK(feedtab_retain(&t, "x.info", 7, v1, strlen(v1), p, 2) == 0);
+    CHECK(t.n_retained == 1);
+    CHECK(open_fds() == base + 4);                    /* the pipe + the broker's dups */
+
+    CHECK(feedtab_retained(&t, "x.info", &js, &len, got, &nfds) == 0);
+    CHECK(len == strlen(v1) && strcmp(js, v1) == 0);
+    CHECK(nfds == 2);
+    CHECK(got[0] != p[0] && same_file(got[0], p[0]));
+    CHECK(got[1] != p[1] && same_file(got[1], p[1]));
+    free(js); close(got[0]); close(got[1]);
+
+    /* a new retained publish replaces the value and closes the old dups */
+    const char *v2 = "{\"type\":\"publish\",\"feed\":\"x.info\",\"n\":2}";
+    CHECK(feedtab_retain(&t, "x.info", 8, v2, strlen(v2), p, 1) == 0);
+    CHECK(t.n_retained == 1);
+    CHECK(open_fds() == base + 3);
+    CHECK(feedtab_retained(&t, "x.info", &js, &len, got, &nfds) == 0);
+    CHECK(strcmp(js, v2) == 0 && nfds == 1);
+    free(js); close(got[0]);
+
+    /* retain creates the feed if needed; values are per feed */
+    CHECK(feedtab_retain(&t, "y.info", 9, "{}", 2, NULL, 0) == 0);
+    CHECK(feedtab_find(&t, "y.info") >= 0);
+    CHECK(t.n_retained == 2);
+
+    /* only the owner's values go when it disconnects */
+    feedtab_drop_retained_fd(&t, 7);                  /* owned x.info before, not now */
+    CHECK(t.n_retained == 2);
+    feedtab_drop_retained_fd(&t, 8);
+    CHECK(t.n_retained == 1);
+    CHECK(feedtab_retained(&t, "x.info", &js, &len, got, &nfds) == -1);
+    CHECK(feedtab_retained(&t, "y.info", &js, &len, got, &nfds) == 0);
+    CHECK(nfds == 0 && len == 2);
+    free(js);
+    CHECK(open_fds() == base + 2);
+
+    /* more than 16 descriptors: the first 16 are kept */
+    int many[20];
+    for(int i = 0; i < 20; i++) many[i] = p[i & 1];
+    CHECK(feedtab_retain(&t, "z.info", 1, "{}", 2, many, 20) == 0);
+    CHECK(feedtab_retained(&t, "z.info", &js, &len, got, &nfds) == 0);
+    CHECK(nfds == 16);
+    free(js);
+    for(size_t k = 0; k < nfds && k < 16; k++) close(got[k]);
+
+    feedtab_free(&t);
+    close(p[0]); close(p[1]);
+    CHECK(open_fds() == base);
+    return ph_test_done("test_retained");
+}
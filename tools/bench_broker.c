@@ -0,0 +1,453 @@
+#define _GNU_SOURCE
+#include "ph_uds_protocol.h"
+#include "common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <poll.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/eventfd.h>
+#include <sys/wait.h>
+
+/* ph-bench-broker: drives ph-core over the real UDS protocol.
+ *
+ * M publisher threads publish on F feeds ("bench.<i>"), N subscriber threads
+ * subscribe round-robin. Every payload starts with the CLOCK_MONOTONIC send
+ * time, so a subscriber measures publish-to-deliver latency directly. With a
+ * fixed rate the intended send time is used, so a stalled broker shows up in
+ * the tail instead of silently slowing the publishers down. */
+
+#define BENCH_MAX_THREADS 1024
+
+typedef struct {
+    int      npub, nsub, nfeeds;
+    size_t   size;          /* payload bytes */
+    double   rate;          /* msgs/s per publisher, 0 = unthrottled */
+    double   secs;
+    double   fd_ratio;      /* fraction of publishes carrying a descriptor */
+    int      nslow;         /* subscribers that sleep after each frame */
+    int      slow_us;
+    bool     bin;           /* negotiated binary frames */
+    bool     spawn;
+    const char *core;
+    const char *core_args;
+    const char *core_log;
+} bench_cfg_t;
+
+typedef struct {
+    int       id;
+    int       fd;
+    uint32_t  feed_id;      /* binary mode */
+    uint64_t  sent, fds;
+    pthread_t th;
+} pub_t;
+
+typedef struct {
+    int       id;
+    int       fd;
+    bool      slow;
+    uint64_t  fds;
+    atomic_uint_fast64_t got;
+    uint32_t *lat;          /* ns, saturating */
+    size_t    nlat, caplat;
+    pthread_t th;
+} sub_t;
+
+static bench_cfg_t     g_cfg;
+static atomic_bool     g_go, g_pub_stop, g_sub_stop;
+static pub_t          *g_pubs;
+static sub_t          *g_subs;
+
+static uint64_t now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void sleep_until(uint64_t ns){
+    struct timespec ts = { (time_t)(ns / 1000000000ull), (long)(ns % 1000000000ull) };
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR){}
+}
+
+/* ---------- publishers ---------- */
+
+/* JSON data: "<ns>:<pub>:<seq>:" padded with 'x' to cfg.size */
+static size_t json_publish(char *out, size_t cap, int feed, uint64_t ns, int pub, uint64_t seq){
+    int n = snprintf(out, cap, "{\"type\":\"publish\",\"feed\":\"bench.%d\",\"data\":\"", feed);
+    if(n < 0 || (size_t)n >= cap) return 0;
+    size_t data = (size_t)n;
+    n = snprintf(out + data, cap - data, "%llu:%d:%llu:", (unsigned long long)ns, pub, (unsigned long long)seq);
+    if(n < 0 || (size_t)n >= cap - data) return 0;
+    size_t pos = data + (size_t)n;
+    while(pos < data + g_cfg.size && pos + 32 < cap) out[pos++] = 'x';
+    n = snprintf(out + pos, cap - pos, "\",\"encoding\":\"utf8\"}");
+    if(n < 0 || (size_t)n >= cap - pos) return 0;
+    return pos + (size_t)n;
+}
+
+static void *pub_main(void *arg){
+    pub_t *p = (pub_t*)arg;
+    int feed = p->id % g_cfg.nfeeds;
+    int efd  = g_cfg.fd_ratio > 0 ? eventfd(0, EFD_CLOEXEC) : -1;
+    char *buf = (char*)malloc(POC_MAX_JSON);
+    if(!buf) return NULL;
+    uint64_t period = g_cfg.rate > 0 ? (uint64_t)(1e9 / g_cfg.rate) : 0;
+    double   acc = 0;
+
+    while(!atomic_load(&g_go)) ph_msleep(1);
+    uint64_t next = now_ns();
+    for(uint64_t seq = 0; !atomic_load(&g_pub_stop); seq++){
+        uint64_t ts;
+        if(period){ sleep_until(next); ts = next; next += period; }
+        else ts = now_ns();
+
+        int fds[1]; size_t nfds = 0;
+        acc += g_cfg.fd_ratio;
+        if(acc >= 1.0 && efd >= 0){ acc -= 1.0; fds[0] = efd; nfds = 1; }
+
+        int rc;
+        if(g_cfg.bin){
+            size_t len = g_cfg.size < 16 ? 16 : g_cfg.size;
+            memset(buf, 'x', len);
+            memcpy(buf, &ts, 8);
+            uint32_t id = (uint32_t)p->id, s32 = (uint32_t)seq;
+            memcpy(buf + 8, &id, 4);
+            memcpy(buf + 12, &s32, 4);
+            ph_bin_hdr_t h = { PH_BIN_VERSION, PH_BIN_OP_PUBLISH, 0, p->feed_id };
+            rc = send_frame_bin(p->fd, &h, buf, len, fds, nfds);
+        } else {
+            size_t len = json_publish(buf, POC_MAX_JSON, feed, ts, p->id, seq);
+            rc = len ? send_frame_json_with_fds(p->fd, buf, len, fds, nfds) : -1;
+        }
+        if(rc < 0){
+            fprintf(stderr, "ph-bench-broker: publisher %d: send failed: %s\n", p->id, strerror(errno));
+            break;
+        }
+        p->sent++;
+        p->fds += nfds;
+    }
+    if(efd >= 0) close(efd);
+    free(buf);
+    return NULL;
+}
+
+/* ---------- subscribers ---------- */
+
+static void lat_push(sub_t *s, uint64_t ns){
+    if(s->nlat == s->caplat){
+        size_t nc = s->caplat ? s->caplat * 2 : 4096;
+        uint32_t *nl = (uint32_t*)realloc(s->lat, nc * sizeof *nl);
+        if(!nl) return;
+        s->lat = nl; s->caplat = nc;
+    }
+    s->lat[s->nlat++] = ns > UINT32_MAX ? UINT32_MAX : (uint32_t)ns;
+}
+
+static void *sub_main(void *arg){
+    sub_t *s = (sub_t*)arg;
+    char *buf = (char*)malloc(POC_MAX_JSON + 16);
+    if(!buf) return NULL;
+    while(!atomic_load(&g_sub_stop)){
+        int fds[16]; size_t nfds = 16; int is_bin = 0;
+        int n = recv_frame_any_with_fds(s->fd, buf, POC_MAX_JSON + 16, &is_bin, fds, &nfds, 100);
+        uint64_t t = now_ns();
+        if(n <= 0){
+            struct pollfd pfd = { .fd = s->fd, .events = 0 };
+            poll(&pfd, 1, 0);
+            if(pfd.revents & POLLHUP) break;
+            continue;
+        }
+        for(size_t k = 0; k < nfds; k++) close(fds[k]);
+        s->fds += nfds;
+
+        uint64_t ts = 0;
+        if(is_bin){
+            if((size_t)n < PH_BIN_HDR_LEN + 8) continue;
+            memcpy(&ts, buf + PH_BIN_HDR_LEN, 8);
+        } else {
+            const char *d = strstr(buf, "\"data\":\"");
+            if(!d) continue;              /* pong, acks */
+            ts = strtoull(d + 8, NULL, 10);
+        }
+        atomic_fetch_add(&s->got, 1);
+        if(ts && t >= ts) lat_push(s, t - ts);
+        if(s->slow) usleep((useconds_t)g_cfg.slow_us);
+    }
+    free(buf);
+    return NULL;
+}
+
+/* ---------- broker ---------- */
+
+static int send_json(int fd, const char *js){ return send_frame_json(fd, js, strlen(js)); }
+
+/* round trip a ping so everything sent before it has been handled */
+static int sync_ping(int fd){
+    if(send_json(fd, "{\"type\":\"ping\"}") < 0) return -1;
+    char buf[512];
+    for(int i = 0; i < 50; i++){
+        if(recv_frame_json(fd, buf, sizeof buf, 100) > 0 && strstr(buf, "\"pong\"")) return 0;
+    }
+    return -1;
+}
+
+static pid_t spawn_core(void){
+    char path[PATH_MAX];
+    if(!realpath(g_cfg.core, path)){
+        fprintf(stderr, "ph-bench-broker: %s: %s\n", g_cfg.core, strerror(errno));
+        return -1;
+    }
+    char  args[512];
+    char *argv[34]; int argc = 0;
+    argv[argc++] = path;
+    snprintf(args, sizeof args, "%s", g_cfg.core_args ? g_cfg.core_args : "");
+    for(char *sv = NULL, *t = strtok_r(args, " ", &sv); t && argc < 33; t = strtok_r(NULL, " ", &sv))
+        argv[argc++] = t;
+    argv[argc] = NULL;
+
+    pid_t pid = fork();
+    if(pid < 0) return -1;
+    if(pid == 0){
+        /* run from / so the broker autoloads no addons and measures routing alone */
+        int lf = open(g_cfg.core_log ? g_cfg.core_log : "/dev/null", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if(lf >= 0){ dup2(lf, 1); dup2(lf, 2); close(lf); }
+        if(chdir("/") != 0) _exit(127);
+        execv(path, argv);
+        _exit(127);
+    }
+    return pid;
+}
+
+/* sum of "dropped" and "coalesced" over the broker's clients listing */
+static void broker_drops(int fd, unsigned long long *dropped, unsigned long long *coalesced){
+    *dropped = *coalesced = 0;
+    if(send_json(fd, "{\"type\":\"command\",\"feed\":\"cli-control\",\"data\":\"clients\"}") < 0) return;
+    char *buf = (char*)malloc(POC_MAX_JSON);
+    if(!buf) return;
+    for(int i = 0; i < 20; i++){
+        if(recv_frame_json(fd, buf, POC_MAX_JSON, 100) <= 0 || !strstr(buf, "\"type\":\"clients\"")) continue;
+        for(const char *p = buf; (p = strstr(p, "\"dropped\":")); p += 10) *dropped += strtoull(p + 10, NULL, 10);
+        for(const char *p = buf; (p = strstr(p, "\"coalesced\":")); p += 12) *coalesced += strtoull(p + 12, NULL, 10);
+        break;
+    }
+    free(buf);
+}
+
+/* ---------- report ---------- */
+
+static int cmp_u32(const void *a, const void *b){
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+static double pct_us(const uint32_t *v, size_t n, double q){
+    if(!n) return 0;
+    size_t i = (size_t)(q * (double)(n - 1) + 0.5);
+    return v[i] / 1e3;
+}
+
+static void report(double elapsed, int ctl){
+    uint64_t sent = 0, pfds = 0;
+    uint64_t *per_feed = (uint64_t*)calloc((size_t)g_cfg.nfeeds, sizeof *per_feed);
+    for(int i = 0; i < g_cfg.npub; i++){
+        sent += g_pubs[i].sent; pfds += g_pubs[i].fds;
+        if(per_feed) per_feed[i % g_cfg.nfeeds] += g_pubs[i].sent;
+    }
+    uint64_t fast_got = 0, fast_exp = 0, slow_got = 0, slow_exp = 0, rfds = 0;
+    size_t nlat = 0;
+    for(int i = 0; i < g_cfg.nsub; i++){
+        sub_t *s = &g_subs[i];
+        uint64_t exp = per_feed ? per_feed[i % g_cfg.nfeeds] : 0;
+        uint64_t got = atomic_load(&s->got);
+        if(s->slow){ slow_got += got; slow_exp += exp; }
+        else { fast_got += got; fast_exp += exp; nlat += s->nlat; }
+        rfds += s->fds;
+    }
+    uint32_t *all = nlat ? (uint32_t*)malloc(nlat * sizeof *all) : NULL;
+    size_t k = 0;
+    if(all) for(int i = 0; i < g_cfg.nsub; i++){
+        if(g_subs[i].slow) continue;
+        memcpy(all + k, g_subs[i].lat, g_subs[i].nlat * sizeof *all);
+        k += g_subs[i].nlat;
+    }
+    if(all) qsort(all, k, sizeof *all, cmp_u32);
+
+    unsigned long long dropped, coalesced;
+    broker_drops(ctl, &dropped, &coalesced);
+
+    size_t frame = g_cfg.bin ? (g_cfg.size < 16 ? 16 : g_cfg.size) : g_cfg.size;
+    printf("ph-bench-broker: %d pub x %d sub, %d feed(s), %zu B %s, rate %s, fd ratio %.2f, %d slow (%d us)\n",
+           g_cfg.npub, g_cfg.nsub, g_cfg.nfeeds, frame, g_cfg.bin ? "binary" : "json",
+           g_cfg.rate > 0 ? "fixed" : "unthrottled", g_cfg.fd_ratio, g_cfg.nslow, g_cfg.slow_us);
+    if(g_cfg.rate > 0) printf("  rate        %.0f msg/s per publisher\n", g_cfg.rate);
+    printf("  published   %llu msgs in %.2f s  %.0f msg/s  %.1f MiB/s\n",
+           (unsigned long long)sent, elapsed, sent / elapsed, sent * (double)frame / elapsed / 1048576.0);
+    printf("  delivered   %llu / %llu  %.0f msg/s\n",
+           (unsigned long long)fast_got, (unsigned long long)fast_exp, fast_got / elapsed);
+    if(g_cfg.nslow)
+        printf("  slow subs   %llu / %llu delivered\n", (unsigned long long)slow_got, (unsigned long long)slow_exp);
+    printf("  broker      dropped %llu  coalesced %llu\n", dropped, coalesced);
+    if(g_cfg.fd_ratio > 0)
+        printf("  fds         passed %llu  received %llu\n", (unsigned long long)pfds, (unsigned long long)rfds);
+    if(k)
+        printf("  latency us  p50 %.1f  p99 %.1f  p999 %.1f  max %.1f\n",
+               pct_us(all, k, 0.50), pct_us(all, k, 0.99), pct_us(all, k, 0.999), all[k - 1] / 1e3);
+    free(all);
+    free(per_feed);
+}
+
+/* ---------- main ---------- */
+
+static void usage(void){
+    fprintf(stderr,
+        "ph-bench-broker usage:\n"
+        "  ph-bench-broker [options]\n"
+        "  -p, --pubs M         publisher connections (default 1)\n"
+        "  -s, --subs N         subscriber connections (default 4)\n"
+        "  -f, --feeds F        feeds, publishers and subscribers spread round-robin (default 1)\n"
+        "  -b, --size BYTES     payload size (default 64)\n"
+        "  -r, --rate R         msgs/s per publisher, 0 = as fast as possible (default 0)\n"
+        "  -d, --duration SEC   publish time (default 5)\n"
+        "  --fd-ratio X         fraction of publishes passing a descriptor, 0..1 (default 0)\n"
+        "  --slow K             K subscribers sleep after every frame (default 0)\n"
+        "  --slow-us US         per-frame delay of slow subscribers (default 1000)\n"
+        "  --bin                negotiated binary frames instead of JSON\n"
+        "  --core PATH          broker to spawn (default ./ph-core)\n"
+        "  --core-args \"ARGS\"   extra broker arguments, e.g. \"-j 4 --io epoll\"\n"
+        "  --core-log FILE      broker output (default /dev/null)\n"
+        "  --attach             use the broker already listening instead of spawning one\n");
+}
+
+static int arg_num(int argc, char **argv, int *i, double *out){
+    if(*i + 1 >= argc) return -1;
+    char *end;
+    *out = strtod(argv[++*i], &end);
+    return *end ? -1 : 0;
+}
+
+int main(int argc, char **argv){
+    g_cfg = (bench_cfg_t){ .npub = 1, .nsub = 4, .nfeeds = 1, .size = 64, .secs = 5,
+                           .slow_us = 1000, .spawn = true, .core = "./ph-core" };
+    for(int i = 1; i < argc; i++){
+        const char *a = argv[i];
+        double v = 0;
+        if(!strcmp(a,"-h") || !strcmp(a,"--help")){ usage(); return 0; }
+        else if(!strcmp(a,"--bin"))    g_cfg.bin = true;
+        else if(!strcmp(a,"--attach")) g_cfg.spawn = false;
+        else if(!strcmp(a,"--core") && i + 1 < argc)      g_cfg.core = argv[++i];
+        else if(!strcmp(a,"--core-args") && i + 1 < argc) g_cfg.core_args = argv[++i];
+        else if(!strcmp(a,"--core-log") && i + 1 < argc)  g_cfg.core_log = argv[++i];
+        else if(arg_num(argc, argv, &i, &v) < 0){ usage(); return 2; }
+        else if(!strcmp(a,"-p") || !strcmp(a,"--pubs"))     g_cfg.npub = (int)v;
+        else if(!strcmp(a,"-s") || !strcmp(a,"--subs"))     g_cfg.nsub = (int)v;
+        else if(!strcmp(a,"-f") || !strcmp(a,"--feeds"))    g_cfg.nfeeds = (int)v;
+        else if(!strcmp(a,"-b") || !strcmp(a,"--size"))     g_cfg.size = (size_t)v;
+        else if(!strcmp(a,"-r") || !strcmp(a,"--rate"))     g_cfg.rate = v;
+        else if(!strcmp(a,"-d") || !strcmp(a,"--duration")) g_cfg.secs = v;
+        else if(!strcmp(a,"--fd-ratio")) g_cfg.fd_ratio = v;
+        else if(!strcmp(a,"--slow"))     g_cfg.nslow = (int)v;
+        else if(!strcmp(a,"--slow-us"))  g_cfg.slow_us = (int)v;
+        else { usage(); return 2; }
+    }
+    size_t max_size = POC_MAX_JSON - 256;
+    if(g_cfg.npub < 1 || g_cfg.npub > BENCH_MAX_THREADS || g_cfg.nsub < 1 || g_cfg.nsub > BENCH_MAX_THREADS ||
+       g_cfg.nfeeds < 1 || g_cfg.size > max_size || g_cfg.secs <= 0 || g_cfg.rate < 0 ||
+       g_cfg.fd_ratio < 0 || g_cfg.fd_ratio > 1 || g_cfg.nslow < 0 || g_cfg.nslow > g_cfg.nsub ||
+       g_cfg.slow_us < 0){
+        fprintf(stderr, "ph-bench-broker: option out of range (at most %d pubs/subs, size <= %zu)\n",
+                BENCH_MAX_THREADS, max_size);
+        return 2;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    pid_t core = -1;
+    if(g_cfg.spawn){
+        int probe = uds_connect(PH_SOCK_PATH);
+        if(probe >= 0){
+            close(probe);
+            fprintf(stderr, "ph-bench-broker: a broker is already listening on %s; stop it or use --attach\n",
+                    PH_SOCK_PATH);
+            return 1;
+        }
+        if((core = spawn_core()) < 0) return 1;
+    }
+    int ctl = ph_connect_retry(PH_SOCK_PATH, 50, 100);
+    if(ctl < 0){
+        fprintf(stderr, "ph-bench-broker: cannot reach the broker on %s\n", PH_SOCK_PATH);
+        if(core > 0){ kill(core, SIGTERM); waitpid(core, NULL, 0); }
+        return 1;
+    }
+
+    g_pubs = (pub_t*)calloc((size_t)g_cfg.npub, sizeof *g_pubs);
+    g_subs = (sub_t*)calloc((size_t)g_cfg.nsub, sizeof *g_subs);
+    int rc = 1;
+    if(!g_pubs || !g_subs) goto out;
+
+    for(int i = 0; i < g_cfg.nsub; i++){
+        sub_t *s = &g_subs[i];
+        s->id = i;
+        s->slow = i >= g_cfg.nsub - g_cfg.nslow;
+        if((s->fd = uds_connect(PH_SOCK_PATH)) < 0){ perror("connect"); goto out; }
+        if(g_cfg.bin && ph_bin_hello(s->fd, 2000) < 0){
+            fprintf(stderr, "ph-bench-broker: broker refused binary frames\n");
+            goto out;
+        }
+        char js[128];
+        snprintf(js, sizeof js, "{\"type\":\"subscribe\",\"feed\":\"bench.%d\"}", i % g_cfg.nfeeds);
+        if(send_json(s->fd, js) < 0 || sync_ping(s->fd) < 0){
+            fprintf(stderr, "ph-bench-broker: subscriber %d: no answer from broker\n", i);
+            goto out;
+        }
+    }
+    for(int i = 0; i < g_cfg.npub; i++){
+        pub_t *p = &g_pubs[i];
+        p->id = i;
+        if((p->fd = uds_connect(PH_SOCK_PATH)) < 0){ perror("connect"); goto out; }
+        char feed[32];
+        snprintf(feed, sizeof feed, "bench.%d", i % g_cfg.nfeeds);
+        if(g_cfg.bin && (ph_bin_hello(p->fd, 2000) < 0 || ph_feed_id(p->fd, feed, &p->feed_id, 2000) < 0)){
+            fprintf(stderr, "ph-bench-broker: publisher %d: binary handshake failed\n", i);
+            goto out;
+        }
+    }
+
+    for(int i = 0; i < g_cfg.nsub; i++) pthread_create(&g_subs[i].th, NULL, sub_main, &g_subs[i]);
+    for(int i = 0; i < g_cfg.npub; i++) pthread_create(&g_pubs[i].th, NULL, pub_main, &g_pubs[i]);
+
+    uint64_t t0 = now_ns();
+    atomic_store(&g_go, true);
+    sleep_until(t0 + (uint64_t)(g_cfg.secs * 1e9));
+    atomic_store(&g_pub_stop, true);
+    for(int i = 0; i < g_cfg.npub; i++) pthread_join(g_pubs[i].th, NULL);
+    double elapsed = (now_ns() - t0) / 1e9;
+
+    /* let fast subscribers drain: stop once nothing arrived for 500 ms */
+    for(uint64_t last = UINT64_MAX;;){
+        uint64_t got = 0;
+        for(int i = 0; i < g_cfg.nsub; i++) if(!g_subs[i].slow) got += atomic_load(&g_subs[i].got);
+        if(got == last) break;
+        last = got;
+        ph_msleep(500);
+    }
+    atomic_store(&g_sub_stop, true);
+    for(int i = 0; i < g_cfg.nsub; i++) pthread_join(g_subs[i].th, NULL);
+
+    report(elapsed, ctl);
+    rc = 0;
+
+out:
+    if(g_subs) for(int i = 0; i < g_cfg.nsub; i++){ if(g_subs[i].fd > 0) close(g_subs[i].fd); free(g_subs[i].lat); }
+    if(g_pubs) for(int i = 0; i < g_cfg.npub; i++) if(g_pubs[i].fd > 0) close(g_pubs[i].fd);
+    free(g_subs); free(g_pubs);
+    close(ctl);
+    if(core > 0){ kill(core, SIGTERM); waitpid(core, NULL, 0); }
+    return rc;
+}
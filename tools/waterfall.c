@@ -336,18 +336,13 @@ static void *fft_thread(void *arg) {
 
         if (fmt==PHIQ_FMT_CF32) {
             src=(const float*)raw;
-        } else if (fmt==PHIQ_FMT_CS16) {
+        } else if (phiq_fmt_bytes(fmt)) {
             if (tmp_cap<nsamp*2) {
                 float *p=(float*)realloc(tmp_f,nsamp*2*sizeof(float));
                 if (!p) continue;
                 tmp_f=p; tmp_cap=nsamp*2;
             }
-            const int16_t *s=(const int16_t*)raw;
-            const float sc=1.0f/32768.0f;
-            for (size_t i=0;i<nsamp;i++) {
-                tmp_f[2*i+0]=(float)s[2*i+0]*sc;
-                tmp_f[2*i+1]=(float)s[2*i+1]*sc;
-            }
+            ph_dsp_iq_to_cf32(fmt, raw, tmp_f, nsamp);
             src=tmp_f;
         } else { continue; }
 
@@ -37,6 +37,7 @@ WFMD_BW=${WFMD_BW:-150000}
 DURATION=${DURATION:-auto}        # auto = estimate from file, 0 = run until Ctrl-C
 DRAIN_SEC=${DRAIN_SEC:-1}         # extra drain window after estimated replay duration
 PLAY_AUDIO=${PLAY_AUDIO:-1}       # set 0 to convert only, no audiosink playback
+FUSED=${FUSED:-0}                 # 1 = run filesource > wfmd as one core pipeline thread
 
 # An explicit output filename selects its obvious format unless OUT_FORMAT was
 # explicitly supplied. This avoids writing WAV data into a .phcap/.f32 path.
@@ -88,6 +89,7 @@ def raw_frame_bytes(t):
     t = t.lower()
     if t in ('iq-cf32','cf32'): return 8
     if t in ('iq-cs16','cs16'): return 4
+    if t in ('iq-cu8','cu8','iq-cs8','cs8'): return 2
     if t in ('audio-f32','pcm-f32','f32'): return 4
     if t in ('audio-s16','pcm-s16','s16'): return 2
     return 0
@@ -249,10 +251,14 @@ if [ -x ./ph-waterfall ]; then
   sleep 0.15   # give recv_thread time to connect and subscribe
 fi
 
+if [ "$FUSED" = "1" ]; then
+  ./ph-cli cmd "pipeline filesource wfmd"
+fi
+
 pub filesource.config.in "start"
 
 printf '\nWFMD replay:\n  IQ in:  %s (%s)\n  Audio:  %s (%s)\n' "$IQ_IN" "$IN_FORMAT" "$OUT" "$OUT_FORMAT"
-printf 'PLAY_AUDIO=%s. THROTTLE=%s. DURATION=%s seconds (0 means manual Ctrl-C).\n\n' "$PLAY_AUDIO" "$THROTTLE" "$DURATION"
+printf 'PLAY_AUDIO=%s. THROTTLE=%s. FUSED=%s. DURATION=%s seconds (0 means manual Ctrl-C).\n\n' "$PLAY_AUDIO" "$THROTTLE" "$FUSED" "$DURATION"
 
 if [ "$DURATION" != "0" ]; then
   sleep "$DURATION"